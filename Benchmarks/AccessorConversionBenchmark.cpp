@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "TinyGltfTools.h"
+
+// Measures the bulk accessor converters in tinygltf::tools against per element iteration, on interleaved, strided and sparse accessors like those found in typical glTF files.
+// Each case checks that both paths produce identical output.
+// Usage: AccessorConversionBenchmark [vertex count] [iterations]
+
+template<typename F>
+static double MeasureBestSeconds(int iterations, F function)
+{
+	double best = std::numeric_limits<double>::max();
+	for (int i = 0; i < iterations; i++) {
+		auto start = std::chrono::steady_clock::now();
+		function();
+		auto end = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double>(end - start).count());
+	}
+	return best;
+}
+
+static int AddBufferView(tinygltf::Model* model, size_t offset, size_t length, int stride)
+{
+	tinygltf::BufferView buffer_view;
+	buffer_view.buffer = 0;
+	buffer_view.byteOffset = offset;
+	buffer_view.byteLength = length;
+	buffer_view.byteStride = stride;
+	model->bufferViews.push_back(buffer_view);
+	return (int)model->bufferViews.size() - 1;
+}
+
+static int AddAccessor(tinygltf::Model* model, int buffer_view, size_t offset, size_t count, int component_type, int type, bool normalized)
+{
+	tinygltf::Accessor accessor;
+	accessor.bufferView = buffer_view;
+	accessor.byteOffset = offset;
+	accessor.count = count;
+	accessor.componentType = component_type;
+	accessor.type = type;
+	accessor.normalized = normalized;
+	model->accessors.push_back(accessor);
+	return (int)model->accessors.size() - 1;
+}
+
+// Converts an accessor with both paths into elements that are output_stride bytes apart.
+template<glm::length_t L, typename T, bool NORMALIZE = false>
+static bool RunCase(const char* name, tinygltf::Model* model, int accessor_id, size_t output_stride, int iterations)
+{
+	tinygltf::Accessor* accessor = &model->accessors[accessor_id];
+	std::vector<std::byte> reference(accessor->count * output_stride);
+	std::vector<std::byte> bulk(accessor->count * output_stride);
+	double reference_seconds = MeasureBestSeconds(iterations, [&]() {
+		tinygltf::tools::Iterate<L, T, NORMALIZE>(model, accessor, [&](int i, const glm::vec<L, T>& value) {
+			std::memcpy(&reference[i * output_stride], &value, sizeof(value));
+		});
+	});
+	double bulk_seconds = MeasureBestSeconds(iterations, [&]() {
+		tinygltf::tools::Copy<L, T, NORMALIZE>((glm::vec<L, T>*)bulk.data(), output_stride, model, accessor);
+	});
+	bool match = reference == bulk;
+
+	// Throughput is measured in accessor bytes.
+	const double MB = 1024.0 * 1024.0;
+	size_t bytes = accessor->count * tinygltf::tools::GetTypeSize(accessor);
+	printf("%-32s %10.2f MB/s %10.2f MB/s %6.2fx %s\n", name, bytes / reference_seconds / MB, bytes / bulk_seconds / MB, reference_seconds / bulk_seconds, match ? "" : "MISMATCH");
+	return match;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t vertex_count = argc > 1 ? std::atoi(argv[1]) : 1 << 20;
+	int iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+
+	// Interleaved vertices as exported by most tools, followed by separate attribute streams.
+	struct Vertex {
+		float position[3];
+		float normal[3];
+		float texcoord[2];
+		uint8_t color[4];
+		uint8_t joints[4];
+		uint16_t weights[4];
+	};
+	struct JointWeight {
+		glm::u16vec4 joints;
+		glm::u16vec4 weights;
+	};
+	size_t vertices_offset = 0;
+	size_t colors_offset = vertices_offset + vertex_count * sizeof(Vertex);
+	size_t joints_offset = colors_offset + vertex_count * sizeof(float) * 3;
+	size_t weights_offset = joints_offset + vertex_count * sizeof(uint16_t) * 4;
+	size_t indices_offset = weights_offset + vertex_count * sizeof(uint8_t) * 4;
+	size_t sparse_indices_offset = indices_offset + vertex_count * sizeof(uint8_t);
+	size_t sparse_count = vertex_count / 8;
+	size_t size = sparse_indices_offset + sparse_count * sizeof(uint32_t);
+
+	tinygltf::Model model;
+	model.buffers.emplace_back().data.resize(size);
+	unsigned char* data = model.buffers[0].data.data();
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+	for (size_t i = 0; i < vertex_count; i++) {
+		Vertex vertex = {};
+		for (int j = 0; j < 3; j++) {
+			vertex.position[j] = distribution(random) * 100.0f;
+			vertex.normal[j] = distribution(random) * 2.0f - 1.0f;
+		}
+		for (int j = 0; j < 2; j++) {
+			vertex.texcoord[j] = distribution(random);
+		}
+		for (int j = 0; j < 4; j++) {
+			vertex.color[j] = (uint8_t)(random() & 0xff);
+			vertex.joints[j] = (uint8_t)(random() & 0x3f);
+			vertex.weights[j] = (uint16_t)(random() & 0xffff);
+		}
+		std::memcpy(data + vertices_offset + i * sizeof(Vertex), &vertex, sizeof(Vertex));
+		for (int j = 0; j < 3; j++) {
+			float color = distribution(random);
+			std::memcpy(data + colors_offset + (i * 3 + j) * sizeof(float), &color, sizeof(float));
+		}
+		for (int j = 0; j < 4; j++) {
+			uint16_t joint = (uint16_t)(random() & 0x3ff);
+			std::memcpy(data + joints_offset + (i * 4 + j) * sizeof(uint16_t), &joint, sizeof(uint16_t));
+			data[weights_offset + i * 4 + j] = (uint8_t)(random() & 0xff);
+		}
+		data[indices_offset + i] = (uint8_t)(random() & 0xff);
+	}
+	// Every 8th vertex is displaced, which is typical for a facial expression morph target.
+	for (size_t i = 0; i < sparse_count; i++) {
+		uint32_t index = (uint32_t)(i * 8);
+		std::memcpy(data + sparse_indices_offset + i * sizeof(uint32_t), &index, sizeof(uint32_t));
+	}
+
+	int vertices_view = AddBufferView(&model, vertices_offset, vertex_count * sizeof(Vertex), sizeof(Vertex));
+	int colors_view = AddBufferView(&model, colors_offset, vertex_count * sizeof(float) * 3, 0);
+	int joints_view = AddBufferView(&model, joints_offset, vertex_count * sizeof(uint16_t) * 4, 0);
+	int weights_view = AddBufferView(&model, weights_offset, vertex_count * sizeof(uint8_t) * 4, 0);
+	int indices_view = AddBufferView(&model, indices_offset, vertex_count * sizeof(uint8_t), 0);
+	int sparse_indices_view = AddBufferView(&model, sparse_indices_offset, sparse_count * sizeof(uint32_t), 0);
+
+	int positions = AddAccessor(&model, vertices_view, offsetof(Vertex, position), vertex_count, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, false);
+	int texcoords = AddAccessor(&model, vertices_view, offsetof(Vertex, texcoord), vertex_count, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC2, false);
+	int interleaved_colors = AddAccessor(&model, vertices_view, offsetof(Vertex, color), vertex_count, TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, TINYGLTF_TYPE_VEC4, true);
+	int interleaved_joints = AddAccessor(&model, vertices_view, offsetof(Vertex, joints), vertex_count, TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, TINYGLTF_TYPE_VEC4, false);
+	int interleaved_weights = AddAccessor(&model, vertices_view, offsetof(Vertex, weights), vertex_count, TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_VEC4, true);
+	int colors = AddAccessor(&model, colors_view, 0, vertex_count, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, false);
+	int joints = AddAccessor(&model, joints_view, 0, vertex_count, TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_VEC4, false);
+	int weights = AddAccessor(&model, weights_view, 0, vertex_count, TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, TINYGLTF_TYPE_VEC4, true);
+	int indices = AddAccessor(&model, indices_view, 0, vertex_count, TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, TINYGLTF_TYPE_SCALAR, false);
+	int morph_target = AddAccessor(&model, -1, 0, vertex_count, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, false);
+	int sparse_positions = AddAccessor(&model, vertices_view, offsetof(Vertex, position), vertex_count, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, false);
+	for (int accessor_id: {morph_target, sparse_positions}) {
+		tinygltf::Accessor& accessor = model.accessors[accessor_id];
+		accessor.sparse.isSparse = true;
+		accessor.sparse.count = (int)sparse_count;
+		accessor.sparse.indices.bufferView = sparse_indices_view;
+		accessor.sparse.indices.componentType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT;
+		accessor.sparse.values.bufferView = colors_view;
+	}
+
+	printf("%zu vertices, best of %d iterations.\n", vertex_count, iterations);
+	printf("%-32s %15s %15s %7s\n", "", "Iterate", "Copy", "Speedup");
+	bool match = true;
+	match &= RunCase<3, float>("Interleaved float3 positions", &model, positions, sizeof(glm::vec3), iterations);
+	match &= RunCase<2, float>("Interleaved float2 texcoords", &model, texcoords, sizeof(glm::vec2), iterations);
+	match &= RunCase<4, uint16_t, true>("Interleaved unorm8 colors", &model, interleaved_colors, sizeof(glm::u16vec4), iterations);
+	match &= RunCase<4, uint16_t>("Interleaved uint8 joints", &model, interleaved_joints, sizeof(JointWeight), iterations);
+	match &= RunCase<4, uint16_t, true>("Interleaved unorm16 weights", &model, interleaved_weights, sizeof(JointWeight), iterations);
+	match &= RunCase<4, uint16_t, true>("Float3 colors", &model, colors, sizeof(glm::u16vec4), iterations);
+	match &= RunCase<3, float>("Float3 contiguous", &model, colors, sizeof(glm::vec3), iterations);
+	match &= RunCase<4, uint16_t>("Uint16 joints", &model, joints, sizeof(JointWeight), iterations);
+	match &= RunCase<4, uint16_t, true>("Unorm8 weights", &model, weights, sizeof(JointWeight), iterations);
+	match &= RunCase<1, uint16_t>("Uint8 indices", &model, indices, sizeof(glm::u16vec1), iterations);
+	match &= RunCase<3, float>("Sparse morph target", &model, morph_target, sizeof(glm::vec3), iterations);
+	match &= RunCase<3, float>("Sparse interleaved positions", &model, sparse_positions, sizeof(glm::vec3), iterations);
+
+	if (!match) {
+		printf("Bulk conversion does not match iteration.\n");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "Animation.h"
+
+// Measures the cost of sampling every channel of an animation once per frame, over clips of increasing length.
+// Compares the linear keyframe search Animation::Channel used to do, a binary search, and keyframe cursors.
+// Playback runs forward at 60 frames per second from the middle of the clip, where a linear search has half the keys to look through.
+// Checks that all three give the same samples.
+// Usage: AnimationSamplingBenchmark [channel count] [frames]
+
+static constexpr float KEYFRAME_RATE = 30.0f;
+static constexpr float FRAME_RATE = 60.0f;
+
+// The search GetTransform used before cursors.
+static int LinearStartKeyframe(const Animation::Channel& channel, float time)
+{
+	time = glm::clamp(time, channel.times[0], channel.times.back());
+	int result = 0;
+	for (int i = 1; i < channel.times.size() && channel.times[i] <= time; i++) {
+		result = i;
+	}
+	return result;
+}
+
+// Alternates translation and rotation channels, with a random value at every keyframe.
+static Animation CreateAnimation(int channel_count, int keyframe_count, std::mt19937* random)
+{
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	Animation animation;
+	animation.length = (keyframe_count - 1) / KEYFRAME_RATE;
+	animation.channels.resize(channel_count);
+	for (int i = 0; i < channel_count; i++) {
+		Animation::Channel& channel = animation.channels[i];
+		channel.node_id = i;
+		channel.format = Animation::Channel::FORMAT_FLOAT;
+		channel.path = i % 2 == 0 ? Animation::Channel::PATH_TRANSLATION : Animation::Channel::PATH_ROTATION;
+		channel.width = channel.path == Animation::Channel::PATH_ROTATION ? 4 : 3;
+		channel.times.resize(keyframe_count);
+		std::vector<float> values(keyframe_count * channel.width);
+		for (int j = 0; j < keyframe_count; j++) {
+			channel.times[j] = j / KEYFRAME_RATE;
+			if (channel.path == Animation::Channel::PATH_ROTATION) {
+				glm::quat rotation = glm::normalize(glm::quat(distribution(*random), distribution(*random), distribution(*random), distribution(*random)));
+				memcpy(&values[j * 4], &rotation.x, sizeof(float) * 4);
+			} else {
+				for (int k = 0; k < 3; k++) {
+					values[j * 3 + k] = distribution(*random);
+				}
+			}
+		}
+		channel.transforms.resize(values.size() * sizeof(float));
+		memcpy(channel.transforms.data(), values.data(), channel.transforms.size());
+	}
+	return animation;
+}
+
+// Samples every channel for each frame and returns the average seconds per frame. Each channel writes four floats per frame to samples.
+template<typename F>
+static double MeasureSecondsPerFrame(Animation* animation, int frames, std::vector<float>* samples, F sample)
+{
+	samples->assign(animation->channels.size() * frames * 4, 0.0f);
+	float start_time = animation->length * 0.5f;
+	auto start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < frames; frame++) {
+		float time = start_time + frame / FRAME_RATE;
+		for (int i = 0; i < animation->channels.size(); i++) {
+			sample(i, time, &(*samples)[(frame * animation->channels.size() + i) * 4]);
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(end - start).count() / frames;
+}
+
+int main(int argc, char* argv[])
+{
+	int channel_count = argc > 1 ? std::atoi(argv[1]) : 200;
+	int frames = argc > 2 ? std::atoi(argv[2]) : 300;
+	const int keyframe_counts[] = {100, 1000, 10000, 100000};
+
+	printf("%d channels, %d frames, keyframes every %.0f ms.\n", channel_count, frames, 1000.0f / KEYFRAME_RATE);
+	printf("%10s %16s %16s %16s\n", "Keyframes", "Linear ms/frame", "Binary ms/frame", "Cursor ms/frame");
+	std::mt19937 random(1234);
+	bool match = true;
+	for (int keyframe_count: keyframe_counts) {
+		Animation animation = CreateAnimation(channel_count, keyframe_count, &random);
+
+		// The linear search's keyframe is passed in as a cursor, which GetTransform accepts without searching again.
+		std::vector<float> linear_samples;
+		double linear_seconds = MeasureSecondsPerFrame(&animation, frames, &linear_samples, [&](int i, float time, float* out) {
+			int cursor = LinearStartKeyframe(animation.channels[i], time);
+			animation.channels[i].GetTransform(time, out, &cursor);
+		});
+		std::vector<float> binary_samples;
+		double binary_seconds = MeasureSecondsPerFrame(&animation, frames, &binary_samples, [&](int i, float time, float* out) {
+			animation.channels[i].GetTransform(time, out);
+		});
+		std::vector<int> cursors(channel_count, 0);
+		std::vector<float> cursor_samples;
+		double cursor_seconds = MeasureSecondsPerFrame(&animation, frames, &cursor_samples, [&](int i, float time, float* out) {
+			animation.channels[i].GetTransform(time, out, &cursors[i]);
+		});
+
+		match &= linear_samples == binary_samples && linear_samples == cursor_samples;
+		printf("%10d %16.4f %16.4f %16.4f\n", keyframe_count, linear_seconds * 1000.0, binary_seconds * 1000.0, cursor_seconds * 1000.0);
+	}
+
+	if (!match) {
+		printf("Samples do not match between searches.\n");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,503 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <tinygltf/json.hpp>
+
+#include "Config.h"
+#include "GltfImport.h"
+#include "Memory.h"
+#include "MipGeneration.h"
+#include "TextureCompression.h"
+#include "ThreadPool.h"
+
+// Runs the CPU side of loading on every .gltf and .glb file in a directory, without a window or a GPU.
+// Each phase is timed separately, along with the heap allocations it makes, and the results are written as JSON and CSV.
+// Takes the same loading options as the renderer, such as --fast-texture-compression or --disable-mesh-optimization.
+// Usage: LoaderBenchmark <corpus directory> [--output=path without extension] [--iterations=count] [loading options]
+
+// Heap usage is counted by replacing the global operator new and delete.
+// Memory allocated with malloc, such as images decoded by stb_image, only shows up in the peak resident set size.
+static std::atomic<uint64_t> allocation_count = 0;
+static std::atomic<uint64_t> allocated_bytes = 0;
+static std::atomic<uint64_t> live_bytes = 0;
+static std::atomic<uint64_t> peak_live_bytes = 0;
+
+// Each allocation starts with its size so that delete can subtract it. 16 bytes keeps the alignment malloc provides.
+static constexpr size_t ALLOCATION_HEADER_SIZE = 16;
+
+void* operator new(size_t size)
+{
+	void* block = malloc(size + ALLOCATION_HEADER_SIZE);
+	if (!block) {
+		throw std::bad_alloc();
+	}
+	*(size_t*)block = size;
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+	uint64_t live = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+	uint64_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+	while (live > peak && !peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+	}
+	return (std::byte*)block + ALLOCATION_HEADER_SIZE;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	if (!ptr) {
+		return;
+	}
+	std::byte* block = (std::byte*)ptr - ALLOCATION_HEADER_SIZE;
+	live_bytes.fetch_sub(*(size_t*)block, std::memory_order_relaxed);
+	free(block);
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	operator delete(ptr);
+}
+
+void operator delete(void* ptr, size_t size) noexcept
+{
+	operator delete(ptr);
+}
+
+void operator delete[](void* ptr, size_t size) noexcept
+{
+	operator delete(ptr);
+}
+
+enum Phase {
+	PHASE_PARSE, // Includes decoding EXT_meshopt_compression buffer views.
+	PHASE_IMAGE_DECODE,
+	PHASE_MATERIALS,
+	PHASE_TEXTURE_PROCESSING, // Mip generation and block compression, without the texture cache.
+	PHASE_ACCESSOR_CONVERSION, // Includes tangent space encoding, which ConvertPrimitive does as it reads the accessors.
+	PHASE_MESH_PROCESSING, // Optimization, meshlets, levels of detail, quantization and morph target compaction.
+	PHASE_UPLOAD,
+	PHASE_COUNT,
+};
+
+static const char* const phase_names[PHASE_COUNT] = {
+	"parse",
+	"image_decode",
+	"materials",
+	"texture_processing",
+	"accessor_conversion",
+	"mesh_processing",
+	"upload",
+};
+
+struct PhaseResult {
+	double seconds = 0.0;
+	uint64_t allocations = 0;
+	uint64_t allocated_bytes = 0;
+	uint64_t peak_heap_bytes = 0; // Most heap memory in use at once, including memory from earlier phases that is still alive.
+};
+
+struct FileResult {
+	std::string file;
+	bool valid = false;
+	uint64_t file_size = 0;
+	uint64_t num_of_primitives = 0;
+	uint64_t num_of_vertices = 0;
+	uint64_t num_of_images = 0;
+	uint64_t num_of_materials = 0;
+	uint64_t upload_bytes = 0;
+	uint64_t peak_rss_bytes = 0; // Peak resident set size of the whole process, so it includes every file loaded before this one.
+	PhaseResult phases[PHASE_COUNT];
+};
+
+// Stands in for UploadBuffer, which needs a device. Writes wrap around a ring like they do in the upload buffer, so the cost of the copies is measured without memory growing with the scene.
+struct UploadSink {
+	std::vector<std::byte> ring;
+	uint64_t offset = 0;
+	uint64_t bytes_written = 0;
+
+	void Write(const void* data, uint64_t size)
+	{
+		const std::byte* bytes = (const std::byte*)data;
+		this->bytes_written += size;
+		while (size > 0) {
+			uint64_t chunk = std::min<uint64_t>(size, this->ring.size() - this->offset);
+			memcpy(this->ring.data() + this->offset, bytes, chunk);
+			this->offset = (this->offset + chunk) % this->ring.size();
+			bytes += chunk;
+			size -= chunk;
+		}
+	}
+
+	template<typename T>
+	void Write(const std::vector<T>& data)
+	{
+		Write(data.data(), data.size() * sizeof(T));
+	}
+};
+
+// Adds the time and allocations of a function to a phase. Phases that run once per batch accumulate over every batch.
+template<typename F>
+static void MeasurePhase(PhaseResult* result, F function)
+{
+	uint64_t start_allocations = allocation_count.load();
+	uint64_t start_bytes = allocated_bytes.load();
+	peak_live_bytes.store(live_bytes.load());
+	auto start = std::chrono::steady_clock::now();
+	function();
+	auto end = std::chrono::steady_clock::now();
+	result->seconds += std::chrono::duration<double>(end - start).count();
+	result->allocations += allocation_count.load() - start_allocations;
+	result->allocated_bytes += allocated_bytes.load() - start_bytes;
+	result->peak_heap_bytes = std::max(result->peak_heap_bytes, peak_live_bytes.load());
+}
+
+static void UploadPrimitive(UploadSink* sink, const GltfImport::PrimitiveData* data)
+{
+	sink->Write(data->indices);
+	sink->Write(data->positions);
+	sink->Write(data->quantized_positions);
+	sink->Write(data->tangent_space);
+	for (int i = 0; i < GltfImport::MAX_TEXCOORDS; i++) {
+		sink->Write(data->texcoords[i]);
+		sink->Write(data->quantized_texcoords[i]);
+	}
+	sink->Write(data->colors);
+	sink->Write(data->quantized_colors);
+	sink->Write(data->joint_weights);
+	sink->Write(data->morph.delta_offsets);
+	sink->Write(data->morph.targets);
+	sink->Write(data->morph.positions);
+	sink->Write(data->morph.normals);
+	sink->Write(data->morph.tangents);
+	sink->Write(data->meshlets.meshlets);
+	sink->Write(data->meshlets.bounds);
+	sink->Write(data->meshlets.vertices);
+	sink->Write(data->meshlets.triangles);
+	sink->Write(data->lod_indices);
+}
+
+// Loads a file the same way Gltf::LoadFromGltf does, except that nothing is kept once the phases have run.
+static bool LoadFile(const std::filesystem::path& path, ThreadPool* thread_pool, UploadSink* sink, FileResult* result)
+{
+	tinygltf::Model model;
+	GltfImport::MappedGlb mapped_glb;
+	std::vector<std::vector<unsigned char>> encoded_images;
+	bool parsed = false;
+	MeasurePhase(&result->phases[PHASE_PARSE], [&]() {
+		parsed = GltfImport::ParseGltf(path.string().c_str(), !Config::disable_memory_mapping, &model, &mapped_glb, &encoded_images, thread_pool);
+	});
+	if (!parsed) {
+		return false;
+	}
+
+	MeasurePhase(&result->phases[PHASE_IMAGE_DECODE], [&]() {
+		thread_pool->ParallelFor(model.images.size(), [&](int i) {
+			size_t size = 0;
+			const unsigned char* bytes = GltfImport::GetEncodedImage(&model, &encoded_images, i, &size);
+			if (bytes) {
+				GltfImport::DecodeImage(&model, i, bytes, size);
+			}
+		});
+		encoded_images.clear();
+	});
+
+	std::vector<GltfImport::Material> materials;
+	std::vector<GltfImport::ImageUsage> images(model.images.size());
+	MeasurePhase(&result->phases[PHASE_MATERIALS], [&]() {
+		GltfImport::ConvertMaterials(&model, &materials, &images);
+	});
+
+	MeasurePhase(&result->phases[PHASE_TEXTURE_PROCESSING], [&]() {
+		thread_pool->ParallelFor(model.images.size(), [&](int i) {
+			tinygltf::Image* image = &model.images[i];
+			if (images[i].format == DXGI_FORMAT_UNKNOWN || image->image.size() != (uint64_t)image->width * image->height * 4) {
+				return;
+			}
+			bool srgb = images[i].format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+			TextureEncoding encoding = {.format = images[i].format};
+			if (!Config::disable_texture_compression) {
+				encoding = ChooseTextureEncoding(image->image.data(), image->width, image->height, images[i].channels, srgb, Config::fast_texture_compression);
+			}
+			GenerateMipChain(&image->image, image->width, image->height, srgb, images[i].alpha_cutoff);
+			if (IsBlockCompressed(encoding.format)) {
+				std::vector<unsigned char> compressed;
+				CompressMipChain(encoding, image->image.data(), image->width, image->height, &compressed, thread_pool);
+				image->image = std::move(compressed);
+			}
+		});
+	});
+
+	MeasurePhase(&result->phases[PHASE_UPLOAD], [&]() {
+		for (const tinygltf::Image& image: model.images) {
+			sink->Write(image.image);
+		}
+	});
+
+	// Primitives are converted in batches that are bounded by MESH_STAGING_CAPACITY, as in Gltf::ConvertMeshes, so the peak heap usage matches the renderer.
+	std::vector<const tinygltf::Primitive*> gltf_primitives;
+	for (const tinygltf::Mesh& mesh: model.meshes) {
+		for (const tinygltf::Primitive& primitive: mesh.primitives) {
+			gltf_primitives.push_back(&primitive);
+		}
+	}
+	// Primitives with identical data are only converted once. Hashing reads every accessor, so it counts as conversion.
+	std::vector<int> sources(gltf_primitives.size());
+	MeasurePhase(&result->phases[PHASE_ACCESSOR_CONVERSION], [&]() {
+		std::vector<uint64_t> hashes(gltf_primitives.size());
+		thread_pool->ParallelFor(hashes.size(), [&](int i) {
+			hashes[i] = GltfImport::HashPrimitive(&model, gltf_primitives[i]);
+		});
+		std::unordered_map<uint64_t, int> first_primitives;
+		for (int i = 0; i < hashes.size(); i++) {
+			sources[i] = first_primitives.try_emplace(hashes[i], i).first->second;
+		}
+	});
+
+	struct ConversionTask {
+		int primitive;
+		int target; // -1 for the primitive itself.
+	};
+	std::vector<GltfImport::PrimitiveData> batch;
+	std::vector<ConversionTask> tasks;
+	int batch_start = 0;
+	while (batch_start < gltf_primitives.size()) {
+		int batch_end = batch_start;
+		uint64_t staging_size = 0;
+		while (batch_end < gltf_primitives.size() && (batch_end == batch_start || staging_size < Config::MESH_STAGING_CAPACITY)) {
+			if (sources[batch_end] == batch_end) {
+				staging_size += GltfImport::EstimatePrimitiveSize(&model, gltf_primitives[batch_end]);
+			}
+			batch_end++;
+		}
+
+		MeasurePhase(&result->phases[PHASE_ACCESSOR_CONVERSION], [&]() {
+			batch.clear();
+			batch.resize(batch_end - batch_start);
+			tasks.clear();
+			for (int i = 0; i < batch.size(); i++) {
+				if (sources[batch_start + i] != batch_start + i) {
+					continue;
+				}
+				batch[i].targets.resize(gltf_primitives[batch_start + i]->targets.size());
+				tasks.push_back({i, -1});
+				for (int j = 0; j < gltf_primitives[batch_start + i]->targets.size(); j++) {
+					tasks.push_back({i, j});
+				}
+			}
+			thread_pool->ParallelFor(tasks.size(), [&](int i) {
+				const ConversionTask& task = tasks[i];
+				const tinygltf::Primitive* gltf_primitive = gltf_primitives[batch_start + task.primitive];
+				if (task.target == -1) {
+					GltfImport::ConvertPrimitive(&model, gltf_primitive, &batch[task.primitive]);
+				} else {
+					int position = GltfImport::GetAttribute(&gltf_primitive->attributes, "POSITION");
+					if (position != -1) {
+						GltfImport::ConvertMorphTarget(&model, &gltf_primitive->targets[task.target], model.accessors[position].count, &batch[task.primitive].targets[task.target]);
+					}
+				}
+			});
+		});
+
+		MeasurePhase(&result->phases[PHASE_MESH_PROCESSING], [&]() {
+			thread_pool->ParallelFor(batch.size(), [&](int i) {
+				if (sources[batch_start + i] != batch_start + i) {
+					return;
+				}
+				if (!Config::disable_mesh_optimization) {
+					GltfImport::OptimizePrimitive(&batch[i], !Config::disable_overdraw_optimization);
+				}
+				GltfImport::BuildPrimitiveMeshlets(&batch[i]);
+				if (!Config::disable_lod_generation) {
+					GltfImport::BuildPrimitiveLods(&batch[i]);
+				}
+				bool integer_texcoords = !batch[i].quantized_texcoords[0].empty() || !batch[i].quantized_texcoords[1].empty();
+				if (Config::quantize_vertices || integer_texcoords) {
+					GltfImport::QuantizePrimitive(&batch[i], Config::quantize_vertices);
+				}
+				GltfImport::BuildPrimitiveMorphData(&batch[i]);
+			});
+		});
+
+		MeasurePhase(&result->phases[PHASE_UPLOAD], [&]() {
+			for (const GltfImport::PrimitiveData& data: batch) {
+				UploadPrimitive(sink, &data);
+			}
+		});
+
+		for (int i = 0; i < batch.size(); i++) {
+			result->num_of_vertices += batch[i].num_of_vertices;
+		}
+		batch_start = batch_end;
+	}
+
+	result->num_of_primitives = gltf_primitives.size();
+	result->num_of_images = model.images.size();
+	result->num_of_materials = materials.size();
+	return true;
+}
+
+static nlohmann::json PhaseToJson(const PhaseResult& phase)
+{
+	return {
+		{"seconds", phase.seconds},
+		{"allocations", phase.allocations},
+		{"allocated_bytes", phase.allocated_bytes},
+		{"peak_heap_bytes", phase.peak_heap_bytes},
+	};
+}
+
+static std::string QuoteCsv(const std::string& value)
+{
+	std::string quoted = "\"";
+	for (char c: value) {
+		quoted += c == '"' ? "\"\"" : std::string(1, c);
+	}
+	return quoted + "\"";
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2) {
+		printf("Usage: LoaderBenchmark <corpus directory> [--output=path without extension] [--iterations=count] [loading options]\n");
+		return EXIT_FAILURE;
+	}
+	std::filesystem::path corpus = argv[1];
+	std::string output = "LoaderBenchmark";
+	int iterations = 1;
+	for (int i = 2; i < argc; i++) {
+		std::string_view argument(argv[i]);
+		if (Config::ParseString(argument, "--output=", &output)) {
+		} else if (Config::ParseInt(argument, "--iterations=", &iterations)) {
+		}
+	}
+	iterations = std::max(iterations, 1);
+	Config::ParseCommandLineArguments(argv, argc);
+
+	std::vector<std::filesystem::path> files;
+	std::error_code error;
+	for (const std::filesystem::directory_entry& entry: std::filesystem::recursive_directory_iterator(corpus, error)) {
+		std::filesystem::path extension = entry.path().extension();
+		if (entry.is_regular_file() && (extension == ".gltf" || extension == ".glb")) {
+			files.push_back(entry.path());
+		}
+	}
+	if (error || files.empty()) {
+		printf("No .gltf or .glb files found in %s.\n", corpus.string().c_str());
+		return EXIT_FAILURE;
+	}
+	std::sort(files.begin(), files.end());
+
+	ThreadPool thread_pool;
+	thread_pool.Create();
+	int thread_count = thread_pool.GetThreadCount();
+	UploadSink sink;
+	sink.ring.resize(Config::STREAMING_UPLOAD_BUDGET);
+
+	// Times are the best of every iteration. Allocations are from the last iteration, as they don't change between iterations.
+	std::vector<FileResult> results(files.size());
+	PhaseResult totals[PHASE_COUNT];
+	bool all_valid = true;
+	printf("%zu files, best of %d iterations, %d worker threads.\n", files.size(), iterations, thread_count);
+	for (int i = 0; i < files.size(); i++) {
+		FileResult* result = &results[i];
+		result->file = files[i].lexically_relative(corpus).generic_string();
+		result->file_size = std::filesystem::file_size(files[i], error);
+		result->valid = true;
+		for (int j = 0; j < iterations && result->valid; j++) {
+			FileResult iteration;
+			sink.bytes_written = 0;
+			result->valid = LoadFile(files[i], &thread_pool, &sink, &iteration);
+			for (int k = 0; k < PHASE_COUNT; k++) {
+				double best = j == 0 ? std::numeric_limits<double>::max() : result->phases[k].seconds;
+				result->phases[k] = iteration.phases[k];
+				result->phases[k].seconds = std::min(best, iteration.phases[k].seconds);
+			}
+			result->num_of_primitives = iteration.num_of_primitives;
+			result->num_of_vertices = iteration.num_of_vertices;
+			result->num_of_images = iteration.num_of_images;
+			result->num_of_materials = iteration.num_of_materials;
+			result->upload_bytes = sink.bytes_written;
+		}
+		result->peak_rss_bytes = GetPeakMemoryUsage();
+		if (!result->valid) {
+			printf("%-48s failed to load\n", result->file.c_str());
+			all_valid = false;
+			continue;
+		}
+
+		double seconds = 0.0;
+		for (int j = 0; j < PHASE_COUNT; j++) {
+			seconds += result->phases[j].seconds;
+			totals[j].seconds += result->phases[j].seconds;
+			totals[j].allocations += result->phases[j].allocations;
+			totals[j].allocated_bytes += result->phases[j].allocated_bytes;
+			totals[j].peak_heap_bytes = std::max(totals[j].peak_heap_bytes, result->phases[j].peak_heap_bytes);
+		}
+		printf("%-48s %10.3f s %10llu MiB peak\n", result->file.c_str(), seconds, (unsigned long long)(result->peak_rss_bytes >> 20));
+	}
+	thread_pool.Destroy();
+
+	printf("\n%-24s %12s %14s %16s\n", "Phase", "Seconds", "Allocations", "Peak heap MiB");
+	for (int i = 0; i < PHASE_COUNT; i++) {
+		printf("%-24s %12.3f %14llu %16llu\n", phase_names[i], totals[i].seconds, (unsigned long long)totals[i].allocations, (unsigned long long)(totals[i].peak_heap_bytes >> 20));
+	}
+
+	// Write the results.
+	nlohmann::json json = {
+		{"corpus", corpus.generic_string()},
+		{"iterations", iterations},
+		{"threads", thread_count},
+		{"peak_rss_bytes", GetPeakMemoryUsage()},
+		{"files", nlohmann::json::array()},
+		{"totals", nlohmann::json::object()},
+	};
+	for (int i = 0; i < PHASE_COUNT; i++) {
+		json["totals"][phase_names[i]] = PhaseToJson(totals[i]);
+	}
+	std::ofstream csv(output + ".csv");
+	csv.precision(9);
+	csv << "file,phase,seconds,allocations,allocated_bytes,peak_heap_bytes\n";
+	for (const FileResult& result: results) {
+		nlohmann::json file = {
+			{"file", result.file},
+			{"valid", result.valid},
+			{"file_size", result.file_size},
+			{"primitives", result.num_of_primitives},
+			{"vertices", result.num_of_vertices},
+			{"images", result.num_of_images},
+			{"materials", result.num_of_materials},
+			{"upload_bytes", result.upload_bytes},
+			{"peak_rss_bytes", result.peak_rss_bytes},
+			{"phases", nlohmann::json::object()},
+		};
+		for (int i = 0; i < PHASE_COUNT && result.valid; i++) {
+			const PhaseResult& phase = result.phases[i];
+			file["phases"][phase_names[i]] = PhaseToJson(phase);
+			csv << QuoteCsv(result.file) << "," << phase_names[i] << "," << phase.seconds << "," << phase.allocations << "," << phase.allocated_bytes << "," << phase.peak_heap_bytes << "\n";
+		}
+		json["files"].push_back(file);
+	}
+	std::ofstream(output + ".json") << json.dump(4) << "\n";
+	if (!csv) {
+		printf("Failed to write %s.csv.\n", output.c_str());
+		return EXIT_FAILURE;
+	}
+	return all_valid ? EXIT_SUCCESS : EXIT_FAILURE;
+}
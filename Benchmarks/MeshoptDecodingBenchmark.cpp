@@ -0,0 +1,429 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "MeshoptDecoding.h"
+
+// Measures the EXT_meshopt_compression decoders on a grid mesh, and checks that they round trip and that the SIMD filters match the scalar ones.
+// The encoders here only exist to produce input data, and follow the reference encoder closely enough to give typical compression ratios.
+// Usage: MeshoptDecodingBenchmark [grid size] [iterations]
+
+template<typename F>
+static double MeasureBestSeconds(int iterations, F function)
+{
+	double best = std::numeric_limits<double>::max();
+	for (int i = 0; i < iterations; i++) {
+		auto start = std::chrono::steady_clock::now();
+		function();
+		auto end = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double>(end - start).count());
+	}
+	return best;
+}
+
+static size_t GetVertexBlockSize(size_t stride)
+{
+	return std::min<size_t>((8192 / stride) & ~size_t(15), 256);
+}
+
+static void EncodeBytesGroup(std::vector<uint8_t>* out, const uint8_t* values, int bits)
+{
+	if (bits == 0) {
+		return;
+	}
+	if (bits == 8) {
+		out->insert(out->end(), values, values + 16);
+		return;
+	}
+	uint8_t sentinel = (1 << bits) - 1;
+	size_t packed_start = out->size();
+	out->resize(packed_start + 16 * bits / 8, 0);
+	for (int i = 0; i < 16; i++) {
+		uint8_t value = std::min(values[i], sentinel);
+		int shift = 8 - bits - (i % (8 / bits)) * bits;
+		(*out)[packed_start + i / (8 / bits)] |= value << shift;
+	}
+	for (int i = 0; i < 16; i++) {
+		if (values[i] >= sentinel) {
+			out->push_back(values[i]);
+		}
+	}
+}
+
+static size_t GetBytesGroupSize(const uint8_t* values, int bits)
+{
+	if (bits == 8) {
+		return 16;
+	}
+	size_t size = bits == 0 ? 0 : 16 * bits / 8;
+	uint8_t sentinel = (1 << bits) - 1;
+	for (int i = 0; i < 16; i++) {
+		if (bits == 0 && values[i] != 0) {
+			return SIZE_MAX;
+		}
+		size += bits != 0 && values[i] >= sentinel;
+	}
+	return size;
+}
+
+static std::vector<uint8_t> EncodeVertices(const uint8_t* vertices, size_t count, size_t stride)
+{
+	std::vector<uint8_t> out = {0xa0};
+	std::vector<uint8_t> last(vertices, vertices + stride);
+	size_t block_size = GetVertexBlockSize(stride);
+	uint8_t deltas[256];
+	for (size_t offset = 0; offset < count; offset += block_size) {
+		size_t block_count = std::min(block_size, count - offset);
+		size_t aligned_count = (block_count + 15) & ~size_t(15);
+		for (size_t k = 0; k < stride; k++) {
+			std::memset(deltas, 0, sizeof(deltas));
+			uint8_t previous = last[k];
+			for (size_t i = 0; i < block_count; i++) {
+				uint8_t value = vertices[(offset + i) * stride + k];
+				uint8_t delta = value - previous;
+				deltas[i] = (uint8_t)((delta << 1) ^ (int8_t(delta) >> 7));
+				previous = value;
+			}
+			last[k] = previous;
+
+			size_t header_start = out.size();
+			out.resize(header_start + (aligned_count / 16 + 3) / 4, 0);
+			for (size_t i = 0; i < aligned_count; i += 16) {
+				int best_bits = 8;
+				int best_mode = 3;
+				size_t best_size = 16;
+				int modes[3][2] = {{0, 0}, {2, 1}, {4, 2}};
+				for (auto [bits, mode]: modes) {
+					size_t size = GetBytesGroupSize(deltas + i, bits);
+					if (size < best_size) {
+						best_size = size;
+						best_bits = bits;
+						best_mode = mode;
+					}
+				}
+				out[header_start + i / 64] |= best_mode << ((i / 16 % 4) * 2);
+				EncodeBytesGroup(&out, deltas + i, best_bits);
+			}
+		}
+	}
+	size_t tail_size = std::max<size_t>(stride, 32);
+	out.resize(out.size() + tail_size - stride, 0);
+	out.insert(out.end(), vertices, vertices + stride);
+	return out;
+}
+
+static void EncodeVByte(std::vector<uint8_t>* out, uint32_t value)
+{
+	while (value >= 128) {
+		out->push_back((uint8_t)((value & 127) | 128));
+		value >>= 7;
+	}
+	out->push_back((uint8_t)value);
+}
+
+static void EncodeIndex(std::vector<uint8_t>* out, uint32_t index, uint32_t last)
+{
+	uint32_t delta = index - last;
+	EncodeVByte(out, (delta << 1) ^ uint32_t(int32_t(delta) >> 31));
+}
+
+static const uint8_t CODE_AUX_TABLE[16] = {0x00, 0x76, 0x87, 0x56, 0x67, 0x78, 0xa9, 0x86, 0x65, 0x89, 0x68, 0x98, 0x01, 0x69, 0, 0};
+
+static std::vector<uint8_t> EncodeTriangles(const uint32_t* indices, size_t count)
+{
+	const uint32_t orders[3][3] = {{0, 1, 2}, {1, 2, 0}, {2, 0, 1}};
+	uint32_t vertex_fifo[16];
+	uint32_t edge_fifo[16][2];
+	std::memset(vertex_fifo, -1, sizeof(vertex_fifo));
+	std::memset(edge_fifo, -1, sizeof(edge_fifo));
+	uint32_t vertex_offset = 0;
+	uint32_t edge_offset = 0;
+	uint32_t next = 0;
+	uint32_t last = 0;
+	auto push_vertex = [&](uint32_t v) { vertex_fifo[vertex_offset] = v; vertex_offset = (vertex_offset + 1) & 15; };
+	auto push_edge = [&](uint32_t a, uint32_t b) { edge_fifo[edge_offset][0] = a; edge_fifo[edge_offset][1] = b; edge_offset = (edge_offset + 1) & 15; };
+	auto find_vertex = [&](uint32_t v) {
+		for (int i = 0; i < 16; i++) {
+			if (vertex_fifo[(vertex_offset - 1 - i) & 15] == v) {
+				return i;
+			}
+		}
+		return -1;
+	};
+
+	std::vector<uint8_t> codes;
+	std::vector<uint8_t> extra;
+	for (size_t i = 0; i < count; i += 3) {
+		const uint32_t* triangle = &indices[i];
+		int edge = -1;
+		for (int j = 0; j < 16 && edge == -1; j++) {
+			const uint32_t* e = edge_fifo[(edge_offset - 1 - j) & 15];
+			for (int r = 0; r < 3 && edge == -1; r++) {
+				if (e[0] == triangle[orders[r][0]] && e[1] == triangle[orders[r][1]]) {
+					edge = (j << 2) | r;
+				}
+			}
+		}
+		if (edge >= 0 && (edge >> 2) < 15) {
+			const uint32_t* order = orders[edge & 3];
+			uint32_t a = triangle[order[0]], b = triangle[order[1]], c = triangle[order[2]];
+			int fc = find_vertex(c);
+			int fec = (fc >= 1 && fc < 13) ? fc : (c == next) ? (next++, 0) : 15;
+			if (fec == 15 && c + 1 == last) {
+				fec = 13;
+				last = c;
+			} else if (fec == 15 && c == last + 1) {
+				fec = 14;
+				last = c;
+			}
+			codes.push_back((uint8_t)(((edge >> 2) << 4) | fec));
+			if (fec == 15) {
+				EncodeIndex(&extra, c, last);
+				last = c;
+			}
+			if (fec == 0 || fec >= 13) {
+				push_vertex(c);
+			}
+			push_edge(c, b);
+			push_edge(a, c);
+		} else {
+			int rotation = triangle[1] == next ? 1 : triangle[2] == next ? 2 : 0;
+			const uint32_t* order = orders[rotation];
+			uint32_t a = triangle[order[0]], b = triangle[order[1]], c = triangle[order[2]];
+			int fb = find_vertex(b);
+			int fc = find_vertex(c);
+			int fea = a == next ? (next++, 0) : 15;
+			int feb = (fb >= 0 && fb < 14) ? fb + 1 : (b == next ? (next++, 0) : 15);
+			int fec = (fc >= 0 && fc < 14) ? fc + 1 : (c == next ? (next++, 0) : 15);
+			uint8_t code_aux = (uint8_t)((feb << 4) | fec);
+			int table_index = -1;
+			for (int j = 0; j < 14; j++) {
+				table_index = table_index == -1 && CODE_AUX_TABLE[j] == code_aux ? j : table_index;
+			}
+			if (fea == 0 && table_index >= 0) {
+				codes.push_back((uint8_t)(0xf0 | table_index));
+			} else {
+				codes.push_back((uint8_t)(0xfe | (fea == 15)));
+				extra.push_back(code_aux);
+			}
+			if (fea == 15) {
+				EncodeIndex(&extra, a, last);
+				last = a;
+			}
+			if (feb == 15) {
+				EncodeIndex(&extra, b, last);
+				last = b;
+			}
+			if (fec == 15) {
+				EncodeIndex(&extra, c, last);
+				last = c;
+			}
+			if (fea == 0 || fea == 15) {
+				push_vertex(a);
+			}
+			if (feb == 0 || feb == 15) {
+				push_vertex(b);
+			}
+			if (fec == 0 || fec == 15) {
+				push_vertex(c);
+			}
+			push_edge(b, a);
+			push_edge(c, b);
+			push_edge(a, c);
+		}
+	}
+	std::vector<uint8_t> out = {0xe1};
+	out.insert(out.end(), codes.begin(), codes.end());
+	out.insert(out.end(), extra.begin(), extra.end());
+	out.insert(out.end(), CODE_AUX_TABLE, CODE_AUX_TABLE + 16);
+	return out;
+}
+
+static std::vector<uint8_t> EncodeIndices(const uint32_t* indices, size_t count)
+{
+	std::vector<uint8_t> out = {0xd1};
+	uint32_t last[2] = {};
+	int current = 0;
+	for (size_t i = 0; i < count; i++) {
+		uint32_t index = indices[i];
+		// Use whichever baseline is closer, like the reference encoder.
+		int32_t delta_0 = int32_t(index - last[0]);
+		int32_t delta_1 = int32_t(index - last[1]);
+		current = std::abs(delta_0) <= std::abs(delta_1) ? 0 : 1;
+		uint32_t delta = index - last[current];
+		uint32_t value = (delta << 1) ^ uint32_t(int32_t(delta) >> 31);
+		EncodeVByte(&out, (value << 1) | current);
+		last[current] = index;
+	}
+	out.insert(out.end(), 4, 0);
+	return out;
+}
+
+// The triangle codec may rotate triangles, which keeps their winding.
+static bool SameTriangles(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b)
+{
+	if (a.size() != b.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < a.size(); i += 3) {
+		bool same = false;
+		for (int r = 0; r < 3; r++) {
+			same = same || (a[i] == b[i + r] && a[i + 1] == b[i + (r + 1) % 3] && a[i + 2] == b[i + (r + 2) % 3]);
+		}
+		if (!same) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static int QuantizeSnorm(float value, int bits)
+{
+	float scale = float((1 << (bits - 1)) - 1);
+	value = std::clamp(value, -1.0f, 1.0f);
+	return int(value * scale + (value >= 0.0f ? 0.5f : -0.5f));
+}
+
+int main(int argc, char* argv[])
+{
+	int grid_size = argc > 1 ? std::atoi(argv[1]) : 1024;
+	int iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+
+	// A grid with 16 bit positions, octahedral normals and 16 bit texture coordinates, like the output of gltfpack.
+	struct Vertex {
+		int16_t position[4];
+		int8_t normal[4];
+		uint16_t texcoord[2];
+	};
+	size_t vertex_count = (size_t)grid_size * grid_size;
+	std::vector<Vertex> vertices(vertex_count);
+	std::vector<int16_t> normals(vertex_count * 4);
+	std::vector<int16_t> rotations(vertex_count * 4);
+	std::vector<uint32_t> floats(vertex_count * 3);
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	for (int y = 0; y < grid_size; y++) {
+		for (int x = 0; x < grid_size; x++) {
+			size_t i = (size_t)y * grid_size + x;
+			float height = std::sin(x * 0.05f) * std::cos(y * 0.05f);
+			float n[3] = {-std::cos(x * 0.05f) * 0.05f, 1.0f, std::sin(y * 0.05f) * 0.05f};
+			float n_length = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+			vertices[i] = {
+				.position = {(int16_t)(x * 16), (int16_t)(height * 1000.0f), (int16_t)(y * 16), 0},
+				.normal = {(int8_t)QuantizeSnorm(n[0] / n_length, 8), (int8_t)QuantizeSnorm(n[2] / n_length, 8), 127, 0},
+				.texcoord = {(uint16_t)(x * 65535 / grid_size), (uint16_t)(y * 65535 / grid_size)},
+			};
+
+			// Random unit normals and rotations for the 16 bit filters.
+			float v[4] = {distribution(random), distribution(random), distribution(random), distribution(random)};
+			float l1 = std::fabs(v[0]) + std::fabs(v[1]) + std::fabs(v[2]);
+			normals[i * 4 + 0] = (int16_t)QuantizeSnorm(v[0] / l1, 16);
+			normals[i * 4 + 1] = (int16_t)QuantizeSnorm(v[1] / l1, 16);
+			normals[i * 4 + 2] = (int16_t)QuantizeSnorm(1.0f, 16);
+			float l2 = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2] + v[3] * v[3]);
+			int largest = 0;
+			for (int j = 1; j < 4; j++) {
+				largest = std::fabs(v[j]) > std::fabs(v[largest]) ? j : largest;
+			}
+			float sign = v[largest] < 0.0f ? -1.0f : 1.0f;
+			for (int j = 0; j < 3; j++) {
+				rotations[i * 4 + j] = (int16_t)QuantizeSnorm(v[(largest + 1 + j) & 3] / l2 * std::sqrt(2.0f) * sign, 12);
+			}
+			rotations[i * 4 + 3] = (int16_t)((QuantizeSnorm(1.0f, 12) & ~3) | largest);
+			for (int j = 0; j < 3; j++) {
+				int32_t mantissa = (int32_t)(v[j] * 8388607.0f);
+				floats[i * 3 + j] = (uint32_t(-15) << 24) | (uint32_t(mantissa) & 0xffffff);
+			}
+		}
+	}
+	std::vector<uint32_t> indices;
+	for (int y = 0; y + 1 < grid_size; y++) {
+		for (int x = 0; x + 1 < grid_size; x++) {
+			uint32_t i = y * grid_size + x;
+			indices.insert(indices.end(), {i, i + grid_size, i + 1, i + 1, i + grid_size, i + grid_size + 1});
+		}
+	}
+
+	std::vector<uint8_t> encoded_vertices = EncodeVertices((const uint8_t*)vertices.data(), vertex_count, sizeof(Vertex));
+	std::vector<uint8_t> encoded_triangles = EncodeTriangles(indices.data(), indices.size());
+	std::vector<uint8_t> encoded_indices = EncodeIndices(indices.data(), indices.size());
+
+	std::vector<Vertex> decoded_vertices(vertex_count);
+	std::vector<uint32_t> decoded_indices(indices.size());
+	bool valid = true;
+	double vertex_seconds = MeasureBestSeconds(iterations, [&]() {
+		valid &= DecodeMeshoptVertices(decoded_vertices.data(), vertex_count, sizeof(Vertex), encoded_vertices.data(), encoded_vertices.size());
+	});
+	bool vertices_match = valid && std::memcmp(vertices.data(), decoded_vertices.data(), vertex_count * sizeof(Vertex)) == 0;
+	valid = true;
+	double triangle_seconds = MeasureBestSeconds(iterations, [&]() {
+		valid &= DecodeMeshoptTriangles(decoded_indices.data(), indices.size(), sizeof(uint32_t), encoded_triangles.data(), encoded_triangles.size());
+	});
+	bool triangles_match = valid && SameTriangles(indices, decoded_indices);
+	valid = true;
+	double index_seconds = MeasureBestSeconds(iterations, [&]() {
+		valid &= DecodeMeshoptIndices(decoded_indices.data(), indices.size(), sizeof(uint32_t), encoded_indices.data(), encoded_indices.size());
+	});
+	bool indices_match = valid && decoded_indices == indices;
+
+	// Filters run in place, so each iteration works on a fresh copy.
+	struct FilterCase {
+		const char* name;
+		MeshoptFilter filter;
+		const void* data;
+		size_t stride;
+		double scalar_seconds = 0.0;
+		double simd_seconds = 0.0;
+		bool match = false;
+	};
+	std::vector<uint8_t> normals_8(vertex_count * 4);
+	for (size_t i = 0; i < vertex_count; i++) {
+		std::memcpy(&normals_8[i * 4], vertices[i].normal, 4);
+	}
+	FilterCase filters[] = {
+		{"Octahedral 8 bit", MESHOPT_FILTER_OCTAHEDRAL, normals_8.data(), 4},
+		{"Octahedral 16 bit", MESHOPT_FILTER_OCTAHEDRAL, normals.data(), 8},
+		{"Quaternion", MESHOPT_FILTER_QUATERNION, rotations.data(), 8},
+		{"Exponential", MESHOPT_FILTER_EXPONENTIAL, floats.data(), 12},
+	};
+	bool filters_match = true;
+	for (FilterCase& filter: filters) {
+		size_t size = vertex_count * filter.stride;
+		std::vector<uint8_t> scalar(size);
+		std::vector<uint8_t> simd(size);
+		filter.scalar_seconds = MeasureBestSeconds(iterations, [&]() {
+			std::memcpy(scalar.data(), filter.data, size);
+			DecodeMeshoptFilterScalar(filter.filter, scalar.data(), vertex_count, filter.stride);
+		});
+		filter.simd_seconds = MeasureBestSeconds(iterations, [&]() {
+			std::memcpy(simd.data(), filter.data, size);
+			DecodeMeshoptFilter(filter.filter, simd.data(), vertex_count, filter.stride);
+		});
+		filter.match = scalar == simd;
+		filters_match &= filter.match;
+	}
+
+	// Throughput is measured in decoded bytes.
+	const double MB = 1024.0 * 1024.0;
+	size_t vertex_bytes = vertex_count * sizeof(Vertex);
+	size_t index_bytes = indices.size() * sizeof(uint32_t);
+	printf("%zu vertices, %zu indices, best of %d iterations.\n", vertex_count, indices.size(), iterations);
+	printf("%-24s %10.2f MB/s, %.2fx smaller\n", "Vertices", vertex_bytes / vertex_seconds / MB, (double)vertex_bytes / encoded_vertices.size());
+	printf("%-24s %10.2f MB/s, %.2fx smaller\n", "Triangles", index_bytes / triangle_seconds / MB, (double)index_bytes / encoded_triangles.size());
+	printf("%-24s %10.2f MB/s, %.2fx smaller\n", "Indices", index_bytes / index_seconds / MB, (double)index_bytes / encoded_indices.size());
+	for (const FilterCase& filter: filters) {
+		size_t size = vertex_count * filter.stride;
+		printf("%-24s %10.2f MB/s scalar, %10.2f MB/s SIMD (%.2fx)\n", filter.name, size / filter.scalar_seconds / MB, size / filter.simd_seconds / MB, filter.scalar_seconds / filter.simd_seconds);
+	}
+	printf("Round trips: vertices %s, triangles %s, indices %s. Filters %s.\n",
+		vertices_match ? "match" : "differ", triangles_match ? "match" : "differ", indices_match ? "match" : "differ", filters_match ? "match" : "differ");
+
+	return (vertices_match && triangles_match && indices_match && filters_match) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
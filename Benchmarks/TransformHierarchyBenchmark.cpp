@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include "ThreadPool.h"
+#include "TransformHierarchy.h"
+
+// Measures TransformHierarchy against recursing through child and sibling links, as Gltf::CalculateGlobalTransforms used to.
+// The hierarchy is timed recalculating everything on one thread and on a thread pool, one animated subtree, and nothing, which is the common case for static scenes.
+// Checks that both produce the same global transforms, and that the thread pool gives exactly the same result as one thread.
+// Usage: TransformHierarchyBenchmark [node count] [iterations]
+
+// The node layout the recursive version works on, with the strings and vectors that sit between the transforms.
+struct Node {
+	std::string name;
+	int child = -1;
+	int sibling = -1;
+	int mesh_id = -1;
+	int skin_id = -1;
+	int dynamic_mesh = -1;
+	int camera_id = -1;
+	int light_id = -1;
+	glm::vec3 translation;
+	glm::quat rotation;
+	glm::vec3 scale;
+	glm::mat4x4 global_transform;
+	glm::mat4x4 previous_global_transform;
+	std::vector<float> weights;
+	std::vector<float> current_weights;
+	std::vector<glm::mat4x4> instances;
+};
+
+template<typename F>
+static double MeasureBestSeconds(int iterations, F function)
+{
+	double best = std::numeric_limits<double>::max();
+	for (int i = 0; i < iterations; i++) {
+		auto start = std::chrono::steady_clock::now();
+		function();
+		auto end = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double>(end - start).count());
+	}
+	return best;
+}
+
+static void CalculateGlobalTransforms(std::vector<Node>* nodes, Node* node, glm::mat4x4 parent_global_transform)
+{
+	node->previous_global_transform = node->global_transform;
+	node->global_transform = parent_global_transform;
+	node->global_transform *= glm::translate(node->translation);
+	node->global_transform *= glm::mat4_cast(node->rotation);
+	node->global_transform *= glm::scale(node->scale);
+	for (int i = node->child; i != -1; i = (*nodes)[i].sibling) {
+		CalculateGlobalTransforms(nodes, &(*nodes)[i], node->global_transform);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int node_count = argc > 1 ? std::atoi(argv[1]) : 100000;
+	int iterations = argc > 2 ? std::atoi(argv[2]) : 20;
+
+	// Every node has a random earlier node as its parent, apart from one in every thousand which is a root.
+	// This gives a bushy hierarchy a few dozen levels deep, with children spread out through the array like in a large glTF file.
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	std::vector<Node> nodes(node_count);
+	std::vector<int> roots;
+	std::vector<int> last_child(node_count, -1);
+	for (int i = 0; i < node_count; i++) {
+		Node& node = nodes[i];
+		node.name = "Node " + std::to_string(i);
+		node.translation = glm::vec3(distribution(random), distribution(random), distribution(random)) * 10.0f;
+		node.rotation = glm::normalize(glm::quat(distribution(random), distribution(random), distribution(random), distribution(random)));
+		node.scale = glm::vec3(1.0f) + glm::vec3(distribution(random), distribution(random), distribution(random)) * 0.1f;
+		if (i % 1000 == 0) {
+			roots.push_back(i);
+			continue;
+		}
+		int parent = std::uniform_int_distribution<int>(0, i - 1)(random);
+		if (last_child[parent] == -1) {
+			nodes[parent].child = i;
+		} else {
+			nodes[last_child[parent]].sibling = i;
+		}
+		last_child[parent] = i;
+	}
+
+	glm::mat4x4 root_transform = glm::mat4x4(
+		1., 0., 0., 0.,
+		0., 0., 1., 0.,
+		0., -1., 0., 0.,
+		0., 0., 0., 1.
+	);
+	double recursive_seconds = MeasureBestSeconds(iterations, [&]() {
+		for (int root: roots) {
+			CalculateGlobalTransforms(&nodes, &nodes[root], root_transform);
+		}
+	});
+
+	std::vector<int> children(node_count);
+	std::vector<int> siblings(node_count);
+	for (int i = 0; i < node_count; i++) {
+		children[i] = nodes[i].child;
+		siblings[i] = nodes[i].sibling;
+	}
+	TransformHierarchy hierarchy;
+	double build_seconds = MeasureBestSeconds(1, [&]() {
+		hierarchy.Build(children, siblings);
+	});
+	for (int i = 0; i < node_count; i++) {
+		int position = hierarchy.positions[i];
+		hierarchy.translations[position] = nodes[i].translation;
+		hierarchy.rotations[position] = nodes[i].rotation;
+		hierarchy.scales[position] = nodes[i].scale;
+	}
+	double flattened_seconds = MeasureBestSeconds(iterations, [&]() {
+		hierarchy.Invalidate();
+		hierarchy.CalculateGlobalTransforms(root_transform);
+	});
+	std::vector<AffineTransform> serial_transforms = hierarchy.global_transforms;
+	ThreadPool thread_pool;
+	thread_pool.Create();
+	int thread_count = thread_pool.GetThreadCount();
+	double parallel_seconds = MeasureBestSeconds(iterations, [&]() {
+		hierarchy.Invalidate();
+		hierarchy.CalculateGlobalTransforms(root_transform, &thread_pool);
+	});
+	thread_pool.Destroy();
+	bool deterministic = memcmp(serial_transforms.data(), hierarchy.global_transforms.data(), sizeof(AffineTransform) * node_count) == 0;
+	double unchanged_seconds = MeasureBestSeconds(iterations, [&]() {
+		hierarchy.CalculateGlobalTransforms(root_transform);
+	});
+	// Moves a child of the first root back and forth, as an animation would.
+	int animated_node = nodes[roots[0]].child;
+	glm::vec3 animated_translation = nodes[animated_node].translation;
+	int frame = 0;
+	double animated_seconds = MeasureBestSeconds(iterations, [&]() {
+		hierarchy.SetTranslation(animated_node, animated_translation + glm::vec3(frame++ % 2 == 0 ? 1.0f : 0.0f));
+		hierarchy.CalculateGlobalTransforms(root_transform);
+	});
+	hierarchy.SetTranslation(animated_node, animated_translation);
+	hierarchy.CalculateGlobalTransforms(root_transform);
+	int animated_position = hierarchy.positions[animated_node];
+	int animated_count = hierarchy.subtree_ends[animated_position] - animated_position;
+
+	// The two compose transforms in a different order, so allow for rounding.
+	float max_error = 0.0f;
+	for (int i = 0; i < node_count; i++) {
+		glm::mat4x4 expected = nodes[i].global_transform;
+		glm::mat4x4 actual = hierarchy.GetGlobalTransform(i);
+		for (int j = 0; j < 4; j++) {
+			for (int k = 0; k < 4; k++) {
+				max_error = std::max(max_error, std::abs(expected[j][k] - actual[j][k]) / std::max(std::abs(expected[j][k]), 1.0f));
+			}
+		}
+	}
+	bool match = max_error < 1e-3f;
+
+	printf("%d nodes, %zu roots, best of %d iterations.\n", node_count, roots.size(), iterations);
+	printf("%-32s %10.3f ms\n", "Recursive", recursive_seconds * 1000.0);
+	printf("%-32s %10.3f ms %6.2fx\n", "Flattened", flattened_seconds * 1000.0, recursive_seconds / flattened_seconds);
+	printf("%-32s %10.3f ms %6.2fx %d threads\n", "Flattened, thread pool", parallel_seconds * 1000.0, recursive_seconds / parallel_seconds, thread_count);
+	printf("%-32s %10.3f ms %6.2fx %d nodes\n", "Flattened, one subtree moved", animated_seconds * 1000.0, recursive_seconds / animated_seconds, animated_count);
+	printf("%-32s %10.3f ms\n", "Flattened, nothing moved", unchanged_seconds * 1000.0);
+	printf("%-32s %10.3f ms\n", "Build", build_seconds * 1000.0);
+	printf("Largest relative difference %g %s\n", max_error, match ? "" : "MISMATCH");
+
+	if (!match) {
+		printf("Flattened transforms do not match recursion.\n");
+		return EXIT_FAILURE;
+	}
+	if (!deterministic) {
+		printf("Thread pool transforms do not match one thread.\n");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
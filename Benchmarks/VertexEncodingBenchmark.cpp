@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "VertexEncoding.h"
+
+// Compares the scalar and batch tangent space encoders.
+// Usage: VertexEncodingBenchmark [vertex count] [iterations]
+
+template<typename F>
+static double MeasureBestSeconds(int iterations, F function)
+{
+	double best = std::numeric_limits<double>::max();
+	for (int i = 0; i < iterations; i++) {
+		auto start = std::chrono::steady_clock::now();
+		function();
+		auto end = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double>(end - start).count());
+	}
+	return best;
+}
+
+static size_t CountMismatches(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b)
+{
+	size_t mismatches = 0;
+	for (size_t i = 0; i < a.size(); i++) {
+		mismatches += a[i] != b[i];
+	}
+	return mismatches;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4000000;
+	int iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+
+	// Random unit normals with tangents perpendicular to them, like a typical mesh.
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	std::vector<glm::vec3> normals(count);
+	std::vector<glm::vec4> tangents(count);
+	for (size_t i = 0; i < count; i++) {
+		glm::vec3 normal;
+		do {
+			normal = glm::vec3(distribution(random), distribution(random), distribution(random));
+		} while (glm::dot(normal, normal) < 1e-4f);
+		normal = glm::normalize(normal);
+		glm::vec3 other = glm::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		glm::vec3 tangent = glm::normalize(glm::cross(normal, other));
+		normals[i] = normal;
+		tangents[i] = glm::vec4(tangent, (random() & 1) ? 1.0f : -1.0f);
+	}
+
+	std::vector<uint32_t> scalar(count);
+	std::vector<uint32_t> batch(count);
+
+	double scalar_normal = MeasureBestSeconds(iterations, [&]() {
+		for (size_t i = 0; i < count; i++) {
+			scalar[i] = EncodeNormal(normals[i]);
+		}
+	});
+	double batch_normal = MeasureBestSeconds(iterations, [&]() {
+		EncodeNormalBatch(&normals[0].x, batch.data(), count);
+	});
+	size_t normal_mismatches = CountMismatches(scalar, batch);
+
+	double scalar_tangent = MeasureBestSeconds(iterations, [&]() {
+		for (size_t i = 0; i < count; i++) {
+			scalar[i] = EncodeTangentSpace(normals[i], tangents[i]);
+		}
+	});
+	double batch_tangent = MeasureBestSeconds(iterations, [&]() {
+		EncodeTangentSpaceBatch(&normals[0].x, &tangents[0].x, batch.data(), count);
+	});
+	size_t tangent_mismatches = CountMismatches(scalar, batch);
+
+	printf("%zu vertices, best of %d iterations.\n", count, iterations);
+	printf("%-32s %12.2f Mvertices/s\n", "EncodeNormal", count / scalar_normal * 1e-6);
+	printf("%-32s %12.2f Mvertices/s (%.2fx)\n", "EncodeNormalBatch", count / batch_normal * 1e-6, scalar_normal / batch_normal);
+	printf("%-32s %12.2f Mvertices/s\n", "EncodeTangentSpace", count / scalar_tangent * 1e-6);
+	printf("%-32s %12.2f Mvertices/s (%.2fx)\n", "EncodeTangentSpaceBatch", count / batch_tangent * 1e-6, scalar_tangent / batch_tangent);
+	printf("Mismatches: normal %zu, tangent space %zu.\n", normal_mismatches, tangent_mismatches);
+
+	return (normal_mismatches == 0 && tangent_mismatches == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,11 +1,15 @@
 #include "Animation.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cassert>
 
 #include <glm/gtc/packing.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+// Keyframes stepped forward from the cursor before falling back to a binary search.
+static constexpr int CURSOR_STEPS = 4;
+
 static float GetInterpolationFactor(float time, float lower_time, float upper_time)
 {
     float diff = upper_time - lower_time;
@@ -27,12 +31,28 @@ static float CubicSpline(float previous_point, float previous_tangent, float nex
     return (2 * t3 - 3 * t2 + 1) * previous_point + delta_time * (t3 - 2 * t2 + t) * previous_tangent + (-2 * t3 + 3 * t2) * next_point + delta_time * (t3 - t2) * next_tangent;
 }
 
-int Animation::Channel::GetStartKeyframe(float time)
+int Animation::Channel::GetStartKeyframe(float time, int* cursor)
 {
     time = glm::clamp(time, times[0], times.back());
-    int result = 0;
-    for (int i = 1; i < times.size() && times[i] <= time; i++) {
-        result = i;
+    int last = times.size() - 1;
+    int first = 0;
+    if (cursor && *cursor >= 0 && *cursor <= last && times[*cursor] <= time) {
+        int result = *cursor;
+        int steps_end = std::min(result + CURSOR_STEPS, last);
+        while (result < steps_end && times[result + 1] <= time) {
+            result++;
+        }
+        if (result == last || times[result + 1] > time) {
+            *cursor = result;
+            return result;
+        }
+        // Skipped further ahead than a few keyframes, but the answer is still after the cursor.
+        first = result;
+    }
+    int result = std::upper_bound(times.begin() + first, times.end(), time) - times.begin() - 1;
+    result = std::max(result, 0);
+    if (cursor) {
+        *cursor = result;
     }
     return result;
 }
@@ -69,15 +89,12 @@ float Animation::Channel::UnpackData(int keyframe, int component)
     }
 }
 
-void Animation::Channel::GetTransform(float time, float* out)
+void Animation::Channel::GetTransform(float time, float* out, int* cursor)
 {
     time = glm::clamp(time, times[0], times.back());
     
     // Get the two keyframes we need to interpolate between.
-    int k_start = 0;
-    for (int i = 1; i < times.size() && times[i] <= time; i++) {
-        k_start = i;
-    }
+    int k_start = GetStartKeyframe(time, cursor);
     int k_end = k_start;
     if (k_end + 1 < times.size() && times[k_end] < time) {
         k_end++;
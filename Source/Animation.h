@@ -38,8 +38,10 @@ struct Animation
         std::vector<std::byte> transforms;
         int FormatSize();
         float UnpackData(int keyframe, int component);
-        int GetStartKeyframe(float time);
-        void GetTransform(float time, float* out);
+        // The last keyframe at or before time. A cursor holds the keyframe found by the previous call, so playing forward
+        // only steps to the next keyframe instead of searching. Seeking or looping falls back to a binary search.
+        int GetStartKeyframe(float time, int* cursor = nullptr);
+        void GetTransform(float time, float* out, int* cursor = nullptr);
     };
     std::string name;
     float length = 0;
@@ -18,6 +18,8 @@ void AnimationPlayer::Tick(Gltf* gltf, float delta_time)
                 this->playing = false;
             }
         }
-        gltf->Animate(&gltf->animations[animation], this->playhead);
+        gltf->Animate(&gltf->animations[animation], this->playhead, &this->keyframe_cursors);
+    } else {
+        gltf->ApplyRestTransforms();
     }
 }
\ No newline at end of file
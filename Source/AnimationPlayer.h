@@ -10,5 +10,6 @@ class AnimationPlayer {
     float playhead = 0;
     bool playing = false;
     bool loop = true;
+    std::vector<int> keyframe_cursors; // Last keyframe sampled from each channel.
     void Tick(Gltf* gltf, float delta_time);
 };
\ No newline at end of file
@@ -5,7 +5,18 @@
 
 bool Config::enable_d3d12_debug_layer = false;
 bool Config::enable_gpu_based_validation = false;
+bool Config::disable_memory_mapping = false;
+bool Config::ignore_cooked_scenes = false;
+bool Config::synchronous_loading = false;
+bool Config::disable_texture_compression = false;
+bool Config::fast_texture_compression = false;
+std::string Config::texture_cache_directory = "TextureCache";
+bool Config::disable_mesh_optimization = false;
+bool Config::disable_overdraw_optimization = false;
+bool Config::disable_lod_generation = false;
+bool Config::quantize_vertices = false;
 std::string Config::load_gltf;
+std::string Config::cook_gltf;
 std::string Config::load_environment;
 bool Config::fullscreen = false;
 int Config::width = 1280;
@@ -49,8 +60,19 @@ void Config::ParseCommandLineArguments(const char* const* arguments, int argumen
         if (ParseBoolean(argument, "--d3d12-debug-layer", &Config::enable_d3d12_debug_layer)) {
         } else if (ParseBoolean(argument, "--gpu-based-validation", &Config::enable_gpu_based_validation)) {
         } else if (ParseBoolean(argument, "--fullscreen", &Config::fullscreen)) {
+        } else if (ParseBoolean(argument, "--disable-memory-mapping", &Config::disable_memory_mapping)) {
+        } else if (ParseBoolean(argument, "--ignore-cooked-scenes", &Config::ignore_cooked_scenes)) {
+        } else if (ParseBoolean(argument, "--synchronous-loading", &Config::synchronous_loading)) {
+        } else if (ParseBoolean(argument, "--disable-texture-compression", &Config::disable_texture_compression)) {
+        } else if (ParseBoolean(argument, "--fast-texture-compression", &Config::fast_texture_compression)) {
+        } else if (ParseString(argument, "--texture-cache=", &texture_cache_directory)) {
+        } else if (ParseBoolean(argument, "--disable-mesh-optimization", &Config::disable_mesh_optimization)) {
+        } else if (ParseBoolean(argument, "--disable-overdraw-optimization", &Config::disable_overdraw_optimization)) {
+        } else if (ParseBoolean(argument, "--disable-lod-generation", &Config::disable_lod_generation)) {
+        } else if (ParseBoolean(argument, "--quantize-vertices", &Config::quantize_vertices)) {
         } else if (ParseString(argument, "--environment-map=", &load_environment)) {
         } else if (ParseString(argument, "--gltf=", &load_gltf)) {
+        } else if (ParseString(argument, "--cook=", &cook_gltf)) {
         } else if (ParseInt(argument, "--width=", &width)) {
         } else if (ParseInt(argument, "--height=", &height)) {
         }
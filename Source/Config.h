@@ -16,18 +16,30 @@ class Config {
 	static constexpr int FRAME_HEAP_CAPACITY = Mebibytes(512);
 	static constexpr int FRAME_COUNT = 2;
     static constexpr int UPLOAD_BUFFER_CAPACITY = Mebibytes(512);
+    static constexpr uint64_t MESH_STAGING_CAPACITY = Mebibytes(256); // Upper bound on mesh data converted on the CPU before it is uploaded.
+    static constexpr uint64_t STREAMING_UPLOAD_BUDGET = Mebibytes(64); // Upper bound on data uploaded per frame while a scene streams in.
 	static constexpr int MIN_WIDTH = 800;
 	static constexpr int MIN_HEIGHT = 600;
-	static constexpr int MAX_SIMULTANEOUS_MORPH_TARGETS = 4;
 	static constexpr int MINIMUM_WINDOW_WIDTH = 800;
 	static constexpr int MINIMUM_WINDOW_HEIGHT = 600;
-    static constexpr int MAX_TLAS_INSTANCES = 1000;
+    static constexpr int MAX_TLAS_INSTANCES = 65536; // Every instance of an EXT_mesh_gpu_instancing node counts separately.
     static constexpr uint32_t MAX_BLAS_VERTICES = 1000000;
 
 	// Runtime configuration.
 	static bool enable_d3d12_debug_layer;
 	static bool enable_gpu_based_validation;
+	static bool disable_memory_mapping;
+	static bool ignore_cooked_scenes;
+	static bool synchronous_loading;
+	static bool disable_texture_compression;
+	static bool fast_texture_compression; // Uses BC1 and BC3 instead of BC7, which compresses much faster at lower quality.
+	static std::string texture_cache_directory;
+	static bool disable_mesh_optimization;
+	static bool disable_overdraw_optimization;
+	static bool disable_lod_generation;
+	static bool quantize_vertices; // Stores vertex attributes in 16 and 8 bit formats.
 	static std::string load_gltf;
+	static std::string cook_gltf;
 	static std::string load_environment;
 	static bool fullscreen;
 	static int width;
@@ -0,0 +1,169 @@
+#include "CookedScene.h"
+
+#include <filesystem>
+#include <system_error>
+
+#include "Config.h"
+#include "File.h"
+#include "Hash.h"
+#include "Memory.h"
+#include "Profiling.h"
+
+namespace CookedScene {
+
+std::string GetCookedFilepath(const char* source_filepath)
+{
+	return std::string(source_filepath) + EXTENSION;
+}
+
+bool HashFile(const char* filepath, uint64_t* hash, uint64_t* size)
+{
+	ProfileZoneScoped();
+	void* data = File::Map(filepath, size);
+	if (!data) {
+		return false;
+	}
+	*hash = Hash(data, *size);
+	File::Unmap(data, *size);
+	return true;
+}
+
+uint64_t GetImportOptionsHash()
+{
+	const bool options[] = {
+		Config::disable_mesh_optimization,
+		Config::disable_overdraw_optimization,
+		Config::disable_lod_generation,
+		Config::quantize_vertices,
+		Config::disable_texture_compression,
+		Config::fast_texture_compression,
+	};
+	return Hash(options, sizeof(options));
+}
+
+bool IsUpToDate(const char* cooked_filepath, const char* source_filepath)
+{
+	ProfileZoneScoped();
+	std::error_code error;
+	if (!std::filesystem::exists(cooked_filepath, error)) {
+		return false;
+	}
+	Reader reader;
+	if (!reader.Open(cooked_filepath)) {
+		return false;
+	}
+	Header header = *reader.GetHeader();
+	reader.Close();
+	if (header.options_hash != GetImportOptionsHash()) {
+		return false;
+	}
+
+	// Check the size first so that most stale files can be rejected without hashing.
+	uint64_t source_size = std::filesystem::file_size(source_filepath, error);
+	if (error || source_size != header.source_size) {
+		return false;
+	}
+	uint64_t source_hash = 0;
+	if (!HashFile(source_filepath, &source_hash, &source_size)) {
+		return false;
+	}
+	return source_hash == header.source_hash && source_size == header.source_size;
+}
+
+bool Writer::Open(const char* filepath)
+{
+	ProfileZoneScoped();
+	file.open(std::filesystem::path(filepath), std::ios::binary | std::ios::trunc);
+	if (!file) {
+		return false;
+	}
+	// Space for the header is reserved now, it is filled in when the file is closed.
+	// Until then the magic number is zero, so a partially written file is never treated as valid.
+	header = Header();
+	header.magic = 0;
+	offset = 0;
+	Write(&header, sizeof(header));
+	return file.good();
+}
+
+Range Writer::Write(const void* data, uint64_t size)
+{
+	static const char padding[ALIGNMENT] = {};
+	uint64_t aligned_offset = AlignPowerOfTwo(offset, ALIGNMENT);
+	file.write(padding, aligned_offset - offset);
+	if (size > 0) {
+		file.write((const char*)data, size);
+	}
+	offset = aligned_offset + size;
+	return {aligned_offset, size};
+}
+
+Range Writer::Write(const std::string& string)
+{
+	return Write(string.data(), string.size());
+}
+
+bool Writer::Close(uint64_t source_hash, uint64_t source_size)
+{
+	ProfileZoneScoped();
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.source_hash = source_hash;
+	header.source_size = source_size;
+	header.options_hash = GetImportOptionsHash();
+	file.seekp(0);
+	file.write((const char*)&header, sizeof(header));
+	bool result = file.good();
+	file.close();
+	return result && !file.fail();
+}
+
+bool Reader::Open(const char* filepath)
+{
+	ProfileZoneScoped();
+	data = File::Map(filepath, &size);
+	if (!data) {
+		return false;
+	}
+	const Header* header = GetHeader();
+	if (size < sizeof(Header) || header->magic != MAGIC || header->version != VERSION) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void Reader::Close()
+{
+	if (data) {
+		File::Unmap(data, size);
+	}
+	data = nullptr;
+	size = 0;
+}
+
+const Header* Reader::GetHeader() const
+{
+	return (const Header*)data;
+}
+
+bool Reader::IsValid(Range range) const
+{
+	return range.offset <= size && range.size <= size - range.offset;
+}
+
+const std::byte* Reader::GetPointer(Range range) const
+{
+	return (const std::byte*)data + range.offset;
+}
+
+bool Reader::Read(Range range, std::string* string) const
+{
+	if (!IsValid(range)) {
+		return false;
+	}
+	string->assign((const char*)GetPointer(range), range.size);
+	return true;
+}
+
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// A cooked scene is a glTF file that has already been converted into the formats used by the renderer.
+// Vertex, index and texture data is stored exactly as it is uploaded, so loading is mostly copying from a memory mapped file into upload memory.
+// Everything else is stored as flat tables of the structs below.
+namespace CookedScene {
+
+    constexpr uint32_t MAGIC = 0x4B4F4F43; // "COOK".
+    constexpr uint32_t VERSION = 10;
+    constexpr uint64_t ALIGNMENT = 16;
+    constexpr const char* EXTENSION = ".cooked";
+
+    enum Table {
+        TABLE_SCENES,
+        TABLE_NODES,
+        TABLE_MESHES,
+        TABLE_PRIMITIVES,
+        TABLE_MATERIALS, // Gltf::Material, with texture and sampler set to glTF image and sampler indices.
+        TABLE_TEXTURES,
+        TABLE_SAMPLERS, // D3D12_SAMPLER_DESC.
+        TABLE_SKINS,
+        TABLE_ANIMATIONS,
+        TABLE_CHANNELS,
+        TABLE_LIGHTS, // Gltf::Light.
+        TABLE_COUNT,
+    };
+
+    enum Stream {
+        STREAM_INDEX,
+        STREAM_POSITION, // In Mesh::GetPositionFormat.
+        STREAM_TANGENT_SPACE,
+        STREAM_TEXCOORD_0, // In Mesh::GetTexcoordFormat.
+        STREAM_TEXCOORD_1,
+        STREAM_COLOR, // In Mesh::GetColorFormat.
+        STREAM_JOINT_WEIGHT,
+        STREAM_MESHLETS, // Meshlet.
+        STREAM_MESHLET_BOUNDS, // MeshletBounds.
+        STREAM_MESHLET_VERTICES, // uint32_t.
+        STREAM_MESHLET_TRIANGLES, // Three uint8_t per triangle.
+        STREAM_LOD_INDEX, // Indices of every level of detail, in the index format.
+        STREAM_LODS, // MeshLod.
+        STREAM_MORPH_DELTA_OFFSETS, // uint32_t, see MorphTargets.
+        STREAM_MORPH_TARGETS, // uint32_t.
+        STREAM_MORPH_POSITIONS, // glm::vec3.
+        STREAM_MORPH_NORMALS, // glm::vec3.
+        STREAM_MORPH_TANGENTS, // glm::vec3.
+        STREAM_COUNT,
+    };
+
+    // Bytes [offset, offset + size) of the file.
+    struct Range {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+    };
+
+    // Rows [first, first + count) of another table.
+    struct Span {
+        uint32_t first = 0;
+        uint32_t count = 0;
+    };
+
+    struct Header {
+        uint32_t magic = MAGIC;
+        uint32_t version = VERSION;
+        uint64_t source_hash = 0;
+        uint64_t source_size = 0;
+        uint64_t options_hash = 0; // GetImportOptionsHash when the scene was cooked.
+        Range tables[TABLE_COUNT];
+    };
+
+    struct Scene {
+        Range name;
+        Range nodes; // int32_t.
+    };
+
+    struct Node {
+        Range name;
+        int32_t child;
+        int32_t sibling;
+        int32_t mesh_id;
+        int32_t skin_id;
+        int32_t camera_id;
+        int32_t light_id;
+        float translation[3];
+        float rotation[4]; // xyzw.
+        float scale[3];
+        Range weights; // float.
+        Range instances; // glm::mat4x4.
+    };
+
+    struct Mesh {
+        Range name;
+        Span primitives;
+        Range weights; // float.
+    };
+
+    struct Primitive {
+        uint32_t valid;
+        int32_t topology;
+        uint32_t index_format;
+        uint32_t num_of_vertices;
+        uint32_t num_of_indices;
+        uint32_t flags; // Mesh::Flags.
+        int32_t material_id;
+        uint32_t num_of_meshlets;
+        uint32_t num_of_meshlet_vertices;
+        uint32_t num_of_meshlet_triangles;
+        uint32_t num_of_lods;
+        uint32_t num_of_lod_indices;
+        float lod_center[3]; // MeshLodData::center.
+        float lod_radius;
+        float position_scale[3]; // VertexDequantization.
+        float position_offset[3];
+        float texcoord_transforms[2][4];
+        uint32_t num_of_targets;
+        uint32_t morph_flags; // MorphTargets::Flags.
+        uint32_t num_of_morph_deltas;
+        Range streams[STREAM_COUNT];
+    };
+
+    // Textures that no material uses have an unknown format and no data.
+    struct Texture {
+        Range name;
+        uint32_t format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t component_mapping;
+        int32_t duplicate_of; // Gltf::Texture::duplicate_of.
+        Range data; // Full mip chain in the texture's format, see MipGeneration.h and TextureCompression.h.
+    };
+
+    struct Skin {
+        Range joints; // uint32_t.
+        Range inverse_bind_poses; // glm::mat4x4.
+    };
+
+    struct Animation {
+        Range name;
+        float length;
+        Span channels;
+    };
+
+    struct Channel {
+        int32_t node_id;
+        int32_t format;
+        int32_t path;
+        int32_t interpolation_mode;
+        int32_t width;
+        Range times; // float.
+        Range transforms;
+    };
+
+    // Path of the cooked scene for a glTF file.
+    std::string GetCookedFilepath(const char* source_filepath);
+    bool HashFile(const char* filepath, uint64_t* hash, uint64_t* size);
+    // Hash of the command line options that change what is cooked, such as vertex quantization and texture compression.
+    uint64_t GetImportOptionsHash();
+    // Checks that a cooked scene exists and was cooked from the current contents of the source file with the current import options.
+    bool IsUpToDate(const char* cooked_filepath, const char* source_filepath);
+
+    // Writes data sequentially, then writes the header once all tables are known.
+    class Writer {
+
+        public:
+
+        bool Open(const char* filepath);
+        Range Write(const void* data, uint64_t size);
+        Range Write(const std::string& string);
+        template<typename T>
+        Range Write(const std::vector<T>& data)
+        {
+            return Write(data.data(), data.size() * sizeof(T));
+        }
+        template<typename T>
+        void WriteTable(Table table, const std::vector<T>& rows)
+        {
+            header.tables[table] = Write(rows);
+        }
+        bool Close(uint64_t source_hash, uint64_t source_size);
+
+        private:
+
+        std::ofstream file;
+        uint64_t offset = 0;
+        Header header;
+    };
+
+    // Reads from a memory mapped cooked scene. Every range is bounds checked before it is used.
+    class Reader {
+
+        public:
+
+        bool Open(const char* filepath);
+        void Close();
+        const Header* GetHeader() const;
+        bool IsValid(Range range) const;
+        const std::byte* GetPointer(Range range) const;
+        bool Read(Range range, std::string* string) const;
+        template<typename T>
+        bool Read(Range range, std::vector<T>* data) const
+        {
+            if (!IsValid(range) || range.size % sizeof(T) != 0) {
+                return false;
+            }
+            data->resize(range.size / sizeof(T));
+            std::memcpy(data->data(), GetPointer(range), range.size);
+            return true;
+        }
+        template<typename T>
+        bool GetTable(Table table, const T** rows, uint32_t* count) const
+        {
+            Range range = GetHeader()->tables[table];
+            if (!IsValid(range) || range.size % sizeof(T) != 0) {
+                return false;
+            }
+            *rows = (const T*)GetPointer(range);
+            *count = range.size / sizeof(T);
+            return true;
+        }
+
+        private:
+
+        void* data = nullptr;
+        uint64_t size = 0;
+    };
+};
@@ -2,20 +2,34 @@
 
 #include <string>
 
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "Memory.h"
 #include "Profiling.h"
 
 namespace File {
 
+#ifdef _WIN32
+static std::wstring Utf8ToUtf16(const char* string)
+{
+    int required_length = MultiByteToWideChar(CP_UTF8, 0, string, -1, nullptr, 0);
+    std::wstring utf16_string(required_length, '\0');
+    MultiByteToWideChar(CP_UTF8, 0, string, -1, utf16_string.data(), utf16_string.size());
+    return utf16_string;
+}
+
 void* Load(const char* filename, uint64_t* size)
 {
     ProfileZoneScoped();
     *size = 0;
-    int required_length = MultiByteToWideChar(CP_UTF8, 0, filename, -1, nullptr, 0);
-    std::wstring utf16_filepath(required_length, '\0');
-    MultiByteToWideChar(CP_UTF8, 0, filename, -1, utf16_filepath.data(), utf16_filepath.size());
+    std::wstring utf16_filepath = Utf8ToUtf16(filename);
     HANDLE file = CreateFileW(utf16_filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, NULL, nullptr);
 	if (file == INVALID_HANDLE_VALUE) {
         return nullptr;
@@ -37,10 +51,111 @@ void* Load(const char* filename, uint64_t* size)
         CloseHandle(file);
         return nullptr;
     }
+    CloseHandle(file);
+    *size = file_size.QuadPart;
+    return data;
+}
+
+void* Map(const char* filename, uint64_t* size)
+{
+    ProfileZoneScoped();
+    *size = 0;
+    std::wstring utf16_filepath = Utf8ToUtf16(filename);
+    HANDLE file = CreateFileW(utf16_filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+    LARGE_INTEGER file_size = {};
+    if (GetFileSizeEx(file, &file_size) == 0 || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return nullptr;
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    // The view keeps the file open, so the handles can be closed straight away.
+    CloseHandle(file);
+    if (!mapping) {
+        return nullptr;
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data) {
+        return nullptr;
+    }
     *size = file_size.QuadPart;
     return data;
 }
 
+void Unmap(void* ptr, uint64_t size)
+{
+    ProfileZoneScoped();
+    UnmapViewOfFile(ptr);
+}
+#else
+void* Load(const char* filename, uint64_t* size)
+{
+    ProfileZoneScoped();
+    *size = 0;
+    int file = open(filename, O_RDONLY);
+    if (file == -1) {
+        return nullptr;
+    }
+    struct stat file_stat = {};
+    if (fstat(file, &file_stat) != 0) {
+        close(file);
+        return nullptr;
+    }
+    void* data = Allocate(file_stat.st_size);
+    if (!data) {
+        close(file);
+        return nullptr;
+    }
+    uint64_t total = 0;
+    while (total < (uint64_t)file_stat.st_size) {
+        ssize_t result = read(file, (char*)data + total, file_stat.st_size - total);
+        if (result <= 0) {
+            ::Free(data);
+            close(file);
+            return nullptr;
+        }
+        total += result;
+    }
+    close(file);
+    *size = total;
+    return data;
+}
+
+void* Map(const char* filename, uint64_t* size)
+{
+    ProfileZoneScoped();
+    *size = 0;
+    int file = open(filename, O_RDONLY);
+    if (file == -1) {
+        return nullptr;
+    }
+    struct stat file_stat = {};
+    if (fstat(file, &file_stat) != 0 || file_stat.st_size == 0) {
+        close(file);
+        return nullptr;
+    }
+    void* data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    // The mapping keeps the file open, so the descriptor can be closed straight away.
+    close(file);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+    // Mesh data is read front to back, so let the kernel read ahead.
+    madvise(data, file_stat.st_size, MADV_SEQUENTIAL);
+    *size = file_stat.st_size;
+    return data;
+}
+
+void Unmap(void* ptr, uint64_t size)
+{
+    ProfileZoneScoped();
+    munmap(ptr, size);
+}
+#endif
+
 void Free(void* ptr)
 {
     ::Free(ptr);
@@ -5,4 +5,7 @@
 namespace File {
     void* Load(const char* filename, uint64_t* size);
     void Free(void* ptr);
+    // Maps a whole file into memory as read only. Pages are read from the page cache on first access.
+    void* Map(const char* filename, uint64_t* size);
+    void Unmap(void* ptr, uint64_t size);
 };
\ No newline at end of file
@@ -25,6 +25,7 @@ void ForwardPass::Create(ID3D12Device* device)
 	root_parameters[ROOT_PARAMETER_CONSTANT_BUFFER_PIXEL_PER_MODEL].InitAsConstantBufferView(1, 0, D3D12_SHADER_VISIBILITY_PIXEL);
 	root_parameters[ROOT_PARAMETER_SRV_LIGHTS].InitAsShaderResourceView(0, 0, D3D12_SHADER_VISIBILITY_PIXEL);
 	root_parameters[ROOT_PARAMETER_SRV_MATERIALS].InitAsShaderResourceView(1, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+	root_parameters[ROOT_PARAMETER_SRV_INSTANCES].InitAsShaderResourceView(2, 0, D3D12_SHADER_VISIBILITY_VERTEX);
 	CD3DX12_STATIC_SAMPLER_DESC static_samplers[] = {
 		CD3DX12_STATIC_SAMPLER_DESC(0, D3D12_FILTER_MIN_MAG_MIP_LINEAR, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP),
 		CD3DX12_STATIC_SAMPLER_DESC(1, D3D12_FILTER_MIN_MAG_MIP_LINEAR, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP)
@@ -89,13 +90,19 @@ void ForwardPass::CreatePipeline(ID3D12Device* device, D3D12_SHADER_BYTECODE ver
 		.StencilEnable = FALSE,
 	};
 
+	// Quantized vertices are dequantized by the vertex shader.
+	uint8_t mesh_flags = 0;
+	mesh_flags |= flags & PIPELINE_FLAGS_QUANTIZED_POSITION ? Mesh::FLAG_QUANTIZED_POSITION : 0;
+	mesh_flags |= flags & PIPELINE_FLAGS_QUANTIZED_ATTRIBUTES ? Mesh::FLAG_QUANTIZED_ATTRIBUTES : 0;
+	DXGI_FORMAT position_format = Mesh::GetPositionFormat(mesh_flags);
+	DXGI_FORMAT texcoord_format = Mesh::GetTexcoordFormat(mesh_flags);
     D3D12_INPUT_ELEMENT_DESC input_layout[] = {
-		{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+		{"POSITION", 0, position_format, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
 		{"TANGENT_SPACE", 0, DXGI_FORMAT_R10G10B10A2_UNORM, 1, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-		{"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 2, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-		{"TEXCOORD", 1, DXGI_FORMAT_R32G32_FLOAT, 3, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-		{"COLOR", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 4, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-		{"PREVIOUS_POS", 0, DXGI_FORMAT_R32G32B32_FLOAT, 5, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}
+		{"TEXCOORD", 0, texcoord_format, 2, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+		{"TEXCOORD", 1, texcoord_format, 3, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+		{"COLOR", 0, Mesh::GetColorFormat(mesh_flags), 4, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+		{"PREVIOUS_POS", 0, position_format, 5, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}
 	};
 	pipeline_desc.InputLayout = {
 		.pInputElementDescs = input_layout,
@@ -185,35 +192,70 @@ void ForwardPass::BindPipeline(CommandContext* context, uint32_t flags)
 {
 	assert(flags < std::size(pipeline_states));
 	flags &= PIPELINE_FLAGS_BITMASK;
+	this->current_pipeline_flags = flags;
+	this->bound_pipeline_flags = flags;
     context->command_list->SetPipelineState(pipeline_states[flags].Get());
 }
 
-void ForwardPass::Draw(CommandContext* context, Mesh* model, int material_id, glm::mat4x4 model_to_world, glm::mat4x4 model_to_world_normals, glm::mat4x4 previous_model_to_world, DynamicMesh* dynamic_mesh)
+void ForwardPass::Draw(CommandContext* context, Mesh* model, int material_id, glm::mat4x4 model_to_world, glm::mat4x4 previous_model_to_world, DynamicMesh* dynamic_mesh, const MeshLod* lod, const glm::mat4x4* instances, uint32_t num_of_instances)
 {
+	// Dynamic meshes always have float positions, as they are written by the skinning shader.
+	bool dynamic_position = dynamic_mesh && (dynamic_mesh->flags & DynamicMesh::FLAG_POSITION);
+	bool quantized_position = (model->flags & Mesh::FLAG_QUANTIZED_POSITION) && !dynamic_position;
+	uint32_t pipeline_flags = this->current_pipeline_flags;
+	pipeline_flags |= quantized_position ? PIPELINE_FLAGS_QUANTIZED_POSITION : 0;
+	pipeline_flags |= model->flags & Mesh::FLAG_QUANTIZED_ATTRIBUTES ? PIPELINE_FLAGS_QUANTIZED_ATTRIBUTES : 0;
+	if (pipeline_flags != this->bound_pipeline_flags) {
+		context->command_list->SetPipelineState(pipeline_states[pipeline_flags].Get());
+		this->bound_pipeline_flags = pipeline_flags;
+	}
+
+	// Write the transforms of each instance.
+	// Dequantization is folded into the transform of the positions.
+	glm::mat4x4 dequantize_position = quantized_position ? model->dequantization.GetPositionTransform() : glm::mat4x4(1.0f);
+	struct GpuInstance {
+		glm::mat4x4 position_to_world;
+		glm::mat4x4 model_to_world;
+		glm::mat4x4 model_to_world_normals;
+		glm::mat4x4 previous_position_to_world;
+	};
+	glm::mat4x4 identity(1.0f);
+	if (!instances) {
+		instances = &identity;
+		num_of_instances = 1;
+	}
+	D3D12_GPU_VIRTUAL_ADDRESS gpu_instances = 0;
+	GpuInstance* instance_data = (GpuInstance*)context->Allocate(num_of_instances * sizeof(GpuInstance), alignof(GpuInstance), &gpu_instances);
+	assert(instance_data);
+	for (uint32_t i = 0; i < num_of_instances; i++) {
+		glm::mat4x4 instance_to_world = model_to_world * instances[i];
+		instance_data[i] = {
+			.position_to_world = instance_to_world * dequantize_position,
+			.model_to_world = instance_to_world,
+			.model_to_world_normals = glm::inverseTranspose(instance_to_world),
+			.previous_position_to_world = previous_model_to_world * instances[i] * dequantize_position,
+		};
+	}
+	context->command_list->SetGraphicsRootShaderResourceView(ROOT_PARAMETER_SRV_INSTANCES, gpu_instances);
+
     // Write constant buffers.
 	struct {
-		alignas(16) glm::mat4x4 model_to_world;
-		alignas(16) glm::mat4x4 model_to_world_normals;
-		alignas(16) glm::mat4x4 previous_model_to_world;
+		alignas(16) glm::vec4 texcoord_transforms[Mesh::MAX_TEXCOORDS];
 	} vertex_per_model;
 
-	vertex_per_model = {
-		.model_to_world = model_to_world,
-		.model_to_world_normals = glm::inverseTranspose(model_to_world),
-		.previous_model_to_world = previous_model_to_world,
-	};
+	for (int i = 0; i < Mesh::MAX_TEXCOORDS; i++) {
+		vertex_per_model.texcoord_transforms[i] = model->flags & Mesh::FLAG_QUANTIZED_ATTRIBUTES ? model->dequantization.texcoord_transforms[i] : glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+	}
 	context->command_list->SetGraphicsRootConstantBufferView(ROOT_PARAMETER_CONSTANT_BUFFER_VERTEX_PER_MODEL, context->CreateConstantBuffer(&vertex_per_model));
 	
 	struct {
 		uint32_t mesh_flags;
         int material_index;
-        alignas(16) glm::mat4x4 model_to_world;
 	} pixel_per_model;
 
 	pixel_per_model = {
 		.mesh_flags = model->flags,
 		.material_index = material_id,
-    	.model_to_world = model_to_world,
 	};
 	context->command_list->SetGraphicsRootConstantBufferView(ROOT_PARAMETER_CONSTANT_BUFFER_PIXEL_PER_MODEL, context->CreateConstantBuffer(&pixel_per_model));
 
@@ -224,21 +266,24 @@ void ForwardPass::Draw(CommandContext* context, Mesh* model, int material_id, gl
 	
 	// Set the vertex buffer.
 	D3D12_VERTEX_BUFFER_VIEW vertex_buffers[] = {
-		dynamic_mesh && (dynamic_mesh->flags & DynamicMesh::FLAG_POSITION) ? dynamic_mesh->GetCurrentPositionBuffer()->view : model->position.view, 
+		dynamic_position ? dynamic_mesh->GetCurrentPositionBuffer()->view : model->position.view, 
 		dynamic_mesh && (dynamic_mesh->flags & DynamicMesh::FLAG_TANGENT_SPACE) ? dynamic_mesh->tangent_space.view : model->tangent_space.view, 
 		model->texcoords[0].view,
 		model->texcoords[1].view,
 		model->color.view,
 		// TODO: We don't always want to use the previous position buffer, such as on a new frame.
-		dynamic_mesh && (dynamic_mesh->flags & DynamicMesh::FLAG_POSITION) ? dynamic_mesh->GetPreviousPositionBuffer()->view : model->position.view
+		dynamic_position ? dynamic_mesh->GetPreviousPositionBuffer()->view : model->position.view
 	};
 	context->command_list->IASetVertexBuffers(0, std::size(vertex_buffers), vertex_buffers);
 
-    if (model->num_of_indices > 0) {
+    if (lod) {
+        context->command_list->IASetIndexBuffer(&model->lod_index.view);
+        context->command_list->DrawIndexedInstanced(lod->num_of_indices, num_of_instances, lod->first_index, 0, 0);
+    } else if (model->num_of_indices > 0) {
         context->command_list->IASetIndexBuffer(&model->index.view);
-        context->command_list->DrawIndexedInstanced(model->num_of_indices, 1, 0, 0, 0);
+        context->command_list->DrawIndexedInstanced(model->num_of_indices, num_of_instances, 0, 0, 0);
     } else {
-        context->command_list->DrawInstanced(model->num_of_vertices, 1, 0, 0);
+        context->command_list->DrawInstanced(model->num_of_vertices, num_of_instances, 0, 0);
     }
 }
 
@@ -311,6 +356,7 @@ void ForwardPass::DrawBackground(CommandContext* context, glm::mat4x4 clip_to_wo
 {
 	context->command_list->SetGraphicsRootSignature(this->background_root_signature.Get());
     context->command_list->SetPipelineState(this->background_pipeline_state.Get());
+	this->bound_pipeline_flags = UINT32_MAX;
 	context->command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 	struct {
@@ -361,6 +407,7 @@ void ForwardPass::GenerateTransmissionMips(CommandContext* context, ID3D12Resour
 	// Generate the mips.
 	context->command_list->SetComputeRootSignature(this->transmission_mips_root_signature.Get());
 	context->command_list->SetPipelineState(this->transmission_mips_pipeline_state.Get());
+	this->bound_pipeline_flags = UINT32_MAX;
 
 	struct {
 		int input_descriptor;
@@ -5,6 +5,7 @@
 
 #include "CommandContext.h"
 #include "Mesh.h"
+#include "MeshSimplification.h"
 
 class ForwardPass {
     public:
@@ -19,7 +20,10 @@ class ForwardPass {
         PIPELINE_FLAGS_DOUBLE_SIDED = 1 << 0,
         PIPELINE_FLAGS_WINDING_ORDER_CLOCKWISE = 1 << 1,
         PIPELINE_FLAGS_ALPHA_BLEND = 1 << 2,
-        PIPELINE_FLAGS_PERMUTATION_COUNT = 1 << 3,
+        // Chosen by Draw from the mesh, see Mesh::FLAG_QUANTIZED_POSITION and Mesh::FLAG_QUANTIZED_ATTRIBUTES.
+        PIPELINE_FLAGS_QUANTIZED_POSITION = 1 << 3,
+        PIPELINE_FLAGS_QUANTIZED_ATTRIBUTES = 1 << 4,
+        PIPELINE_FLAGS_PERMUTATION_COUNT = 1 << 5,
         PIPELINE_FLAGS_BITMASK = PIPELINE_FLAGS_PERMUTATION_COUNT - 1,
     };
 
@@ -49,7 +53,9 @@ class ForwardPass {
     void SetConfig(CommandContext* context, const Config* config);
     void BindRenderTargets(CommandContext* context, D3D12_CPU_DESCRIPTOR_HANDLE render, D3D12_CPU_DESCRIPTOR_HANDLE velocity, D3D12_CPU_DESCRIPTOR_HANDLE depth);
     void BindPipeline(CommandContext* context, uint32_t pipeline_flags);
-    void Draw(CommandContext* context, Mesh* model, int material_id, glm::mat4x4 model_to_world, glm::mat4x4 model_to_world_normals, glm::mat4x4 previous_model_to_world, DynamicMesh* dynamic_mesh = nullptr);
+    // Draws the full detail mesh unless a level of detail is given.
+    // If instance transforms are given, every instance is drawn in a single draw, with each transform applied before model_to_world.
+    void Draw(CommandContext* context, Mesh* model, int material_id, glm::mat4x4 model_to_world, glm::mat4x4 previous_model_to_world, DynamicMesh* dynamic_mesh = nullptr, const MeshLod* lod = nullptr, const glm::mat4x4* instances = nullptr, uint32_t num_of_instances = 0);
     void DrawBackground(CommandContext* context, glm::mat4x4 clip_to_world, float environment_intensity, int environment_descriptor);
     void GenerateTransmissionMips(CommandContext* context, ID3D12Resource* input, ID3D12Resource* output, int sample_pattern);
 
@@ -62,11 +68,13 @@ class ForwardPass {
 		ROOT_PARAMETER_CONSTANT_BUFFER_PIXEL_PER_MODEL,
 		ROOT_PARAMETER_SRV_LIGHTS,
 		ROOT_PARAMETER_SRV_MATERIALS,
+		ROOT_PARAMETER_SRV_INSTANCES,
 		ROOT_PARAMETER_COUNT,
 	};
 
     D3D12_PRIMITIVE_TOPOLOGY current_topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-    uint32_t current_pipeline_flags;
+    uint32_t current_pipeline_flags = PIPELINE_FLAGS_NONE;
+    uint32_t bound_pipeline_flags = UINT32_MAX; // Includes the flags chosen from the mesh. UINT32_MAX if another pipeline is bound.
 
     Microsoft::WRL::ComPtr<ID3D12RootSignature> root_signature;
     Microsoft::WRL::ComPtr<ID3D12PipelineState> pipeline_states[PIPELINE_FLAGS_PERMUTATION_COUNT];
@@ -1,8 +1,14 @@
 #include "Gltf.h"
 
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <limits>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include <directx/d3d12.h>
@@ -14,94 +20,23 @@
 #include <spdlog/spdlog.h>
 
 #include "Animation.h"
+#include "Config.h"
+#include "CookedScene.h"
 #include "DescriptorAllocator.h"
 #include "DirectXHelpers.h"
+#include "GltfImport.h"
+#include "Hash.h"
+#include "Memory.h"
+#include "MeshSimplification.h"
+#include "MipGeneration.h"
 #include "Profiling.h"
+#include "Timer.h"
 #include "UploadBuffer.h"
 #include "TinyGltfTools.h"
 
-static glm::vec2 EncodeOctahedralMap(glm::vec3 normal)
-{
-	// Project onto the octahedron.
-	glm::vec3 octahedral = normal / (glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z));
-	// Flatten onto square with coordinates in range [-1, 1].
-	glm::vec2 result;
-	if (octahedral.z >= 0.f) {
-		result = glm::vec2(octahedral.x, octahedral.y);
-	} else {
-		result.x = (octahedral.x >= 0.f ? 1.f : -1.f) * (1.f - glm::abs(octahedral.y));
-		result.y = (octahedral.y >= 0.f ? 1.f : -1.f) * (1.f - glm::abs(octahedral.x));
-	}
-	return result;
-}
-
-static glm::vec3 DecodeOctahedralMap(glm::vec2 encoded)
-{
-	glm::vec3 result;
-	// Find point on octahedron.
-	result.z = 1. - glm::abs(encoded.x) - glm::abs(encoded.y);
-	if (result.z >= 0.) {
-		result.x = encoded.x;
-		result.y = encoded.y;
-	} else {
-		result.x = (encoded.x >= 0.f ? 1.f : -1.f) * (1.f - glm::abs(encoded.y));
-		result.y = (encoded.y >= 0.f ? 1.f : -1.f) * (1.f - glm::abs(encoded.x));
-	}
-	// Project onto sphere.
-	result = glm::normalize(result);
-	return result;
-}
-
-// From the paper "Building an Orthonormal Basis, Revisited".
-static void CreateBasis(glm::vec3 normal, glm::vec3* tangent, glm::vec3* bitangent)
-{
-	const float sign = normal.z >= 0.0f ? 1.0f : -1.0f;
-	const float a = -1.0f / (sign + normal.z);
-	const float b = normal.x * normal.y * a;
-	*tangent = glm::vec3(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
-	*bitangent = glm::vec3(b, sign + normal.y * normal.y * a, -normal.y);
-}
-
-static uint32_t EncodeNormal(glm::vec3 normal)
-{
-	glm::vec4 encoded;
-
-    // Encode normal.
-    glm::vec2 encoded_normal = 0.5f * EncodeOctahedralMap(normal) + 0.5f;
-	glm::u32vec2 quantized_normal = glm::clamp(encoded_normal, 0.0f, 1.0f) * 1023.0f + 0.5f;
-
-    // Encode winding.
-    uint32_t quantized_winding = 3;
-
-    return quantized_normal.x | (quantized_normal.y << 10) | (quantized_winding << 30);
-}
-
-static uint32_t EncodeTangentSpace(glm::vec3 normal, glm::vec4 tangent)
-{
-	glm::vec4 encoded;
-
-    // Encode and quantize normal.
-    glm::vec2 encoded_normal = 0.5f * EncodeOctahedralMap(normal) + 0.5f;
-	glm::u32vec2 quantized_normal = glm::clamp(encoded_normal, 0.0f, 1.0f) * 1023.0f + 0.5f;
-
-	// Decode normal to use in basis calculation.
-	// This is to prevent numerical issues due to quantization.
-	glm::vec2 unpacked_encoded_normal = glm::vec2(quantized_normal) / 1023.0f;
-	normal = DecodeOctahedralMap(2.0f * unpacked_encoded_normal - 1.0f);
-
-    // Encode tangent.
-    glm::vec3 canonical_tangent;
-    glm::vec3 canonical_bitangent;
-    CreateBasis(normal, &canonical_tangent, &canonical_bitangent);
-    float angle = std::atan2(glm::dot(glm::vec3(tangent), canonical_bitangent), glm::dot(glm::vec3(tangent), canonical_tangent));
-    float encoded_tangent = (angle / glm::two_pi<float>()) + 0.5f;
-	uint32_t quantized_tangent = glm::clamp(encoded_tangent, 0.0f, 1.0f) * 1023.0f + 0.5f;
-
-    // Encode winding.
-    uint32_t quantized_winding = tangent.w == 1.0f ? 3 : 0;
-
-    return quantized_normal.x | (quantized_normal.y << 10) | (quantized_tangent << 20) | (quantized_winding << 30);
-}
+// Scene updates smaller than this stay on the calling thread, where they take less time than waking the pool.
+static constexpr int CHANNELS_PER_TASK = 64;
+static constexpr int BONES_PER_TASK = 256;
 
 void Gltf::TraverseScene(int scene, const std::function<void(Gltf*, int)>& lambda)
 {
@@ -128,7 +63,10 @@ void Gltf::Unload()
 	// Need to explicitly free descriptors for all meshes and textures.
 	for (Mesh& mesh: meshes) {
 		for (Primitive& primitive: mesh.primitives) {
-			primitive.mesh.Destroy(this->srv_uav_cbv_descriptors);
+			if (!primitive.shares_mesh) {
+				primitive.mesh.Destroy(this->srv_uav_cbv_descriptors);
+				primitive.morph_targets.Destroy(this->srv_uav_cbv_descriptors);
+			}
 		}
 	}
 	for (DynamicPrimitives& dynamic: dynamic_primitives) {
@@ -154,478 +92,365 @@ void Gltf::Unload()
     animations.clear();
     lights.clear();
     textures.clear();
+    transforms.Clear();
+    posed_animation = nullptr;
+    skinned_nodes.clear();
 }
 
 void Gltf::LoadMeshes(tinygltf::Model* gltf, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer)
 {
 	ProfileZoneScoped();
-	// Create meshes.
-	this->meshes.resize(gltf->meshes.size());
-	for (int i = 0; i < gltf->meshes.size(); i++) {
-		LoadMesh(gltf, &gltf->meshes[i], gpu_allocator, upload_buffer, &this->meshes[i]);
-	}
+	LoadMeshLayout(gltf);
+	ConvertMeshes(gltf, [&](int mesh, int primitive, GltfImport::PrimitiveData* data) {
+		UploadPrimitive(data, gpu_allocator, upload_buffer, &this->meshes[mesh].primitives[primitive]);
+		this->meshes[mesh].primitives[primitive].resident = data->valid;
+		return true;
+	}, [&](int mesh, int primitive, int source_mesh, int source_primitive) {
+		const Primitive& source = this->meshes[source_mesh].primitives[source_primitive];
+		if (source.resident) {
+			SharePrimitive(source, &this->meshes[mesh].primitives[primitive]);
+			this->meshes[mesh].primitives[primitive].resident = true;
+		}
+		return true;
+	});
 }
 
-void Gltf::LoadMesh(tinygltf::Model* gltf, tinygltf::Mesh* gltf_mesh, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer, Mesh* mesh)
+void Gltf::LoadMeshLayout(tinygltf::Model* gltf)
 {
-	mesh->name = gltf_mesh->name;
-	mesh->primitives.resize(gltf_mesh->primitives.size());
-	for (int i = 0; i < gltf_mesh->primitives.size(); i++) {
-		LoadPrimitive(gltf, &gltf_mesh->primitives[i], gpu_allocator, upload_buffer, &mesh->primitives[i]);
-	}
-	mesh->weights.resize(gltf_mesh->weights.size());
-	for (int i = 0; i < gltf_mesh->weights.size(); i++) {
-		mesh->weights[i] = (float)gltf_mesh->weights[i];
+	ProfileZoneScoped();
+	// Everything except the mesh data, so that nodes and materials can be used before any primitive is converted.
+	this->meshes.resize(gltf->meshes.size());
+	for (int i = 0; i < gltf->meshes.size(); i++) {
+		tinygltf::Mesh* gltf_mesh = &gltf->meshes[i];
+		Mesh* mesh = &this->meshes[i];
+		mesh->name = gltf_mesh->name;
+		mesh->primitives.resize(gltf_mesh->primitives.size());
+		for (int j = 0; j < gltf_mesh->primitives.size(); j++) {
+			// The material id is incremented by 1 so that an id of 0 will use the default material.
+			mesh->primitives[j].material_id = gltf_mesh->primitives[j].material + 1;
+			mesh->primitives[j].num_of_targets = gltf_mesh->primitives[j].targets.size();
+		}
+		mesh->weights.resize(gltf_mesh->weights.size());
+		for (int j = 0; j < gltf_mesh->weights.size(); j++) {
+			mesh->weights[j] = (float)gltf_mesh->weights[j];
+		}
 	}
 }
 
-void Gltf::LoadPrimitive(tinygltf::Model* gltf, tinygltf::Primitive* gltf_primitive, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer, Primitive* primitive)
+void Gltf::ConvertMeshes(tinygltf::Model* gltf, const std::function<bool(int, int, GltfImport::PrimitiveData*)>& consume, const std::function<bool(int, int, int, int)>& share)
 {
-	::Mesh::Desc desc = {};
-
-	// Get the primitive type.
-	switch (gltf_primitive->mode) {
-		case TINYGLTF_MODE_POINTS: { 
-			desc.topology = D3D_PRIMITIVE_TOPOLOGY_POINTLIST;  
-		} break;
-		case TINYGLTF_MODE_LINE: { 
-			desc.topology = D3D_PRIMITIVE_TOPOLOGY_LINELIST; 
-		} break;
-		case TINYGLTF_MODE_LINE_LOOP: { 
-			SPDLOG_WARN("Unsupported Topology: Line Loop.");
-			return;
-		} break;
-		case TINYGLTF_MODE_LINE_STRIP: { 
-			desc.topology = D3D_PRIMITIVE_TOPOLOGY_LINESTRIP; 
-		} break;
-		case TINYGLTF_MODE_TRIANGLES: { 
-			desc.topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST; 
-		} break;
-		case TINYGLTF_MODE_TRIANGLE_STRIP: { 
-			desc.topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP; 
-		} break;
-		case TINYGLTF_MODE_TRIANGLE_FAN: { 
-			SPDLOG_WARN("Unsupported Topology: Triangle Fan.");
-			return;
-		} break;
+	ProfileZoneScoped();
+	struct PrimitiveReference {
+		int mesh;
+		int primitive;
+	};
+	std::vector<PrimitiveReference> primitive_references;
+	for (int i = 0; i < gltf->meshes.size(); i++) {
+		for (int j = 0; j < gltf->meshes[i].primitives.size(); j++) {
+			primitive_references.push_back({i, j});
+		}
 	}
 
-	desc.flags |= gltf_primitive->indices != -1 ? ::Mesh::FLAG_INDEX : 0;
-	desc.flags |= gltf_primitive->attributes.contains("NORMAL") ? ::Mesh::FLAG_TANGENT_SPACE : 0;
-	desc.flags |= gltf_primitive->attributes.contains("TEXCOORD_0") ? ::Mesh::FLAG_TEXCOORD_0 : 0;
-	desc.flags |= gltf_primitive->attributes.contains("TEXCOORD_1") ? ::Mesh::FLAG_TEXCOORD_1 : 0;
-	desc.flags |= gltf_primitive->attributes.contains("COLOR_0") ? ::Mesh::FLAG_COLOR : 0;
-	desc.flags |= gltf_primitive->attributes.contains("JOINTS_0") && gltf_primitive->attributes.contains("WEIGHTS_0")? ::Mesh::FLAG_JOINT_WEIGHT : 0;
-
-	if (desc.flags & ::Mesh::FLAG_INDEX) {
-		desc.num_of_indices = gltf->accessors[gltf_primitive->indices].count;
-		switch (gltf->accessors[gltf_primitive->indices].componentType) {
-			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
-			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-				desc.index_format = DXGI_FORMAT_R16_UINT;
-				break;
-			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
-				desc.index_format = DXGI_FORMAT_R32_UINT;
+	// Primitives with identical data use the first of them, so only that one is converted.
+	std::vector<uint64_t> hashes(primitive_references.size());
+	this->thread_pool->ParallelFor(hashes.size(), [&](int i) {
+		const PrimitiveReference& reference = primitive_references[i];
+		hashes[i] = GltfImport::HashPrimitive(gltf, &gltf->meshes[reference.mesh].primitives[reference.primitive]);
+	});
+	// Equal hashes are confirmed by comparing the data, and a primitive that only collides gets its own entry.
+	std::vector<int> sources(primitive_references.size());
+	std::unordered_multimap<uint64_t, int> first_primitives;
+	for (int i = 0; i < hashes.size(); i++) {
+		const tinygltf::Primitive* primitive = &gltf->meshes[primitive_references[i].mesh].primitives[primitive_references[i].primitive];
+		sources[i] = i;
+		auto [begin, end] = first_primitives.equal_range(hashes[i]);
+		for (auto it = begin; it != end; it++) {
+			const PrimitiveReference& first = primitive_references[it->second];
+			if (GltfImport::ComparePrimitives(gltf, &gltf->meshes[first.mesh].primitives[first.primitive], primitive)) {
+				sources[i] = it->second;
 				break;
+			}
+		}
+		if (sources[i] == i) {
+			first_primitives.emplace(hashes[i], i);
 		}
 	}
 
-	desc.num_of_vertices = gltf->accessors[gltf_primitive->attributes["POSITION"]].count;
-
-	primitive->mesh.Create(gpu_allocator, srv_uav_cbv_descriptors, &desc);
+	// Primitives are converted on the thread pool in batches to limit the amount of staging memory.
+	// Each batch is then consumed in order, so the output doesn't depend on how the work was scheduled.
+	struct ConversionTask {
+		int primitive;
+		int target; // -1 for the primitive itself.
+	};
+	std::vector<GltfImport::PrimitiveData> batch;
+	std::vector<ConversionTask> tasks;
+	VertexCacheStats mesh_before, mesh_after, total_before, total_after;
+	uint64_t num_of_meshlets = 0;
+	uint64_t num_of_lods = 0;
+	QuantizationStats quantization_stats;
+	int batch_start = 0;
+	while (batch_start < primitive_references.size()) {
+		int batch_end = batch_start;
+		uint64_t staging_size = 0;
+		while (batch_end < primitive_references.size() && (batch_end == batch_start || staging_size < Config::MESH_STAGING_CAPACITY)) {
+			const PrimitiveReference& reference = primitive_references[batch_end];
+			if (sources[batch_end] == batch_end) {
+				staging_size += GltfImport::EstimatePrimitiveSize(gltf, &gltf->meshes[reference.mesh].primitives[reference.primitive]);
+			}
+			batch_end++;
+		}
 
-	// Begin uploading data.
-	if (desc.flags & ::Mesh::FLAG_INDEX) {
-		std::byte* dest = (std::byte*)primitive->mesh.QueueIndexUpdate(upload_buffer);
-		tinygltf::Accessor* index_accessor = &gltf->accessors[gltf_primitive->indices];
-		int component_type = index_accessor->componentType;
-		if (component_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
-			// DirectX 12 doesn't support 8 bit indices, so convert them to 16 bit.
-			tinygltf::tools::Copy((glm::u16vec1*)dest, gltf, index_accessor);
-		} else {
-			tinygltf::tools::Copy(dest, gltf, index_accessor);
+		batch.clear();
+		batch.resize(batch_end - batch_start);
+		tasks.clear();
+		for (int i = 0; i < batch.size(); i++) {
+			if (sources[batch_start + i] != batch_start + i) {
+				continue;
+			}
+			const PrimitiveReference& reference = primitive_references[batch_start + i];
+			tinygltf::Primitive* gltf_primitive = &gltf->meshes[reference.mesh].primitives[reference.primitive];
+			batch[i].targets.resize(gltf_primitive->targets.size());
+			tasks.push_back({i, -1});
+			for (int j = 0; j < gltf_primitive->targets.size(); j++) {
+				tasks.push_back({i, j});
+			}
 		}
-	}
 
-	tinygltf::Accessor* position_accessor = &gltf->accessors[gltf_primitive->attributes["POSITION"]];
-	glm::vec3* dest = (glm::vec3*)primitive->mesh.QueuePositionUpdate(upload_buffer);
-	tinygltf::tools::Copy(dest, gltf, position_accessor);
+		this->thread_pool->ParallelFor(tasks.size(), [&](int i) {
+			const ConversionTask& task = tasks[i];
+			const PrimitiveReference& reference = primitive_references[batch_start + task.primitive];
+			tinygltf::Primitive* gltf_primitive = &gltf->meshes[reference.mesh].primitives[reference.primitive];
+			if (task.target == -1) {
+				GltfImport::ConvertPrimitive(gltf, gltf_primitive, &batch[task.primitive]);
+			} else {
+				// Morph targets have the same number of vertices as the primitive.
+				int position = GltfImport::GetAttribute(&gltf_primitive->attributes, "POSITION");
+				if (position != -1) {
+					GltfImport::ConvertMorphTarget(gltf, &gltf_primitive->targets[task.target], gltf->accessors[position].count, &batch[task.primitive].targets[task.target]);
+				}
+			}
+		});
 
-	if (desc.flags & ::Mesh::FLAG_TANGENT_SPACE) {
-		if (gltf_primitive->attributes.contains("TANGENT")) {
-			tinygltf::Accessor* normal_accessor = &gltf->accessors[gltf_primitive->attributes["NORMAL"]];
-			auto normal_it = tinygltf::tools::Iterator<3, float>(gltf, normal_accessor);
-			tinygltf::Accessor* tangent_accessor = &gltf->accessors[gltf_primitive->attributes["TANGENT"]];
-			auto tangent_it = tinygltf::tools::Iterator<4, float>(gltf, tangent_accessor);
-			uint32_t* dest = (uint32_t*)primitive->mesh.QueueTangentSpaceUpdate(upload_buffer);
-			while (!normal_it.AtEnd() && !tangent_it.AtEnd()) {
-				glm::vec3 normal = normal_it.Get();
-				glm::vec4 tangent = tangent_it.Get();
-				*dest = EncodeTangentSpace(normal, tangent);
-				normal_it.Next();
-				tangent_it.Next();
-				dest++;
+		// Optimizing remaps every stream, so it has to wait until the morph targets have been converted.
+		this->thread_pool->ParallelFor(batch.size(), [&](int i) {
+			if (sources[batch_start + i] != batch_start + i) {
+				return;
 			}
-		} else {
-			tinygltf::Accessor* normal_accessor = &gltf->accessors[gltf_primitive->attributes["NORMAL"]];
-			auto normal_it = tinygltf::tools::Iterator<3, float>(gltf, normal_accessor);
-			uint32_t* dest = (uint32_t*)primitive->mesh.QueueTangentSpaceUpdate(upload_buffer);
-			while (!normal_it.AtEnd()) {
-				glm::vec3 normal = normal_it.Get();
-				*dest = EncodeNormal(normal);
-				normal_it.Next();
-				dest++;
+			if (!Config::disable_mesh_optimization) {
+				GltfImport::OptimizePrimitive(&batch[i], !Config::disable_overdraw_optimization);
 			}
-		}
-	}
+			GltfImport::BuildPrimitiveMeshlets(&batch[i]);
+			if (!Config::disable_lod_generation) {
+				GltfImport::BuildPrimitiveLods(&batch[i]);
+			}
+			// Texture coordinates and colors share a quantized flag, so integer texture coordinates from the file quantize the rest.
+			bool integer_texcoords = !batch[i].quantized_texcoords[0].empty() || !batch[i].quantized_texcoords[1].empty();
+			if (Config::quantize_vertices || integer_texcoords) {
+				GltfImport::QuantizePrimitive(&batch[i], Config::quantize_vertices);
+			}
+			GltfImport::BuildPrimitiveMorphData(&batch[i]);
+		});
 
-	if (desc.flags & ::Mesh::FLAG_TEXCOORD_0) {
-		tinygltf::Accessor* texcoord_0_accessor = &gltf->accessors[gltf_primitive->attributes["TEXCOORD_0"]];
-		glm::vec2* dest = (glm::vec2*)primitive->mesh.QueueTexcoord0Update(upload_buffer);
-		tinygltf::tools::Copy(dest, gltf, texcoord_0_accessor);
-	}
+		for (int i = 0; i < batch.size(); i++) {
+			const PrimitiveReference& reference = primitive_references[batch_start + i];
+			const PrimitiveReference& source = primitive_references[sources[batch_start + i]];
+			bool result = sources[batch_start + i] == batch_start + i ?
+				consume(reference.mesh, reference.primitive, &batch[i]) :
+				share(reference.mesh, reference.primitive, source.mesh, source.primitive);
+			if (!result) {
+				return;
+			}
 
-	if (desc.flags & ::Mesh::FLAG_TEXCOORD_1) {
-		tinygltf::Accessor* texcoord_1_accessor = &gltf->accessors[gltf_primitive->attributes["TEXCOORD_1"]];
-		glm::vec2* dest = (glm::vec2*)primitive->mesh.QueueTexcoord1Update(upload_buffer);
-		tinygltf::tools::Copy(dest, gltf, texcoord_1_accessor);
-	}
+			num_of_meshlets += batch[i].meshlets.meshlets.size();
+			num_of_lods += batch[i].lods.lods.size();
+			quantization_stats += batch[i].quantization_stats;
+			mesh_before += batch[i].cache_stats_before;
+			mesh_after += batch[i].cache_stats_after;
+			if (reference.primitive == gltf->meshes[reference.mesh].primitives.size() - 1 && mesh_before.triangles > 0) {
+				SPDLOG_DEBUG("Mesh {}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}.", gltf->meshes[reference.mesh].name, mesh_before.GetAcmr(), mesh_after.GetAcmr(), mesh_before.GetAtvr(), mesh_after.GetAtvr());
+				total_before += mesh_before;
+				total_after += mesh_after;
+				mesh_before = {};
+				mesh_after = {};
+			}
+		}
 
-	if (desc.flags & ::Mesh::FLAG_COLOR) {
-		tinygltf::Accessor* color_accessor = &gltf->accessors[gltf_primitive->attributes["COLOR_0"]];
-		glm::u16vec4* dest = (glm::u16vec4*)primitive->mesh.QueueColorUpdate(upload_buffer);
-		tinygltf::tools::Copy<4, uint16_t, true>(dest, gltf, color_accessor);
+		batch_start = batch_end;
 	}
-
-	// Create bone weights.
-	if (desc.flags & ::Mesh::FLAG_JOINT_WEIGHT) {
-		::Mesh::JointWeight* dest = (::Mesh::JointWeight*)primitive->mesh.QueueJointWeightUpdate(upload_buffer);
-		tinygltf::Accessor* joint_accessor = &gltf->accessors[gltf_primitive->attributes["JOINTS_0"]];
-		tinygltf::tools::Iterate<4, uint16_t>(gltf, joint_accessor, [&](int i, const glm::u32vec4& data) {
-			dest[i].joints = data;
-		});
-		tinygltf::Accessor* weight_accessor = &gltf->accessors[gltf_primitive->attributes["WEIGHTS_0"]];
-		tinygltf::tools::Iterate<4, uint16_t, true>(gltf, weight_accessor, [&](int i, const glm::vec4& data) {
-			dest[i].weights = data;
-		});
+	if (total_before.triangles > 0) {
+		SPDLOG_INFO("Optimized meshes for the vertex cache, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}.", total_before.GetAcmr(), total_after.GetAcmr(), total_before.GetAtvr(), total_after.GetAtvr());
 	}
-
-	// The material id is incremented by 1 so that an id of 0 will use the default material.
-	primitive->material_id = gltf_primitive->material + 1;
-	
-	// Create morph targets.
-	primitive->targets.resize(gltf_primitive->targets.size());
-	for (int i = 0; i < gltf_primitive->targets.size(); i++) {
-		CreateMorphTarget(gltf, &gltf_primitive->targets[i], gpu_allocator, upload_buffer, primitive->mesh.num_of_vertices, &primitive->targets[i]);
+	SPDLOG_INFO("Built {} meshlets.", num_of_meshlets);
+	SPDLOG_INFO("Built {} levels of detail.", num_of_lods);
+	if (Config::quantize_vertices) {
+		SPDLOG_INFO("Quantized vertices, {:.2f} MiB -> {:.2f} MiB.", quantization_stats.vertex_bytes_before / (1024.0 * 1024.0), quantization_stats.vertex_bytes_after / (1024.0 * 1024.0));
+		SPDLOG_INFO("Largest quantization error: position {:.2e} of the mesh bounds, texture coordinate {:.2e}, color {:.2e}.", quantization_stats.position_error, quantization_stats.texcoord_error, quantization_stats.color_error);
 	}
 }
 
-void Gltf::CreateMorphTarget(tinygltf::Model* gltf, std::map<std::string, int>* target, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer, int num_of_vertices, MorphTarget* morph_target)
+static ::Mesh::Desc GetMeshDesc(const GltfImport::PrimitiveData* data)
 {
-	ProfileZoneScoped();
+	::Mesh::Desc desc = {};
+	desc.topology = data->topology;
+	desc.index_format = data->index_format;
+	desc.num_of_vertices = data->num_of_vertices;
+	desc.num_of_indices = data->num_of_indices;
+	desc.num_of_lod_indices = data->lod_indices.size() / (data->index_format == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(uint32_t));
+	desc.flags |= data->index_format != DXGI_FORMAT_UNKNOWN ? ::Mesh::FLAG_INDEX : 0;
+	desc.flags |= !data->tangent_space.empty() ? ::Mesh::FLAG_TANGENT_SPACE : 0;
+	desc.flags |= !data->texcoords[0].empty() || !data->quantized_texcoords[0].empty() ? ::Mesh::FLAG_TEXCOORD_0 : 0;
+	desc.flags |= !data->texcoords[1].empty() || !data->quantized_texcoords[1].empty() ? ::Mesh::FLAG_TEXCOORD_1 : 0;
+	desc.flags |= !data->colors.empty() || !data->quantized_colors.empty() ? ::Mesh::FLAG_COLOR : 0;
+	desc.flags |= !data->joint_weights.empty() ? ::Mesh::FLAG_JOINT_WEIGHT : 0;
+	desc.flags |= !data->quantized_positions.empty() ? ::Mesh::FLAG_QUANTIZED_POSITION : 0;
+	bool quantized_attributes = !data->quantized_texcoords[0].empty() || !data->quantized_texcoords[1].empty() || !data->quantized_colors.empty();
+	desc.flags |= quantized_attributes ? ::Mesh::FLAG_QUANTIZED_ATTRIBUTES : 0;
+	desc.dequantization = data->dequantization;
+	return desc;
+}
 
-	MorphTarget::Desc desc = {};
+static MorphTargets::Desc GetMorphTargetsDesc(const GltfImport::MorphData* data, int num_of_vertices)
+{
+	MorphTargets::Desc desc = {};
 	desc.num_of_vertices = num_of_vertices;
-	desc.flags |= target->contains("POSITION") ? MorphTarget::FLAG_POSITION : 0;
-	desc.flags |= target->contains("NORMAL") ? MorphTarget::FLAG_TANGENT_SPACE : 0;
-
-	morph_target->Create(gpu_allocator, srv_uav_cbv_descriptors, &desc);
-
-	if (desc.flags & MorphTarget::FLAG_POSITION) {
-		glm::vec3* dest = (glm::vec3*)morph_target->QueuePositionUpdate(upload_buffer);
-		tinygltf::Accessor* accessor = &gltf->accessors[target->at("POSITION")];
-		tinygltf::tools::Copy(dest, gltf, accessor);
-	}
-
-	if (desc.flags & MorphTarget::FLAG_TANGENT_SPACE) {
-		if (target->contains("TANGENT")) {
-			tinygltf::Accessor* normal_accessor =  &gltf->accessors[target->at("NORMAL")];
-			auto normal_it = tinygltf::tools::Iterator<3, float>(gltf, normal_accessor);
-			tinygltf::Accessor* tangent_accessor =  &gltf->accessors[target->at("TANGENT")];
-			auto tangent_it = tinygltf::tools::Iterator<4, float>(gltf, tangent_accessor);
-			uint32_t* dest = (uint32_t*)morph_target->QueueTangentSpaceUpdate(upload_buffer);
-			while (!normal_it.AtEnd() && !tangent_it.AtEnd()) {
-				glm::vec3 normal = normal_it.Get();
-				glm::vec4 tangent = tangent_it.Get();
-				*dest = EncodeTangentSpace(normal, tangent);
-				normal_it.Next();
-				tangent_it.Next();
-				dest++;
-			}
-		} else {
-			tinygltf::Accessor* normal_accessor =  &gltf->accessors[target->at("NORMAL")];
-			auto normal_it = tinygltf::tools::Iterator<3, float>(gltf, normal_accessor);
-			uint32_t* dest = (uint32_t*)morph_target->QueueTangentSpaceUpdate(upload_buffer);
-			while (!normal_it.AtEnd()) {
-				glm::vec3 normal = normal_it.Get();
-				*dest = EncodeNormal(normal);
-				normal_it.Next();
-				dest++;
-			}
-		}
-	}
+	desc.num_of_deltas = data->targets.size();
+	desc.flags |= !data->positions.empty() ? MorphTargets::FLAG_POSITION : 0;
+	desc.flags |= !data->normals.empty() ? MorphTargets::FLAG_NORMAL : 0;
+	desc.flags |= !data->tangents.empty() ? MorphTargets::FLAG_TANGENT : 0;
+	return desc;
 }
 
-void Gltf::GetTextureTransform(tinygltf::Value* gltf_value, int* tex_coord, glm::vec2* offset, float* rotation, glm::vec2* scale)
+void Gltf::UploadPrimitive(GltfImport::PrimitiveData* data, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer, Primitive* primitive)
 {
-	*offset = glm::vec2(0.0, 0.0);
-	*rotation = 0.0;
-	*scale = glm::vec2(1.0, 1.0);
-	
-	if (!gltf_value->IsObject()) {
+	ProfileZoneScoped();
+	if (!data->valid) {
 		return;
 	}
 
-	auto offset_value = gltf_value->Get("offset");
-	if (offset_value.ArrayLen() == 2) {
-		*offset = glm::vec2(offset_value.Get(0).GetNumberAsDouble(), offset_value.Get(1).GetNumberAsDouble());
+	::Mesh::Desc desc = GetMeshDesc(data);
+	primitive->mesh.Create(gpu_allocator, srv_uav_cbv_descriptors, &desc);
+	primitive->meshlets = std::move(data->meshlets);
+	primitive->lods = std::move(data->lods);
+
+	// Begin uploading data.
+	if (desc.flags & ::Mesh::FLAG_INDEX) {
+		void* dest = primitive->mesh.QueueIndexUpdate(upload_buffer);
+		memcpy(dest, data->indices.data(), data->indices.size());
 	}
-	auto rotation_value = gltf_value->Get("rotation");
-	if (rotation_value.IsNumber()) {
-		*rotation = rotation_value.GetNumberAsDouble();
+
+	if (desc.num_of_lod_indices > 0) {
+		void* dest = primitive->mesh.QueueLodIndexUpdate(upload_buffer);
+		memcpy(dest, data->lod_indices.data(), data->lod_indices.size());
 	}
-	auto scale_value = gltf_value->Get("scale");
-	if (scale_value.ArrayLen() == 2) {
-		*scale = glm::vec2(scale_value.Get(0).GetNumberAsDouble(), scale_value.Get(1).GetNumberAsDouble());
+
+	void* dest = primitive->mesh.QueuePositionUpdate(upload_buffer);
+	if (desc.flags & ::Mesh::FLAG_QUANTIZED_POSITION) {
+		memcpy(dest, data->quantized_positions.data(), data->quantized_positions.size() * sizeof(glm::i16vec4));
+	} else {
+		memcpy(dest, data->positions.data(), data->positions.size() * sizeof(glm::vec3));
 	}
-	auto tex_coord_value = gltf_value->Get("texCoord");
-	if (tex_coord_value.IsInt()) {
-		int value = tex_coord_value.GetNumberAsInt();
-		if (value >= 0 && value < ::Mesh::MAX_TEXCOORDS) {
-			*tex_coord = value;
-		}
+
+	if (desc.flags & ::Mesh::FLAG_TANGENT_SPACE) {
+		void* dest = primitive->mesh.QueueTangentSpaceUpdate(upload_buffer);
+		memcpy(dest, data->tangent_space.data(), data->tangent_space.size() * sizeof(uint32_t));
 	}
-}
 
-Gltf::Material::Texture Gltf::GetTexture(tinygltf::Model* gltf, int texture_index, int tex_coord, tinygltf::Value* texture_transform, bool srgb, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer)
-{
-	Material::Texture material_texture;
-	if (texture_index != -1) {
-		tinygltf::Texture* texture = &gltf->textures[texture_index];
-		int texture_source = texture->source;
-		if (texture_source != -1) {
-			if (this->textures[texture_source].descriptor == -1) {
-				// Load the texture if not yet loaded.
-				LoadTexture(gltf, texture_source, srgb, gpu_allocator, upload_buffer);
-			}
-			material_texture = {
-				.texture = this->textures[texture_source].descriptor,
-				.sampler = texture->sampler == -1 ? 0 : sampler_descriptors->GetAbsoluteIndex(texture->sampler),
-				.tex_coord = tex_coord < ::Mesh::MAX_TEXCOORDS ? tex_coord : 0,
-			};
-			GetTextureTransform(texture_transform, &material_texture.tex_coord, &material_texture.offset, &material_texture.rotation, &material_texture.scale);
+	if (desc.flags & ::Mesh::FLAG_TEXCOORD_0) {
+		void* dest = primitive->mesh.QueueTexcoord0Update(upload_buffer);
+		if (desc.flags & ::Mesh::FLAG_QUANTIZED_ATTRIBUTES) {
+			memcpy(dest, data->quantized_texcoords[0].data(), data->quantized_texcoords[0].size() * sizeof(glm::u16vec2));
 		} else {
-			// TODO: Create a default magenta texture.
+			memcpy(dest, data->texcoords[0].data(), data->texcoords[0].size() * sizeof(glm::vec2));
 		}
 	}
-	return material_texture;
-}
-
-Gltf::Material::Texture Gltf::GetTexture(tinygltf::Model* gltf, tinygltf::TextureInfo* texture_info, bool srgb, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer)
-{
-	return GetTexture(gltf, texture_info->index, texture_info->texCoord, &texture_info->extensions["KHR_texture_transform"], srgb, gpu_allocator, upload_buffer);
-}
 
-Gltf::Material::Texture Gltf::GetTexture(tinygltf::Model* gltf, tinygltf::NormalTextureInfo* texture_info, float* scale, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer)
-{
-	*scale = texture_info->scale;
-	return GetTexture(gltf, texture_info->index, texture_info->texCoord, &texture_info->extensions["KHR_texture_transform"], false, gpu_allocator, upload_buffer);
-}
-
-Gltf::Material::Texture Gltf::GetTexture(tinygltf::Model* gltf, tinygltf::OcclusionTextureInfo* texture_info, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer)
-{
-	return GetTexture(gltf, texture_info->index, texture_info->texCoord, &texture_info->extensions["KHR_texture_transform"], false, gpu_allocator, upload_buffer);
-}
-
-Gltf::Material::Texture Gltf::GetTexture(tinygltf::Model* gltf, const tinygltf::Value* texture_info, float* scale, bool srgb, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer)
-{
-	Material::Texture desc;
-
-	if (!texture_info->IsObject()) {
-		return desc;
+	if (desc.flags & ::Mesh::FLAG_TEXCOORD_1) {
+		void* dest = primitive->mesh.QueueTexcoord1Update(upload_buffer);
+		if (desc.flags & ::Mesh::FLAG_QUANTIZED_ATTRIBUTES) {
+			memcpy(dest, data->quantized_texcoords[1].data(), data->quantized_texcoords[1].size() * sizeof(glm::u16vec2));
+		} else {
+			memcpy(dest, data->texcoords[1].data(), data->texcoords[1].size() * sizeof(glm::vec2));
+		}
 	}
 
-	auto index_value = texture_info->Get("index");
-	int index = index_value.GetNumberAsInt();
-	auto tex_coord_value = texture_info->Get("texCoord");
-	int tex_coord = tex_coord_value.GetNumberAsInt();
-	if (scale) {
-		auto scale_value = texture_info->Get("scale");
-		if (scale_value.IsNumber()) {
-			*scale = scale_value.GetNumberAsDouble();
+	if (desc.flags & ::Mesh::FLAG_COLOR) {
+		void* dest = primitive->mesh.QueueColorUpdate(upload_buffer);
+		if (desc.flags & ::Mesh::FLAG_QUANTIZED_ATTRIBUTES) {
+			memcpy(dest, data->quantized_colors.data(), data->quantized_colors.size() * sizeof(glm::u8vec4));
+		} else {
+			memcpy(dest, data->colors.data(), data->colors.size() * sizeof(glm::u16vec4));
 		}
 	}
-	auto extensions = texture_info->Get("extensions");
-	tinygltf::Value transform_extension;
-	if (extensions.IsObject()) {
-		transform_extension = extensions.Get("KHR_texture_transform");
+
+	if (desc.flags & ::Mesh::FLAG_JOINT_WEIGHT) {
+		static_assert(sizeof(GltfImport::JointWeight) == sizeof(::Mesh::JointWeight));
+		void* dest = primitive->mesh.QueueJointWeightUpdate(upload_buffer);
+		memcpy(dest, data->joint_weights.data(), data->joint_weights.size() * sizeof(GltfImport::JointWeight));
 	}
 
-	return GetTexture(gltf, index, tex_coord, &transform_extension, srgb, gpu_allocator, upload_buffer);
+	primitive->material_id = data->material_id;
+	
+	// Create morph targets.
+	primitive->num_of_targets = data->morph.num_of_targets;
+	if (!data->morph.targets.empty()) {
+		UploadMorphTargets(&data->morph, gpu_allocator, upload_buffer, primitive->mesh.num_of_vertices, &primitive->morph_targets);
+	}
 }
 
-void Gltf::LoadMaterials(tinygltf::Model* gltf, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer)
+void Gltf::UploadMorphTargets(GltfImport::MorphData* data, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer, int num_of_vertices, MorphTargets* morph_targets)
 {
 	ProfileZoneScoped();
-	materials.resize(gltf->materials.size() + 1);
-	for (int i = 0; i < gltf->materials.size(); i++) {
-		tinygltf::Material* tiny_gltf_material = &gltf->materials[i];
-
-		// Material indexes are incremented so that we can put a default material at 0.
-		Material& material = materials[i+1];
-
-		// Normal map.
-		tinygltf::NormalTextureInfo* normal_texture_info = &tiny_gltf_material->normalTexture;
-		material.normal = GetTexture(gltf, normal_texture_info, &material.normal_map_scale, gpu_allocator, upload_buffer);
-
-		// Albedo.
-		tinygltf::TextureInfo* albedo_texture_info = &tiny_gltf_material->pbrMetallicRoughness.baseColorTexture;
-		material.albedo = GetTexture(gltf, albedo_texture_info, true, gpu_allocator, upload_buffer);
-		material.base_color_factor = glm::vec4(
-			tiny_gltf_material->pbrMetallicRoughness.baseColorFactor[0],
-			tiny_gltf_material->pbrMetallicRoughness.baseColorFactor[1],
-			tiny_gltf_material->pbrMetallicRoughness.baseColorFactor[2],
-			tiny_gltf_material->pbrMetallicRoughness.baseColorFactor[3]
-		);
-
-		// Metalness and roughness.
-		tinygltf::TextureInfo* metallic_roughness_texture_info = &tiny_gltf_material->pbrMetallicRoughness.metallicRoughnessTexture;
-		material.metallic_roughness = GetTexture(gltf, metallic_roughness_texture_info, false, gpu_allocator, upload_buffer);
-		material.metalness_factor = tiny_gltf_material->pbrMetallicRoughness.metallicFactor;
-		material.roughness_factor = tiny_gltf_material->pbrMetallicRoughness.roughnessFactor;
-
-		// Occlusion.
-		tinygltf::OcclusionTextureInfo* occlusion_texture_info = &tiny_gltf_material->occlusionTexture;
-		material.occlusion = GetTexture(gltf, occlusion_texture_info, gpu_allocator, upload_buffer);
-
-		// Emissive.
-		tinygltf::TextureInfo* emissive_texture_info = &tiny_gltf_material->emissiveTexture;
-		material.emissive = GetTexture(gltf, emissive_texture_info, true, gpu_allocator, upload_buffer);
-		material.emissive_factor = glm::vec3(tiny_gltf_material->emissiveFactor[0], tiny_gltf_material->emissiveFactor[1], tiny_gltf_material->emissiveFactor[2]);
-
-		// Alpha.
-		if (tiny_gltf_material->alphaMode == "OPAQUE") {
-			material.alpha_mode = Material::ALPHA_MODE_OPAQUE;
-		} else if (tiny_gltf_material->alphaMode == "MASK") {
-			material.alpha_mode = Material::ALPHA_MODE_MASK;
-		} else if (tiny_gltf_material->alphaMode == "BLEND") {
-			material.alpha_mode = Material::ALPHA_MODE_BLEND;
-		}
-		material.alpha_cutoff = tiny_gltf_material->alphaCutoff;
-
-		// Double sided.
-		if (tiny_gltf_material->doubleSided) {
-			material.flags |= Material::FLAG_DOUBLE_SIDED;
-		}
-		
-		// Anisotropy.
-		{
-			auto it = tiny_gltf_material->extensions.find("KHR_materials_anisotropy");
-			if (it != tiny_gltf_material->extensions.end()) {
-				tinygltf::tools::GetValue(it->second, "anisotropyStrength", &material.anisotropy_strength);
-				tinygltf::tools::GetValue(it->second, "anisotropyRotation", &material.anisotropy_rotation);
-				material.anisotropy_texture = GetTexture(gltf, &it->second.Get("anisotropyTexture"), nullptr, false, gpu_allocator, upload_buffer);
-			}
-		}
 
-		// Clearcoat.
-		{
-			auto it = tiny_gltf_material->extensions.find("KHR_materials_clearcoat");
-			if (it != tiny_gltf_material->extensions.end()) {
-				tinygltf::tools::GetValue(it->second, "clearcoatFactor", &material.clearcoat_factor);
-				tinygltf::tools::GetValue(it->second, "clearcoatRoughnessFactor", &material.clearcoat_roughness_factor);
-				material.clearcoat_texture = GetTexture(gltf, &it->second.Get("clearcoatTexture"), nullptr, false, gpu_allocator, upload_buffer);
-				material.clearcoat_roughness_texture = GetTexture(gltf, &it->second.Get("clearcoatRoughnessTexture"), nullptr, false, gpu_allocator, upload_buffer);
-				material.clearcoat_normal_texture = GetTexture(gltf, &it->second.Get("clearcoatNormalTexture"), &material.clearcoat_normal_scale, false, gpu_allocator, upload_buffer);
-			}
-		}
-
-		// Dispersion.
-		{
-			auto it = tiny_gltf_material->extensions.find("KHR_dispersion");
-			if (it != tiny_gltf_material->extensions.end()) {
-				tinygltf::tools::GetValue(it->second, "dispersion", &material.dispersion);
-			}
-		}
-
-		// Emissive strength.
-		{
-			auto it = tiny_gltf_material->extensions.find("KHR_materials_emissive_strength");
-			if (it != tiny_gltf_material->extensions.end()) {
-				tinygltf::tools::GetValue(it->second, "emissiveStrength", &material.emissive_strength);
-			}
-		}
-		
-		// Index of refraction.
-		{
-			auto it = tiny_gltf_material->extensions.find("KHR_materials_ior");
-			if (it != tiny_gltf_material->extensions.end()) {
-				tinygltf::tools::GetValue(it->second, "ior", &material.ior);
-			}
-		}
+	MorphTargets::Desc desc = GetMorphTargetsDesc(data, num_of_vertices);
+	morph_targets->Create(gpu_allocator, srv_uav_cbv_descriptors, &desc);
 
-		// Iridescence.
-		{
-			auto it = tiny_gltf_material->extensions.find("KHR_materials_iridescence");
-			if (it != tiny_gltf_material->extensions.end()) {
-				tinygltf::tools::GetValue(it->second, "iridescenceFactor", &material.iridescence_factor);
-				tinygltf::tools::GetValue(it->second, "iridescenceIor", &material.iridescence_ior);
-				tinygltf::tools::GetValue(it->second, "iridescenceThicknessMinimum", &material.iridescence_thickness_minimum);
-				tinygltf::tools::GetValue(it->second, "iridescenceThicknessMaximum", &material.iridescence_thickness_maximum);
-				material.iridescence_texture = GetTexture(gltf, &it->second.Get("iridescenceTexture"), nullptr, false, gpu_allocator, upload_buffer);
-				material.iridescence_thickness_texture = GetTexture(gltf, &it->second.Get("iridescenceThicknessTexture"), nullptr, false, gpu_allocator, upload_buffer);
-			}
-		}
+	memcpy(morph_targets->QueueDeltaOffsetUpdate(upload_buffer), data->delta_offsets.data(), data->delta_offsets.size() * sizeof(uint32_t));
+	memcpy(morph_targets->QueueTargetUpdate(upload_buffer), data->targets.data(), data->targets.size() * sizeof(uint32_t));
 
-		// Sheen.
-		{
-			auto it = tiny_gltf_material->extensions.find("KHR_materials_sheen");
-			if (it != tiny_gltf_material->extensions.end()) {
-				tinygltf::tools::GetValue(it->second, "sheenColorFactor", &material.sheen_color_factor);
-				tinygltf::tools::GetValue(it->second, "sheenRoughnessFactor", &material.sheen_roughness_factor);
-				material.sheen_color_texture = GetTexture(gltf, &it->second.Get("sheenColorTexture"), nullptr, true, gpu_allocator, upload_buffer);
-				material.sheen_roughness_texture = GetTexture(gltf, &it->second.Get("sheenRoughnessTexture"), nullptr, false, gpu_allocator, upload_buffer);
-			}
-		}
+	if (desc.flags & MorphTargets::FLAG_POSITION) {
+		void* dest = morph_targets->QueuePositionUpdate(upload_buffer);
+		memcpy(dest, data->positions.data(), data->positions.size() * sizeof(glm::vec3));
+	}
 
-		// Specular.
-		{
-			auto it = tiny_gltf_material->extensions.find("KHR_materials_specular");
-			if (it != tiny_gltf_material->extensions.end()) {
-				tinygltf::tools::GetValue(it->second, "specularFactor", &material.specular_factor);
-				tinygltf::tools::GetValue(it->second, "specularColorFactor", &material.specular_color_factor);
-				material.specular_texture = GetTexture(gltf, &it->second.Get("specularTexture"), nullptr, false, gpu_allocator, upload_buffer);
-				material.specular_color_texture = GetTexture(gltf, &it->second.Get("specularColorTexture"), nullptr, true, gpu_allocator, upload_buffer);
-			}
-		}
+	if (desc.flags & MorphTargets::FLAG_NORMAL) {
+		void* dest = morph_targets->QueueNormalUpdate(upload_buffer);
+		memcpy(dest, data->normals.data(), data->normals.size() * sizeof(glm::vec3));
+	}
 
-		// Transmission.
-		{
-			auto it = tiny_gltf_material->extensions.find("KHR_materials_transmission");
-			if (it != tiny_gltf_material->extensions.end()) {
-				tinygltf::tools::GetValue(it->second, "transmissionFactor", &material.transmission_factor);
-				material.transmission_texture = GetTexture(gltf, &it->second.Get("transmissionTexture"), nullptr, false, gpu_allocator, upload_buffer);
-			}
-		}
+	if (desc.flags & MorphTargets::FLAG_TANGENT) {
+		void* dest = morph_targets->QueueTangentUpdate(upload_buffer);
+		memcpy(dest, data->tangents.data(), data->tangents.size() * sizeof(glm::vec3));
+	}
+}
 
-		// Volume.
-		{
-			auto it = tiny_gltf_material->extensions.find("KHR_materials_volume");
-			if (it != tiny_gltf_material->extensions.end()) {
-				tinygltf::tools::GetValue(it->second, "thicknessFactor", &material.thickness_factor);
-				material.thickness_texture = GetTexture(gltf, &it->second.Get("thicknessTexture"), nullptr, false, gpu_allocator, upload_buffer);
-				tinygltf::tools::GetValue(it->second, "attenuationDistance", &material.attenuation_distance);
-				tinygltf::tools::GetValue(it->second, "attenuationColor", &material.attenuation_color);
-			}
-		}
+void Gltf::SharePrimitive(const Primitive& source, Primitive* primitive)
+{
+	// The material is kept, as it isn't part of the shared data.
+	primitive->mesh = source.mesh;
+	primitive->num_of_targets = source.num_of_targets;
+	primitive->morph_targets = source.morph_targets;
+	primitive->meshlets = source.meshlets;
+	primitive->lods = source.lods;
+	primitive->shares_mesh = true;
+}
 
-		// Unlit.
-		{
-			auto it = tiny_gltf_material->extensions.find("KHR_materials_unlit");
-			if (it != tiny_gltf_material->extensions.end()) {
-				material.flags |= Material::Flags::FLAG_UNLIT;
-			}
-		}
+void Gltf::LoadMaterials(tinygltf::Model* gltf)
+{
+	ProfileZoneScoped();
+	std::vector<GltfImport::ImageUsage> images(this->textures.size());
+	for (int i = 0; i < this->textures.size(); i++) {
+		images[i] = {
+			.duplicate_of = this->textures[i].duplicate_of,
+			.format = this->textures[i].format,
+			.channels = this->textures[i].channels,
+			.alpha_cutoff = this->textures[i].alpha_cutoff,
+		};
+	}
+	GltfImport::ConvertMaterials(gltf, &this->materials, &images);
+	for (int i = 0; i < this->textures.size(); i++) {
+		this->textures[i].format = images[i].format;
+		this->textures[i].channels = images[i].channels;
+		this->textures[i].alpha_cutoff = images[i].alpha_cutoff;
 	}
 }
 
@@ -653,6 +478,55 @@ void Gltf::LoadCameras(tinygltf::Model* gltf)
 	}
 }
 
+// Reads the TRANSLATION, ROTATION and SCALE attributes of EXT_mesh_gpu_instancing into a transform per instance.
+static void LoadInstances(tinygltf::Model* gltf, const tinygltf::Value& extension, std::vector<glm::mat4x4>* instances)
+{
+	ProfileZoneScoped();
+	const tinygltf::Value& attributes = extension.Get("attributes");
+	auto get_accessor = [&](const char* name) -> tinygltf::Accessor* {
+		const tinygltf::Value& value = attributes.Get(name);
+		if (!value.IsInt() || value.GetNumberAsInt() < 0 || value.GetNumberAsInt() >= gltf->accessors.size()) {
+			return nullptr;
+		}
+		return &gltf->accessors[value.GetNumberAsInt()];
+	};
+	tinygltf::Accessor* translation_accessor = get_accessor("TRANSLATION");
+	tinygltf::Accessor* rotation_accessor = get_accessor("ROTATION");
+	tinygltf::Accessor* scale_accessor = get_accessor("SCALE");
+
+	// Every attribute must have the same number of instances.
+	size_t count = 0;
+	bool valid = true;
+	for (const tinygltf::Accessor* accessor: {translation_accessor, rotation_accessor, scale_accessor}) {
+		if (accessor) {
+			valid &= count == 0 || accessor->count == count;
+			count = accessor->count;
+		}
+	}
+	if (!valid) {
+		SPDLOG_WARN("EXT_mesh_gpu_instancing attributes have different counts, instances are ignored.");
+		return;
+	}
+
+	std::vector<glm::vec3> translations(count, glm::vec3(0.0f));
+	std::vector<glm::vec4> rotations(count, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	std::vector<glm::vec3> scales(count, glm::vec3(1.0f));
+	if (translation_accessor) {
+		tinygltf::tools::Copy(translations.data(), gltf, translation_accessor);
+	}
+	if (rotation_accessor) {
+		tinygltf::tools::Copy(rotations.data(), gltf, rotation_accessor);
+	}
+	if (scale_accessor) {
+		tinygltf::tools::Copy(scales.data(), gltf, scale_accessor);
+	}
+	instances->resize(count);
+	for (int i = 0; i < count; i++) {
+		glm::quat rotation(rotations[i].x, rotations[i].y, rotations[i].z, rotations[i].w);
+		(*instances)[i] = glm::translate(translations[i]) * glm::mat4_cast(rotation) * glm::scale(scales[i]);
+	}
+}
+
 void Gltf::LoadNodes(tinygltf::Model* gltf)
 {
 	ProfileZoneScoped();
@@ -688,12 +562,17 @@ void Gltf::LoadNodes(tinygltf::Model* gltf)
 			node.weights[j] = tiny_gltf_node.weights[j];
 		}
 		if (node.mesh_id != -1) {
-			node.current_weights.assign(meshes[node.mesh_id].primitives[0].targets.size(), 0.0f);
+			node.current_weights.assign(meshes[node.mesh_id].primitives[0].num_of_targets, 0.0f);
 		}
 
 		node.camera_id = tiny_gltf_node.camera;
 		node.light_id = tiny_gltf_node.light;
 
+		auto instancing = tiny_gltf_node.extensions.find("EXT_mesh_gpu_instancing");
+		if (instancing != tiny_gltf_node.extensions.end() && node.mesh_id != -1) {
+			LoadInstances(gltf, instancing->second, &node.instances);
+		}
+
 		// Convert into a child-sibling binary tree.
 		if (tiny_gltf_node.children.size() > 0) {
 			node.child = tiny_gltf_node.children[0];
@@ -702,6 +581,52 @@ void Gltf::LoadNodes(tinygltf::Model* gltf)
 			}
 		}
 	}
+	BuildTransformHierarchy();
+}
+
+void Gltf::BuildTransformHierarchy()
+{
+	std::vector<int> children(this->nodes.size());
+	std::vector<int> siblings(this->nodes.size());
+	for (int i = 0; i < this->nodes.size(); i++) {
+		children[i] = this->nodes[i].child;
+		siblings[i] = this->nodes[i].sibling;
+	}
+	this->transforms.Build(children, siblings);
+	this->skinned_nodes.clear();
+	for (int i = 0; i < this->nodes.size(); i++) {
+		ApplyRestTransform(i);
+		if (this->nodes[i].skin_id != -1) {
+			this->skinned_nodes.push_back(i);
+		}
+	}
+	BuildRenderLists();
+}
+
+void Gltf::BuildRenderLists()
+{
+	ProfileZoneScoped();
+	for (Scene& scene: this->scenes) {
+		scene.mesh_nodes.clear();
+		scene.light_nodes.clear();
+		scene.dynamic_nodes.clear();
+		for (int root: scene.nodes) {
+			int start = this->transforms.positions[root];
+			for (int i = start; i < this->transforms.subtree_ends[start]; i++) {
+				int node_id = this->transforms.order[i];
+				const Node& node = this->nodes[node_id];
+				if (node.mesh_id != -1) {
+					scene.mesh_nodes.push_back(node_id);
+				}
+				if (node.light_id != -1) {
+					scene.light_nodes.push_back(node_id);
+				}
+				if (node.skin_id != -1 || node.current_weights.size() > 0) {
+					scene.dynamic_nodes.push_back(node_id);
+				}
+			}
+		}
+	}
 }
 
 void Gltf::LoadAnimations(tinygltf::Model* gltf)
@@ -836,19 +761,23 @@ void Gltf::LoadSkins(tinygltf::Model* gltf)
 	}
 }
 
+static D3D12_SAMPLER_DESC GetSamplerDesc(const tinygltf::Sampler* gltf_sampler)
+{
+	return {
+		.Filter = tinygltf::tools::TextureFilterConversion(gltf_sampler->minFilter, gltf_sampler->magFilter),
+		.AddressU = tinygltf::tools::TextureAddressConversion(gltf_sampler->wrapS),
+		.AddressV = tinygltf::tools::TextureAddressConversion(gltf_sampler->wrapT),
+		.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP,
+		.MinLOD = 0.0f,
+		.MaxLOD = (gltf_sampler->minFilter == TINYGLTF_TEXTURE_FILTER_NEAREST) || (gltf_sampler->minFilter == TINYGLTF_TEXTURE_FILTER_LINEAR) ? 0.0f : std::numeric_limits<float>::max(),
+	};
+}
+
 void Gltf::LoadSamplers(tinygltf::Model* gltf)
 {
 	ProfileZoneScoped();
 	for (int i = 0; i < gltf->samplers.size(); i++) {
-		const tinygltf::Sampler& gltf_sampler = gltf->samplers[i];
-		D3D12_SAMPLER_DESC sampler_desc = {
-			.Filter = tinygltf::tools::TextureFilterConversion(gltf_sampler.minFilter, gltf_sampler.magFilter),
-			.AddressU = tinygltf::tools::TextureAddressConversion(gltf_sampler.wrapS),
-			.AddressV = tinygltf::tools::TextureAddressConversion(gltf_sampler.wrapT),
-			.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP,
-			.MinLOD = 0.0f,
-			.MaxLOD = (gltf_sampler.minFilter == TINYGLTF_TEXTURE_FILTER_NEAREST) || (gltf_sampler.minFilter == TINYGLTF_TEXTURE_FILTER_LINEAR) ? 0.0f : std::numeric_limits<float>::max(),
-		};
+		D3D12_SAMPLER_DESC sampler_desc = GetSamplerDesc(&gltf->samplers[i]);
 		sampler_descriptors->CreateSampler(sampler_descriptors->GetAbsoluteIndex(i), &sampler_desc);
 	}
 }
@@ -881,71 +810,692 @@ void Gltf::LoadLights(tinygltf::Model* gltf)
 	}
 }
 
-void Gltf::Init(CbvSrvUavPool* srv_uav_cbv_descriptors, SamplerStack* sampler_descriptors)
+void Gltf::Init(CbvSrvUavPool* srv_uav_cbv_descriptors, SamplerStack* sampler_descriptors, ThreadPool* thread_pool)
 {
 	this->srv_uav_cbv_descriptors = srv_uav_cbv_descriptors;
 	this->sampler_descriptors = sampler_descriptors;
+	this->thread_pool = thread_pool;
+}
+
+// Every texture slot of a material.
+static std::array<Gltf::Material::Texture*, 17> GetMaterialTextures(Gltf::Material* material)
+{
+	return {
+		&material->albedo,
+		&material->normal,
+		&material->metallic_roughness,
+		&material->occlusion,
+		&material->emissive,
+		&material->anisotropy_texture,
+		&material->clearcoat_texture,
+		&material->clearcoat_roughness_texture,
+		&material->clearcoat_normal_texture,
+		&material->iridescence_texture,
+		&material->iridescence_thickness_texture,
+		&material->sheen_color_texture,
+		&material->sheen_roughness_texture,
+		&material->specular_texture,
+		&material->specular_color_texture,
+		&material->transmission_texture,
+		&material->thickness_texture,
+	};
 }
 
 bool Gltf::LoadFromGltf(const char* filepath, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer)
 {
 	ProfileZoneScoped();
-	tinygltf::TinyGLTF gltf;
+	Timer timer;
+	timer.Create();
 	tinygltf::Model model;
-	std::string error, warning;
-	bool result = false;
-
-	std::filesystem::path path(filepath);
-	if (path.extension() == ".glb") {
-		ProfileZoneScopedN("LoadBinaryFromFile");
-		result = gltf.LoadBinaryFromFile(&model, &error, &warning, filepath);
-	} else if (path.extension() == ".gltf") {
-		ProfileZoneScopedN("LoadASCIIFromFile");
-		result = gltf.LoadASCIIFromFile(&model, &error, &warning, filepath);
-	} else {
+	GltfImport::MappedGlb mapped_glb;
+	std::vector<std::vector<unsigned char>> encoded_images;
+	if (!GltfImport::ParseGltf(filepath, !Config::disable_memory_mapping, &model, &mapped_glb, &encoded_images, this->thread_pool)) {
 		Unload();
-		result = false;
-	}
-	if (!error.empty()) {
-		SPDLOG_ERROR(error);
-	}
-	if (!warning.empty()) {
-		SPDLOG_WARN(warning);
+		return false;
 	}
-	if (!result) {
+	ReserveTextures(&model, &encoded_images);
+	if (!DecodeImages(&model, &encoded_images)) {
 		Unload();
 		return false;
 	}
-	filename = path.filename().string();
-
-	// Check for any unsupported extensions.
-	for (auto extension: model.extensionsRequired) {
-		if (
-			extension != "KHR_lights_punctual" && 
-			extension != "KHR_texture_transform" &&
-			extension != "KHR_materials_ior" &&
-			extension != "KHR_materials_specular" &&
-			extension != "KHR_materials_anisotropy" &&
-			extension != "KHR_materials_sheen"
-		) {
-			return false;
-		}
-	}
+	filename = std::filesystem::path(filepath).filename().string();
 
 	LoadSamplers(&model);
-	ReserveTextures(&model);
 	LoadMeshes(&model, gpu_allocator, upload_buffer);
-	LoadMaterials(&model, gpu_allocator, upload_buffer);
+	LoadMaterials(&model);
+	PrepareTextures(&model);
+	LoadTextures(&model, gpu_allocator, upload_buffer);
+	ResolveMaterialTextures();
 	LoadScenes(&model);
 	LoadNodes(&model);
 	LoadSkins(&model);
 	LoadAnimations(&model);
 	LoadLights(&model);
 	CreateDynamicMesh(gpu_allocator);
+	LogMemoryUsage();
 
+	SPDLOG_INFO("Loaded {} in {:.3f}s{}, peak memory usage {} MiB.", filename, timer.Delta(), mapped_glb.data ? " (memory mapped)" : "", GetPeakMemoryUsage() >> 20);
 	return true;
 }
 
+bool Gltf::Cook(const char* filepath, const char* cooked_filepath, ThreadPool* thread_pool)
+{
+	ProfileZoneScoped();
+	Timer timer;
+	timer.Create();
+
+	// Only the CPU side of loading is used, so no descriptors or GPU resources are needed.
+	Gltf scene;
+	scene.srv_uav_cbv_descriptors = nullptr;
+	scene.sampler_descriptors = nullptr;
+	scene.thread_pool = thread_pool;
+
+	uint64_t source_hash = 0;
+	uint64_t source_size = 0;
+	if (!CookedScene::HashFile(filepath, &source_hash, &source_size)) {
+		SPDLOG_ERROR("Failed to read {}.", filepath);
+		return false;
+	}
+	tinygltf::Model model;
+	GltfImport::MappedGlb mapped_glb;
+	std::vector<std::vector<unsigned char>> encoded_images;
+	if (!GltfImport::ParseGltf(filepath, !Config::disable_memory_mapping, &model, &mapped_glb, &encoded_images, thread_pool)) {
+		return false;
+	}
+	scene.ReserveTextures(&model, &encoded_images);
+	if (!scene.DecodeImages(&model, &encoded_images)) {
+		return false;
+	}
+
+	CookedScene::Writer writer;
+	if (!writer.Open(cooked_filepath)) {
+		SPDLOG_ERROR("Failed to create {}.", cooked_filepath);
+		return false;
+	}
+
+	// Vertex and index streams are written as each batch of primitives is converted.
+	// Primitives are converted in mesh order, so each mesh's primitives end up next to each other.
+	std::vector<CookedScene::Primitive> cooked_primitives;
+	scene.LoadMeshLayout(&model);
+	std::vector<uint32_t> first_primitives(scene.meshes.size());
+	for (int i = 1; i < scene.meshes.size(); i++) {
+		first_primitives[i] = first_primitives[i - 1] + scene.meshes[i - 1].primitives.size();
+	}
+	scene.ConvertMeshes(&model, [&](int mesh_id, int primitive_id, GltfImport::PrimitiveData* data) {
+		CookedScene::Primitive& cooked = cooked_primitives.emplace_back();
+		cooked.valid = data->valid;
+		if (!data->valid) {
+			return true;
+		}
+		::Mesh::Desc desc = GetMeshDesc(data);
+		cooked.topology = desc.topology;
+		cooked.index_format = desc.index_format;
+		cooked.num_of_vertices = desc.num_of_vertices;
+		cooked.num_of_indices = desc.num_of_indices;
+		cooked.flags = desc.flags;
+		cooked.material_id = data->material_id;
+		cooked.streams[CookedScene::STREAM_INDEX] = writer.Write(data->indices);
+		if (desc.flags & ::Mesh::FLAG_QUANTIZED_POSITION) {
+			cooked.streams[CookedScene::STREAM_POSITION] = writer.Write(data->quantized_positions);
+		} else {
+			cooked.streams[CookedScene::STREAM_POSITION] = writer.Write(data->positions);
+		}
+		cooked.streams[CookedScene::STREAM_TANGENT_SPACE] = writer.Write(data->tangent_space);
+		if (desc.flags & ::Mesh::FLAG_QUANTIZED_ATTRIBUTES) {
+			cooked.streams[CookedScene::STREAM_TEXCOORD_0] = writer.Write(data->quantized_texcoords[0]);
+			cooked.streams[CookedScene::STREAM_TEXCOORD_1] = writer.Write(data->quantized_texcoords[1]);
+			cooked.streams[CookedScene::STREAM_COLOR] = writer.Write(data->quantized_colors);
+		} else {
+			cooked.streams[CookedScene::STREAM_TEXCOORD_0] = writer.Write(data->texcoords[0]);
+			cooked.streams[CookedScene::STREAM_TEXCOORD_1] = writer.Write(data->texcoords[1]);
+			cooked.streams[CookedScene::STREAM_COLOR] = writer.Write(data->colors);
+		}
+		cooked.streams[CookedScene::STREAM_JOINT_WEIGHT] = writer.Write(data->joint_weights);
+		cooked.num_of_meshlets = data->meshlets.meshlets.size();
+		cooked.num_of_meshlet_vertices = data->meshlets.vertices.size();
+		cooked.num_of_meshlet_triangles = data->meshlets.triangles.size() / 3;
+		cooked.streams[CookedScene::STREAM_MESHLETS] = writer.Write(data->meshlets.meshlets);
+		cooked.streams[CookedScene::STREAM_MESHLET_BOUNDS] = writer.Write(data->meshlets.bounds);
+		cooked.streams[CookedScene::STREAM_MESHLET_VERTICES] = writer.Write(data->meshlets.vertices);
+		cooked.streams[CookedScene::STREAM_MESHLET_TRIANGLES] = writer.Write(data->meshlets.triangles);
+		cooked.num_of_lods = data->lods.lods.size();
+		cooked.num_of_lod_indices = desc.num_of_lod_indices;
+		cooked.lod_center[0] = data->lods.center.x;
+		cooked.lod_center[1] = data->lods.center.y;
+		cooked.lod_center[2] = data->lods.center.z;
+		cooked.lod_radius = data->lods.radius;
+		for (int i = 0; i < 3; i++) {
+			cooked.position_scale[i] = desc.dequantization.position_scale[i];
+			cooked.position_offset[i] = desc.dequantization.position_offset[i];
+		}
+		for (int i = 0; i < 2; i++) {
+			for (int j = 0; j < 4; j++) {
+				cooked.texcoord_transforms[i][j] = desc.dequantization.texcoord_transforms[i][j];
+			}
+		}
+		cooked.streams[CookedScene::STREAM_LOD_INDEX] = writer.Write(data->lod_indices);
+		cooked.streams[CookedScene::STREAM_LODS] = writer.Write(data->lods.lods);
+		MorphTargets::Desc morph_desc = GetMorphTargetsDesc(&data->morph, data->num_of_vertices);
+		cooked.num_of_targets = data->morph.num_of_targets;
+		cooked.morph_flags = morph_desc.flags;
+		cooked.num_of_morph_deltas = morph_desc.num_of_deltas;
+		cooked.streams[CookedScene::STREAM_MORPH_DELTA_OFFSETS] = writer.Write(data->morph.delta_offsets);
+		cooked.streams[CookedScene::STREAM_MORPH_TARGETS] = writer.Write(data->morph.targets);
+		cooked.streams[CookedScene::STREAM_MORPH_POSITIONS] = writer.Write(data->morph.positions);
+		cooked.streams[CookedScene::STREAM_MORPH_NORMALS] = writer.Write(data->morph.normals);
+		cooked.streams[CookedScene::STREAM_MORPH_TANGENTS] = writer.Write(data->morph.tangents);
+		return true;
+	}, [&](int mesh_id, int primitive_id, int source_mesh_id, int source_primitive_id) {
+		// Duplicates point at the same streams, which is how they are found again when loading.
+		CookedScene::Primitive cooked = cooked_primitives[first_primitives[source_mesh_id] + source_primitive_id];
+		cooked.material_id = scene.meshes[mesh_id].primitives[primitive_id].material_id;
+		cooked_primitives.push_back(cooked);
+		return true;
+	});
+
+	scene.LoadMaterials(&model);
+	scene.PrepareTextures(&model);
+	scene.LoadScenes(&model);
+	scene.LoadNodes(&model);
+	scene.LoadSkins(&model);
+	scene.LoadAnimations(&model);
+	scene.LoadLights(&model);
+
+	// Textures.
+	std::vector<CookedScene::Texture> cooked_textures(model.images.size());
+	for (int i = 0; i < model.images.size(); i++) {
+		tinygltf::Image& image = model.images[i];
+		CookedScene::Texture& cooked = cooked_textures[i];
+		cooked.name = writer.Write(image.name);
+		cooked.format = scene.textures[i].format;
+		cooked.component_mapping = scene.textures[i].component_mapping;
+		cooked.duplicate_of = scene.textures[i].duplicate_of;
+		if (cooked.format != DXGI_FORMAT_UNKNOWN) {
+			assert(image.component == 4);
+			assert(image.bits == 8);
+			assert(image.image.size() == GetTextureSize(scene.textures[i].format, image.width, image.height));
+			cooked.width = image.width;
+			cooked.height = image.height;
+			cooked.data = writer.Write(image.image);
+		}
+		std::vector<unsigned char>().swap(image.image);
+	}
+
+	// Samplers.
+	std::vector<D3D12_SAMPLER_DESC> cooked_samplers(model.samplers.size());
+	for (int i = 0; i < model.samplers.size(); i++) {
+		cooked_samplers[i] = GetSamplerDesc(&model.samplers[i]);
+	}
+
+	// Meshes.
+	std::vector<CookedScene::Mesh> cooked_meshes(scene.meshes.size());
+	for (int i = 0; i < scene.meshes.size(); i++) {
+		cooked_meshes[i].name = writer.Write(scene.meshes[i].name);
+		cooked_meshes[i].primitives = {first_primitives[i], (uint32_t)scene.meshes[i].primitives.size()};
+		cooked_meshes[i].weights = writer.Write(scene.meshes[i].weights);
+	}
+
+	// Scenes.
+	std::vector<CookedScene::Scene> cooked_scenes(scene.scenes.size());
+	for (int i = 0; i < scene.scenes.size(); i++) {
+		cooked_scenes[i].name = writer.Write(scene.scenes[i].name);
+		cooked_scenes[i].nodes = writer.Write(scene.scenes[i].nodes);
+	}
+
+	// Nodes.
+	std::vector<CookedScene::Node> cooked_nodes(scene.nodes.size());
+	for (int i = 0; i < scene.nodes.size(); i++) {
+		const Node& node = scene.nodes[i];
+		CookedScene::Node& cooked = cooked_nodes[i];
+		cooked.name = writer.Write(node.name);
+		cooked.child = node.child;
+		cooked.sibling = node.sibling;
+		cooked.mesh_id = node.mesh_id;
+		cooked.skin_id = node.skin_id;
+		cooked.camera_id = node.camera_id;
+		cooked.light_id = node.light_id;
+		std::memcpy(cooked.translation, &node.rest_transform.translation, sizeof(cooked.translation));
+		std::memcpy(cooked.rotation, &node.rest_transform.rotation, sizeof(cooked.rotation));
+		std::memcpy(cooked.scale, &node.rest_transform.scale, sizeof(cooked.scale));
+		cooked.weights = writer.Write(node.weights);
+		cooked.instances = writer.Write(node.instances);
+	}
+
+	// Skins.
+	std::vector<CookedScene::Skin> cooked_skins(scene.skins.size());
+	for (int i = 0; i < scene.skins.size(); i++) {
+		cooked_skins[i].joints = writer.Write(scene.skins[i].joints);
+		cooked_skins[i].inverse_bind_poses = writer.Write(scene.skins[i].inverse_bind_poses);
+	}
+
+	// Animations.
+	std::vector<CookedScene::Animation> cooked_animations(scene.animations.size());
+	std::vector<CookedScene::Channel> cooked_channels;
+	for (int i = 0; i < scene.animations.size(); i++) {
+		const Animation& animation = scene.animations[i];
+		cooked_animations[i].name = writer.Write(animation.name);
+		cooked_animations[i].length = animation.length;
+		cooked_animations[i].channels = {(uint32_t)cooked_channels.size(), (uint32_t)animation.channels.size()};
+		for (const Animation::Channel& channel: animation.channels) {
+			CookedScene::Channel& cooked = cooked_channels.emplace_back();
+			cooked.node_id = channel.node_id;
+			cooked.format = channel.format;
+			cooked.path = channel.path;
+			cooked.interpolation_mode = channel.interpolation_mode;
+			cooked.width = channel.width;
+			cooked.times = writer.Write(channel.times);
+			cooked.transforms = writer.Write(channel.transforms);
+		}
+	}
+
+	static_assert(std::is_trivially_copyable_v<Material>);
+	static_assert(std::is_trivially_copyable_v<Light>);
+	writer.WriteTable(CookedScene::TABLE_SCENES, cooked_scenes);
+	writer.WriteTable(CookedScene::TABLE_NODES, cooked_nodes);
+	writer.WriteTable(CookedScene::TABLE_MESHES, cooked_meshes);
+	writer.WriteTable(CookedScene::TABLE_PRIMITIVES, cooked_primitives);
+	writer.WriteTable(CookedScene::TABLE_MATERIALS, scene.materials);
+	writer.WriteTable(CookedScene::TABLE_TEXTURES, cooked_textures);
+	writer.WriteTable(CookedScene::TABLE_SAMPLERS, cooked_samplers);
+	writer.WriteTable(CookedScene::TABLE_SKINS, cooked_skins);
+	writer.WriteTable(CookedScene::TABLE_ANIMATIONS, cooked_animations);
+	writer.WriteTable(CookedScene::TABLE_CHANNELS, cooked_channels);
+	writer.WriteTable(CookedScene::TABLE_LIGHTS, scene.lights);
+	if (!writer.Close(source_hash, source_size)) {
+		SPDLOG_ERROR("Failed to write {}.", cooked_filepath);
+		return false;
+	}
+
+	SPDLOG_INFO("Cooked {} into {} in {:.3f}s.", filepath, cooked_filepath, timer.Delta());
+	return true;
+}
+
+bool Gltf::LoadFromCooked(const char* filepath, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer)
+{
+	ProfileZoneScoped();
+	Timer timer;
+	timer.Create();
+	CookedScene::Reader reader;
+	if (!reader.Open(filepath)) {
+		SPDLOG_ERROR("{} is not a cooked scene.", filepath);
+		return false;
+	}
+
+	// Everything is validated before any GPU resources are created, so a bad file can't leave uploads behind.
+	if (!ReadCookedScene(&reader)) {
+		SPDLOG_ERROR("{} is corrupt.", filepath);
+		reader.Close();
+		Unload();
+		return false;
+	}
+	filename = std::filesystem::path(filepath).filename().string();
+	UploadCookedScene(&reader, gpu_allocator, upload_buffer);
+	CreateDynamicMesh(gpu_allocator);
+	reader.Close();
+	LogMemoryUsage();
+
+	SPDLOG_INFO("Loaded {} in {:.3f}s, peak memory usage {} MiB.", filename, timer.Delta(), GetPeakMemoryUsage() >> 20);
+	return true;
+}
+
+// Size of each stream of a cooked primitive, or zero for streams that it doesn't have.
+static void GetCookedStreamSizes(const CookedScene::Primitive* primitive, uint64_t* sizes)
+{
+	uint64_t num_of_vertices = primitive->num_of_vertices;
+	uint64_t index_size = primitive->index_format == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(uint32_t);
+	sizes[CookedScene::STREAM_INDEX] = primitive->flags & ::Mesh::FLAG_INDEX ? primitive->num_of_indices * index_size : 0;
+	uint64_t position_size = primitive->flags & ::Mesh::FLAG_QUANTIZED_POSITION ? sizeof(glm::i16vec4) : sizeof(glm::vec3);
+	uint64_t texcoord_size = primitive->flags & ::Mesh::FLAG_QUANTIZED_ATTRIBUTES ? sizeof(glm::u16vec2) : sizeof(glm::vec2);
+	uint64_t color_size = primitive->flags & ::Mesh::FLAG_QUANTIZED_ATTRIBUTES ? sizeof(glm::u8vec4) : sizeof(glm::u16vec4);
+	sizes[CookedScene::STREAM_POSITION] = num_of_vertices * position_size;
+	sizes[CookedScene::STREAM_TANGENT_SPACE] = primitive->flags & ::Mesh::FLAG_TANGENT_SPACE ? num_of_vertices * sizeof(uint32_t) : 0;
+	sizes[CookedScene::STREAM_TEXCOORD_0] = primitive->flags & ::Mesh::FLAG_TEXCOORD_0 ? num_of_vertices * texcoord_size : 0;
+	sizes[CookedScene::STREAM_TEXCOORD_1] = primitive->flags & ::Mesh::FLAG_TEXCOORD_1 ? num_of_vertices * texcoord_size : 0;
+	sizes[CookedScene::STREAM_COLOR] = primitive->flags & ::Mesh::FLAG_COLOR ? num_of_vertices * color_size : 0;
+	sizes[CookedScene::STREAM_JOINT_WEIGHT] = primitive->flags & ::Mesh::FLAG_JOINT_WEIGHT ? num_of_vertices * sizeof(::Mesh::JointWeight) : 0;
+	sizes[CookedScene::STREAM_MESHLETS] = (uint64_t)primitive->num_of_meshlets * sizeof(Meshlet);
+	sizes[CookedScene::STREAM_MESHLET_BOUNDS] = (uint64_t)primitive->num_of_meshlets * sizeof(MeshletBounds);
+	sizes[CookedScene::STREAM_MESHLET_VERTICES] = (uint64_t)primitive->num_of_meshlet_vertices * sizeof(uint32_t);
+	sizes[CookedScene::STREAM_MESHLET_TRIANGLES] = (uint64_t)primitive->num_of_meshlet_triangles * 3;
+	sizes[CookedScene::STREAM_LOD_INDEX] = primitive->flags & ::Mesh::FLAG_INDEX ? (uint64_t)primitive->num_of_lod_indices * index_size : 0;
+	sizes[CookedScene::STREAM_LODS] = (uint64_t)primitive->num_of_lods * sizeof(MeshLod);
+	uint64_t num_of_deltas = primitive->num_of_morph_deltas;
+	sizes[CookedScene::STREAM_MORPH_DELTA_OFFSETS] = num_of_deltas > 0 ? (num_of_vertices + 1) * sizeof(uint32_t) : 0;
+	sizes[CookedScene::STREAM_MORPH_TARGETS] = num_of_deltas * sizeof(uint32_t);
+	sizes[CookedScene::STREAM_MORPH_POSITIONS] = primitive->morph_flags & MorphTargets::FLAG_POSITION ? num_of_deltas * sizeof(glm::vec3) : 0;
+	sizes[CookedScene::STREAM_MORPH_NORMALS] = primitive->morph_flags & MorphTargets::FLAG_NORMAL ? num_of_deltas * sizeof(glm::vec3) : 0;
+	sizes[CookedScene::STREAM_MORPH_TANGENTS] = primitive->morph_flags & MorphTargets::FLAG_TANGENT ? num_of_deltas * sizeof(glm::vec3) : 0;
+}
+
+// Checks that every vertex's deltas are in bounds and belong to a target of the primitive, as the skinning shader trusts both.
+static bool ValidateMorphDeltas(const CookedScene::Reader* reader, const CookedScene::Primitive* primitive)
+{
+	if (primitive->num_of_morph_deltas == 0) {
+		return true;
+	}
+	const uint32_t* delta_offsets = (const uint32_t*)reader->GetPointer(primitive->streams[CookedScene::STREAM_MORPH_DELTA_OFFSETS]);
+	const uint32_t* targets = (const uint32_t*)reader->GetPointer(primitive->streams[CookedScene::STREAM_MORPH_TARGETS]);
+	if (delta_offsets[0] != 0 || delta_offsets[primitive->num_of_vertices] != primitive->num_of_morph_deltas) {
+		return false;
+	}
+	for (uint32_t i = 0; i < primitive->num_of_vertices; i++) {
+		if (delta_offsets[i] > delta_offsets[i + 1]) {
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < primitive->num_of_morph_deltas; i++) {
+		if (targets[i] >= primitive->num_of_targets) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool IsSpanValid(CookedScene::Span span, uint32_t count)
+{
+	return span.first <= count && span.count <= count - span.first;
+}
+
+bool Gltf::ReadCookedScene(const CookedScene::Reader* reader)
+{
+	ProfileZoneScoped();
+	const CookedScene::Scene* cooked_scenes;
+	const CookedScene::Node* cooked_nodes;
+	const CookedScene::Mesh* cooked_meshes;
+	const CookedScene::Primitive* cooked_primitives;
+	const Material* cooked_materials;
+	const CookedScene::Texture* cooked_textures;
+	const D3D12_SAMPLER_DESC* cooked_samplers;
+	const CookedScene::Skin* cooked_skins;
+	const CookedScene::Animation* cooked_animations;
+	const CookedScene::Channel* cooked_channels;
+	const Light* cooked_lights;
+	uint32_t num_of_scenes, num_of_nodes, num_of_meshes, num_of_primitives, num_of_materials, num_of_textures, num_of_samplers, num_of_skins, num_of_animations, num_of_channels, num_of_lights;
+	bool valid = 
+		reader->GetTable(CookedScene::TABLE_SCENES, &cooked_scenes, &num_of_scenes) &&
+		reader->GetTable(CookedScene::TABLE_NODES, &cooked_nodes, &num_of_nodes) &&
+		reader->GetTable(CookedScene::TABLE_MESHES, &cooked_meshes, &num_of_meshes) &&
+		reader->GetTable(CookedScene::TABLE_PRIMITIVES, &cooked_primitives, &num_of_primitives) &&
+		reader->GetTable(CookedScene::TABLE_MATERIALS, &cooked_materials, &num_of_materials) &&
+		reader->GetTable(CookedScene::TABLE_TEXTURES, &cooked_textures, &num_of_textures) &&
+		reader->GetTable(CookedScene::TABLE_SAMPLERS, &cooked_samplers, &num_of_samplers) &&
+		reader->GetTable(CookedScene::TABLE_SKINS, &cooked_skins, &num_of_skins) &&
+		reader->GetTable(CookedScene::TABLE_ANIMATIONS, &cooked_animations, &num_of_animations) &&
+		reader->GetTable(CookedScene::TABLE_CHANNELS, &cooked_channels, &num_of_channels) &&
+		reader->GetTable(CookedScene::TABLE_LIGHTS, &cooked_lights, &num_of_lights);
+	if (!valid) {
+		return false;
+	}
+
+	// Textures.
+	this->textures.resize(num_of_textures);
+	for (int i = 0; i < num_of_textures; i++) {
+		const CookedScene::Texture& cooked = cooked_textures[i];
+		valid &= reader->Read(cooked.name, &this->textures[i].name);
+		valid &= cooked.duplicate_of >= -1 && cooked.duplicate_of < i;
+		this->textures[i].duplicate_of = cooked.duplicate_of;
+		if (cooked.format != DXGI_FORMAT_UNKNOWN) {
+			DXGI_FORMAT format = (DXGI_FORMAT)cooked.format;
+			if (IsBlockCompressed(format)) {
+				valid &= cooked.width % 4 == 0 && cooked.height % 4 == 0;
+			} else {
+				valid &= format == DXGI_FORMAT_R8G8B8A8_UNORM || format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+			}
+			valid &= reader->IsValid(cooked.data) && cooked.data.size == GetTextureSize(format, cooked.width, cooked.height);
+			this->textures[i].format = format;
+			this->textures[i].component_mapping = cooked.component_mapping;
+		}
+	}
+
+	// Materials.
+	this->materials.assign(cooked_materials, cooked_materials + num_of_materials);
+	for (Material& material: this->materials) {
+		for (Material::Texture* texture: GetMaterialTextures(&material)) {
+			if (texture->texture != -1) {
+				valid &= texture->texture >= 0 && texture->texture < num_of_textures && this->textures[texture->texture].format != DXGI_FORMAT_UNKNOWN;
+				valid &= texture->sampler >= -1 && texture->sampler < (int)num_of_samplers;
+			}
+		}
+	}
+
+	// Meshes.
+	this->meshes.resize(num_of_meshes);
+	for (int i = 0; i < num_of_meshes; i++) {
+		const CookedScene::Mesh& cooked = cooked_meshes[i];
+		Mesh& mesh = this->meshes[i];
+		valid &= reader->Read(cooked.name, &mesh.name);
+		valid &= reader->Read(cooked.weights, &mesh.weights);
+		if (!IsSpanValid(cooked.primitives, num_of_primitives)) {
+			return false;
+		}
+		mesh.primitives.resize(cooked.primitives.count);
+		for (int j = 0; j < cooked.primitives.count; j++) {
+			const CookedScene::Primitive& cooked_primitive = cooked_primitives[cooked.primitives.first + j];
+			if (!cooked_primitive.valid) {
+				continue;
+			}
+			uint64_t sizes[CookedScene::STREAM_COUNT];
+			GetCookedStreamSizes(&cooked_primitive, sizes);
+			for (int k = 0; k < CookedScene::STREAM_COUNT; k++) {
+				valid &= reader->IsValid(cooked_primitive.streams[k]) && cooked_primitive.streams[k].size == sizes[k];
+			}
+			if (cooked_primitive.flags & ::Mesh::FLAG_INDEX) {
+				valid &= cooked_primitive.index_format == DXGI_FORMAT_R16_UINT || cooked_primitive.index_format == DXGI_FORMAT_R32_UINT;
+			}
+			valid &= cooked_primitive.material_id >= 0 && cooked_primitive.material_id < (int)num_of_materials;
+			if (!valid) {
+				return false;
+			}
+			valid &= ValidateMorphDeltas(reader, &cooked_primitive);
+			mesh.primitives[j].material_id = cooked_primitive.material_id;
+			mesh.primitives[j].num_of_targets = cooked_primitive.num_of_targets;
+			MeshletData* meshlets = &mesh.primitives[j].meshlets;
+			valid &= reader->Read(cooked_primitive.streams[CookedScene::STREAM_MESHLETS], &meshlets->meshlets);
+			valid &= reader->Read(cooked_primitive.streams[CookedScene::STREAM_MESHLET_BOUNDS], &meshlets->bounds);
+			valid &= reader->Read(cooked_primitive.streams[CookedScene::STREAM_MESHLET_VERTICES], &meshlets->vertices);
+			valid &= reader->Read(cooked_primitive.streams[CookedScene::STREAM_MESHLET_TRIANGLES], &meshlets->triangles);
+			valid &= ValidateMeshlets(*meshlets, cooked_primitive.num_of_vertices);
+			MeshLodData* lods = &mesh.primitives[j].lods;
+			valid &= reader->Read(cooked_primitive.streams[CookedScene::STREAM_LODS], &lods->lods);
+			for (const MeshLod& lod: lods->lods) {
+				valid &= lod.first_index <= cooked_primitive.num_of_lod_indices && lod.num_of_indices <= cooked_primitive.num_of_lod_indices - lod.first_index;
+			}
+			lods->center = glm::vec3(cooked_primitive.lod_center[0], cooked_primitive.lod_center[1], cooked_primitive.lod_center[2]);
+			lods->radius = cooked_primitive.lod_radius;
+		}
+	}
+
+	// Scenes.
+	this->scenes.resize(num_of_scenes);
+	for (int i = 0; i < num_of_scenes; i++) {
+		valid &= reader->Read(cooked_scenes[i].name, &this->scenes[i].name);
+		valid &= reader->Read(cooked_scenes[i].nodes, &this->scenes[i].nodes);
+		for (int node_id: this->scenes[i].nodes) {
+			valid &= node_id >= 0 && node_id < num_of_nodes;
+		}
+	}
+
+	// Nodes.
+	this->nodes.resize(num_of_nodes);
+	for (int i = 0; i < num_of_nodes; i++) {
+		const CookedScene::Node& cooked = cooked_nodes[i];
+		Node& node = this->nodes[i];
+		valid &= reader->Read(cooked.name, &node.name);
+		valid &= reader->Read(cooked.weights, &node.weights);
+		valid &= reader->Read(cooked.instances, &node.instances);
+		valid &= cooked.child >= -1 && cooked.child < (int)num_of_nodes;
+		valid &= cooked.sibling >= -1 && cooked.sibling < (int)num_of_nodes;
+		valid &= cooked.mesh_id >= -1 && cooked.mesh_id < (int)num_of_meshes;
+		valid &= cooked.skin_id >= -1 && cooked.skin_id < (int)num_of_skins;
+		valid &= cooked.light_id >= -1 && cooked.light_id < (int)num_of_lights;
+		if (!valid) {
+			return false;
+		}
+		node.child = cooked.child;
+		node.sibling = cooked.sibling;
+		node.mesh_id = cooked.mesh_id;
+		node.skin_id = cooked.skin_id;
+		node.camera_id = cooked.camera_id;
+		node.light_id = cooked.light_id;
+		std::memcpy(&node.rest_transform.translation, cooked.translation, sizeof(cooked.translation));
+		std::memcpy(&node.rest_transform.rotation, cooked.rotation, sizeof(cooked.rotation));
+		std::memcpy(&node.rest_transform.scale, cooked.scale, sizeof(cooked.scale));
+		if (node.mesh_id != -1 && !this->meshes[node.mesh_id].primitives.empty()) {
+			node.current_weights.assign(this->meshes[node.mesh_id].primitives[0].num_of_targets, 0.0f);
+		}
+	}
+	BuildTransformHierarchy();
+
+	// Skins.
+	this->skins.resize(num_of_skins);
+	for (int i = 0; i < num_of_skins; i++) {
+		valid &= reader->Read(cooked_skins[i].joints, &this->skins[i].joints);
+		valid &= reader->Read(cooked_skins[i].inverse_bind_poses, &this->skins[i].inverse_bind_poses);
+		for (uint32_t joint: this->skins[i].joints) {
+			valid &= joint < num_of_nodes;
+		}
+	}
+
+	// Animations.
+	this->animations.resize(num_of_animations);
+	for (int i = 0; i < num_of_animations; i++) {
+		const CookedScene::Animation& cooked = cooked_animations[i];
+		Animation& animation = this->animations[i];
+		valid &= reader->Read(cooked.name, &animation.name);
+		animation.length = cooked.length;
+		if (!IsSpanValid(cooked.channels, num_of_channels)) {
+			return false;
+		}
+		animation.channels.resize(cooked.channels.count);
+		for (int j = 0; j < cooked.channels.count; j++) {
+			const CookedScene::Channel& cooked_channel = cooked_channels[cooked.channels.first + j];
+			Animation::Channel& channel = animation.channels[j];
+			valid &= cooked_channel.node_id >= 0 && cooked_channel.node_id < (int)num_of_nodes;
+			channel.node_id = cooked_channel.node_id;
+			channel.format = (Animation::Channel::Format)cooked_channel.format;
+			channel.path = (Animation::Channel::Path)cooked_channel.path;
+			channel.interpolation_mode = (Animation::Channel::InterpolationMode)cooked_channel.interpolation_mode;
+			channel.width = cooked_channel.width;
+			valid &= reader->Read(cooked_channel.times, &channel.times);
+			valid &= reader->Read(cooked_channel.transforms, &channel.transforms);
+		}
+	}
+
+	// Lights.
+	this->lights.assign(cooked_lights, cooked_lights + num_of_lights);
+
+	return valid;
+}
+
+void Gltf::UploadCookedScene(const CookedScene::Reader* reader, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer)
+{
+	ProfileZoneScoped();
+	const CookedScene::Mesh* cooked_meshes;
+	const CookedScene::Primitive* cooked_primitives;
+	const CookedScene::Texture* cooked_textures;
+	const D3D12_SAMPLER_DESC* cooked_samplers;
+	uint32_t num_of_meshes, num_of_primitives, num_of_textures, num_of_samplers;
+	reader->GetTable(CookedScene::TABLE_MESHES, &cooked_meshes, &num_of_meshes);
+	reader->GetTable(CookedScene::TABLE_PRIMITIVES, &cooked_primitives, &num_of_primitives);
+	reader->GetTable(CookedScene::TABLE_TEXTURES, &cooked_textures, &num_of_textures);
+	reader->GetTable(CookedScene::TABLE_SAMPLERS, &cooked_samplers, &num_of_samplers);
+
+	for (int i = 0; i < num_of_samplers; i++) {
+		sampler_descriptors->CreateSampler(sampler_descriptors->GetAbsoluteIndex(i), &cooked_samplers[i]);
+	}
+
+	for (int i = 0; i < num_of_textures; i++) {
+		const CookedScene::Texture& cooked = cooked_textures[i];
+		if (cooked.format != DXGI_FORMAT_UNKNOWN) {
+			CreateTexture(i, this->textures[i].name.c_str(), cooked.width, cooked.height, reader->GetPointer(cooked.data), gpu_allocator, upload_buffer);
+			this->textures[i].resident = true;
+		}
+	}
+	ResolveMaterialTextures();
+
+	// Streams are copied straight from the file into upload memory.
+	// Primitives that were duplicates when cooked share the same position stream, and share a mesh again.
+	std::unordered_map<uint64_t, const Primitive*> uploaded_primitives;
+	for (int i = 0; i < num_of_meshes; i++) {
+		for (int j = 0; j < cooked_meshes[i].primitives.count; j++) {
+			const CookedScene::Primitive& cooked = cooked_primitives[cooked_meshes[i].primitives.first + j];
+			if (!cooked.valid) {
+				continue;
+			}
+			Primitive* primitive = &this->meshes[i].primitives[j];
+			auto [uploaded, inserted] = uploaded_primitives.try_emplace(cooked.streams[CookedScene::STREAM_POSITION].offset, primitive);
+			if (!inserted) {
+				SharePrimitive(*uploaded->second, primitive);
+				primitive->resident = true;
+				continue;
+			}
+			::Mesh::Desc desc = {
+				.topology = (D3D12_PRIMITIVE_TOPOLOGY)cooked.topology,
+				.index_format = (DXGI_FORMAT)cooked.index_format,
+				.num_of_vertices = cooked.num_of_vertices,
+				.num_of_indices = cooked.num_of_indices,
+				.num_of_lod_indices = cooked.num_of_lod_indices,
+				.flags = (uint8_t)cooked.flags,
+			};
+			for (int k = 0; k < 3; k++) {
+				desc.dequantization.position_scale[k] = cooked.position_scale[k];
+				desc.dequantization.position_offset[k] = cooked.position_offset[k];
+			}
+			for (int k = 0; k < 2; k++) {
+				for (int l = 0; l < 4; l++) {
+					desc.dequantization.texcoord_transforms[k][l] = cooked.texcoord_transforms[k][l];
+				}
+			}
+			primitive->mesh.Create(gpu_allocator, srv_uav_cbv_descriptors, &desc);
+			primitive->resident = true;
+			const CookedScene::Range* streams = cooked.streams;
+			if (desc.flags & ::Mesh::FLAG_INDEX) {
+				memcpy(primitive->mesh.QueueIndexUpdate(upload_buffer), reader->GetPointer(streams[CookedScene::STREAM_INDEX]), streams[CookedScene::STREAM_INDEX].size);
+			}
+			if (primitive->mesh.num_of_lod_indices > 0) {
+				memcpy(primitive->mesh.QueueLodIndexUpdate(upload_buffer), reader->GetPointer(streams[CookedScene::STREAM_LOD_INDEX]), streams[CookedScene::STREAM_LOD_INDEX].size);
+			}
+			memcpy(primitive->mesh.QueuePositionUpdate(upload_buffer), reader->GetPointer(streams[CookedScene::STREAM_POSITION]), streams[CookedScene::STREAM_POSITION].size);
+			if (desc.flags & ::Mesh::FLAG_TANGENT_SPACE) {
+				memcpy(primitive->mesh.QueueTangentSpaceUpdate(upload_buffer), reader->GetPointer(streams[CookedScene::STREAM_TANGENT_SPACE]), streams[CookedScene::STREAM_TANGENT_SPACE].size);
+			}
+			if (desc.flags & ::Mesh::FLAG_TEXCOORD_0) {
+				memcpy(primitive->mesh.QueueTexcoord0Update(upload_buffer), reader->GetPointer(streams[CookedScene::STREAM_TEXCOORD_0]), streams[CookedScene::STREAM_TEXCOORD_0].size);
+			}
+			if (desc.flags & ::Mesh::FLAG_TEXCOORD_1) {
+				memcpy(primitive->mesh.QueueTexcoord1Update(upload_buffer), reader->GetPointer(streams[CookedScene::STREAM_TEXCOORD_1]), streams[CookedScene::STREAM_TEXCOORD_1].size);
+			}
+			if (desc.flags & ::Mesh::FLAG_COLOR) {
+				memcpy(primitive->mesh.QueueColorUpdate(upload_buffer), reader->GetPointer(streams[CookedScene::STREAM_COLOR]), streams[CookedScene::STREAM_COLOR].size);
+			}
+			if (desc.flags & ::Mesh::FLAG_JOINT_WEIGHT) {
+				memcpy(primitive->mesh.QueueJointWeightUpdate(upload_buffer), reader->GetPointer(streams[CookedScene::STREAM_JOINT_WEIGHT]), streams[CookedScene::STREAM_JOINT_WEIGHT].size);
+			}
+
+			if (cooked.num_of_morph_deltas > 0) {
+				MorphTargets* morph_targets = &primitive->morph_targets;
+				MorphTargets::Desc morph_desc = {
+					.num_of_vertices = cooked.num_of_vertices,
+					.num_of_deltas = cooked.num_of_morph_deltas,
+					.flags = (uint8_t)cooked.morph_flags,
+				};
+				morph_targets->Create(gpu_allocator, srv_uav_cbv_descriptors, &morph_desc);
+				memcpy(morph_targets->QueueDeltaOffsetUpdate(upload_buffer), reader->GetPointer(streams[CookedScene::STREAM_MORPH_DELTA_OFFSETS]), streams[CookedScene::STREAM_MORPH_DELTA_OFFSETS].size);
+				memcpy(morph_targets->QueueTargetUpdate(upload_buffer), reader->GetPointer(streams[CookedScene::STREAM_MORPH_TARGETS]), streams[CookedScene::STREAM_MORPH_TARGETS].size);
+				if (morph_desc.flags & MorphTargets::FLAG_POSITION) {
+					memcpy(morph_targets->QueuePositionUpdate(upload_buffer), reader->GetPointer(streams[CookedScene::STREAM_MORPH_POSITIONS]), streams[CookedScene::STREAM_MORPH_POSITIONS].size);
+				}
+				if (morph_desc.flags & MorphTargets::FLAG_NORMAL) {
+					memcpy(morph_targets->QueueNormalUpdate(upload_buffer), reader->GetPointer(streams[CookedScene::STREAM_MORPH_NORMALS]), streams[CookedScene::STREAM_MORPH_NORMALS].size);
+				}
+				if (morph_desc.flags & MorphTargets::FLAG_TANGENT) {
+					memcpy(morph_targets->QueueTangentUpdate(upload_buffer), reader->GetPointer(streams[CookedScene::STREAM_MORPH_TANGENTS]), streams[CookedScene::STREAM_MORPH_TANGENTS].size);
+				}
+			}
+		}
+	}
+}
+
 void Gltf::CreateDynamicMesh(GpuAllocator* gpu_allocator)
 {
 	ProfileZoneScoped();
@@ -977,42 +1527,76 @@ void Gltf::CreateDynamicMesh(GpuAllocator* gpu_allocator)
 void Gltf::ApplyRestTransforms()
 {
 	ProfileZoneScoped();
-    for (Node& node: nodes) {
-        node.local_transform = node.rest_transform;
-		if (node.weights.size() > 0) {
-			node.current_weights = node.weights;
-		} else if (node.mesh_id != -1 && this->meshes[node.mesh_id].weights.size() > 0) { 
-			node.current_weights = this->meshes[node.mesh_id].weights;
-		} else {
-			node.current_weights.assign(node.current_weights.size(), 0.0f);
-		}
-    }
+	if (!this->posed_animation) {
+		return;
+	}
+	for (const Animation::Channel& channel: this->posed_animation->channels) {
+		ApplyRestTransform(channel.node_id);
+	}
+	this->posed_animation = nullptr;
 }
 
-void Gltf::Animate(Animation* animation, float time)
+void Gltf::ApplyRestTransform(int node_id)
+{
+	Node& node = nodes[node_id];
+	transforms.SetTranslation(node_id, node.rest_transform.translation);
+	transforms.SetRotation(node_id, node.rest_transform.rotation);
+	transforms.SetScale(node_id, node.rest_transform.scale);
+	if (node.weights.size() > 0) {
+		node.current_weights = node.weights;
+	} else if (node.mesh_id != -1 && this->meshes[node.mesh_id].weights.size() > 0) { 
+		node.current_weights = this->meshes[node.mesh_id].weights;
+	} else {
+		node.current_weights.assign(node.current_weights.size(), 0.0f);
+	}
+}
+
+void Gltf::Animate(Animation* animation, float time, std::vector<int>* keyframe_cursors)
 {
 	ProfileZoneScoped();
-    ApplyRestTransforms();
-    for (Animation::Channel& channel: animation->channels) {
-        int target = channel.node_id;
-        switch (channel.path) {
+	// Every channel sets its node, so only the nodes of a different animation need to go back to rest.
+	if (animation != this->posed_animation) {
+		ApplyRestTransforms();
+		this->posed_animation = animation;
+	}
+	// Each channel targets a different node and path, so weights can be written in place.
+	// Transforms are applied afterwards on this thread, as the setters track which nodes changed.
+	std::vector<Animation::Channel>& channels = animation->channels;
+	this->channel_samples.resize(channels.size());
+	if (keyframe_cursors) {
+		keyframe_cursors->resize(channels.size(), 0);
+	}
+	this->thread_pool->ParallelForRanges(channels.size(), CHANNELS_PER_TASK, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			Animation::Channel& channel = channels[i];
+			int* cursor = keyframe_cursors ? &(*keyframe_cursors)[i] : nullptr;
+			if (channel.path == Animation::Channel::PATH_WEIGHTS) {
+				channel.GetTransform(time, nodes[channel.node_id].current_weights.data(), cursor);
+			} else {
+				channel.GetTransform(time, &this->channel_samples[i].x, cursor);
+			}
+		}
+	});
+    for (int i = 0; i < channels.size(); i++) {
+        int target = channels[i].node_id;
+		const glm::vec4& sample = this->channel_samples[i];
+        switch (channels[i].path) {
             case Animation::Channel::PATH_TRANSLATION: {
-                channel.GetTransform(time, &nodes[target].local_transform.translation.x);
+                transforms.SetTranslation(target, glm::vec3(sample));
             } break;
             case Animation::Channel::PATH_ROTATION: {
-                channel.GetTransform(time, &nodes[target].local_transform.rotation.x);
+                transforms.SetRotation(target, glm::quat(sample.x, sample.y, sample.z, sample.w));
             } break;
             case Animation::Channel::PATH_SCALE: {
-                channel.GetTransform(time, &nodes[target].local_transform.scale.x);
+                transforms.SetScale(target, glm::vec3(sample));
             } break;
-			case Animation::Channel::PATH_WEIGHTS: {
-				channel.GetTransform(time, nodes[target].current_weights.data());
-			} break;
+			case Animation::Channel::PATH_WEIGHTS:
+				break;
         }
     }
 }
 
-void Gltf::CalculateGlobalTransforms(int scene)
+void Gltf::CalculateGlobalTransforms()
 {
 	glm::mat4x4 coordinate_system_transform = glm::mat4x4(
 		1., 0., 0., 0.,
@@ -1020,59 +1604,268 @@ void Gltf::CalculateGlobalTransforms(int scene)
 		0., -1., 0., 0.,
 		0., 0., 0., 1.
 	);
-	for (int i = 0; i < scenes[scene].nodes.size(); i++) {
-    	CalculateGlobalTransforms(&this->nodes[this->scenes[scene].nodes[i]], coordinate_system_transform);
-	}
+	this->transforms.CalculateGlobalTransforms(coordinate_system_transform, this->thread_pool);
 }
 
-void Gltf::CalculateGlobalTransforms(Gltf::Node* node, glm::mat4x4 parent_global_transform)
+void Gltf::CalculateSkinPalettes()
 {
-    // Calculate the global transform for this node.
-    node->previous_global_transform = node->global_transform;
-    node->global_transform = parent_global_transform;
-	node->global_transform *= glm::translate(node->local_transform.translation);
-	node->global_transform *= glm::mat4_cast(node->local_transform.rotation);
-	node->global_transform *= glm::scale(node->local_transform.scale);
-
-    // Iterate through this nodes children.
-    for (int i = node->child; i != -1; i = this->nodes[i].sibling) {
-		CalculateGlobalTransforms(&this->nodes[i], node->global_transform);
-    }
+	ProfileZoneScoped();
+	int num_of_bones = 0;
+	for (int node_id: this->skinned_nodes) {
+		Node& node = this->nodes[node_id];
+		node.bones.resize(this->skins[node.skin_id].joints.size());
+		num_of_bones += node.bones.size();
+	}
+
+	// Every palette only reads global transforms and writes its own node's bones.
+	auto calculate_palette = [&](int i) {
+		Node& node = this->nodes[this->skinned_nodes[i]];
+		const Skin& skin = this->skins[node.skin_id];
+		glm::mat4x4 inverse_global_transform = glm::affineInverse(this->transforms.GetGlobalTransform(this->skinned_nodes[i]));
+		for (int j = 0; j < skin.joints.size(); j++) {
+			GpuSkin::Bone& bone = node.bones[j];
+			bone.transform = inverse_global_transform * this->transforms.GetGlobalTransform(skin.joints[j]) * skin.inverse_bind_poses[j];
+			bone.inverse_transpose = glm::inverseTranspose(glm::mat3x3(bone.transform));
+		}
+	};
+	if (num_of_bones < BONES_PER_TASK) {
+		for (int i = 0; i < this->skinned_nodes.size(); i++) {
+			calculate_palette(i);
+		}
+	} else {
+		this->thread_pool->ParallelFor(this->skinned_nodes.size(), calculate_palette);
+	}
 }
 
-void Gltf::ReserveTextures(tinygltf::Model* gltf)
-{;
+void Gltf::ReserveTextures(tinygltf::Model* gltf, const std::vector<std::vector<unsigned char>>* encoded_images)
+{
+	ProfileZoneScoped();
 	this->textures.resize(gltf->images.size());
+	std::vector<uint64_t> hashes(gltf->images.size());
+	this->thread_pool->ParallelFor(gltf->images.size(), [&](int i) {
+		size_t size = 0;
+		const unsigned char* bytes = GltfImport::GetEncodedImage(gltf, encoded_images, i, &size);
+		hashes[i] = Hash(bytes, size);
+	});
+
+	// Images without data are left alone, so the error is still reported when decoding.
+	// Equal hashes are confirmed by comparing the bytes, and an image that only collides gets its own entry.
+	std::unordered_multimap<uint64_t, int> first_images;
+	for (int i = 0; i < gltf->images.size(); i++) {
+		size_t size = 0;
+		const unsigned char* bytes = GltfImport::GetEncodedImage(gltf, encoded_images, i, &size);
+		if (size == 0) {
+			continue;
+		}
+		this->textures[i].duplicate_of = -1;
+		auto [begin, end] = first_images.equal_range(hashes[i]);
+		for (auto it = begin; it != end; it++) {
+			size_t first_size = 0;
+			const unsigned char* first_bytes = GltfImport::GetEncodedImage(gltf, encoded_images, it->second, &first_size);
+			if (first_size == size && memcmp(first_bytes, bytes, size) == 0) {
+				this->textures[i].duplicate_of = it->second;
+				break;
+			}
+		}
+		if (this->textures[i].duplicate_of == -1) {
+			first_images.emplace(hashes[i], i);
+		}
+	}
 }
 
-void Gltf::LoadTexture(tinygltf::Model* gltf, int slot, bool srgb, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer)
+bool Gltf::DecodeImages(tinygltf::Model* gltf, std::vector<std::vector<unsigned char>>* encoded_images, const std::atomic<bool>* cancel)
 {
 	ProfileZoneScoped();
-	this->textures.reserve(slot + 1);
+	encoded_images->resize(gltf->images.size());
+	std::atomic<bool> success = true;
+	this->thread_pool->ParallelFor(gltf->images.size(), [&](int i) {
+		if (cancel && *cancel) {
+			return;
+		}
+		ProfileZoneScopedN("Decode Image");
+		tinygltf::Image* image = &gltf->images[i];
+		ProfileZoneText(image->name.data(), image->name.size());
+
+		// Duplicates are never used, so there is no need to decode them.
+		if (this->textures[i].duplicate_of != -1) {
+			std::vector<unsigned char>().swap((*encoded_images)[i]);
+			return;
+		}
+		size_t size = 0;
+		const unsigned char* bytes = GltfImport::GetEncodedImage(gltf, encoded_images, i, &size);
+		if (size == 0) {
+			SPDLOG_ERROR("Image {} \"{}\" has no data.", i, image->name);
+			success = false;
+			return;
+		}
+
+		if (!GltfImport::DecodeImage(gltf, i, bytes, size)) {
+			success = false;
+		}
+
+		// The encoded image is no longer needed.
+		std::vector<unsigned char>().swap((*encoded_images)[i]);
+	});
+	return success;
+}
+
+void Gltf::LoadTextures(tinygltf::Model* gltf, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer)
+{
+	ProfileZoneScoped();
+	for (int i = 0; i < gltf->images.size(); i++) {
+		// Textures that aren't used by any material are skipped.
+		if (this->textures[i].format != DXGI_FORMAT_UNKNOWN) {
+			tinygltf::Image& image = gltf->images[i];
+			// Only support RGBA 8 bit images, with a full mip chain.
+			assert(image.component == 4);
+			assert(image.bits == 8);
+			assert(image.image.size() == GetTextureSize(this->textures[i].format, image.width, image.height));
+			CreateTexture(i, image.name.c_str(), image.width, image.height, (const std::byte*)image.image.data(), gpu_allocator, upload_buffer);
+			this->textures[i].resident = true;
+
+			// The decoded image has been copied into upload memory, so release it.
+			std::vector<unsigned char>().swap(image.image);
+		}
+	}
+}
+
+void Gltf::CreateTexture(int slot, const char* name, uint32_t width, uint32_t height, const std::byte* data, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer)
+{
+	ProfileZoneScoped();
+	this->textures[slot].name = name;
 
-	tinygltf::Image& image = gltf->images[slot];
-	// Only support RGBA 8 bit images.
-	assert(image.component == 4);
-	assert(image.bits == 8);
-	
 	// Create the resource.
-	DXGI_FORMAT format = srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
-	CD3DX12_RESOURCE_DESC resource_desc = CD3DX12_RESOURCE_DESC::Tex2D(format, image.width, image.height, 1, 1);
-	CD3DX12_HEAP_PROPERTIES heap_properties(D3D12_HEAP_TYPE_DEFAULT);
+	DXGI_FORMAT format = this->textures[slot].format;
+	uint32_t mip_levels = GetMipLevelCount(width, height);
+	this->textures[slot].size = GetTextureSize(format, width, height);
+	this->textures[slot].uncompressed_size = GetMipChainSize(width, height);
+	CD3DX12_RESOURCE_DESC resource_desc = CD3DX12_RESOURCE_DESC::Tex2D(format, width, height, 1, mip_levels);
 	HRESULT result = gpu_allocator->CreateResource(&resource_desc, D3D12_RESOURCE_STATE_COMMON, nullptr, &this->textures[slot].resource);
 	assert(result == S_OK);
 	if (SUCCEEDED(result)) {
-		SetName(this->textures[slot].resource.resource.Get(), image.name.data());
+		SetName(this->textures[slot].resource.resource.Get(), name);
 	}
 
-	// Create the descriptor.
+	// Create the descriptor. BC4 and BC5 textures are swizzled back to the channels the shaders read.
+	D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc = {
+		.Format = format,
+		.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D,
+		.Shader4ComponentMapping = this->textures[slot].component_mapping,
+		.Texture2D = {
+			.MipLevels = mip_levels,
+		},
+	};
 	textures[slot].descriptor = srv_uav_cbv_descriptors->Allocate();
-	srv_uav_cbv_descriptors->CreateSrv(textures[slot].descriptor, textures[slot].resource.resource.Get(), nullptr);
+	srv_uav_cbv_descriptors->CreateSrv(textures[slot].descriptor, textures[slot].resource.resource.Get(), &srv_desc);
+
+	// Upload every mip level to the GPU.
+	for (uint32_t level = 0; level < mip_levels; level++) {
+		uint32_t pitch = 0;
+		uint32_t row_size = 0;
+		uint32_t row_count = 0;
+		GetSurfaceInfo(format, width, height, &row_size, &row_count);
+		std::byte* upload_ptr = (std::byte*)upload_buffer->QueueTextureUpload(format, width, height, 1, textures[slot].resource.resource.Get(), level, &pitch);
+		for (uint32_t i = 0; i < row_count; i++) {
+			memcpy(upload_ptr + i * pitch, data + i * row_size, row_size);
+		}
+		data += (uint64_t)row_size * row_count;
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
+}
+
+void Gltf::PrepareTextures(tinygltf::Model* gltf, const std::atomic<bool>* cancel)
+{
+	ProfileZoneScoped();
+	this->thread_pool->ParallelFor(gltf->images.size(), [&](int i) {
+		if (cancel && *cancel) {
+			return;
+		}
+		tinygltf::Image* image = &gltf->images[i];
+		Texture* texture = &this->textures[i];
+		if (texture->format == DXGI_FORMAT_UNKNOWN || image->image.size() != (uint64_t)image->width * image->height * 4) {
+			return;
+		}
+		bool srgb = texture->format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+		TextureEncoding encoding = {.format = texture->format};
+		if (!Config::disable_texture_compression) {
+			encoding = ChooseTextureEncoding(image->image.data(), image->width, image->height, texture->channels, srgb, Config::fast_texture_compression);
+		}
+		texture->format = encoding.format;
+		texture->component_mapping = encoding.component_mapping;
+		if (!IsBlockCompressed(encoding.format)) {
+			GenerateMipChain(&image->image, image->width, image->height, srgb, texture->alpha_cutoff);
+			return;
+		}
+
+		// Compression is slow, so check the cache first.
+		const char* cache_directory = Config::texture_cache_directory.c_str();
+		uint64_t key = GetTextureCacheKey(image->image.data(), image->width, image->height, encoding, srgb, texture->alpha_cutoff);
+		if (LoadCachedTexture(cache_directory, key, GetTextureSize(encoding.format, image->width, image->height), &image->image)) {
+			return;
+		}
+		std::vector<unsigned char> compressed;
+		GenerateMipChain(&image->image, image->width, image->height, srgb, texture->alpha_cutoff);
+		if (cancel && *cancel) {
+			return;
+		}
+		CompressMipChain(encoding, image->image.data(), image->width, image->height, &compressed, this->thread_pool);
+		if (!SaveCachedTexture(cache_directory, key, compressed)) {
+			SPDLOG_WARN("Failed to cache compressed texture {}.", image->name);
+		}
+		image->image = std::move(compressed);
+	});
+}
+
+Gltf::DeduplicationStats Gltf::GetDeduplicationStats() const
+{
+	DeduplicationStats stats;
+	for (const Texture& texture: this->textures) {
+		if (texture.duplicate_of != -1) {
+			stats.textures++;
+			stats.texture_bytes += this->textures[texture.duplicate_of].size;
+		}
+	}
+	for (const Mesh& mesh: this->meshes) {
+		for (const Primitive& primitive: mesh.primitives) {
+			if (!primitive.shares_mesh) {
+				continue;
+			}
+			stats.primitives++;
+			stats.mesh_bytes += primitive.mesh.resource.resource ? primitive.mesh.resource.resource->GetDesc().Width : 0;
+			stats.mesh_bytes += primitive.morph_targets.resource.resource ? primitive.morph_targets.resource.resource->GetDesc().Width : 0;
+		}
+	}
+	return stats;
+}
+
+void Gltf::LogMemoryUsage()
+{
+	uint64_t total_size = 0;
+	uint64_t total_uncompressed_size = 0;
+	for (const Texture& texture: this->textures) {
+		if (texture.size == 0) {
+			continue;
+		}
+		SPDLOG_DEBUG("Texture {}: {}, {} KiB, saved {} KiB.", texture.name, GetFormatName(texture.format), texture.size >> 10, (texture.uncompressed_size - texture.size) >> 10);
+		total_size += texture.size;
+		total_uncompressed_size += texture.uncompressed_size;
+	}
+	SPDLOG_INFO("Textures use {} MiB, block compression saved {} MiB.", total_size >> 20, (total_uncompressed_size - total_size) >> 20);
+	DeduplicationStats stats = GetDeduplicationStats();
+	SPDLOG_INFO("Shared {} duplicate images ({} MiB) and {} duplicate primitives ({} MiB).", stats.textures, stats.texture_bytes >> 20, stats.primitives, stats.mesh_bytes >> 20);
+}
 
-	// Upload image to the GPU.
-	uint32_t pitch = 0;
-	std::byte* upload_ptr = (std::byte*)upload_buffer->QueueTextureUpload(format, image.width, image.height, 1, textures[slot].resource.resource.Get(), 0, &pitch);
-	for (int i = 0; i < image.height; i++) {
-		memcpy(upload_ptr + i * pitch, image.image.data() + i * image.width * 4, image.width * 4);
+void Gltf::ResolveMaterialTextures()
+{
+	ProfileZoneScoped();
+	for (Material& material: this->materials) {
+		for (Material::Texture* texture: GetMaterialTextures(&material)) {
+			if (texture->texture != -1) {
+				// Textures that are still streaming in are left unbound, so only the material factors are used.
+				texture->sampler = texture->sampler == -1 ? 0 : sampler_descriptors->GetAbsoluteIndex(texture->sampler);
+				texture->texture = this->textures[texture->texture].resident ? this->textures[texture->texture].descriptor : -1;
+			}
+		}
 	}
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -8,9 +9,16 @@
 
 #include "Animation.h"
 #include "Camera.h"
+#include "CookedScene.h"
 #include "DescriptorAllocator.h"
+#include "GltfImport.h"
+#include "GpuSkin.h"
 #include "Mesh.h"
+#include "MeshSimplification.h"
+#include "Meshlet.h"
 #include "RayTracingAccelerationStructure.h"
+#include "ThreadPool.h"
+#include "TransformHierarchy.h"
 #include "UploadBuffer.h"
 
 class Gltf {
@@ -33,16 +41,19 @@ class Gltf {
         int camera_id = -1;
         int light_id = -1;
         Trs rest_transform;
-        Trs local_transform;
-        glm::mat4x4 global_transform;
-        glm::mat4x4 previous_global_transform;
         std::vector<float> weights;
         std::vector<float> current_weights;
+        std::vector<glm::mat4x4> instances; // EXT_mesh_gpu_instancing transforms, relative to the node. The mesh is drawn once per instance when there are any.
+        std::vector<GpuSkin::Bone> bones; // Skin palette relative to the node, set by CalculateSkinPalettes.
     };
 
     struct Scene {
         std::string name;
         std::vector<int> nodes;
+        // Nodes of the scene in traversal order, found once when the scene is loaded so that rendering doesn't walk the hierarchy every frame.
+        std::vector<int> mesh_nodes;
+        std::vector<int> light_nodes;
+        std::vector<int> dynamic_nodes; // Skinned or morphed nodes.
     };
 
     struct Light {
@@ -61,10 +72,15 @@ class Gltf {
 
     struct Primitive {
         Mesh mesh;
+        MeshLodData lods; // Simplified versions of the mesh, drawn from mesh.lod_index.
         RaytracingAccelerationStructure::Blas blas;
         int material_id = 0;
-        std::vector<MorphTarget> targets;
+        bool resident = false; // Set once the mesh data has finished uploading. Primitives that aren't resident aren't drawn.
+        bool shares_mesh = false; // The mesh and morph targets belong to an earlier primitive with identical data.
+        uint32_t num_of_targets = 0;
+        MorphTargets morph_targets; // Not created if no target moves a vertex.
         std::vector<float> weights;
+        MeshletData meshlets; // Kept on the CPU for cluster culling and splitting acceleration structures.
     };
 
     struct Mesh {
@@ -83,100 +99,18 @@ class Gltf {
         std::vector<uint32_t> joints;
     };
 
-    struct Material {
-
-        enum Flags {
-            FLAG_NONE = 0,
-            FLAG_DOUBLE_SIDED = 1 << 0,
-            FLAG_UNLIT = 1 << 1,
-        };
-
-        enum AlphaMode {
-            ALPHA_MODE_OPAQUE,
-            ALPHA_MODE_MASK,
-            ALPHA_MODE_BLEND,
-        };
-
-        struct Texture {
-            int texture = -1;
-            int sampler = 0;
-            int tex_coord = 0;
-            glm::vec2 offset = glm::vec2(0.0);
-            glm::vec2 scale = glm::vec2(1.0);
-            float rotation = 0.0;
-        };
-
-        uint32_t flags = FLAG_NONE;
-
-        glm::vec4 base_color_factor = glm::vec4(1.0);
-        float metalness_factor = 1.0;
-        float roughness_factor = 1.0;
-        float occlusion_factor = 1.0;
-        glm::vec3 emissive_factor = glm::vec3(0.0);
-        float normal_map_scale = 1.0;
-        Texture albedo;
-        Texture normal;
-        Texture metallic_roughness;
-        Texture occlusion;
-        Texture emissive;
-        AlphaMode alpha_mode = ALPHA_MODE_OPAQUE;
-        float alpha_cutoff = 0.5;
-
-        // Anisotropy.
-        float anisotropy_strength = 0.0;
-        float anisotropy_rotation = 0.0;
-        Texture anisotropy_texture;
-
-        // Clearcoat.
-        float clearcoat_factor = 0.0;
-        Texture clearcoat_texture;
-        float clearcoat_roughness_factor = 0.0;
-        Texture clearcoat_roughness_texture;
-        float clearcoat_normal_scale = 1.0;
-        Texture clearcoat_normal_texture;
-
-        // Dispersion.
-        float dispersion = 0.0;
-
-        // Emissive strength.
-        float emissive_strength = 1.0;
-        
-        // Index of refraction.
-        float ior = 1.5;
-
-        // Iridescence.
-        float iridescence_factor = 0.0;
-        Texture iridescence_texture;
-        float iridescence_ior = 1.3;
-        float iridescence_thickness_minimum = 100.0;
-        float iridescence_thickness_maximum = 400.0;
-        Texture iridescence_thickness_texture;
-
-        // Sheen.
-        glm::vec3 sheen_color_factor = glm::vec3(0.0);
-        Texture sheen_color_texture;
-        float sheen_roughness_factor = 0.0;
-        Texture sheen_roughness_texture;
-
-        // Specular.
-        float specular_factor = 1.0;
-        Texture specular_texture;
-        glm::vec3 specular_color_factor = glm::vec3(1.0);
-        Texture specular_color_texture;
-
-        // Transmission.
-        float transmission_factor = 0.0;
-        Texture transmission_texture;
-
-        // Volume.
-        float thickness_factor = 0;
-        float attenuation_distance = 0;
-        glm::vec3 attenuation_color = glm::vec3(1.0);
-        Texture thickness_texture;
-    };
+    using Material = GltfImport::Material;
 
     struct Texture {
         std::string name;
+        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN; // Set by the first material that uses the texture, then replaced by the compressed format.
+        uint32_t channels = 0; // TextureChannel flags for every channel any material reads.
+        uint32_t component_mapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        bool resident = false; // Set once the image has finished uploading.
+        float alpha_cutoff = -1.0f; // Positive if an alpha tested material uses the texture, so its mips need to preserve alpha coverage.
+        uint64_t size = 0; // Bytes used on the GPU.
+        uint64_t uncompressed_size = 0; // Bytes the texture would use as RGBA8.
+        int duplicate_of = -1; // An earlier image with identical data, which is used in place of this one.
         int descriptor = -1;
         GpuResource resource;
     };
@@ -192,32 +126,57 @@ class Gltf {
     std::vector<Animation> animations;
     std::vector<Light> lights;
     std::vector<Texture> textures;
-    
-    void Init(CbvSrvUavPool* srv_uav_cbv_descriptors, SamplerStack* sampler_descriptors);
+    TransformHierarchy transforms; // Local and global transforms of every node.
+
+    // Images and primitives that reuse the GPU resources of an identical earlier one.
+    struct DeduplicationStats {
+        int textures = 0;
+        int primitives = 0;
+        uint64_t texture_bytes = 0; // GPU memory the duplicates would otherwise have used.
+        uint64_t mesh_bytes = 0;
+    };
+
+    void Init(CbvSrvUavPool* srv_uav_cbv_descriptors, SamplerStack* sampler_descriptors, ThreadPool* thread_pool);
     bool LoadFromGltf(const char* filepath, GpuAllocator* allocator, UploadBuffer* upload_buffer);
+    bool LoadFromCooked(const char* filepath, GpuAllocator* allocator, UploadBuffer* upload_buffer);
+    // Converts a glTF file into a cooked scene without using the GPU.
+    static bool Cook(const char* filepath, const char* cooked_filepath, ThreadPool* thread_pool);
     void Unload();
+    // Puts the nodes posed by the last animation back to their rest transforms and weights.
     void ApplyRestTransforms();
-    void CalculateGlobalTransforms(int scene);
-    void Animate(Animation* animation, float time);
+    // Covers the nodes of every scene, as they share one hierarchy. Only nodes that changed are recalculated, so scenes that aren't animated cost nothing.
+    void CalculateGlobalTransforms();
+    // Calculates the bones of every skinned node from the global transforms.
+    void CalculateSkinPalettes();
+    // Only nodes whose transform changes are marked for CalculateGlobalTransforms, so a paused animation costs nothing to update.
+    // Channels are sampled in parallel, then applied in order, so the result doesn't depend on the thread count.
+    // Keyframe cursors, one per channel, make finding keyframes constant time when time moves forward. They are resized to fit the animation.
+    void Animate(Animation* animation, float time, std::vector<int>* keyframe_cursors = nullptr);
     void TraverseScene(int scene, const std::function<void(Gltf*, int)>& lambda);
     void TraverseNode(int node, const std::function<void(Gltf*, int)>& lambda);
+    DeduplicationStats GetDeduplicationStats() const;
     
     private:
 
+    friend class GltfLoader;
+
     CbvSrvUavPool* srv_uav_cbv_descriptors;
     SamplerStack* sampler_descriptors;
+    ThreadPool* thread_pool;
+    Animation* posed_animation = nullptr; // The animation whose channels last set the node transforms.
+    std::vector<glm::vec4> channel_samples; // Translation, rotation or scale sampled from each channel by Animate.
+    std::vector<int> skinned_nodes;
 
     void LoadMeshes(tinygltf::Model* gltf, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer);
-    void LoadMesh(tinygltf::Model* gltf, tinygltf::Mesh* gltf_mesh, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer, Mesh* mesh);
-    void LoadPrimitive(tinygltf::Model* gltf, tinygltf::Primitive* gltf_primitive, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer, Primitive* primitive);
-    void CreateMorphTarget(tinygltf::Model* gltf, std::map<std::string, int>* target, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer, int num_of_vertices, MorphTarget* morph_target);
-    void GetTextureTransform(tinygltf::Value* gltf_value, int* tex_coord, glm::vec2* offset, float* rotation, glm::vec2* scale);
-    Material::Texture GetTexture(tinygltf::Model* gltf, int texture_index, int tex_coord, tinygltf::Value* extensions, bool srgb, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer);
-    Material::Texture GetTexture(tinygltf::Model* gltf, tinygltf::TextureInfo* texture_info, bool srgb, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer);
-    Material::Texture GetTexture(tinygltf::Model* gltf, tinygltf::NormalTextureInfo* texture_info, float* scale, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer);
-    Material::Texture GetTexture(tinygltf::Model* gltf, tinygltf::OcclusionTextureInfo* texture_info, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer);
-    Material::Texture GetTexture(tinygltf::Model* gltf, const tinygltf::Value* texture_info, float* scale, bool srgb, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer);
-    void LoadMaterials(tinygltf::Model* gltf, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer);
+    void LoadMeshLayout(tinygltf::Model* gltf);
+    // Converts every primitive, calling consume in order on the calling thread. Conversion stops if consume returns false.
+    // Primitives with the same data as an earlier one aren't converted, share is called with the earlier primitive instead.
+    void ConvertMeshes(tinygltf::Model* gltf, const std::function<bool(int, int, GltfImport::PrimitiveData*)>& consume, const std::function<bool(int, int, int, int)>& share);
+    void SharePrimitive(const Primitive& source, Primitive* primitive);
+    void UploadPrimitive(GltfImport::PrimitiveData* data, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer, Primitive* primitive);
+    void UploadMorphTargets(GltfImport::MorphData* data, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer, int num_of_vertices, MorphTargets* morph_targets);
+    void LoadMaterials(tinygltf::Model* gltf);
+    void ResolveMaterialTextures();
     void LoadScenes(tinygltf::Model* gltf);
     void LoadCameras(tinygltf::Model* gltf);
     void LoadNodes(tinygltf::Model* gltf);
@@ -226,8 +185,22 @@ class Gltf {
     void LoadSkins(tinygltf::Model* gltf);
     void LoadSamplers(tinygltf::Model* gltf);
     void LoadLights(tinygltf::Model* gltf);
-    void ReserveTextures(tinygltf::Model* gltf);
-    void LoadTexture(tinygltf::Model* gltf, int slot, bool srgb, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer);
+    // Also finds images with identical encoded data, so that only the first of them is decoded and uploaded.
+    void ReserveTextures(tinygltf::Model* gltf, const std::vector<std::vector<unsigned char>>* encoded_images);
+    // Images that haven't started when cancel is set are skipped. The same goes for PrepareTextures.
+    bool DecodeImages(tinygltf::Model* gltf, std::vector<std::vector<unsigned char>>* encoded_images, const std::atomic<bool>* cancel = nullptr);
+    void LoadTextures(tinygltf::Model* gltf, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer);
+    // Generates mip chains and block compresses them, replacing each image with the data to upload.
+    void PrepareTextures(tinygltf::Model* gltf, const std::atomic<bool>* cancel = nullptr);
+    void LogMemoryUsage();
+    // Data is a full mip chain in the texture's format, see MipGeneration.h and TextureCompression.h.
+    void CreateTexture(int slot, const char* name, uint32_t width, uint32_t height, const std::byte* data, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer);
+    bool ReadCookedScene(const CookedScene::Reader* reader);
+    void UploadCookedScene(const CookedScene::Reader* reader, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer);
     void CreateDynamicMesh(GpuAllocator* gpu_allocator);
-    void CalculateGlobalTransforms(Node* node, glm::mat4x4 parent_global_transform);
+    // Also puts every node in its rest pose and finds the skinned nodes.
+    void BuildTransformHierarchy();
+    // Needs the transform hierarchy, as each scene's nodes are the subtrees of its roots.
+    void BuildRenderLists();
+    void ApplyRestTransform(int node);
 };
\ No newline at end of file
@@ -0,0 +1,1397 @@
+#include "GltfImport.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <directx/d3d12.h>
+#include <directx/dxgiformat.h>
+#include <spdlog/spdlog.h>
+#include <tinygltf/json.hpp>
+
+#include "File.h"
+#include "Hash.h"
+#include "Memory.h"
+#include "MeshOptimization.h"
+#include "MeshSimplification.h"
+#include "Meshlet.h"
+#include "MeshoptDecoding.h"
+#include "Profiling.h"
+#include "TextureCompression.h"
+#include "ThreadPool.h"
+#include "TinyGltfTools.h"
+#include "VertexEncoding.h"
+#include "VertexQuantization.h"
+
+// Returns tightly packed float data for an accessor.
+// The buffer is used directly when possible, otherwise the accessor is converted into storage.
+template<glm::length_t L>
+static const float* GetFloatData(tinygltf::Model* gltf, tinygltf::Accessor* accessor, std::vector<glm::vec<L, float>>* storage)
+{
+	bool same_dimension = tinygltf::GetNumComponentsInType(accessor->type) == L;
+	bool same_component = accessor->componentType == TINYGLTF_COMPONENT_TYPE_FLOAT;
+	if (same_dimension && same_component && accessor->bufferView != -1 && tinygltf::tools::IsContiguous(gltf, accessor) && !accessor->sparse.isSparse) {
+		return (const float*)tinygltf::tools::GetBufferPtr(gltf, accessor);
+	}
+	storage->resize(accessor->count);
+	tinygltf::tools::Copy(storage->data(), gltf, accessor);
+	return (const float*)storage->data();
+}
+
+// Adds the bytes an accessor reads and how they are interpreted to a list of words to hash.
+static void HashAccessor(tinygltf::Model* gltf, int accessor_id, std::vector<uint64_t>* words)
+{
+	if (accessor_id == -1) {
+		words->push_back(UINT64_MAX);
+		return;
+	}
+	const tinygltf::Accessor* accessor = &gltf->accessors[accessor_id];
+	int stride = tinygltf::tools::GetStride(gltf, accessor);
+	words->insert(words->end(), {(uint64_t)accessor->componentType, (uint64_t)accessor->type, (uint64_t)accessor->count, (uint64_t)accessor->normalized});
+	if (accessor->bufferView != -1 && accessor->count > 0) {
+		uint64_t size = (uint64_t)stride * (accessor->count - 1) + tinygltf::tools::GetTypeSize(accessor);
+		words->insert(words->end(), {(uint64_t)stride, Hash(tinygltf::tools::GetBufferPtr(gltf, accessor), size)});
+	}
+	if (accessor->sparse.isSparse) {
+		uint64_t count = accessor->sparse.count;
+		int index_stride = tinygltf::tools::GetSparseIndexStride(gltf, accessor);
+		int value_stride = tinygltf::tools::GetSparseValueStride(gltf, accessor);
+		uint64_t index_size = count > 0 ? index_stride * (count - 1) + tinygltf::GetComponentSizeInBytes(accessor->sparse.indices.componentType) : 0;
+		uint64_t value_size = count > 0 ? value_stride * (count - 1) + tinygltf::tools::GetTypeSize(accessor) : 0;
+		words->insert(words->end(), {count, (uint64_t)accessor->sparse.indices.componentType, (uint64_t)index_stride, (uint64_t)value_stride});
+		words->push_back(Hash(tinygltf::tools::GetSparseIndexPtr(gltf, accessor), index_size));
+		words->push_back(Hash(tinygltf::tools::GetSparseValuePtr(gltf, accessor), value_size));
+	}
+}
+
+static bool CompareAccessors(tinygltf::Model* gltf, int a_id, int b_id)
+{
+	if (a_id == b_id) {
+		return true;
+	}
+	if (a_id == -1 || b_id == -1) {
+		return false;
+	}
+	const tinygltf::Accessor* a = &gltf->accessors[a_id];
+	const tinygltf::Accessor* b = &gltf->accessors[b_id];
+	if (a->componentType != b->componentType || a->type != b->type || a->count != b->count || a->normalized != b->normalized) {
+		return false;
+	}
+	if ((a->bufferView != -1) != (b->bufferView != -1) || a->sparse.isSparse != b->sparse.isSparse) {
+		return false;
+	}
+	// Elements are compared one at a time, as the padding between them isn't part of the data.
+	if (a->bufferView != -1) {
+		int a_stride = tinygltf::tools::GetStride(gltf, a);
+		int b_stride = tinygltf::tools::GetStride(gltf, b);
+		size_t element_size = tinygltf::tools::GetTypeSize(a);
+		const unsigned char* a_data = tinygltf::tools::GetBufferPtr(gltf, a);
+		const unsigned char* b_data = tinygltf::tools::GetBufferPtr(gltf, b);
+		for (size_t i = 0; i < a->count; i++) {
+			if (memcmp(a_data + i * a_stride, b_data + i * b_stride, element_size) != 0) {
+				return false;
+			}
+		}
+	}
+	if (a->sparse.isSparse) {
+		if (a->sparse.count != b->sparse.count || a->sparse.indices.componentType != b->sparse.indices.componentType) {
+			return false;
+		}
+		int a_index_stride = tinygltf::tools::GetSparseIndexStride(gltf, a);
+		int b_index_stride = tinygltf::tools::GetSparseIndexStride(gltf, b);
+		int a_value_stride = tinygltf::tools::GetSparseValueStride(gltf, a);
+		int b_value_stride = tinygltf::tools::GetSparseValueStride(gltf, b);
+		size_t index_size = tinygltf::GetComponentSizeInBytes(a->sparse.indices.componentType);
+		size_t value_size = tinygltf::tools::GetTypeSize(a);
+		const unsigned char* a_indices = tinygltf::tools::GetSparseIndexPtr(gltf, a);
+		const unsigned char* b_indices = tinygltf::tools::GetSparseIndexPtr(gltf, b);
+		const unsigned char* a_values = tinygltf::tools::GetSparseValuePtr(gltf, a);
+		const unsigned char* b_values = tinygltf::tools::GetSparseValuePtr(gltf, b);
+		for (size_t i = 0; i < a->sparse.count; i++) {
+			if (memcmp(a_indices + i * a_index_stride, b_indices + i * b_index_stride, index_size) != 0) {
+				return false;
+			}
+			if (memcmp(a_values + i * a_value_stride, b_values + i * b_value_stride, value_size) != 0) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static void ConvertTangentSpace(tinygltf::Model* gltf, int normal_accessor_id, int tangent_accessor_id, uint32_t num_of_vertices, uint32_t* dest)
+{
+	ProfileZoneScoped();
+	tinygltf::Accessor* normal_accessor = &gltf->accessors[normal_accessor_id];
+	std::vector<glm::vec3> normal_storage;
+	const float* normals = GetFloatData(gltf, normal_accessor, &normal_storage);
+	size_t count = std::min<size_t>(num_of_vertices, normal_accessor->count);
+	if (tangent_accessor_id != -1) {
+		tinygltf::Accessor* tangent_accessor = &gltf->accessors[tangent_accessor_id];
+		std::vector<glm::vec4> tangent_storage;
+		const float* tangents = GetFloatData(gltf, tangent_accessor, &tangent_storage);
+		count = std::min<size_t>(count, tangent_accessor->count);
+		EncodeTangentSpaceBatch(normals, tangents, dest, count);
+	} else {
+		EncodeNormalBatch(normals, dest, count);
+	}
+}
+
+// KHR_mesh_quantization allows 8 and 16 bit integer positions and texture coordinates.
+// These are kept as integers in the quantized vertex formats instead of being expanded to floats.
+static bool IsQuantizableInteger(const tinygltf::Accessor* accessor)
+{
+	switch (accessor->componentType) {
+		case TINYGLTF_COMPONENT_TYPE_BYTE:
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+		case TINYGLTF_COMPONENT_TYPE_SHORT:
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+			return true;
+		default:
+			return false;
+	}
+}
+
+// Integer that a normalized accessor maps to 1, or 1 if the accessor isn't normalized.
+static float GetIntegerDivisor(const tinygltf::Accessor* accessor)
+{
+	if (!accessor->normalized) {
+		return 1.0f;
+	}
+	switch (accessor->componentType) {
+		case TINYGLTF_COMPONENT_TYPE_BYTE:
+			return 127.0f;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			return 255.0f;
+		case TINYGLTF_COMPONENT_TYPE_SHORT:
+			return 32767.0f;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+			return 65535.0f;
+		default:
+			return 1.0f;
+	}
+}
+
+template<glm::length_t L, typename T, typename S>
+static void BiasIntegers(const std::byte* values, size_t count, int num_of_components, int32_t bias, glm::vec<L, T>* dest)
+{
+	int n = std::min<int>(L, num_of_components);
+	for (size_t i = 0; i < count; i++) {
+		S components[4] = {};
+		std::memcpy(components, values + i * num_of_components * sizeof(S), num_of_components * sizeof(S));
+		dest[i] = glm::vec<L, T>(0);
+		for (int j = 0; j < n; j++) {
+			dest[i][j] = (T)((int32_t)components[j] - bias);
+		}
+	}
+}
+
+// Copies each integer component minus bias, without any normalization.
+template<glm::length_t L, typename T>
+static void CopyBiasedIntegers(tinygltf::Model* gltf, tinygltf::Accessor* accessor, int32_t bias, glm::vec<L, T>* dest)
+{
+	// Gather the raw integers first so the component type is only switched on once.
+	int num_of_components = tinygltf::GetNumComponentsInType(accessor->type);
+	std::vector<std::byte> values((size_t)accessor->count * tinygltf::tools::GetTypeSize(accessor));
+	tinygltf::tools::Copy(values.data(), gltf, accessor);
+	switch (accessor->componentType) {
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			BiasIntegers<L, T, uint8_t>(values.data(), accessor->count, num_of_components, bias, dest);
+			break;
+		case TINYGLTF_COMPONENT_TYPE_BYTE:
+			BiasIntegers<L, T, int8_t>(values.data(), accessor->count, num_of_components, bias, dest);
+			break;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+			BiasIntegers<L, T, uint16_t>(values.data(), accessor->count, num_of_components, bias, dest);
+			break;
+		case TINYGLTF_COMPONENT_TYPE_SHORT:
+			BiasIntegers<L, T, int16_t>(values.data(), accessor->count, num_of_components, bias, dest);
+			break;
+		default:
+			std::fill(dest, dest + accessor->count, glm::vec<L, T>(0));
+			break;
+	}
+}
+
+// Stores integer positions as R16G16B16A16_SNORM, which the GPU reads as stored / 32767.
+// Each position is stored as value - bias and decodes to (stored + bias) / divisor, which gives the scale and offset.
+static void ConvertIntegerPositions(tinygltf::Model* gltf, tinygltf::Accessor* accessor, std::vector<glm::i16vec4>* dest, glm::vec3* scale, glm::vec3* offset)
+{
+	ProfileZoneScoped();
+	// Unsigned shorts are moved into the signed range.
+	int32_t bias = accessor->componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT ? 32768 : 0;
+	float divisor = GetIntegerDivisor(accessor);
+	dest->resize(accessor->count);
+	if (accessor->componentType == TINYGLTF_COMPONENT_TYPE_SHORT) {
+		tinygltf::tools::Copy(dest->data(), gltf, accessor);
+	} else {
+		CopyBiasedIntegers(gltf, accessor, bias, dest->data());
+	}
+	*scale = glm::vec3(32767.0f / divisor);
+	*offset = glm::vec3(bias / divisor);
+}
+
+// Stores integer texture coordinates as R16G16_UNORM, which the GPU reads as stored / 65535.
+// Each coordinate is stored as value - bias and decodes to (stored + bias) / divisor, which gives the transform.
+static void ConvertIntegerTexcoords(tinygltf::Model* gltf, tinygltf::Accessor* accessor, std::vector<glm::u16vec2>* dest, glm::vec4* transform)
+{
+	ProfileZoneScoped();
+	// Signed types are moved into the unsigned range.
+	int32_t bias = 0;
+	if (accessor->componentType == TINYGLTF_COMPONENT_TYPE_BYTE) {
+		bias = -128;
+	} else if (accessor->componentType == TINYGLTF_COMPONENT_TYPE_SHORT) {
+		bias = -32768;
+	}
+	float divisor = GetIntegerDivisor(accessor);
+	dest->resize(accessor->count);
+	if (accessor->componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
+		tinygltf::tools::Copy(dest->data(), gltf, accessor);
+	} else {
+		CopyBiasedIntegers(gltf, accessor, bias, dest->data());
+	}
+	*transform = glm::vec4(glm::vec2(65535.0f / divisor), glm::vec2(bias / divisor));
+}
+
+// Image loader that keeps a copy of the encoded image instead of decoding it.
+// This lets all images be decoded in parallel once the file has been parsed.
+static bool DeferImageDecode(tinygltf::Image* image, const int image_index, std::string* error, std::string* warning, int required_width, int required_height, const unsigned char* bytes, int size, void* user_data)
+{
+	// Images stored in buffer views are read straight from the buffer when decoding.
+	if (image->bufferView != -1) {
+		return true;
+	}
+	std::vector<std::vector<unsigned char>>* encoded_images = (std::vector<std::vector<unsigned char>>*)user_data;
+	if (image_index >= encoded_images->size()) {
+		encoded_images->resize(image_index + 1);
+	}
+	(*encoded_images)[image_index].assign(bytes, bytes + size);
+	return true;
+}
+
+static bool LoadBinaryFromMappedFile(tinygltf::TinyGLTF* loader, tinygltf::Model* model, std::string* error, std::string* warning, const char* filepath, GltfImport::MappedGlb* glb)
+{
+	ProfileZoneScoped();
+	constexpr uint32_t GLB_MAGIC = 0x46546C67; // "glTF".
+	constexpr uint32_t GLB_VERSION = 2;
+	constexpr uint32_t GLB_HEADER_SIZE = 12;
+	constexpr uint32_t GLB_CHUNK_HEADER_SIZE = 8;
+	constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A; // "JSON".
+	constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942; // "BIN\0".
+	constexpr uint32_t PLACEHOLDER_SIZE = 4;
+
+	glb->data = File::Map(filepath, &glb->size);
+	if (!glb->data) {
+		*error += "Failed to map file \"" + std::string(filepath) + "\".\n";
+		return false;
+	}
+	const unsigned char* bytes = (const unsigned char*)glb->data;
+	std::string base_dir = std::filesystem::path(filepath).parent_path().string();
+
+	// Find the JSON and BIN chunks.
+	uint32_t header[5] = {};
+	if (glb->size >= sizeof(header)) {
+		std::memcpy(header, bytes, sizeof(header));
+	}
+	uint64_t length = std::min<uint64_t>(header[2], glb->size);
+	uint64_t json_offset = GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE;
+	uint64_t json_length = header[3];
+	uint64_t bin_offset = json_offset + json_length + GLB_CHUNK_HEADER_SIZE;
+	uint32_t bin_header[2] = {};
+	bool valid_header = glb->size >= sizeof(header) && header[0] == GLB_MAGIC && header[1] == GLB_VERSION && header[4] == GLB_CHUNK_JSON;
+	if (valid_header && bin_offset <= length) {
+		std::memcpy(bin_header, bytes + bin_offset - GLB_CHUNK_HEADER_SIZE, sizeof(bin_header));
+	}
+	uint64_t bin_length = bin_header[0];
+	bool has_bin_chunk = valid_header && bin_header[1] == GLB_CHUNK_BIN && bin_offset + bin_length <= length;
+
+	// The JSON chunk is patched so that tinygltf only copies a small placeholder BIN chunk.
+	nlohmann::json json;
+	if (has_bin_chunk) {
+		ProfileZoneScopedN("Parse JSON Chunk");
+		json = nlohmann::json::parse(bytes + json_offset, bytes + json_offset + json_length, nullptr, false);
+	}
+	bool patchable = 
+		has_bin_chunk && 
+		json.is_object() && 
+		json.contains("buffers") && json["buffers"].is_array() && !json["buffers"].empty() && 
+		json["buffers"][0].is_object() && !json["buffers"][0].contains("uri");
+	if (!patchable) {
+		// Nothing to map, let tinygltf load it and report any errors.
+		return loader->LoadBinaryFromMemory(model, error, warning, bytes, glb->size, base_dir);
+	}
+	json["buffers"][0]["byteLength"] = PLACEHOLDER_SIZE;
+
+	// Any other buffer without a uri is an EXT_meshopt_compression fallback buffer, which only gets data when its buffer views are decoded.
+	std::vector<int> fallback_buffers;
+	for (int i = 1; i < json["buffers"].size(); i++) {
+		nlohmann::json& buffer = json["buffers"][i];
+		if (buffer.is_object() && !buffer.contains("uri")) {
+			buffer["byteLength"] = PLACEHOLDER_SIZE;
+			fallback_buffers.push_back(i);
+		}
+	}
+
+	// tinygltf passes images stored in buffer views to the image loader, so point them at a buffer view that fits inside the placeholder.
+	std::vector<int> image_buffer_views;
+	bool has_placeholder_view = false;
+	if (json.contains("images") && json["images"].is_array() && json.contains("bufferViews") && json["bufferViews"].is_array()) {
+		int placeholder_view = json["bufferViews"].size();
+		image_buffer_views.resize(json["images"].size(), -1);
+		for (int i = 0; i < image_buffer_views.size(); i++) {
+			nlohmann::json& image = json["images"][i];
+			if (image.is_object() && image.contains("bufferView") && image["bufferView"].is_number_integer()) {
+				image_buffer_views[i] = image["bufferView"].get<int>();
+				image["bufferView"] = placeholder_view;
+				has_placeholder_view = true;
+			}
+		}
+		if (has_placeholder_view) {
+			json["bufferViews"].push_back({{"buffer", 0}, {"byteLength", PLACEHOLDER_SIZE}});
+		}
+	}
+
+	// Build a new .glb from the patched JSON and the placeholder.
+	std::string json_string = json.dump();
+	json_string.resize(AlignPowerOfTwo(json_string.size(), 4), ' ');
+	uint32_t bin_chunk_offset = GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE + json_string.size();
+	uint32_t patched_size = bin_chunk_offset + GLB_CHUNK_HEADER_SIZE + PLACEHOLDER_SIZE;
+	std::vector<unsigned char> patched(patched_size, 0);
+	uint32_t patched_header[5] = {GLB_MAGIC, GLB_VERSION, patched_size, (uint32_t)json_string.size(), GLB_CHUNK_JSON};
+	uint32_t patched_bin_header[2] = {PLACEHOLDER_SIZE, GLB_CHUNK_BIN};
+	std::memcpy(&patched[0], patched_header, sizeof(patched_header));
+	std::memcpy(&patched[sizeof(patched_header)], json_string.data(), json_string.size());
+	std::memcpy(&patched[bin_chunk_offset], patched_bin_header, sizeof(patched_bin_header));
+	{
+		ProfileZoneScopedN("LoadBinaryFromMemory");
+		if (!loader->LoadBinaryFromMemory(model, error, warning, patched.data(), patched.size(), base_dir)) {
+			return false;
+		}
+	}
+
+	// Undo the patches.
+	for (int i = 0; i < image_buffer_views.size() && i < model->images.size(); i++) {
+		if (image_buffer_views[i] != -1) {
+			model->images[i].bufferView = image_buffer_views[i];
+		}
+	}
+	if (has_placeholder_view) {
+		model->bufferViews.pop_back();
+	}
+	for (int buffer: fallback_buffers) {
+		std::vector<unsigned char>().swap(model->buffers[buffer].data);
+	}
+	for (const tinygltf::BufferView& buffer_view: model->bufferViews) {
+		if (buffer_view.buffer == 0 && buffer_view.byteOffset + buffer_view.byteLength > bin_length) {
+			*error += "Buffer view is outside of the BIN chunk.\n";
+			return false;
+		}
+	}
+	std::vector<unsigned char>().swap(model->buffers[0].data);
+	tinygltf::tools::AddExternalBuffer(&model->buffers[0], (std::byte*)bytes + bin_offset, bin_length);
+	return true;
+}
+
+// Decodes buffer views compressed with EXT_meshopt_compression into their fallback buffers, so that accessors can read them like any other buffer view.
+static bool DecodeCompressedBufferViews(tinygltf::Model* model, ThreadPool* thread_pool)
+{
+	ProfileZoneScoped();
+	enum Mode {
+		MODE_ATTRIBUTES,
+		MODE_TRIANGLES,
+		MODE_INDICES,
+	};
+	struct CompressedBufferView {
+		int buffer_view;
+		int source_buffer;
+		size_t source_offset;
+		size_t source_size;
+		size_t count;
+		size_t stride;
+		Mode mode;
+		MeshoptFilter filter;
+	};
+	std::vector<CompressedBufferView> compressed_views;
+	std::vector<size_t> fallback_sizes(model->buffers.size(), 0);
+	for (int i = 0; i < model->bufferViews.size(); i++) {
+		const tinygltf::BufferView& buffer_view = model->bufferViews[i];
+		auto it = buffer_view.extensions.find("EXT_meshopt_compression");
+		if (it == buffer_view.extensions.end()) {
+			continue;
+		}
+		const tinygltf::Value& extension = it->second;
+		auto get_number = [&](const char* name, int64_t default_value) {
+			const tinygltf::Value& value = extension.Get(name);
+			return value.IsNumber() ? (int64_t)value.GetNumberAsDouble() : default_value;
+		};
+		auto get_string = [&](const char* name, const char* default_value) {
+			const tinygltf::Value& value = extension.Get(name);
+			return value.IsString() ? value.Get<std::string>() : std::string(default_value);
+		};
+		int64_t source_buffer = get_number("buffer", -1);
+		int64_t source_offset = get_number("byteOffset", 0);
+		int64_t source_size = get_number("byteLength", -1);
+		int64_t stride = get_number("byteStride", -1);
+		int64_t count = get_number("count", -1);
+		std::string mode = get_string("mode", "");
+		std::string filter = get_string("filter", "NONE");
+
+		CompressedBufferView view = {
+			.buffer_view = i,
+			.source_buffer = (int)source_buffer,
+			.source_offset = (size_t)source_offset,
+			.source_size = (size_t)source_size,
+			.count = (size_t)count,
+			.stride = (size_t)stride,
+		};
+		bool valid = 
+			source_buffer >= 0 && source_buffer < model->buffers.size() && source_buffer != buffer_view.buffer &&
+			source_offset >= 0 && source_size >= 0 && stride > 0 && count >= 0 &&
+			view.source_offset + view.source_size <= tinygltf::tools::GetBufferSize(model, view.source_buffer) &&
+			buffer_view.buffer >= 0 && buffer_view.buffer < model->buffers.size() &&
+			view.count * view.stride <= buffer_view.byteLength;
+		if (mode == "ATTRIBUTES") {
+			view.mode = MODE_ATTRIBUTES;
+			valid = valid && stride % 4 == 0 && stride <= 256;
+		} else if (mode == "TRIANGLES") {
+			view.mode = MODE_TRIANGLES;
+			valid = valid && count % 3 == 0 && (stride == 2 || stride == 4);
+		} else if (mode == "INDICES") {
+			view.mode = MODE_INDICES;
+			valid = valid && (stride == 2 || stride == 4);
+		} else {
+			valid = false;
+		}
+		if (filter == "NONE") {
+			view.filter = MESHOPT_FILTER_NONE;
+		} else if (filter == "OCTAHEDRAL") {
+			view.filter = MESHOPT_FILTER_OCTAHEDRAL;
+			valid = valid && view.mode == MODE_ATTRIBUTES && (stride == 4 || stride == 8);
+		} else if (filter == "QUATERNION") {
+			view.filter = MESHOPT_FILTER_QUATERNION;
+			valid = valid && view.mode == MODE_ATTRIBUTES && stride == 8;
+		} else if (filter == "EXPONENTIAL") {
+			view.filter = MESHOPT_FILTER_EXPONENTIAL;
+			valid = valid && view.mode == MODE_ATTRIBUTES;
+		} else {
+			valid = false;
+		}
+		if (!valid) {
+			SPDLOG_ERROR("Buffer view {} has invalid EXT_meshopt_compression properties.", i);
+			return false;
+		}
+		compressed_views.push_back(view);
+		fallback_sizes[buffer_view.buffer] = std::max(fallback_sizes[buffer_view.buffer], buffer_view.byteOffset + buffer_view.byteLength);
+	}
+	if (compressed_views.empty()) {
+		return true;
+	}
+
+	// Fallback buffers usually have no data of their own, so make room for the decoded buffer views.
+	for (int i = 0; i < model->buffers.size(); i++) {
+		if (model->buffers[i].data.size() < fallback_sizes[i]) {
+			model->buffers[i].data.resize(fallback_sizes[i]);
+		}
+	}
+
+	std::atomic<bool> success = true;
+	thread_pool->ParallelFor(compressed_views.size(), [&](int i) {
+		const CompressedBufferView& view = compressed_views[i];
+		const tinygltf::BufferView& buffer_view = model->bufferViews[view.buffer_view];
+		const uint8_t* source = (const uint8_t*)tinygltf::tools::GetBufferData(model, view.source_buffer) + view.source_offset;
+		unsigned char* destination = model->buffers[buffer_view.buffer].data.data() + buffer_view.byteOffset;
+		bool result = false;
+		switch (view.mode) {
+			case MODE_ATTRIBUTES: {
+				result = DecodeMeshoptVertices(destination, view.count, view.stride, source, view.source_size);
+			} break;
+			case MODE_TRIANGLES: {
+				result = DecodeMeshoptTriangles(destination, view.count, view.stride, source, view.source_size);
+			} break;
+			case MODE_INDICES: {
+				result = DecodeMeshoptIndices(destination, view.count, view.stride, source, view.source_size);
+			} break;
+		}
+		if (result) {
+			DecodeMeshoptFilter(view.filter, destination, view.count, view.stride);
+		} else {
+			SPDLOG_ERROR("Failed to decode buffer view {}.", view.buffer_view);
+			success = false;
+		}
+	});
+	return success;
+}
+
+static void GetTextureTransform(tinygltf::Value* gltf_value, int* tex_coord, glm::vec2* offset, float* rotation, glm::vec2* scale)
+{
+	*offset = glm::vec2(0.0, 0.0);
+	*rotation = 0.0;
+	*scale = glm::vec2(1.0, 1.0);
+	
+	if (!gltf_value->IsObject()) {
+		return;
+	}
+
+	auto offset_value = gltf_value->Get("offset");
+	if (offset_value.ArrayLen() == 2) {
+		*offset = glm::vec2(offset_value.Get(0).GetNumberAsDouble(), offset_value.Get(1).GetNumberAsDouble());
+	}
+	auto rotation_value = gltf_value->Get("rotation");
+	if (rotation_value.IsNumber()) {
+		*rotation = rotation_value.GetNumberAsDouble();
+	}
+	auto scale_value = gltf_value->Get("scale");
+	if (scale_value.ArrayLen() == 2) {
+		*scale = glm::vec2(scale_value.Get(0).GetNumberAsDouble(), scale_value.Get(1).GetNumberAsDouble());
+	}
+	auto tex_coord_value = gltf_value->Get("texCoord");
+	if (tex_coord_value.IsInt()) {
+		int value = tex_coord_value.GetNumberAsInt();
+		if (value >= 0 && value < GltfImport::MAX_TEXCOORDS) {
+			*tex_coord = value;
+		}
+	}
+}
+
+static GltfImport::Material::Texture GetTexture(tinygltf::Model* gltf, std::vector<GltfImport::ImageUsage>* images, int texture_index, int tex_coord, tinygltf::Value* texture_transform, bool srgb, uint32_t channels)
+{
+	GltfImport::Material::Texture material_texture;
+	if (texture_index != -1) {
+		tinygltf::Texture* texture = &gltf->textures[texture_index];
+		int texture_source = texture->source;
+		// Identical images all use the first of them.
+		if (texture_source != -1 && (*images)[texture_source].duplicate_of != -1) {
+			texture_source = (*images)[texture_source].duplicate_of;
+		}
+		if (texture_source != -1) {
+			// The first material to use a texture decides its format.
+			if ((*images)[texture_source].format == DXGI_FORMAT_UNKNOWN) {
+				(*images)[texture_source].format = srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+			}
+			(*images)[texture_source].channels |= channels;
+			// These are glTF image and sampler indices until ResolveMaterialTextures is called.
+			material_texture = {
+				.texture = texture_source,
+				.sampler = texture->sampler,
+				.tex_coord = tex_coord < GltfImport::MAX_TEXCOORDS ? tex_coord : 0,
+			};
+			GetTextureTransform(texture_transform, &material_texture.tex_coord, &material_texture.offset, &material_texture.rotation, &material_texture.scale);
+		} else {
+			// TODO: Create a default magenta texture.
+		}
+	}
+	return material_texture;
+}
+
+static GltfImport::Material::Texture GetTexture(tinygltf::Model* gltf, std::vector<GltfImport::ImageUsage>* images, tinygltf::TextureInfo* texture_info, bool srgb, uint32_t channels)
+{
+	return GetTexture(gltf, images, texture_info->index, texture_info->texCoord, &texture_info->extensions["KHR_texture_transform"], srgb, channels);
+}
+
+static GltfImport::Material::Texture GetTexture(tinygltf::Model* gltf, std::vector<GltfImport::ImageUsage>* images, tinygltf::NormalTextureInfo* texture_info, float* scale)
+{
+	*scale = texture_info->scale;
+	return GetTexture(gltf, images, texture_info->index, texture_info->texCoord, &texture_info->extensions["KHR_texture_transform"], false, TEXTURE_CHANNEL_R | TEXTURE_CHANNEL_G);
+}
+
+static GltfImport::Material::Texture GetTexture(tinygltf::Model* gltf, std::vector<GltfImport::ImageUsage>* images, tinygltf::OcclusionTextureInfo* texture_info)
+{
+	return GetTexture(gltf, images, texture_info->index, texture_info->texCoord, &texture_info->extensions["KHR_texture_transform"], false, TEXTURE_CHANNEL_R);
+}
+
+static GltfImport::Material::Texture GetTexture(tinygltf::Model* gltf, std::vector<GltfImport::ImageUsage>* images, const tinygltf::Value* texture_info, float* scale, bool srgb, uint32_t channels)
+{
+	GltfImport::Material::Texture desc;
+
+	if (!texture_info->IsObject()) {
+		return desc;
+	}
+
+	auto index_value = texture_info->Get("index");
+	int index = index_value.GetNumberAsInt();
+	auto tex_coord_value = texture_info->Get("texCoord");
+	int tex_coord = tex_coord_value.GetNumberAsInt();
+	if (scale) {
+		auto scale_value = texture_info->Get("scale");
+		if (scale_value.IsNumber()) {
+			*scale = scale_value.GetNumberAsDouble();
+		}
+	}
+	auto extensions = texture_info->Get("extensions");
+	tinygltf::Value transform_extension;
+	if (extensions.IsObject()) {
+		transform_extension = extensions.Get("KHR_texture_transform");
+	}
+
+	return GetTexture(gltf, images, index, tex_coord, &transform_extension, srgb, channels);
+}
+
+namespace GltfImport {
+
+int GetAttribute(const std::map<std::string, int>* attributes, const char* name)
+{
+	auto it = attributes->find(name);
+	return it != attributes->end() ? it->second : -1;
+}
+
+uint64_t EstimatePrimitiveSize(tinygltf::Model* gltf, const tinygltf::Primitive* gltf_primitive)
+{
+	int position = GetAttribute(&gltf_primitive->attributes, "POSITION");
+	uint64_t num_of_vertices = position != -1 ? gltf->accessors[position].count : 0;
+	uint64_t num_of_indices = gltf_primitive->indices != -1 ? gltf->accessors[gltf_primitive->indices].count : 0;
+	uint64_t vertex_size = sizeof(glm::vec3) + sizeof(uint32_t) + MAX_TEXCOORDS * sizeof(glm::vec2) + sizeof(glm::u16vec4) + sizeof(JointWeight);
+	uint64_t target_vertex_size = 3 * sizeof(glm::vec3);
+	// Levels of detail halve the triangle count each time, so together they need at most as many indices as the primitive.
+	return num_of_vertices * (vertex_size + gltf_primitive->targets.size() * target_vertex_size) + num_of_indices * 2 * sizeof(uint32_t);
+}
+
+uint64_t HashPrimitive(tinygltf::Model* gltf, const tinygltf::Primitive* gltf_primitive)
+{
+	ProfileZoneScoped();
+	// Each accessor is hashed in place, then the hashes are combined with the accessor metadata.
+	std::vector<uint64_t> words = {(uint64_t)gltf_primitive->mode};
+	HashAccessor(gltf, gltf_primitive->indices, &words);
+	const char* attributes[] = {"POSITION", "NORMAL", "TANGENT", "TEXCOORD_0", "TEXCOORD_1", "COLOR_0", "JOINTS_0", "WEIGHTS_0"};
+	for (const char* attribute: attributes) {
+		HashAccessor(gltf, GetAttribute(&gltf_primitive->attributes, attribute), &words);
+	}
+	words.push_back(gltf_primitive->targets.size());
+	for (const std::map<std::string, int>& target: gltf_primitive->targets) {
+		HashAccessor(gltf, GetAttribute(&target, "POSITION"), &words);
+		HashAccessor(gltf, GetAttribute(&target, "NORMAL"), &words);
+		HashAccessor(gltf, GetAttribute(&target, "TANGENT"), &words);
+	}
+	return Hash(words.data(), words.size() * sizeof(uint64_t));
+}
+
+bool ComparePrimitives(tinygltf::Model* gltf, const tinygltf::Primitive* a, const tinygltf::Primitive* b)
+{
+	ProfileZoneScoped();
+	if (a->mode != b->mode || a->targets.size() != b->targets.size()) {
+		return false;
+	}
+	if (!CompareAccessors(gltf, a->indices, b->indices)) {
+		return false;
+	}
+	const char* attributes[] = {"POSITION", "NORMAL", "TANGENT", "TEXCOORD_0", "TEXCOORD_1", "COLOR_0", "JOINTS_0", "WEIGHTS_0"};
+	for (const char* attribute: attributes) {
+		if (!CompareAccessors(gltf, GetAttribute(&a->attributes, attribute), GetAttribute(&b->attributes, attribute))) {
+			return false;
+		}
+	}
+	for (int i = 0; i < a->targets.size(); i++) {
+		for (const char* attribute: {"POSITION", "NORMAL", "TANGENT"}) {
+			if (!CompareAccessors(gltf, GetAttribute(&a->targets[i], attribute), GetAttribute(&b->targets[i], attribute))) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool ConvertPrimitive(tinygltf::Model* gltf, const tinygltf::Primitive* gltf_primitive, PrimitiveData* data)
+{
+	ProfileZoneScoped();
+	data->valid = false;
+
+	// Get the primitive type.
+	switch (gltf_primitive->mode) {
+		case TINYGLTF_MODE_POINTS: {
+			data->topology = D3D_PRIMITIVE_TOPOLOGY_POINTLIST;
+		} break;
+		case TINYGLTF_MODE_LINE: {
+			data->topology = D3D_PRIMITIVE_TOPOLOGY_LINELIST;
+		} break;
+		case TINYGLTF_MODE_LINE_LOOP: {
+			SPDLOG_WARN("Unsupported Topology: Line Loop.");
+			return false;
+		} break;
+		case TINYGLTF_MODE_LINE_STRIP: {
+			data->topology = D3D_PRIMITIVE_TOPOLOGY_LINESTRIP;
+		} break;
+		case TINYGLTF_MODE_TRIANGLES: {
+			data->topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		} break;
+		case TINYGLTF_MODE_TRIANGLE_STRIP: {
+			data->topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+		} break;
+		case TINYGLTF_MODE_TRIANGLE_FAN: {
+			SPDLOG_WARN("Unsupported Topology: Triangle Fan.");
+			return false;
+		} break;
+	}
+
+	const std::map<std::string, int>* attributes = &gltf_primitive->attributes;
+	int position = GetAttribute(attributes, "POSITION");
+	int normal = GetAttribute(attributes, "NORMAL");
+	int tangent = GetAttribute(attributes, "TANGENT");
+	int texcoord_0 = GetAttribute(attributes, "TEXCOORD_0");
+	int texcoord_1 = GetAttribute(attributes, "TEXCOORD_1");
+	int color = GetAttribute(attributes, "COLOR_0");
+	int joints = GetAttribute(attributes, "JOINTS_0");
+	int weights = GetAttribute(attributes, "WEIGHTS_0");
+	if (position == -1) {
+		SPDLOG_WARN("Primitive has no positions.");
+		return false;
+	}
+
+	data->num_of_vertices = gltf->accessors[position].count;
+	uint32_t num_of_vertices = data->num_of_vertices;
+
+	if (gltf_primitive->indices != -1) {
+		tinygltf::Accessor* index_accessor = &gltf->accessors[gltf_primitive->indices];
+		data->num_of_indices = index_accessor->count;
+		switch (index_accessor->componentType) {
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+				// DirectX 12 doesn't support 8 bit indices, so convert them to 16 bit.
+				data->index_format = DXGI_FORMAT_R16_UINT;
+				data->indices.resize(data->num_of_indices * sizeof(uint16_t));
+				tinygltf::tools::Copy((glm::u16vec1*)data->indices.data(), gltf, index_accessor);
+			} break;
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+				data->index_format = DXGI_FORMAT_R16_UINT;
+				data->indices.resize(data->num_of_indices * sizeof(uint16_t));
+				tinygltf::tools::Copy(data->indices.data(), gltf, index_accessor);
+			} break;
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+				data->index_format = DXGI_FORMAT_R32_UINT;
+				data->indices.resize(data->num_of_indices * sizeof(uint32_t));
+				tinygltf::tools::Copy(data->indices.data(), gltf, index_accessor);
+			} break;
+			default: {
+				SPDLOG_WARN("Unsupported index component type {}.", index_accessor->componentType);
+				return false;
+			} break;
+		}
+	}
+
+	tinygltf::Accessor* position_accessor = &gltf->accessors[position];
+	if (IsQuantizableInteger(position_accessor)) {
+		ConvertIntegerPositions(gltf, position_accessor, &data->quantized_positions, &data->dequantization.position_scale, &data->dequantization.position_offset);
+	} else {
+		data->positions.resize(num_of_vertices);
+		tinygltf::tools::Copy(data->positions.data(), gltf, position_accessor);
+	}
+
+	if (normal != -1) {
+		data->tangent_space.resize(num_of_vertices);
+		ConvertTangentSpace(gltf, normal, tangent, num_of_vertices, data->tangent_space.data());
+	}
+
+	int texcoords[MAX_TEXCOORDS] = {texcoord_0, texcoord_1};
+	for (int i = 0; i < MAX_TEXCOORDS; i++) {
+		if (texcoords[i] == -1) {
+			continue;
+		}
+		tinygltf::Accessor* texcoord_accessor = &gltf->accessors[texcoords[i]];
+		if (IsQuantizableInteger(texcoord_accessor)) {
+			ConvertIntegerTexcoords(gltf, texcoord_accessor, &data->quantized_texcoords[i], &data->dequantization.texcoord_transforms[i]);
+		} else {
+			data->texcoords[i].resize(num_of_vertices);
+			tinygltf::tools::Copy(data->texcoords[i].data(), gltf, texcoord_accessor);
+		}
+	}
+
+	if (color != -1) {
+		data->colors.resize(num_of_vertices);
+		tinygltf::tools::Copy<4, uint16_t, true>(data->colors.data(), gltf, &gltf->accessors[color]);
+	}
+
+	// Create bone weights.
+	if (joints != -1 && weights != -1) {
+		data->joint_weights.resize(num_of_vertices);
+		JointWeight* dest = data->joint_weights.data();
+		tinygltf::tools::Copy<4, uint16_t>(&dest->joints, sizeof(JointWeight), gltf, &gltf->accessors[joints]);
+		tinygltf::tools::Copy<4, uint16_t, true>(&dest->weights, sizeof(JointWeight), gltf, &gltf->accessors[weights]);
+	}
+
+	// The material id is incremented by 1 so that an id of 0 will use the default material.
+	data->material_id = gltf_primitive->material + 1;
+
+	data->valid = true;
+	return true;
+}
+
+// Morph target attributes are deltas, so they are kept as floats instead of being encoded like the base attributes.
+static void CopyMorphTargetAttribute(tinygltf::Model* gltf, int accessor_id, uint32_t num_of_vertices, std::vector<glm::vec3>* dest)
+{
+	if (accessor_id == -1) {
+		return;
+	}
+	tinygltf::Accessor* accessor = &gltf->accessors[accessor_id];
+	if (accessor->count != num_of_vertices) {
+		SPDLOG_WARN("Morph target attribute has {} elements instead of {}, ignoring it.", accessor->count, num_of_vertices);
+		return;
+	}
+	dest->resize(num_of_vertices);
+	tinygltf::tools::Copy(dest->data(), gltf, accessor);
+}
+
+void ConvertMorphTarget(tinygltf::Model* gltf, const std::map<std::string, int>* target, uint32_t num_of_vertices, MorphTargetData* data)
+{
+	ProfileZoneScoped();
+	CopyMorphTargetAttribute(gltf, GetAttribute(target, "POSITION"), num_of_vertices, &data->positions);
+	CopyMorphTargetAttribute(gltf, GetAttribute(target, "NORMAL"), num_of_vertices, &data->normals);
+	CopyMorphTargetAttribute(gltf, GetAttribute(target, "TANGENT"), num_of_vertices, &data->tangents);
+}
+
+// Returns false if an index is out of range, which is left for the GPU to deal with.
+static bool GetIndices(const PrimitiveData* data, std::vector<uint32_t>* indices)
+{
+	if (data->index_format == DXGI_FORMAT_UNKNOWN) {
+		indices->resize(data->num_of_vertices);
+		for (uint32_t i = 0; i < data->num_of_vertices; i++) {
+			(*indices)[i] = i;
+		}
+		return true;
+	}
+	indices->resize(data->num_of_indices);
+	if (data->index_format == DXGI_FORMAT_R16_UINT) {
+		const uint16_t* source = (const uint16_t*)data->indices.data();
+		std::copy(source, source + data->num_of_indices, indices->data());
+	} else {
+		std::memcpy(indices->data(), data->indices.data(), data->num_of_indices * sizeof(uint32_t));
+	}
+	for (uint32_t index: *indices) {
+		if (index >= data->num_of_vertices) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Positions kept quantized from KHR_mesh_quantization are decoded into storage.
+static const glm::vec3* GetPositions(const PrimitiveData* data, std::vector<glm::vec3>* storage)
+{
+	if (data->quantized_positions.empty()) {
+		return data->positions.data();
+	}
+	storage->resize(data->quantized_positions.size());
+	DequantizePositions(data->quantized_positions.data(), data->quantized_positions.size(), data->dequantization.position_scale, data->dequantization.position_offset, storage->data());
+	return storage->data();
+}
+
+void OptimizePrimitive(PrimitiveData* data, bool reduce_overdraw)
+{
+	ProfileZoneScoped();
+	if (!data->valid || data->topology != D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST || data->index_format == DXGI_FORMAT_UNKNOWN || data->num_of_indices < 3) {
+		return;
+	}
+	std::vector<uint32_t> indices;
+	if (!GetIndices(data, &indices)) {
+		return;
+	}
+
+	data->cache_stats_before = SimulateVertexCache(indices.data(), indices.size(), data->num_of_vertices);
+	OptimizeVertexCache(indices.data(), indices.size(), data->num_of_vertices);
+	if (reduce_overdraw) {
+		std::vector<glm::vec3> position_storage;
+		OptimizeOverdraw(indices.data(), indices.size(), GetPositions(data, &position_storage), data->num_of_vertices);
+	}
+	std::vector<uint32_t> remap;
+	uint32_t num_of_vertices = OptimizeVertexFetch(indices.data(), indices.size(), data->num_of_vertices, &remap);
+	RemapVertexStream(&data->positions, remap, num_of_vertices);
+	RemapVertexStream(&data->tangent_space, remap, num_of_vertices);
+	RemapVertexStream(&data->texcoords[0], remap, num_of_vertices);
+	RemapVertexStream(&data->texcoords[1], remap, num_of_vertices);
+	RemapVertexStream(&data->colors, remap, num_of_vertices);
+	RemapVertexStream(&data->joint_weights, remap, num_of_vertices);
+	RemapVertexStream(&data->quantized_positions, remap, num_of_vertices);
+	RemapVertexStream(&data->quantized_texcoords[0], remap, num_of_vertices);
+	RemapVertexStream(&data->quantized_texcoords[1], remap, num_of_vertices);
+	for (MorphTargetData& target: data->targets) {
+		RemapVertexStream(&target.positions, remap, num_of_vertices);
+		RemapVertexStream(&target.normals, remap, num_of_vertices);
+		RemapVertexStream(&target.tangents, remap, num_of_vertices);
+	}
+	data->num_of_vertices = num_of_vertices;
+	data->cache_stats_after = SimulateVertexCache(indices.data(), indices.size(), data->num_of_vertices);
+
+	if (data->index_format == DXGI_FORMAT_R16_UINT) {
+		uint16_t* dest = (uint16_t*)data->indices.data();
+		for (uint32_t i = 0; i < data->num_of_indices; i++) {
+			dest[i] = (uint16_t)indices[i];
+		}
+	} else {
+		std::memcpy(data->indices.data(), indices.data(), data->num_of_indices * sizeof(uint32_t));
+	}
+}
+
+void BuildPrimitiveMeshlets(PrimitiveData* data)
+{
+	ProfileZoneScoped();
+	if (!data->valid || data->topology != D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST) {
+		return;
+	}
+	std::vector<uint32_t> indices;
+	if (!GetIndices(data, &indices)) {
+		return;
+	}
+	BuildMeshlets(indices.data(), indices.size(), data->num_of_vertices, &data->meshlets);
+	std::vector<glm::vec3> position_storage;
+	ComputeMeshletBounds(GetPositions(data, &position_storage), &data->meshlets);
+}
+
+// How much attributes count against distance when simplifying, relative to the radius of the mesh.
+static constexpr float LOD_TEXCOORD_WEIGHT = 0.05f;
+static constexpr float LOD_SKIN_WEIGHT = 0.1f;
+
+void BuildPrimitiveLods(PrimitiveData* data)
+{
+	ProfileZoneScoped();
+	if (!data->valid || data->topology != D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST || data->index_format == DXGI_FORMAT_UNKNOWN || data->num_of_indices / 3 < MESH_LOD_MIN_TRIANGLES) {
+		return;
+	}
+	std::vector<uint32_t> indices;
+	if (!GetIndices(data, &indices)) {
+		return;
+	}
+
+	std::vector<glm::vec3> position_storage;
+	const glm::vec3* positions = GetPositions(data, &position_storage);
+	glm::vec3 minimum = positions[0];
+	glm::vec3 maximum = positions[0];
+	for (uint32_t i = 0; i < data->num_of_vertices; i++) {
+		minimum = glm::min(minimum, positions[i]);
+		maximum = glm::max(maximum, positions[i]);
+	}
+	data->lods.center = (minimum + maximum) * 0.5f;
+	data->lods.radius = 0.0f;
+	for (uint32_t i = 0; i < data->num_of_vertices; i++) {
+		data->lods.radius = std::max(data->lods.radius, glm::length(positions[i] - data->lods.center));
+	}
+
+	const glm::vec2* texcoords = data->texcoords[0].empty() ? nullptr : data->texcoords[0].data();
+	std::vector<glm::vec2> texcoord_storage;
+	if (!data->quantized_texcoords[0].empty()) {
+		texcoord_storage.resize(data->quantized_texcoords[0].size());
+		DequantizeTexcoords(data->quantized_texcoords[0].data(), texcoord_storage.size(), data->dequantization.texcoord_transforms[0], texcoord_storage.data());
+		texcoords = texcoord_storage.data();
+	}
+
+	// Attributes are scaled to the size of the mesh so that the same weights work for any mesh.
+	uint32_t attribute_count = (texcoords ? 2 : 0) + (data->joint_weights.empty() ? 0 : 4);
+	std::vector<float> attributes(data->num_of_vertices * attribute_count);
+	std::vector<uint32_t> groups;
+	if (!data->joint_weights.empty()) {
+		groups.resize(data->num_of_vertices);
+	}
+	for (uint32_t i = 0; i < data->num_of_vertices; i++) {
+		float* vertex_attributes = attributes.data() + i * attribute_count;
+		if (texcoords) {
+			*vertex_attributes++ = texcoords[i].x * data->lods.radius * LOD_TEXCOORD_WEIGHT;
+			*vertex_attributes++ = texcoords[i].y * data->lods.radius * LOD_TEXCOORD_WEIGHT;
+		}
+		if (!data->joint_weights.empty()) {
+			const JointWeight& joint_weight = data->joint_weights[i];
+			for (int j = 0; j < 4; j++) {
+				*vertex_attributes++ = joint_weight.weights[j] / 65535.0f * data->lods.radius * LOD_SKIN_WEIGHT;
+			}
+			groups[i] = (uint32_t)Hash(&joint_weight.joints, sizeof(joint_weight.joints));
+		}
+	}
+	SimplifyVertices vertices = {
+		.positions = positions,
+		.vertex_count = data->num_of_vertices,
+		.attributes = attributes.data(),
+		.attribute_count = attribute_count,
+		.groups = groups.empty() ? nullptr : groups.data(),
+	};
+
+	// Each level halves the previous one. Errors are added up, as each level is simplified from the one before.
+	std::vector<uint32_t> lod_indices;
+	std::vector<uint32_t> simplified;
+	float error = 0.0f;
+	for (int i = 0; i < MESH_MAX_LODS; i++) {
+		size_t target_index_count = indices.size() / 6 * 3;
+		error += SimplifyMesh(indices.data(), indices.size(), &vertices, target_index_count, data->lods.radius, &simplified);
+		// Stop once seams and borders stop the mesh from getting much simpler, as the next level would barely differ.
+		if (simplified.empty() || simplified.size() > indices.size() * 3 / 4) {
+			break;
+		}
+		OptimizeVertexCache(simplified.data(), simplified.size(), data->num_of_vertices);
+		data->lods.lods.push_back({
+			.first_index = (uint32_t)lod_indices.size(),
+			.num_of_indices = (uint32_t)simplified.size(),
+			.error = error,
+		});
+		lod_indices.insert(lod_indices.end(), simplified.begin(), simplified.end());
+		indices.swap(simplified);
+	}
+
+	if (data->index_format == DXGI_FORMAT_R16_UINT) {
+		data->lod_indices.resize(lod_indices.size() * sizeof(uint16_t));
+		uint16_t* dest = (uint16_t*)data->lod_indices.data();
+		for (size_t i = 0; i < lod_indices.size(); i++) {
+			dest[i] = (uint16_t)lod_indices[i];
+		}
+	} else {
+		data->lod_indices.resize(lod_indices.size() * sizeof(uint32_t));
+		std::memcpy(data->lod_indices.data(), lod_indices.data(), lod_indices.size() * sizeof(uint32_t));
+	}
+}
+
+void BuildPrimitiveMorphData(PrimitiveData* data)
+{
+	ProfileZoneScoped();
+	MorphData* morph = &data->morph;
+	*morph = {};
+	morph->num_of_targets = data->targets.size();
+	bool has_positions = false;
+	bool has_normals = false;
+	bool has_tangents = false;
+	for (const MorphTargetData& target: data->targets) {
+		has_positions |= !target.positions.empty();
+		has_normals |= !target.normals.empty();
+		has_tangents |= !target.tangents.empty();
+	}
+
+	// Visiting every target for each vertex in turn keeps the deltas of a vertex next to each other.
+	morph->delta_offsets.resize(data->num_of_vertices + 1);
+	for (uint32_t i = 0; i < data->num_of_vertices; i++) {
+		morph->delta_offsets[i] = morph->targets.size();
+		for (uint32_t j = 0; j < data->targets.size(); j++) {
+			const MorphTargetData& target = data->targets[j];
+			glm::vec3 position = target.positions.empty() ? glm::vec3(0.0f) : target.positions[i];
+			glm::vec3 normal = target.normals.empty() ? glm::vec3(0.0f) : target.normals[i];
+			glm::vec3 tangent = target.tangents.empty() ? glm::vec3(0.0f) : target.tangents[i];
+			if (position == glm::vec3(0.0f) && normal == glm::vec3(0.0f) && tangent == glm::vec3(0.0f)) {
+				continue;
+			}
+			morph->targets.push_back(j);
+			if (has_positions) {
+				morph->positions.push_back(position);
+			}
+			if (has_normals) {
+				morph->normals.push_back(normal);
+			}
+			if (has_tangents) {
+				morph->tangents.push_back(tangent);
+			}
+		}
+	}
+	morph->delta_offsets[data->num_of_vertices] = morph->targets.size();
+	if (morph->targets.empty()) {
+		morph->delta_offsets.clear();
+	}
+	data->targets = {};
+}
+
+void QuantizePrimitive(PrimitiveData* data, bool quantize_positions)
+{
+	ProfileZoneScoped();
+	if (!data->valid) {
+		return;
+	}
+	QuantizationStats* stats = &data->quantization_stats;
+	if (quantize_positions && !data->positions.empty()) {
+		data->quantized_positions.resize(data->positions.size());
+		stats->position_error = QuantizePositions(data->positions.data(), data->positions.size(), data->quantized_positions.data(), &data->dequantization.position_scale, &data->dequantization.position_offset);
+		data->positions = {};
+	}
+	for (int i = 0; i < MAX_TEXCOORDS; i++) {
+		if (data->texcoords[i].empty()) {
+			continue;
+		}
+		data->quantized_texcoords[i].resize(data->texcoords[i].size());
+		float error = QuantizeTexcoords(data->texcoords[i].data(), data->texcoords[i].size(), data->quantized_texcoords[i].data(), &data->dequantization.texcoord_transforms[i]);
+		stats->texcoord_error = std::max(stats->texcoord_error, error);
+		data->texcoords[i] = {};
+	}
+	if (!data->colors.empty()) {
+		data->quantized_colors.resize(data->colors.size());
+		stats->color_error = QuantizeColors(data->colors.data(), data->colors.size(), data->quantized_colors.data());
+		data->colors = {};
+	}
+
+	// Sizes are compared against float streams, including streams that were already quantized in the source file.
+	// Streams that are not quantized still count, so the totals cover the whole vertex.
+	uint64_t num_of_vertices = data->num_of_vertices;
+	uint64_t other_bytes = num_of_vertices * ((data->tangent_space.empty() ? 0 : sizeof(uint32_t)) + (data->joint_weights.empty() ? 0 : sizeof(JointWeight)));
+	stats->vertex_bytes_before = other_bytes + num_of_vertices * sizeof(glm::vec3);
+	stats->vertex_bytes_after = other_bytes + num_of_vertices * (data->quantized_positions.empty() ? sizeof(glm::vec3) : sizeof(glm::i16vec4));
+	for (int i = 0; i < MAX_TEXCOORDS; i++) {
+		if (!data->quantized_texcoords[i].empty()) {
+			stats->vertex_bytes_before += num_of_vertices * sizeof(glm::vec2);
+			stats->vertex_bytes_after += num_of_vertices * sizeof(glm::u16vec2);
+		}
+	}
+	if (!data->quantized_colors.empty()) {
+		stats->vertex_bytes_before += num_of_vertices * sizeof(glm::u16vec4);
+		stats->vertex_bytes_after += num_of_vertices * sizeof(glm::u8vec4);
+	}
+}
+
+MappedGlb::~MappedGlb()
+{
+	tinygltf::tools::ClearExternalBuffers();
+	if (data) {
+		File::Unmap(data, size);
+	}
+}
+
+bool ParseGltf(const char* filepath, bool memory_map, tinygltf::Model* model, MappedGlb* mapped_glb, std::vector<std::vector<unsigned char>>* encoded_images, ThreadPool* thread_pool)
+{
+	ProfileZoneScoped();
+	tinygltf::TinyGLTF gltf;
+	std::string error, warning;
+	bool result = false;
+
+	// Decoding images is deferred so that it can be done in parallel.
+	gltf.SetImageLoader(DeferImageDecode, encoded_images);
+
+	std::filesystem::path path(filepath);
+	if (path.extension() == ".glb" && memory_map) {
+		result = LoadBinaryFromMappedFile(&gltf, model, &error, &warning, filepath, mapped_glb);
+	} else if (path.extension() == ".glb") {
+		ProfileZoneScopedN("LoadBinaryFromFile");
+		result = gltf.LoadBinaryFromFile(model, &error, &warning, filepath);
+	} else if (path.extension() == ".gltf") {
+		ProfileZoneScopedN("LoadASCIIFromFile");
+		result = gltf.LoadASCIIFromFile(model, &error, &warning, filepath);
+	} else {
+		result = false;
+	}
+	if (!error.empty()) {
+		SPDLOG_ERROR(error);
+	}
+	if (!warning.empty()) {
+		SPDLOG_WARN(warning);
+	}
+	if (!result) {
+		return false;
+	}
+
+	// Check for any unsupported extensions.
+	for (auto extension: model->extensionsRequired) {
+		if (
+			extension != "KHR_lights_punctual" && 
+			extension != "KHR_texture_transform" &&
+			extension != "KHR_materials_ior" &&
+			extension != "KHR_materials_specular" &&
+			extension != "KHR_materials_anisotropy" &&
+			extension != "KHR_materials_sheen" &&
+			extension != "KHR_mesh_quantization" &&
+			extension != "EXT_mesh_gpu_instancing" &&
+			extension != "EXT_meshopt_compression"
+		) {
+			SPDLOG_ERROR("Unsupported required extension {}.", extension);
+			return false;
+		}
+	}
+	return DecodeCompressedBufferViews(model, thread_pool);
+}
+
+const unsigned char* GetEncodedImage(const tinygltf::Model* gltf, const std::vector<std::vector<unsigned char>>* encoded_images, int image, size_t* size)
+{
+	if (gltf->images[image].bufferView != -1) {
+		*size = gltf->bufferViews[gltf->images[image].bufferView].byteLength;
+		return (const unsigned char*)tinygltf::tools::GetBufferViewPtr(gltf, gltf->images[image].bufferView);
+	}
+	if (image < encoded_images->size()) {
+		*size = (*encoded_images)[image].size();
+		return (*encoded_images)[image].data();
+	}
+	*size = 0;
+	return nullptr;
+}
+
+bool DecodeImage(tinygltf::Model* gltf, int image, const unsigned char* bytes, size_t size)
+{
+	// Always decode to 4 channels as only RGBA images are supported.
+	tinygltf::LoadImageDataOption option;
+	option.preserve_channels = false;
+	std::string error, warning;
+	bool result = tinygltf::LoadImageData(&gltf->images[image], image, &error, &warning, 0, 0, bytes, size, &option);
+	if (!error.empty()) {
+		SPDLOG_ERROR(error);
+	}
+	if (!warning.empty()) {
+		SPDLOG_WARN(warning);
+	}
+	return result;
+}
+
+void ConvertMaterials(tinygltf::Model* gltf, std::vector<Material>* materials, std::vector<ImageUsage>* images)
+{
+	ProfileZoneScoped();
+	materials->resize(gltf->materials.size() + 1);
+	for (int i = 0; i < gltf->materials.size(); i++) {
+		tinygltf::Material* tiny_gltf_material = &gltf->materials[i];
+
+		// Material indexes are incremented so that we can put a default material at 0.
+		Material& material = (*materials)[i+1];
+
+		// Normal map.
+		tinygltf::NormalTextureInfo* normal_texture_info = &tiny_gltf_material->normalTexture;
+		material.normal = GetTexture(gltf, images, normal_texture_info, &material.normal_map_scale);
+
+		// Albedo.
+		tinygltf::TextureInfo* albedo_texture_info = &tiny_gltf_material->pbrMetallicRoughness.baseColorTexture;
+		material.albedo = GetTexture(gltf, images, albedo_texture_info, true, TEXTURE_CHANNEL_RGB);
+		material.base_color_factor = glm::vec4(
+			tiny_gltf_material->pbrMetallicRoughness.baseColorFactor[0],
+			tiny_gltf_material->pbrMetallicRoughness.baseColorFactor[1],
+			tiny_gltf_material->pbrMetallicRoughness.baseColorFactor[2],
+			tiny_gltf_material->pbrMetallicRoughness.baseColorFactor[3]
+		);
+
+		// Metalness and roughness.
+		tinygltf::TextureInfo* metallic_roughness_texture_info = &tiny_gltf_material->pbrMetallicRoughness.metallicRoughnessTexture;
+		material.metallic_roughness = GetTexture(gltf, images, metallic_roughness_texture_info, false, TEXTURE_CHANNEL_G | TEXTURE_CHANNEL_B);
+		material.metalness_factor = tiny_gltf_material->pbrMetallicRoughness.metallicFactor;
+		material.roughness_factor = tiny_gltf_material->pbrMetallicRoughness.roughnessFactor;
+
+		// Occlusion.
+		tinygltf::OcclusionTextureInfo* occlusion_texture_info = &tiny_gltf_material->occlusionTexture;
+		material.occlusion = GetTexture(gltf, images, occlusion_texture_info);
+
+		// Emissive.
+		tinygltf::TextureInfo* emissive_texture_info = &tiny_gltf_material->emissiveTexture;
+		material.emissive = GetTexture(gltf, images, emissive_texture_info, true, TEXTURE_CHANNEL_RGB);
+		material.emissive_factor = glm::vec3(tiny_gltf_material->emissiveFactor[0], tiny_gltf_material->emissiveFactor[1], tiny_gltf_material->emissiveFactor[2]);
+
+		// Alpha.
+		if (tiny_gltf_material->alphaMode == "OPAQUE") {
+			material.alpha_mode = Material::ALPHA_MODE_OPAQUE;
+		} else if (tiny_gltf_material->alphaMode == "MASK") {
+			material.alpha_mode = Material::ALPHA_MODE_MASK;
+		} else if (tiny_gltf_material->alphaMode == "BLEND") {
+			material.alpha_mode = Material::ALPHA_MODE_BLEND;
+		}
+		material.alpha_cutoff = tiny_gltf_material->alphaCutoff;
+		if (material.alpha_mode != Material::ALPHA_MODE_OPAQUE && material.albedo.texture != -1) {
+			(*images)[material.albedo.texture].channels |= TEXTURE_CHANNEL_A;
+		}
+
+		// The alpha test is done after multiplying by the base color factor, so the cutoff for the texture alone is larger.
+		if (material.alpha_mode == Material::ALPHA_MODE_MASK && material.albedo.texture != -1 && material.base_color_factor.a > 0.0f) {
+			float& alpha_cutoff = (*images)[material.albedo.texture].alpha_cutoff;
+			if (alpha_cutoff < 0.0f) {
+				alpha_cutoff = material.alpha_cutoff / material.base_color_factor.a;
+			}
+		}
+
+		// Double sided.
+		if (tiny_gltf_material->doubleSided) {
+			material.flags |= Material::FLAG_DOUBLE_SIDED;
+		}
+		
+		// Anisotropy.
+		{
+			auto it = tiny_gltf_material->extensions.find("KHR_materials_anisotropy");
+			if (it != tiny_gltf_material->extensions.end()) {
+				tinygltf::tools::GetValue(it->second, "anisotropyStrength", &material.anisotropy_strength);
+				tinygltf::tools::GetValue(it->second, "anisotropyRotation", &material.anisotropy_rotation);
+				material.anisotropy_texture = GetTexture(gltf, images, &it->second.Get("anisotropyTexture"), nullptr, false, TEXTURE_CHANNEL_RGB);
+			}
+		}
+
+		// Clearcoat.
+		{
+			auto it = tiny_gltf_material->extensions.find("KHR_materials_clearcoat");
+			if (it != tiny_gltf_material->extensions.end()) {
+				tinygltf::tools::GetValue(it->second, "clearcoatFactor", &material.clearcoat_factor);
+				tinygltf::tools::GetValue(it->second, "clearcoatRoughnessFactor", &material.clearcoat_roughness_factor);
+				material.clearcoat_texture = GetTexture(gltf, images, &it->second.Get("clearcoatTexture"), nullptr, false, TEXTURE_CHANNEL_R);
+				material.clearcoat_roughness_texture = GetTexture(gltf, images, &it->second.Get("clearcoatRoughnessTexture"), nullptr, false, TEXTURE_CHANNEL_G);
+				material.clearcoat_normal_texture = GetTexture(gltf, images, &it->second.Get("clearcoatNormalTexture"), &material.clearcoat_normal_scale, false, TEXTURE_CHANNEL_R | TEXTURE_CHANNEL_G);
+			}
+		}
+
+		// Dispersion.
+		{
+			auto it = tiny_gltf_material->extensions.find("KHR_dispersion");
+			if (it != tiny_gltf_material->extensions.end()) {
+				tinygltf::tools::GetValue(it->second, "dispersion", &material.dispersion);
+			}
+		}
+
+		// Emissive strength.
+		{
+			auto it = tiny_gltf_material->extensions.find("KHR_materials_emissive_strength");
+			if (it != tiny_gltf_material->extensions.end()) {
+				tinygltf::tools::GetValue(it->second, "emissiveStrength", &material.emissive_strength);
+			}
+		}
+		
+		// Index of refraction.
+		{
+			auto it = tiny_gltf_material->extensions.find("KHR_materials_ior");
+			if (it != tiny_gltf_material->extensions.end()) {
+				tinygltf::tools::GetValue(it->second, "ior", &material.ior);
+			}
+		}
+
+		// Iridescence.
+		{
+			auto it = tiny_gltf_material->extensions.find("KHR_materials_iridescence");
+			if (it != tiny_gltf_material->extensions.end()) {
+				tinygltf::tools::GetValue(it->second, "iridescenceFactor", &material.iridescence_factor);
+				tinygltf::tools::GetValue(it->second, "iridescenceIor", &material.iridescence_ior);
+				tinygltf::tools::GetValue(it->second, "iridescenceThicknessMinimum", &material.iridescence_thickness_minimum);
+				tinygltf::tools::GetValue(it->second, "iridescenceThicknessMaximum", &material.iridescence_thickness_maximum);
+				material.iridescence_texture = GetTexture(gltf, images, &it->second.Get("iridescenceTexture"), nullptr, false, TEXTURE_CHANNEL_R);
+				material.iridescence_thickness_texture = GetTexture(gltf, images, &it->second.Get("iridescenceThicknessTexture"), nullptr, false, TEXTURE_CHANNEL_G);
+			}
+		}
+
+		// Sheen.
+		{
+			auto it = tiny_gltf_material->extensions.find("KHR_materials_sheen");
+			if (it != tiny_gltf_material->extensions.end()) {
+				tinygltf::tools::GetValue(it->second, "sheenColorFactor", &material.sheen_color_factor);
+				tinygltf::tools::GetValue(it->second, "sheenRoughnessFactor", &material.sheen_roughness_factor);
+				material.sheen_color_texture = GetTexture(gltf, images, &it->second.Get("sheenColorTexture"), nullptr, true, TEXTURE_CHANNEL_RGB);
+				material.sheen_roughness_texture = GetTexture(gltf, images, &it->second.Get("sheenRoughnessTexture"), nullptr, false, TEXTURE_CHANNEL_A);
+			}
+		}
+
+		// Specular.
+		{
+			auto it = tiny_gltf_material->extensions.find("KHR_materials_specular");
+			if (it != tiny_gltf_material->extensions.end()) {
+				tinygltf::tools::GetValue(it->second, "specularFactor", &material.specular_factor);
+				tinygltf::tools::GetValue(it->second, "specularColorFactor", &material.specular_color_factor);
+				material.specular_texture = GetTexture(gltf, images, &it->second.Get("specularTexture"), nullptr, false, TEXTURE_CHANNEL_A);
+				material.specular_color_texture = GetTexture(gltf, images, &it->second.Get("specularColorTexture"), nullptr, true, TEXTURE_CHANNEL_RGB);
+			}
+		}
+
+		// Transmission.
+		{
+			auto it = tiny_gltf_material->extensions.find("KHR_materials_transmission");
+			if (it != tiny_gltf_material->extensions.end()) {
+				tinygltf::tools::GetValue(it->second, "transmissionFactor", &material.transmission_factor);
+				material.transmission_texture = GetTexture(gltf, images, &it->second.Get("transmissionTexture"), nullptr, false, TEXTURE_CHANNEL_R);
+			}
+		}
+
+		// Volume.
+		{
+			auto it = tiny_gltf_material->extensions.find("KHR_materials_volume");
+			if (it != tiny_gltf_material->extensions.end()) {
+				tinygltf::tools::GetValue(it->second, "thicknessFactor", &material.thickness_factor);
+				material.thickness_texture = GetTexture(gltf, images, &it->second.Get("thicknessTexture"), nullptr, false, TEXTURE_CHANNEL_G);
+				tinygltf::tools::GetValue(it->second, "attenuationDistance", &material.attenuation_distance);
+				tinygltf::tools::GetValue(it->second, "attenuationColor", &material.attenuation_color);
+			}
+		}
+
+		// Unlit.
+		{
+			auto it = tiny_gltf_material->extensions.find("KHR_materials_unlit");
+			if (it != tiny_gltf_material->extensions.end()) {
+				material.flags |= Material::Flags::FLAG_UNLIT;
+			}
+		}
+	}
+}
+
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <directx/d3d12.h>
+#include <glm/glm.hpp>
+#include <tinygltf/tiny_gltf.h>
+
+#include "MeshOptimization.h"
+#include "MeshSimplification.h"
+#include "Meshlet.h"
+#include "VertexQuantization.h"
+
+class ThreadPool;
+
+// CPU side loading of glTF files: parsing, image decoding, and conversion of materials and primitives into the formats used by the renderer.
+// None of these functions touch the GPU. Apart from ParseGltf and DecodeImage they don't modify the model, so they are safe to call from multiple threads.
+namespace GltfImport {
+
+    constexpr int MAX_TEXCOORDS = 2;
+
+    // Matches the layout of Mesh::JointWeight.
+    struct JointWeight {
+        glm::u16vec4 joints;
+        glm::u16vec4 weights;
+    };
+
+    // Streams that are not present in the source primitive are left empty.
+    struct MorphTargetData {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec3> tangents;
+    };
+
+    // All morph targets of a primitive, with only the deltas that move a vertex.
+    // The deltas of vertex i are [delta_offsets[i], delta_offsets[i + 1]), and each belongs to the target in targets.
+    // Everything is empty if no target moves a vertex, and streams that no target has are empty.
+    struct MorphData {
+        uint32_t num_of_targets = 0;
+        std::vector<uint32_t> delta_offsets;
+        std::vector<uint32_t> targets;
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec3> tangents;
+    };
+
+    struct PrimitiveData {
+        bool valid = false;
+        D3D12_PRIMITIVE_TOPOLOGY topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+        DXGI_FORMAT index_format = DXGI_FORMAT_UNKNOWN;
+        uint32_t num_of_vertices = 0;
+        uint32_t num_of_indices = 0;
+        int material_id = 0;
+        std::vector<std::byte> indices;
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> tangent_space;
+        std::vector<glm::vec2> texcoords[MAX_TEXCOORDS];
+        std::vector<glm::u16vec4> colors;
+        std::vector<JointWeight> joint_weights;
+        std::vector<MorphTargetData> targets; // Cleared by BuildPrimitiveMorphData.
+        MorphData morph; // Set by BuildPrimitiveMorphData.
+        MeshletData meshlets; // Set by BuildPrimitiveMeshlets.
+        // Set by BuildPrimitiveLods. The indices of every level one after the other, in the index format of the primitive.
+        std::vector<std::byte> lod_indices;
+        MeshLodData lods;
+        // Set by QuantizePrimitive, which clears the streams they replace.
+        // ConvertPrimitive also sets positions and texture coordinates that are integers in the source, from KHR_mesh_quantization.
+        std::vector<glm::i16vec4> quantized_positions;
+        std::vector<glm::u16vec2> quantized_texcoords[MAX_TEXCOORDS];
+        std::vector<glm::u8vec4> quantized_colors;
+        VertexDequantization dequantization;
+        QuantizationStats quantization_stats;
+        // Set by OptimizePrimitive.
+        VertexCacheStats cache_stats_before;
+        VertexCacheStats cache_stats_after;
+    };
+
+    struct Material {
+
+        enum Flags {
+            FLAG_NONE = 0,
+            FLAG_DOUBLE_SIDED = 1 << 0,
+            FLAG_UNLIT = 1 << 1,
+        };
+
+        enum AlphaMode {
+            ALPHA_MODE_OPAQUE,
+            ALPHA_MODE_MASK,
+            ALPHA_MODE_BLEND,
+        };
+
+        struct Texture {
+            int texture = -1;
+            int sampler = 0;
+            int tex_coord = 0;
+            glm::vec2 offset = glm::vec2(0.0);
+            glm::vec2 scale = glm::vec2(1.0);
+            float rotation = 0.0;
+        };
+
+        uint32_t flags = FLAG_NONE;
+
+        glm::vec4 base_color_factor = glm::vec4(1.0);
+        float metalness_factor = 1.0;
+        float roughness_factor = 1.0;
+        float occlusion_factor = 1.0;
+        glm::vec3 emissive_factor = glm::vec3(0.0);
+        float normal_map_scale = 1.0;
+        Texture albedo;
+        Texture normal;
+        Texture metallic_roughness;
+        Texture occlusion;
+        Texture emissive;
+        AlphaMode alpha_mode = ALPHA_MODE_OPAQUE;
+        float alpha_cutoff = 0.5;
+
+        // Anisotropy.
+        float anisotropy_strength = 0.0;
+        float anisotropy_rotation = 0.0;
+        Texture anisotropy_texture;
+
+        // Clearcoat.
+        float clearcoat_factor = 0.0;
+        Texture clearcoat_texture;
+        float clearcoat_roughness_factor = 0.0;
+        Texture clearcoat_roughness_texture;
+        float clearcoat_normal_scale = 1.0;
+        Texture clearcoat_normal_texture;
+
+        // Dispersion.
+        float dispersion = 0.0;
+
+        // Emissive strength.
+        float emissive_strength = 1.0;
+        
+        // Index of refraction.
+        float ior = 1.5;
+
+        // Iridescence.
+        float iridescence_factor = 0.0;
+        Texture iridescence_texture;
+        float iridescence_ior = 1.3;
+        float iridescence_thickness_minimum = 100.0;
+        float iridescence_thickness_maximum = 400.0;
+        Texture iridescence_thickness_texture;
+
+        // Sheen.
+        glm::vec3 sheen_color_factor = glm::vec3(0.0);
+        Texture sheen_color_texture;
+        float sheen_roughness_factor = 0.0;
+        Texture sheen_roughness_texture;
+
+        // Specular.
+        float specular_factor = 1.0;
+        Texture specular_texture;
+        glm::vec3 specular_color_factor = glm::vec3(1.0);
+        Texture specular_color_texture;
+
+        // Transmission.
+        float transmission_factor = 0.0;
+        Texture transmission_texture;
+
+        // Volume.
+        float thickness_factor = 0;
+        float attenuation_distance = 0;
+        glm::vec3 attenuation_color = glm::vec3(1.0);
+        Texture thickness_texture;
+    };
+
+    // How the materials use an image, which decides how it is encoded.
+    struct ImageUsage {
+        int duplicate_of = -1; // An earlier image with identical data, which materials use instead.
+        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN; // Set by the first material that uses the image.
+        uint32_t channels = 0; // TextureChannel flags for every channel any material reads.
+        float alpha_cutoff = -1.0f; // Positive if an alpha tested material uses the image.
+    };
+
+    // A memory mapped .glb file. Accessors read the BIN chunk straight from the mapping instead of from a copy in tinygltf::Buffer::data.
+    struct MappedGlb {
+        void* data = nullptr;
+        uint64_t size = 0;
+        ~MappedGlb();
+    };
+
+    // Parses a .gltf or .glb file, memory mapping .glb files if memory_map is set. Images are left encoded, see GetEncodedImage.
+    // Buffer views compressed with EXT_meshopt_compression are decoded in parallel on the thread pool.
+    bool ParseGltf(const char* filepath, bool memory_map, tinygltf::Model* model, MappedGlb* mapped_glb, std::vector<std::vector<unsigned char>>* encoded_images, ThreadPool* thread_pool);
+    // Encoded data of an image after ParseGltf, or null if it has none.
+    const unsigned char* GetEncodedImage(const tinygltf::Model* gltf, const std::vector<std::vector<unsigned char>>* encoded_images, int image, size_t* size);
+    // Decodes an image into 8 bit RGBA. Different images can be decoded in parallel.
+    bool DecodeImage(tinygltf::Model* gltf, int image, const unsigned char* bytes, size_t size);
+    // Converts every material, with a default material at index 0. Texture and sampler indices are glTF image and sampler indices.
+    // Every image a material uses has its usage updated.
+    void ConvertMaterials(tinygltf::Model* gltf, std::vector<Material>* materials, std::vector<ImageUsage>* images);
+    int GetAttribute(const std::map<std::string, int>* attributes, const char* name);
+    // Rough number of bytes of staging memory needed to convert a primitive, used to limit how much is converted at once.
+    uint64_t EstimatePrimitiveSize(tinygltf::Model* gltf, const tinygltf::Primitive* gltf_primitive);
+    // Hash of everything that affects the converted data except the material, so primitives with equal hashes can share a mesh.
+    uint64_t HashPrimitive(tinygltf::Model* gltf, const tinygltf::Primitive* gltf_primitive);
+    // Compares everything HashPrimitive hashes, to confirm that primitives with equal hashes really are identical.
+    bool ComparePrimitives(tinygltf::Model* gltf, const tinygltf::Primitive* a, const tinygltf::Primitive* b);
+    // Converts everything except morph targets. Integer positions and texture coordinates are kept quantized instead of being expanded to floats.
+    bool ConvertPrimitive(tinygltf::Model* gltf, const tinygltf::Primitive* gltf_primitive, PrimitiveData* data);
+    void ConvertMorphTarget(tinygltf::Model* gltf, const std::map<std::string, int>* target, uint32_t num_of_vertices, MorphTargetData* data);
+    // Reorders the triangles of an indexed triangle list for the vertex cache, then its vertices for vertex fetch.
+    // Every stream is remapped, so this must be called after the morph targets have been converted.
+    void OptimizePrimitive(PrimitiveData* data, bool reduce_overdraw);
+    // Splits a triangle list into meshlets. Call after OptimizePrimitive, as meshlets reference vertices and follow the triangle order.
+    void BuildPrimitiveMeshlets(PrimitiveData* data);
+    // Simplifies an indexed triangle list into up to MESH_MAX_LODS levels of detail that reuse its vertices.
+    // Texture coordinate 0 and skin weights are kept where possible, and vertices only collapse onto vertices with the same joints.
+    void BuildPrimitiveLods(PrimitiveData* data);
+    // Compacts the morph targets into MorphData, keeping only non zero deltas. Call after OptimizePrimitive, which remaps the dense targets.
+    void BuildPrimitiveMorphData(PrimitiveData* data);
+    // Quantizes texture coordinates and colors, and positions if quantize_positions is set.
+    // Call last, as every other step works on the original streams.
+    void QuantizePrimitive(PrimitiveData* data, bool quantize_positions);
+};
@@ -0,0 +1,374 @@
+#include "GltfLoader.h"
+
+#include <cassert>
+#include <filesystem>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+#include "Config.h"
+#include "Memory.h"
+#include "TextureCompression.h"
+#include "Profiling.h"
+
+template<typename T>
+static uint64_t GetVectorSize(const std::vector<T>& vector)
+{
+	return vector.size() * sizeof(T);
+}
+
+// Number of bytes that will be uploaded for a converted primitive.
+static uint64_t GetPrimitiveDataSize(const GltfImport::PrimitiveData* data)
+{
+	uint64_t size = GetVectorSize(data->indices) + GetVectorSize(data->lod_indices) + GetVectorSize(data->positions) + GetVectorSize(data->tangent_space);
+	size += GetVectorSize(data->texcoords[0]) + GetVectorSize(data->texcoords[1]);
+	size += GetVectorSize(data->colors) + GetVectorSize(data->joint_weights);
+	size += GetVectorSize(data->quantized_positions) + GetVectorSize(data->quantized_texcoords[0]) + GetVectorSize(data->quantized_texcoords[1]) + GetVectorSize(data->quantized_colors);
+	size += GetVectorSize(data->morph.delta_offsets) + GetVectorSize(data->morph.targets);
+	size += GetVectorSize(data->morph.positions) + GetVectorSize(data->morph.normals) + GetVectorSize(data->morph.tangents);
+	return size;
+}
+
+void GltfLoader::Begin(const char* filepath, Gltf* scene, ThreadPool* thread_pool)
+{
+	ProfileZoneScoped();
+	assert(!IsLoading());
+	this->scene = scene;
+	this->filepath = filepath;
+	this->timer.Create();
+
+	// The staging scene is only used for CPU side loading, so it has no descriptors.
+	this->source = std::make_unique<Source>();
+	this->source->staging.srv_uav_cbv_descriptors = nullptr;
+	this->source->staging.sampler_descriptors = nullptr;
+	this->source->staging.thread_pool = thread_pool;
+
+	this->queue.clear();
+	this->queued_size = 0;
+	this->parsed = false;
+	this->failed = false;
+	this->converted = false;
+	this->cancel = false;
+	this->pending.clear();
+	this->total_resources = 0;
+	this->completed_resources = 0;
+
+	this->state = STATE_PARSING;
+	this->thread = std::thread(&GltfLoader::Load, this);
+}
+
+void GltfLoader::Load()
+{
+	ProfileSetThreadName("glTF Loader");
+	ProfileZoneScoped();
+	Gltf* staging = &this->source->staging;
+	tinygltf::Model* model = &this->source->model;
+
+	// Load everything except mesh and image data, so the scene can be published straight away.
+	std::vector<std::vector<unsigned char>> encoded_images;
+	bool result = GltfImport::ParseGltf(this->filepath.c_str(), !Config::disable_memory_mapping, model, &this->source->mapped_glb, &encoded_images, staging->thread_pool);
+	if (result) {
+		staging->LoadMeshLayout(model);
+		staging->ReserveTextures(model, &encoded_images);
+		staging->LoadMaterials(model);
+		staging->LoadScenes(model);
+		staging->LoadNodes(model);
+		staging->LoadSkins(model);
+		staging->LoadAnimations(model);
+		staging->LoadLights(model);
+		for (int i = 0; i < staging->textures.size(); i++) {
+			if (staging->textures[i].format != DXGI_FORMAT_UNKNOWN) {
+				this->source->used_images.push_back(i);
+			}
+		}
+		this->source->textures = staging->textures;
+	}
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->parsed = true;
+		this->failed = !result;
+	}
+	if (!result || this->cancel) {
+		return;
+	}
+
+	// From here on only the thread pool of the staging scene is used, as the rest has been handed over to the main thread.
+	staging->ConvertMeshes(model, [&](int mesh, int primitive, GltfImport::PrimitiveData* data) {
+		Item item;
+		item.mesh = mesh;
+		item.primitive = primitive;
+		item.size = GetPrimitiveDataSize(data);
+		item.primitive_data = std::move(*data);
+		return Push(std::move(item));
+	}, [&](int mesh, int primitive, int source_mesh, int source_primitive) {
+		Item item;
+		item.mesh = mesh;
+		item.primitive = primitive;
+		item.source_mesh = source_mesh;
+		item.source_primitive = source_primitive;
+		return Push(std::move(item));
+	});
+
+	// Images that fail to decode are left empty, and their textures stay unbound.
+	// Decoding and compression check for cancellation between images, so cancelling doesn't wait for every texture.
+	if (!this->cancel) {
+		staging->DecodeImages(model, &encoded_images, &this->cancel);
+	}
+	if (!this->cancel) {
+		staging->PrepareTextures(model, &this->cancel);
+	}
+	if (!this->cancel) {
+		for (int image: this->source->used_images) {
+			Item item;
+			item.texture = image;
+			item.image = std::move(model->images[image].image);
+			item.format = staging->textures[image].format;
+			item.component_mapping = staging->textures[image].component_mapping;
+			item.size = item.image.size();
+			if (!Push(std::move(item))) {
+				break;
+			}
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->converted = true;
+	}
+}
+
+bool GltfLoader::Push(Item item)
+{
+	ProfileZoneScoped();
+	// Wait until there is room in the queue. An empty queue always accepts an item, so large items can't block forever.
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->queue_changed.wait(lock, [&]() {
+		return this->cancel || this->queue.empty() || this->queued_size + item.size <= Config::MESH_STAGING_CAPACITY;
+	});
+	if (this->cancel) {
+		return false;
+	}
+	this->queued_size += item.size;
+	this->queue.push_back(std::move(item));
+	return true;
+}
+
+void GltfLoader::Publish()
+{
+	ProfileZoneScoped();
+	Gltf* staging = &this->source->staging;
+	this->scene->filename = std::filesystem::path(this->filepath).filename().string();
+	this->scene->meshes = std::move(staging->meshes);
+	this->scene->scenes = std::move(staging->scenes);
+	this->scene->nodes = std::move(staging->nodes);
+	this->scene->transforms = std::move(staging->transforms);
+	this->scene->skinned_nodes = std::move(staging->skinned_nodes);
+	this->scene->skins = std::move(staging->skins);
+	this->scene->animations = std::move(staging->animations);
+	this->scene->lights = std::move(staging->lights);
+	this->scene->textures = std::move(this->source->textures);
+	this->materials = staging->materials;
+	this->scene->materials = std::move(staging->materials);
+
+	// Nothing is resident yet, so every material starts with only its factors.
+	this->scene->LoadSamplers(&this->source->model);
+	this->scene->ResolveMaterialTextures();
+
+	this->total_resources = this->source->used_images.size();
+	for (const Gltf::Mesh& mesh: this->scene->meshes) {
+		this->total_resources += mesh.primitives.size();
+	}
+	this->state = STATE_STREAMING;
+	SPDLOG_INFO("Parsed {} in {:.3f}s.", this->scene->filename, this->timer.Delta());
+}
+
+void GltfLoader::Upload(Item* item, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer, PendingUpload* pending_upload)
+{
+	ProfileZoneScoped();
+	if (item->texture != -1) {
+		const tinygltf::Image& image = this->source->model.images[item->texture];
+		if (item->image.empty() || item->image.size() != GetTextureSize(item->format, image.width, image.height)) {
+			this->completed_resources++;
+			return;
+		}
+		this->scene->textures[item->texture].format = item->format;
+		this->scene->textures[item->texture].component_mapping = item->component_mapping;
+		this->scene->CreateTexture(item->texture, image.name.c_str(), image.width, image.height, (const std::byte*)item->image.data(), gpu_allocator, upload_buffer);
+		pending_upload->resources.push_back({-1, -1, item->texture});
+	} else if (item->source_mesh != -1) {
+		// The source was queued first, so it has been uploaded in this or an earlier submission unless it failed to convert.
+		const Gltf::Primitive& source = this->scene->meshes[item->source_mesh].primitives[item->source_primitive];
+		if (!source.mesh.resource.resource) {
+			this->completed_resources++;
+			return;
+		}
+		this->scene->SharePrimitive(source, &this->scene->meshes[item->mesh].primitives[item->primitive]);
+		pending_upload->resources.push_back({item->mesh, item->primitive, -1});
+	} else {
+		// Primitives that failed to convert are never drawn.
+		if (!item->primitive_data.valid) {
+			this->completed_resources++;
+			return;
+		}
+		Gltf::Primitive* primitive = &this->scene->meshes[item->mesh].primitives[item->primitive];
+		this->scene->UploadPrimitive(&item->primitive_data, gpu_allocator, upload_buffer, primitive);
+		pending_upload->resources.push_back({item->mesh, item->primitive, -1});
+	}
+}
+
+bool GltfLoader::Retire(UploadBuffer* upload_buffer)
+{
+	ProfileZoneScoped();
+	bool changed = false;
+	bool textures_changed = false;
+	while (!this->pending.empty() && upload_buffer->IsSubmissionComplete(this->pending.front().submission)) {
+		for (const PendingUpload::Resource& resource: this->pending.front().resources) {
+			if (resource.texture != -1) {
+				this->scene->textures[resource.texture].resident = true;
+				textures_changed = true;
+			} else {
+				this->scene->meshes[resource.mesh].primitives[resource.primitive].resident = true;
+			}
+			this->completed_resources++;
+		}
+		this->pending.pop_front();
+		changed = true;
+	}
+
+	// Resolve the materials again so they pick up the new textures.
+	if (textures_changed) {
+		this->scene->materials = this->materials;
+		this->scene->ResolveMaterialTextures();
+	}
+	return changed;
+}
+
+bool GltfLoader::Update(GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer)
+{
+	ProfileZoneScoped();
+	bool changed = false;
+	if (this->state == STATE_PARSING) {
+		bool parsed = false;
+		bool failed = false;
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			parsed = this->parsed;
+			failed = this->failed;
+		}
+		if (!parsed) {
+			return false;
+		}
+		if (failed) {
+			this->thread.join();
+			this->source.reset();
+			this->state = STATE_FAILED;
+			SPDLOG_ERROR("Failed to load {}.", this->filepath);
+			return false;
+		}
+		Publish();
+		changed = true;
+	}
+	if (this->state != STATE_STREAMING) {
+		return changed;
+	}
+
+	changed |= Retire(upload_buffer);
+
+	// Take as much as fits in this frame's budget, but always at least one item.
+	// Uploading is skipped while every command allocator is still in use, as beginning another upload would wait for the GPU.
+	std::vector<Item> items;
+	if (this->pending.size() < Config::FRAME_COUNT) {
+		uint64_t upload_size = 0;
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			while (!this->queue.empty() && (items.empty() || upload_size + this->queue.front().size <= Config::STREAMING_UPLOAD_BUDGET)) {
+				upload_size += this->queue.front().size;
+				this->queued_size -= this->queue.front().size;
+				items.push_back(std::move(this->queue.front()));
+				this->queue.pop_front();
+			}
+		}
+		this->queue_changed.notify_all();
+	}
+	if (!items.empty()) {
+		PendingUpload pending_upload;
+		upload_buffer->Begin();
+		for (Item& item: items) {
+			Upload(&item, gpu_allocator, upload_buffer, &pending_upload);
+		}
+		pending_upload.submission = upload_buffer->Submit();
+		this->pending.push_back(std::move(pending_upload));
+	}
+
+	// Once everything has been uploaded, the dynamic meshes for skinning and morphing can be created.
+	bool converted = false;
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		converted = this->converted && this->queue.empty();
+	}
+	if (converted && this->pending.empty()) {
+		this->thread.join();
+		this->source.reset();
+		this->scene->CreateDynamicMesh(gpu_allocator);
+		this->scene->LogMemoryUsage();
+		this->state = STATE_COMPLETE;
+		SPDLOG_INFO("Streamed {} in {:.3f}s, peak memory usage {} MiB.", this->scene->filename, this->timer.Delta(), GetPeakMemoryUsage() >> 20);
+		changed = true;
+	}
+	return changed;
+}
+
+void GltfLoader::Cancel(UploadBuffer* upload_buffer)
+{
+	ProfileZoneScoped();
+	if (!IsLoading()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->cancel = true;
+	}
+	this->queue_changed.notify_all();
+	this->thread.join();
+
+	// Anything that has already been submitted is kept.
+	upload_buffer->WaitForAllSubmissionsToComplete();
+	Retire(upload_buffer);
+	this->queue.clear();
+	this->queued_size = 0;
+	this->source.reset();
+	this->state = STATE_CANCELLED;
+	SPDLOG_INFO("Cancelled loading {}.", this->filepath);
+}
+
+bool GltfLoader::IsLoading() const
+{
+	return this->state == STATE_PARSING || this->state == STATE_STREAMING;
+}
+
+GltfLoader::State GltfLoader::GetState() const
+{
+	return this->state;
+}
+
+const char* GltfLoader::GetStateName() const
+{
+	switch (this->state) {
+		case STATE_IDLE: return "Idle";
+		case STATE_PARSING: return "Parsing";
+		case STATE_STREAMING: return "Streaming";
+		case STATE_COMPLETE: return "Complete";
+		case STATE_CANCELLED: return "Cancelled";
+		case STATE_FAILED: return "Failed";
+	}
+	return "";
+}
+
+float GltfLoader::GetProgress() const
+{
+	switch (this->state) {
+		case STATE_STREAMING: return this->total_resources > 0 ? (float)this->completed_resources / this->total_resources : 1.0f;
+		case STATE_COMPLETE: return 1.0f;
+		default: return 0.0f;
+	}
+}
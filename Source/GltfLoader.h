@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <tinygltf/tiny_gltf.h>
+
+#include "BufferAllocator.h"
+#include "Gltf.h"
+#include "GltfImport.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+#include "UploadBuffer.h"
+
+// Loads a glTF file without stalling the frame loop.
+// Parsing, mesh conversion and image decoding happen on a background thread. The scene is published as soon as it has been parsed,
+// then each call to Update uploads a few converted meshes and textures, which become resident once their upload has completed.
+class GltfLoader {
+
+    public:
+
+    enum State {
+        STATE_IDLE,
+        STATE_PARSING,
+        STATE_STREAMING,
+        STATE_COMPLETE,
+        STATE_CANCELLED,
+        STATE_FAILED,
+    };
+
+    // The scene must be empty.
+    void Begin(const char* filepath, Gltf* scene, ThreadPool* thread_pool);
+    // Call once per frame. Returns true if anything new became visible.
+    bool Update(GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer);
+    // Stops loading, keeping anything that has already been uploaded.
+    // Skinning and morphing need the whole scene, so they stay disabled for a cancelled scene.
+    void Cancel(UploadBuffer* upload_buffer);
+    bool IsLoading() const;
+    State GetState() const;
+    const char* GetStateName() const;
+    float GetProgress() const;
+
+    private:
+
+    // Owned by the background thread until the scene has been published.
+    struct Source {
+        Gltf staging;
+        std::vector<Gltf::Texture> textures; // Textures as they were when parsing finished, as the staging textures change once they are compressed.
+        GltfImport::MappedGlb mapped_glb;
+        tinygltf::Model model;
+        std::vector<int> used_images;
+    };
+
+    // A converted primitive or decoded image waiting to be uploaded.
+    struct Item {
+        int mesh = -1;
+        int primitive = -1;
+        int texture = -1;
+        // Set for primitives that share the mesh of an earlier one instead of having primitive data.
+        int source_mesh = -1;
+        int source_primitive = -1;
+        GltfImport::PrimitiveData primitive_data;
+        std::vector<unsigned char> image;
+        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+        uint32_t component_mapping = 0;
+        uint64_t size = 0;
+    };
+
+    struct PendingUpload {
+        struct Resource {
+            int mesh;
+            int primitive;
+            int texture;
+        };
+        uint64_t submission = 0;
+        std::vector<Resource> resources;
+    };
+
+    State state = STATE_IDLE;
+    Gltf* scene = nullptr;
+    std::string filepath;
+    Timer timer;
+    std::thread thread;
+    std::unique_ptr<Source> source;
+    std::vector<Gltf::Material> materials; // Materials before their textures are resolved.
+
+    // Shared with the background thread.
+    std::mutex mutex;
+    std::condition_variable queue_changed;
+    std::deque<Item> queue;
+    uint64_t queued_size = 0;
+    bool parsed = false;
+    bool failed = false;
+    bool converted = false;
+    std::atomic<bool> cancel = false;
+
+    // Uploads that haven't completed yet, oldest first.
+    std::deque<PendingUpload> pending;
+    int total_resources = 0;
+    int completed_resources = 0;
+
+    void Load();
+    bool Push(Item item);
+    void Publish();
+    void Upload(Item* item, GpuAllocator* gpu_allocator, UploadBuffer* upload_buffer, PendingUpload* pending_upload);
+    bool Retire(UploadBuffer* upload_buffer);
+};
@@ -1,13 +1,11 @@
 #include "GpuSkin.h"
 
-#include <algorithm>
 #include <cassert>
 
 #include <directx/d3d12.h>
 #include <directx/d3dx12_barriers.h>
 #include <directx/d3dx12_root_signature.h>
 
-#include "Config.h"
 #include "GpuResources.h"
 
 void GpuSkin::Create(ID3D12Device* device)
@@ -22,6 +20,7 @@ void GpuSkin::Create(ID3D12Device* device)
 	root_parameters[ROOT_PARAMETER_TANGENT_SPACE_INPUT].InitAsShaderResourceView(1);
 	root_parameters[ROOT_PARAMETER_SKIN].InitAsShaderResourceView(3);
     root_parameters[ROOT_PARAMETER_BONES].InitAsShaderResourceView(4);
+    root_parameters[ROOT_PARAMETER_MORPH_WEIGHTS].InitAsShaderResourceView(5);
     root_parameters[ROOT_PARAMETER_VERTEX_OUTPUT].InitAsUnorderedAccessView(0);
     root_parameters[ROOT_PARAMETER_TANGENT_SPACE_OUTPUT].InitAsUnorderedAccessView(1);
 
@@ -54,7 +53,7 @@ void GpuSkin::Bind(CommandContext* context)
     context->command_list->SetComputeRootSignature(this->root_signature.Get());
 }
 
-void GpuSkin::Run(CommandContext* context, Mesh* input, DynamicMesh* output, D3D12_GPU_VIRTUAL_ADDRESS bones, int num_of_morph_targets, MorphTarget** morph_targets, float* morph_weights)
+void GpuSkin::Run(CommandContext* context, Mesh* input, DynamicMesh* output, D3D12_GPU_VIRTUAL_ADDRESS bones, const MorphTargets* morph_targets, D3D12_GPU_VIRTUAL_ADDRESS morph_weights, uint32_t num_of_morph_weights)
 {
 	context->PushTransitionBarrier(
 		output->resource.resource.Get(),
@@ -67,31 +66,39 @@ void GpuSkin::Run(CommandContext* context, Mesh* input, DynamicMesh* output, D3D
 		uint32_t num_of_vertices;
 		uint32_t input_mesh_flags;
 		uint32_t output_mesh_flags;
-		int num_of_morph_targets;
-		struct {
-			float weight;
-			int position_descriptor;
-			int tangent_space_descriptor;
-		} morph_targets[Config::MAX_SIMULTANEOUS_MORPH_TARGETS];
+		uint32_t morph_flags;
+		glm::vec3 position_scale;
+		uint32_t num_of_morph_weights;
+		glm::vec3 position_offset;
+		int morph_delta_offsets_descriptor;
+		int morph_targets_descriptor;
+		int morph_position_descriptor;
+		int morph_normal_descriptor;
+		int morph_tangent_descriptor;
 	} constant_buffer = {};
 
 	constant_buffer = {
 		.num_of_vertices = output->num_of_vertices,
 		.input_mesh_flags = input->flags,
 		.output_mesh_flags = output->flags,
-		.num_of_morph_targets = std::min(num_of_morph_targets, Config::MAX_SIMULTANEOUS_MORPH_TARGETS),
+		.position_scale = input->dequantization.position_scale,
+		.position_offset = input->dequantization.position_offset,
 	};
-	for (int i = 0; i < constant_buffer.num_of_morph_targets; i++) {
-		constant_buffer.morph_targets[i] = {
-			.weight = morph_weights[i],
-			.position_descriptor = morph_targets[i]->position.descriptor,
-			.tangent_space_descriptor = morph_targets[i]->tangent_space.descriptor,
-		};
+
+	// Every target is applied, as each vertex only visits the deltas that move it.
+	if (morph_targets && morph_targets->num_of_deltas > 0 && morph_weights != 0) {
+		constant_buffer.morph_flags = morph_targets->flags;
+		constant_buffer.num_of_morph_weights = num_of_morph_weights;
+		constant_buffer.morph_delta_offsets_descriptor = morph_targets->delta_offsets.descriptor;
+		constant_buffer.morph_targets_descriptor = morph_targets->targets.descriptor;
+		constant_buffer.morph_position_descriptor = morph_targets->position.descriptor;
+		constant_buffer.morph_normal_descriptor = morph_targets->normal.descriptor;
+		constant_buffer.morph_tangent_descriptor = morph_targets->tangent.descriptor;
 	}
 
 	// If no bones are supplied, ignore skinning.
 	if (bones == 0) {
-		constant_buffer.input_mesh_flags &= !Mesh::FLAG_JOINT_WEIGHT;
+		constant_buffer.input_mesh_flags &= ~Mesh::FLAG_JOINT_WEIGHT;
 	}
 
     context->command_list->SetComputeRootConstantBufferView(ROOT_PARAMETER_CONSTANT_BUFFER, context->CreateConstantBuffer(&constant_buffer));
@@ -104,6 +111,7 @@ void GpuSkin::Run(CommandContext* context, Mesh* input, DynamicMesh* output, D3D
 
     context->command_list->SetComputeRootShaderResourceView(ROOT_PARAMETER_SKIN, input->joint_weight.view.BufferLocation);
     context->command_list->SetComputeRootShaderResourceView(ROOT_PARAMETER_BONES, bones);
+    context->command_list->SetComputeRootShaderResourceView(ROOT_PARAMETER_MORPH_WEIGHTS, morph_weights);
 
     context->command_list->Dispatch((constant_buffer.num_of_vertices + THREAD_GROUP_SIZE - 1) / THREAD_GROUP_SIZE, 1, 1);
 
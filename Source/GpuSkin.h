@@ -16,7 +16,8 @@ class GpuSkin {
 
     void Create(ID3D12Device* device);
     void Bind(CommandContext* context);
-    void Run(CommandContext* context, Mesh* input, DynamicMesh* output, D3D12_GPU_VIRTUAL_ADDRESS bones, int num_of_morph_targets, MorphTarget** morph_targets, float* morph_weights);
+    // Morph targets are optional, and morph_weights holds a float for each target of the mesh.
+    void Run(CommandContext* context, Mesh* input, DynamicMesh* output, D3D12_GPU_VIRTUAL_ADDRESS bones, const MorphTargets* morph_targets, D3D12_GPU_VIRTUAL_ADDRESS morph_weights, uint32_t num_of_morph_weights);
 
     private:
 
@@ -26,6 +27,7 @@ class GpuSkin {
 		ROOT_PARAMETER_TANGENT_SPACE_INPUT,
         ROOT_PARAMETER_SKIN,
         ROOT_PARAMETER_BONES,
+        ROOT_PARAMETER_MORPH_WEIGHTS,
 		ROOT_PARAMETER_VERTEX_OUTPUT,
 		ROOT_PARAMETER_TANGENT_SPACE_OUTPUT,
 		ROOT_PARAMETER_COUNT,
@@ -0,0 +1,54 @@
+#include "Hash.h"
+
+#include <cstring>
+
+#include "Profiling.h"
+
+static constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ull;
+static constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+static constexpr uint64_t PRIME_3 = 0x165667B19E3779F9ull;
+
+static uint64_t RotateLeft(uint64_t value, int bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+static uint64_t HashRound(uint64_t accumulator, uint64_t input)
+{
+	accumulator += input * PRIME_2;
+	accumulator = RotateLeft(accumulator, 31);
+	return accumulator * PRIME_1;
+}
+
+uint64_t Hash(const void* data, uint64_t size)
+{
+	ProfileZoneScoped();
+	const std::byte* bytes = (const std::byte*)data;
+	uint64_t lanes[4] = {PRIME_1 + PRIME_2, PRIME_2, 0, 0 - PRIME_1};
+	uint64_t i = 0;
+	for (; i + 32 <= size; i += 32) {
+		for (int j = 0; j < 4; j++) {
+			uint64_t word;
+			std::memcpy(&word, bytes + i + j * 8, sizeof(word));
+			lanes[j] = HashRound(lanes[j], word);
+		}
+	}
+	uint64_t hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+	hash += size;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		std::memcpy(&word, bytes + i, sizeof(word));
+		hash ^= HashRound(0, word);
+		hash = RotateLeft(hash, 27) * PRIME_1 + PRIME_3;
+	}
+	for (; i < size; i++) {
+		hash ^= (uint64_t)bytes[i] * PRIME_3;
+		hash = RotateLeft(hash, 11) * PRIME_1;
+	}
+	hash ^= hash >> 33;
+	hash *= PRIME_2;
+	hash ^= hash >> 29;
+	hash *= PRIME_3;
+	hash ^= hash >> 32;
+	return hash;
+}
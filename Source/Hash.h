@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 64 bit hash with four independent lanes, so hashing large files isn't limited by multiply latency.
+uint64_t Hash(const void* data, uint64_t size);
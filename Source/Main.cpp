@@ -8,10 +8,14 @@
 #include "AnimationPlayer.h"
 #include "Camera.h"
 #include "CameraController.h"
+#include "Config.h"
+#include "CookedScene.h"
 #include "Gltf.h"
+#include "GltfLoader.h"
 #include "imgui.h"
 #include "Profiling.h"
 #include "Renderer.h"
+#include "ThreadPool.h"
 #include "Timer.h"
 
 struct Context {
@@ -29,7 +33,9 @@ OrbitController g_orbit(glm::vec3(), 1., 0., 0.);
 FreeController g_free(glm::vec3(0, -1, 0), 0, 0);
 bool g_camera_free_mode = false;
 Timer g_timer;
+ThreadPool g_thread_pool;
 Gltf g_gltf;
+GltfLoader g_gltf_loader;
 Context g_context;
 
 // Configuration.
@@ -42,19 +48,39 @@ float GetWindowScaling(HWND window)
 
 void LoadGltf(const char* filepath)
 {
+	g_gltf_loader.Cancel(&renderer.upload_buffer);
 	g_context.animation_player = AnimationPlayer();
 	renderer.WaitForOutstandingWork();
 	renderer.upload_buffer.WaitForAllSubmissionsToComplete();
 	g_gltf.Unload();
-	renderer.upload_buffer.Begin();
-	g_gltf.LoadFromGltf(filepath, &renderer.resources.allocator, &renderer.upload_buffer);
 	g_context.scene_id = 0;
-	renderer.upload_buffer.WaitForSubmissionToComplete(renderer.upload_buffer.Submit());
+
+	// Use the cooked scene next to the glTF file if it is up to date and was cooked with the current import options. Cooked scenes are quick to load, so they are loaded immediately.
+	bool loaded = false;
+	bool cooked = std::filesystem::path(filepath).extension() == CookedScene::EXTENSION;
+	std::string cooked_filepath = cooked ? filepath : CookedScene::GetCookedFilepath(filepath);
+	if (cooked || (!Config::ignore_cooked_scenes && CookedScene::IsUpToDate(cooked_filepath.c_str(), filepath))) {
+		renderer.upload_buffer.Begin();
+		loaded = g_gltf.LoadFromCooked(cooked_filepath.c_str(), &renderer.resources.allocator, &renderer.upload_buffer);
+		renderer.upload_buffer.WaitForSubmissionToComplete(renderer.upload_buffer.Submit());
+	}
+
+	// Otherwise stream the glTF file in over the next few frames.
+	if (!loaded && !cooked) {
+		if (Config::synchronous_loading) {
+			renderer.upload_buffer.Begin();
+			g_gltf.LoadFromGltf(filepath, &renderer.resources.allocator, &renderer.upload_buffer);
+			renderer.upload_buffer.WaitForSubmissionToComplete(renderer.upload_buffer.Submit());
+		} else {
+			g_gltf_loader.Begin(filepath, &g_gltf, &g_thread_pool);
+		}
+	}
 	g_render_settings.pathtracer.reset = true;
 }
 
 void Unload()
 {
+	g_gltf_loader.Cancel(&renderer.upload_buffer);
 	g_context.animation_player = AnimationPlayer();
 	renderer.WaitForOutstandingWork();
 	renderer.upload_buffer.WaitForAllSubmissionsToComplete();
@@ -141,8 +167,8 @@ void OpenGltfFileDialog()
 			ScheduleGltfLoad(filelist[0]);
 		}
 	};
-	SDL_DialogFileFilter filter = {"glTF", "gltf;glb"};
-	SDL_ShowOpenFileDialog(callback, nullptr, nullptr, &filter, 1, nullptr, false);
+	SDL_DialogFileFilter filter[] = {{"glTF", "gltf;glb"}, {"Cooked scene", "cooked"}};
+	SDL_ShowOpenFileDialog(callback, nullptr, nullptr, filter, 2, nullptr, false);
 }
 
 void OpenEnvironmentFileDialog()
@@ -164,6 +190,13 @@ void DrawGltfTab(Gltf* gltf, Context* context)
 	if (ImGui::Button("Load Environment Map")) {
 		OpenEnvironmentFileDialog();
 	}
+	if (g_gltf_loader.IsLoading()) {
+		ImGui::Text("%s %s", g_gltf_loader.GetStateName(), gltf->filename.c_str());
+		ImGui::ProgressBar(g_gltf_loader.GetProgress());
+		if (ImGui::Button("Cancel Loading")) {
+			g_gltf_loader.Cancel(&renderer.upload_buffer);
+		}
+	}
 
 	// Camera.
     if (ImGui::CollapsingHeader("Camera")) {
@@ -219,6 +252,47 @@ void DrawGltfTab(Gltf* gltf, Context* context)
             g_render_settings.pathtracer.reset |= ImGui::SliderFloat("Animation Time", &context->animation_player.playhead, 0., gltf->animations[context->animation_player.animation].length);
         }
     }
+
+	// Texture memory.
+	if (!gltf->textures.empty() && ImGui::CollapsingHeader("Texture Memory")) {
+		uint64_t total_size = 0;
+		uint64_t total_uncompressed_size = 0;
+		for (const Gltf::Texture& texture: gltf->textures) {
+			total_size += texture.size;
+			total_uncompressed_size += texture.uncompressed_size;
+		}
+		ImGui::Text("%llu MiB, saved %llu MiB", (unsigned long long)(total_size >> 20), (unsigned long long)((total_uncompressed_size - total_size) >> 20));
+		if (ImGui::BeginTable("Textures", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY, ImVec2(0., 300. * g_window_scale))) {
+			ImGui::TableSetupColumn("Name");
+			ImGui::TableSetupColumn("Format");
+			ImGui::TableSetupColumn("KiB");
+			ImGui::TableSetupColumn("Saved KiB");
+			ImGui::TableHeadersRow();
+			for (const Gltf::Texture& texture: gltf->textures) {
+				// Textures that haven't been uploaded have no size yet.
+				if (texture.size == 0) {
+					continue;
+				}
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(texture.name.c_str());
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(GetFormatName(texture.format));
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", (unsigned long long)(texture.size >> 10));
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", (unsigned long long)((texture.uncompressed_size - texture.size) >> 10));
+			}
+			ImGui::EndTable();
+		}
+	}
+
+	// Deduplication.
+	if (!gltf->meshes.empty() && ImGui::CollapsingHeader("Deduplication")) {
+		Gltf::DeduplicationStats stats = gltf->GetDeduplicationStats();
+		ImGui::Text("Images: %d shared, saved %llu KiB", stats.textures, (unsigned long long)(stats.texture_bytes >> 10));
+		ImGui::Text("Primitives: %d shared, saved %llu KiB", stats.primitives, (unsigned long long)(stats.mesh_bytes >> 10));
+	}
 }
 
 void DrawGraphicsTab()
@@ -256,6 +330,7 @@ void DrawGraphicsTab()
 			ImGui::SliderInt("Transmission Downsample Sample Pattern", &g_render_settings.raster.transmission_downsample_sample_pattern, 0, ForwardPass::TRANSMISSION_DOWNSAMPLE_SAMPLE_PATTERN_COUNT - 1);
 			ImGui::InputFloat("Bloom Strength", &g_render_settings.raster.bloom_strength);
 			ImGui::SliderInt("Bloom Radius", &g_render_settings.raster.bloom_radius, 0, 6);
+			ImGui::SliderFloat("LOD Pixel Error", &g_render_settings.raster.lod_pixel_error, 0.0f, 8.0f);
 		}
 
 		if (g_render_settings.renderer_type == Renderer::RENDERER_TYPE_PATHTRACER) {
@@ -412,6 +487,15 @@ int main(int argc, char* argv[])
 	// Get command line arguments.
 	Config::ParseCommandLineArguments(argv, argc);
 
+	// Cook a glTF file without creating a window.
+	if (!Config::cook_gltf.empty()) {
+		g_thread_pool.Create();
+		std::string cooked_filepath = CookedScene::GetCookedFilepath(Config::cook_gltf.c_str());
+		bool cooked = Gltf::Cook(Config::cook_gltf.c_str(), cooked_filepath.c_str(), &g_thread_pool);
+		g_thread_pool.Destroy();
+		return cooked ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
 	// Initialize SDL.
 	bool sdl_result = true;
 	sdl_result = SDL_SetAppMetadata("glTF Viewer", nullptr, nullptr);
@@ -475,7 +559,8 @@ int main(int argc, char* argv[])
 
     renderer.Init(hwnd, &g_render_settings);
 
-	g_gltf.Init(&renderer.resources.cbv_uav_srv_dynamic_allocator, &renderer.resources.gltf_sampler_allocator);
+	g_thread_pool.Create();
+	g_gltf.Init(&renderer.resources.cbv_uav_srv_dynamic_allocator, &renderer.resources.gltf_sampler_allocator, &g_thread_pool);
 
 	g_timer.Create();
 
@@ -491,6 +576,11 @@ int main(int argc, char* argv[])
 			g_render_settings.pathtracer.reset = true;
 		}
 
+		// Stream in the glTF model being loaded.
+		if (g_gltf_loader.IsLoading() && g_gltf_loader.Update(&renderer.resources.allocator, &renderer.upload_buffer)) {
+			g_render_settings.pathtracer.reset = true;
+		}
+
 		// Load an environment.
 		if (!Config::load_environment.empty()) {
 			LoadEnvironmentMap(Config::load_environment.c_str());
@@ -515,8 +605,6 @@ int main(int argc, char* argv[])
 		glm::mat4x4 camera_transform = g_camera_free_mode ? g_free.GetTransform() : g_orbit.GetTransform();
 		camera.SetWorldToView(camera_transform);
 
-		g_gltf.ApplyRestTransforms();
-
 		// Animate.
 		if (g_context.animation_player.playing) {
 			g_render_settings.pathtracer.reset = true;
@@ -527,7 +615,11 @@ int main(int argc, char* argv[])
 		}
 		{
 			ProfileZoneScopedN("Global Transforms");
-			g_gltf.CalculateGlobalTransforms(g_context.scene_id);
+			g_gltf.CalculateGlobalTransforms();
+		}
+		{
+			ProfileZoneScopedN("Skin Palettes");
+			g_gltf.CalculateSkinPalettes();
 		}
 		{
 			ProfileZoneScopedN("ImGui Draw List");
@@ -543,8 +635,10 @@ int main(int argc, char* argv[])
 
 	// Wait for all outstanding GPU work to complete before releasing resources.
 	renderer.WaitForOutstandingWork();
+	g_gltf_loader.Cancel(&renderer.upload_buffer);
 	renderer.upload_buffer.WaitForAllSubmissionsToComplete();
 	g_gltf.Unload();
+	g_thread_pool.Destroy();
 
 	// Release resources.
 	ImGui_ImplDX12_Shutdown();
@@ -1,5 +1,15 @@
 #include "Memory.h"
 
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
 #include "Profiling.h"
 
 void* Allocate(size_t size)
@@ -78,4 +88,22 @@ void ApplyGroupedAllocationOffsets(int* offsets, int offset_count, void* base, v
 	for (int i = 0; i < offset_count; i++) {
 		out_pointers[i] = (std::byte*)base + offsets[i];
 	}
-}
\ No newline at end of file
+}
+
+size_t GetPeakMemoryUsage()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return counters.PeakWorkingSetSize;
+	}
+	return 0;
+#else
+	rusage usage = {};
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		// Linux reports this in kibibytes.
+		return Kibibytes(usage.ru_maxrss);
+	}
+	return 0;
+#endif
+}
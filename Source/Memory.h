@@ -46,4 +46,6 @@ void Copy(void* destination, void* source, size_t size);
 void Copy(void* destination, void* source, size_t element_size, uint32_t element_count, size_t source_stride);
 int CalculateGroupedAllocationSize(Allocation* allocations, int allocation_count);
 int CalculateGroupedAllocationSizeAndOffsets(Allocation* allocations, int allocation_count, int* offsets);
-void ApplyGroupedAllocationOffsets(int* offsets, int offset_count, void* base, void** out_pointers);
\ No newline at end of file
+void ApplyGroupedAllocationOffsets(int* offsets, int offset_count, void* base, void** out_pointers);
+// Peak resident memory of the process in bytes.
+size_t GetPeakMemoryUsage();
\ No newline at end of file
@@ -110,12 +110,29 @@ void IndexBuffer::Destroy(CbvSrvUavPool* descriptor_allocator)
 	descriptor = -1;
 }
 
+DXGI_FORMAT Mesh::GetPositionFormat(uint8_t flags)
+{
+	return flags & FLAG_QUANTIZED_POSITION ? DXGI_FORMAT_R16G16B16A16_SNORM : DXGI_FORMAT_R32G32B32_FLOAT;
+}
+
+DXGI_FORMAT Mesh::GetTexcoordFormat(uint8_t flags)
+{
+	return flags & FLAG_QUANTIZED_ATTRIBUTES ? DXGI_FORMAT_R16G16_UNORM : DXGI_FORMAT_R32G32_FLOAT;
+}
+
+DXGI_FORMAT Mesh::GetColorFormat(uint8_t flags)
+{
+	return flags & FLAG_QUANTIZED_ATTRIBUTES ? DXGI_FORMAT_R8G8B8A8_UNORM : DXGI_FORMAT_R16G16B16A16_UNORM;
+}
+
 HRESULT Mesh::Create(GpuAllocator* allocator, CbvSrvUavPool* descriptor_allocator, const Desc* desc, const char* name)
 {
 	ProfileZoneScoped();
 	this->topology = desc->topology;
 	this->flags = desc->flags;
+	this->dequantization = desc->dequantization;
 	this->num_of_indices = desc->num_of_indices;
+	this->num_of_lod_indices = desc->flags & FLAG_INDEX ? desc->num_of_lod_indices : 0;
 	this->num_of_vertices = desc->num_of_vertices;
 
 	// Calculate the space needed.
@@ -123,12 +140,13 @@ HRESULT Mesh::Create(GpuAllocator* allocator, CbvSrvUavPool* descriptor_allocato
 	VertexAllocation null_allocation = {};
 	VertexAllocation allocations[] = {
 		desc->flags & FLAG_INDEX ? IndexBuffer::GetAllocationSize(num_of_indices, desc->index_format) : null_allocation,
-		VertexBuffer::GetAllocationSize(num_of_vertices, DXGI_FORMAT_R32G32B32_FLOAT),
+		VertexBuffer::GetAllocationSize(num_of_vertices, GetPositionFormat(desc->flags)),
 		desc->flags & FLAG_TANGENT_SPACE ? VertexBuffer::GetAllocationSize(num_of_vertices, DXGI_FORMAT_R10G10B10A2_UNORM) : null_allocation,
-		desc->flags & FLAG_TEXCOORD_0 ? VertexBuffer::GetAllocationSize(num_of_vertices, DXGI_FORMAT_R32G32_FLOAT) : null_allocation,
-		desc->flags & FLAG_TEXCOORD_1 ? VertexBuffer::GetAllocationSize(num_of_vertices, DXGI_FORMAT_R32G32_FLOAT) : null_allocation,
-		desc->flags & FLAG_COLOR ? VertexBuffer::GetAllocationSize(num_of_vertices, DXGI_FORMAT_R16G16B16A16_UNORM) : null_allocation,
+		desc->flags & FLAG_TEXCOORD_0 ? VertexBuffer::GetAllocationSize(num_of_vertices, GetTexcoordFormat(desc->flags)) : null_allocation,
+		desc->flags & FLAG_TEXCOORD_1 ? VertexBuffer::GetAllocationSize(num_of_vertices, GetTexcoordFormat(desc->flags)) : null_allocation,
+		desc->flags & FLAG_COLOR ? VertexBuffer::GetAllocationSize(num_of_vertices, GetColorFormat(desc->flags)) : null_allocation,
 		desc->flags & FLAG_JOINT_WEIGHT ? VertexBuffer::GetAllocationSize(num_of_vertices, sizeof(JointWeight)) : null_allocation,
+		num_of_lod_indices > 0 ? IndexBuffer::GetAllocationSize(num_of_lod_indices, desc->index_format) : null_allocation,
 	};
 	uint64_t offsets[std::size(allocations)];
 	size = CalculateTotalAllocationSize(std::size(allocations), allocations, offsets);
@@ -146,22 +164,25 @@ HRESULT Mesh::Create(GpuAllocator* allocator, CbvSrvUavPool* descriptor_allocato
 	if (desc->flags & FLAG_INDEX) {
     	index.Create(resource.resource.Get(), base_address + offsets[0], descriptor_allocator, num_of_indices, desc->index_format);
 	}
-	position.Create(resource.resource.Get(), base_address + offsets[1], descriptor_allocator, num_of_vertices, DXGI_FORMAT_R32G32B32_FLOAT);
+	position.Create(resource.resource.Get(), base_address + offsets[1], descriptor_allocator, num_of_vertices, GetPositionFormat(desc->flags));
     if (desc->flags & FLAG_TANGENT_SPACE) {
 		tangent_space.Create(resource.resource.Get(), base_address + offsets[2], descriptor_allocator, num_of_vertices, DXGI_FORMAT_R10G10B10A2_UNORM);
 	}
     if (desc->flags & FLAG_TEXCOORD_0) {
-		texcoords[0].Create(resource.resource.Get(), base_address + offsets[3], descriptor_allocator, num_of_vertices, DXGI_FORMAT_R32G32_FLOAT);
+		texcoords[0].Create(resource.resource.Get(), base_address + offsets[3], descriptor_allocator, num_of_vertices, GetTexcoordFormat(desc->flags));
 	}
     if (desc->flags & FLAG_TEXCOORD_1) {
-		texcoords[1].Create(resource.resource.Get(), base_address + offsets[4], descriptor_allocator, num_of_vertices, DXGI_FORMAT_R32G32_FLOAT);
+		texcoords[1].Create(resource.resource.Get(), base_address + offsets[4], descriptor_allocator, num_of_vertices, GetTexcoordFormat(desc->flags));
 	}
     if (desc->flags & FLAG_COLOR) {
-		color.Create(resource.resource.Get(), base_address + offsets[5], descriptor_allocator, num_of_vertices, DXGI_FORMAT_R16G16B16A16_UNORM);
+		color.Create(resource.resource.Get(), base_address + offsets[5], descriptor_allocator, num_of_vertices, GetColorFormat(desc->flags));
 	}
     if (desc->flags & FLAG_JOINT_WEIGHT) {
 		joint_weight.Create(resource.resource.Get(), base_address + offsets[6], descriptor_allocator, num_of_vertices, sizeof(JointWeight));
 	}
+	if (num_of_lod_indices > 0) {
+		lod_index.Create(resource.resource.Get(), base_address + offsets[7], descriptor_allocator, num_of_lod_indices, desc->index_format);
+	}
 
 	return S_OK;
 }
@@ -172,6 +193,12 @@ void* Mesh::QueueIndexUpdate(UploadBuffer* upload_buffer)
 	return index.QueueUpdate(upload_buffer, resource.resource.Get());
 }
 
+void* Mesh::QueueLodIndexUpdate(UploadBuffer* upload_buffer)
+{
+	assert(num_of_lod_indices > 0);
+	return lod_index.QueueUpdate(upload_buffer, resource.resource.Get());
+}
+
 void* Mesh::QueuePositionUpdate(UploadBuffer* upload_buffer)
 {
 	return position.QueueUpdate(upload_buffer, resource.resource.Get());
@@ -210,6 +237,7 @@ void* Mesh::QueueJointWeightUpdate(UploadBuffer* upload_buffer)
 void Mesh::Destroy(CbvSrvUavPool* descriptor_allocator)
 {
 	index.Destroy(descriptor_allocator);
+	lod_index.Destroy(descriptor_allocator);
 	position.Destroy(descriptor_allocator);
 	tangent_space.Destroy(descriptor_allocator);
 	texcoords[0].Destroy(descriptor_allocator);
@@ -278,55 +306,83 @@ VertexBuffer* DynamicMesh::GetPreviousPositionBuffer()
 	return &position[(current_position_buffer - 1) % 1];
 }
 
-HRESULT MorphTarget::Create(GpuAllocator* allocator, CbvSrvUavPool* descriptor_allocator, const Desc* desc, const char* name)
+HRESULT MorphTargets::Create(GpuAllocator* allocator, CbvSrvUavPool* descriptor_allocator, const Desc* desc, const char* name)
 {
 	this->flags = desc->flags;
 	this->num_of_vertices = desc->num_of_vertices;
+	this->num_of_deltas = desc->num_of_deltas;
 
 	uint64_t size = 0;
 	VertexAllocation null_allocation = {};
 	VertexAllocation allocations[] = {
-		desc->flags & FLAG_POSITION ? VertexBuffer::GetAllocationSize(num_of_vertices, DXGI_FORMAT_R32G32B32_FLOAT) : null_allocation,
-		desc->flags & FLAG_POSITION ? VertexBuffer::GetAllocationSize(num_of_vertices, DXGI_FORMAT_R32G32B32_FLOAT) : null_allocation,
-		desc->flags & FLAG_TANGENT_SPACE ? VertexBuffer::GetAllocationSize(num_of_vertices, DXGI_FORMAT_R10G10B10A2_UNORM) : null_allocation,
+		VertexBuffer::GetAllocationSize(num_of_vertices + 1, DXGI_FORMAT_R32_UINT),
+		VertexBuffer::GetAllocationSize(num_of_deltas, DXGI_FORMAT_R32_UINT),
+		desc->flags & FLAG_POSITION ? VertexBuffer::GetAllocationSize(num_of_deltas, DXGI_FORMAT_R32G32B32_FLOAT) : null_allocation,
+		desc->flags & FLAG_NORMAL ? VertexBuffer::GetAllocationSize(num_of_deltas, DXGI_FORMAT_R32G32B32_FLOAT) : null_allocation,
+		desc->flags & FLAG_TANGENT ? VertexBuffer::GetAllocationSize(num_of_deltas, DXGI_FORMAT_R32G32B32_FLOAT) : null_allocation,
 	};
 	uint64_t offsets[std::size(allocations)];
 	size = CalculateTotalAllocationSize(std::size(allocations), allocations, offsets);
 	
-	// Allocate a resource for vertices.
+	// Allocate a resource for the deltas.
 	CD3DX12_RESOURCE_DESC resource_desc = CD3DX12_RESOURCE_DESC::Buffer(size);
 	HRESULT result = allocator->CreateResource(&resource_desc, D3D12_RESOURCE_STATE_COMMON, nullptr, &this->resource);
 	if (result != S_OK) {
 		Destroy(descriptor_allocator);
 		return result;
 	}
-	SetName(this->resource.resource.Get(), name ? name : "Morph Target");
+	SetName(this->resource.resource.Get(), name ? name : "Morph Targets");
 
 	D3D12_GPU_VIRTUAL_ADDRESS base_address = resource.resource->GetGPUVirtualAddress();
+	delta_offsets.Create(resource.resource.Get(), base_address + offsets[0], descriptor_allocator, num_of_vertices + 1, DXGI_FORMAT_R32_UINT);
+	targets.Create(resource.resource.Get(), base_address + offsets[1], descriptor_allocator, num_of_deltas, DXGI_FORMAT_R32_UINT);
 	if (desc->flags & FLAG_POSITION) {
-		position.Create(resource.resource.Get(), base_address + offsets[0], descriptor_allocator, num_of_vertices, DXGI_FORMAT_R32G32B32_FLOAT);
+		position.Create(resource.resource.Get(), base_address + offsets[2], descriptor_allocator, num_of_deltas, DXGI_FORMAT_R32G32B32_FLOAT);
 	}
-    if (desc->flags & FLAG_TANGENT_SPACE) {
-		tangent_space.Create(resource.resource.Get(), base_address + offsets[1], descriptor_allocator, num_of_vertices, DXGI_FORMAT_R10G10B10A2_UNORM);
+	if (desc->flags & FLAG_NORMAL) {
+		normal.Create(resource.resource.Get(), base_address + offsets[3], descriptor_allocator, num_of_deltas, DXGI_FORMAT_R32G32B32_FLOAT);
+	}
+	if (desc->flags & FLAG_TANGENT) {
+		tangent.Create(resource.resource.Get(), base_address + offsets[4], descriptor_allocator, num_of_deltas, DXGI_FORMAT_R32G32B32_FLOAT);
 	}
 
 	return S_OK;
 }
 
-void* MorphTarget::QueuePositionUpdate(UploadBuffer* upload_buffer)
+void* MorphTargets::QueueDeltaOffsetUpdate(UploadBuffer* upload_buffer)
+{
+	return delta_offsets.QueueUpdate(upload_buffer, resource.resource.Get());
+}
+
+void* MorphTargets::QueueTargetUpdate(UploadBuffer* upload_buffer)
 {
+	return targets.QueueUpdate(upload_buffer, resource.resource.Get());
+}
+
+void* MorphTargets::QueuePositionUpdate(UploadBuffer* upload_buffer)
+{
+	assert(flags & FLAG_POSITION);
 	return position.QueueUpdate(upload_buffer, resource.resource.Get());
 }
 
-void* MorphTarget::QueueTangentSpaceUpdate(UploadBuffer* upload_buffer)
+void* MorphTargets::QueueNormalUpdate(UploadBuffer* upload_buffer)
 {
-	assert(flags & FLAG_TANGENT_SPACE);
-	return tangent_space.QueueUpdate(upload_buffer, resource.resource.Get());
+	assert(flags & FLAG_NORMAL);
+	return normal.QueueUpdate(upload_buffer, resource.resource.Get());
 }
 
-void MorphTarget::Destroy(CbvSrvUavPool* descriptor_allocator)
+void* MorphTargets::QueueTangentUpdate(UploadBuffer* upload_buffer)
+{
+	assert(flags & FLAG_TANGENT);
+	return tangent.QueueUpdate(upload_buffer, resource.resource.Get());
+}
+
+void MorphTargets::Destroy(CbvSrvUavPool* descriptor_allocator)
 {
 	resource.Reset();
+	delta_offsets.Destroy(descriptor_allocator);
+	targets.Destroy(descriptor_allocator);
 	position.Destroy(descriptor_allocator);
-	tangent_space.Destroy(descriptor_allocator);
+	normal.Destroy(descriptor_allocator);
+	tangent.Destroy(descriptor_allocator);
 }
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include "DescriptorAllocator.h"
 #include "GpuAllocator.h"
 #include "UploadBuffer.h"
+#include "VertexQuantization.h"
 
 struct VertexAllocation {
 	uint64_t size;
@@ -49,7 +50,9 @@ struct Mesh {
         DXGI_FORMAT index_format;
         uint32_t num_of_vertices;
         uint32_t num_of_indices;
+        uint32_t num_of_lod_indices; // Indices of every level of detail, in the same format as the full detail indices.
         uint8_t flags;
+        VertexDequantization dequantization; // Only used with FLAG_QUANTIZED_POSITION or FLAG_QUANTIZED_ATTRIBUTES.
     };
 
     enum Flags {
@@ -59,16 +62,25 @@ struct Mesh {
         FLAG_TEXCOORD_1 = 1 << 3,
         FLAG_COLOR = 1 << 4,
         FLAG_JOINT_WEIGHT = 1 << 5,
+        FLAG_QUANTIZED_POSITION = 1 << 6, // Positions are R16G16B16A16_SNORM and need dequantization.
+        FLAG_QUANTIZED_ATTRIBUTES = 1 << 7, // Texture coordinates are R16G16_UNORM and need dequantization. Colors are R8G8B8A8_UNORM.
     };
 
+    static DXGI_FORMAT GetPositionFormat(uint8_t flags);
+    static DXGI_FORMAT GetTexcoordFormat(uint8_t flags);
+    static DXGI_FORMAT GetColorFormat(uint8_t flags);
+
     D3D12_PRIMITIVE_TOPOLOGY topology;
     uint8_t flags = 0;
+    VertexDequantization dequantization;
     uint32_t num_of_vertices = 0;
     uint32_t num_of_indices = 0;
+    uint32_t num_of_lod_indices = 0;
 
     GpuResource resource;
 
     IndexBuffer index;
+    IndexBuffer lod_index; // Kept separate from the full detail indices, which are also used for ray tracing.
     VertexBuffer position;
     VertexBuffer tangent_space;
     VertexBuffer texcoords[MAX_TEXCOORDS];
@@ -77,6 +89,7 @@ struct Mesh {
 
     HRESULT Create(GpuAllocator* allocator, CbvSrvUavPool* descriptor_allocator, const Desc* desc, const char* name = nullptr);
     void* QueueIndexUpdate(UploadBuffer* upload_buffer);
+    void* QueueLodIndexUpdate(UploadBuffer* upload_buffer);
     void* QueuePositionUpdate(UploadBuffer* upload_buffer);
     void* QueueTangentSpaceUpdate(UploadBuffer* upload_buffer);
     void* QueueTexcoord0Update(UploadBuffer* upload_buffer);
@@ -114,28 +127,40 @@ struct DynamicMesh {
     void Destroy(CbvSrvUavPool* descriptor_allocator);
 };
 
-struct MorphTarget {
+// Every morph target of a primitive, stored as a compacted list of deltas for each vertex.
+// Vertices that a target doesn't move take no memory, which is most of them for blend shapes.
+// The deltas of vertex i are [delta_offsets[i], delta_offsets[i + 1]), and targets gives the target of each delta.
+struct MorphTargets {
 
     enum Flags {
         FLAG_POSITION = 1 << 0,
-        FLAG_TANGENT_SPACE = 1 << 1,
+        FLAG_NORMAL = 1 << 1,
+        FLAG_TANGENT = 1 << 2,
     };
 
     struct Desc {
         uint32_t num_of_vertices;
+        uint32_t num_of_deltas;
         uint8_t flags;
     };
 
     uint8_t flags = 0;
     uint32_t num_of_vertices = 0;
+    uint32_t num_of_deltas = 0;
 
     GpuResource resource;
     
-    VertexBuffer position;
-    VertexBuffer tangent_space;
+    VertexBuffer delta_offsets; // R32_UINT, one more than the number of vertices.
+    VertexBuffer targets; // R32_UINT.
+    VertexBuffer position; // R32G32B32_FLOAT.
+    VertexBuffer normal; // R32G32B32_FLOAT.
+    VertexBuffer tangent; // R32G32B32_FLOAT.
 
     HRESULT Create(GpuAllocator* allocator, CbvSrvUavPool* descriptor_allocator, const Desc* desc, const char* name = nullptr);
+    void* QueueDeltaOffsetUpdate(UploadBuffer* upload_buffer);
+    void* QueueTargetUpdate(UploadBuffer* upload_buffer);
     void* QueuePositionUpdate(UploadBuffer* upload_buffer);
-    void* QueueTangentSpaceUpdate(UploadBuffer* upload_buffer);
+    void* QueueNormalUpdate(UploadBuffer* upload_buffer);
+    void* QueueTangentUpdate(UploadBuffer* upload_buffer);
     void Destroy(CbvSrvUavPool* descriptor_allocator);
 };
\ No newline at end of file
@@ -0,0 +1,272 @@
+#include "MeshOptimization.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Profiling.h"
+
+float VertexCacheStats::GetAcmr() const
+{
+	return this->triangles > 0 ? (float)this->transforms / this->triangles : 0.0f;
+}
+
+float VertexCacheStats::GetAtvr() const
+{
+	return this->vertices > 0 ? (float)this->transforms / this->vertices : 0.0f;
+}
+
+VertexCacheStats& VertexCacheStats::operator+=(const VertexCacheStats& other)
+{
+	this->triangles += other.triangles;
+	this->vertices += other.vertices;
+	this->transforms += other.transforms;
+	return *this;
+}
+
+VertexCacheStats SimulateVertexCache(const uint32_t* indices, size_t index_count, size_t vertex_count, int cache_size)
+{
+	ProfileZoneScoped();
+	VertexCacheStats stats;
+	stats.triangles = index_count / 3;
+
+	// A vertex is in the cache if fewer than cache_size vertices have been transformed since it was.
+	std::vector<uint32_t> transformed_at(vertex_count, 0);
+	std::vector<bool> used(vertex_count, false);
+	uint32_t time = cache_size + 1;
+	for (size_t i = 0; i < stats.triangles * 3; i++) {
+		uint32_t vertex = indices[i];
+		if (time - transformed_at[vertex] > (uint32_t)cache_size) {
+			transformed_at[vertex] = time++;
+			stats.transforms++;
+		}
+		if (!used[vertex]) {
+			used[vertex] = true;
+			stats.vertices++;
+		}
+	}
+	return stats;
+}
+
+static constexpr int FORSYTH_CACHE_SIZE = 32;
+static constexpr int FORSYTH_VALENCE_TABLE_SIZE = 32;
+
+struct ForsythTables {
+	float cache[FORSYTH_CACHE_SIZE];
+	float valence[FORSYTH_VALENCE_TABLE_SIZE];
+
+	ForsythTables()
+	{
+		// The vertices of the last triangle score the same, whichever order they were used in.
+		for (int i = 0; i < FORSYTH_CACHE_SIZE; i++) {
+			cache[i] = i < 3 ? 0.75f : std::pow(1.0f - (float)(i - 3) / (FORSYTH_CACHE_SIZE - 3), 1.5f);
+		}
+		// Vertices with few triangles left are preferred, so that they can leave the cache sooner.
+		valence[0] = 0.0f;
+		for (int i = 1; i < FORSYTH_VALENCE_TABLE_SIZE; i++) {
+			valence[i] = 2.0f / std::sqrt((float)i);
+		}
+	}
+};
+
+static const ForsythTables& GetForsythTables()
+{
+	static const ForsythTables tables;
+	return tables;
+}
+
+static float GetVertexScore(const ForsythTables& tables, int cache_position, uint32_t remaining)
+{
+	if (remaining == 0) {
+		return -1.0f;
+	}
+	float score = cache_position >= 0 ? tables.cache[cache_position] : 0.0f;
+	return score + (remaining < FORSYTH_VALENCE_TABLE_SIZE ? tables.valence[remaining] : 2.0f / std::sqrt((float)remaining));
+}
+
+void OptimizeVertexCache(uint32_t* indices, size_t index_count, size_t vertex_count)
+{
+	ProfileZoneScoped();
+	size_t triangle_count = index_count / 3;
+	if (triangle_count == 0) {
+		return;
+	}
+	const ForsythTables& tables = GetForsythTables();
+
+	// Triangles that use each vertex. The first remaining[v] triangles of a vertex haven't been emitted yet.
+	std::vector<uint32_t> remaining(vertex_count, 0);
+	for (size_t i = 0; i < triangle_count * 3; i++) {
+		remaining[indices[i]]++;
+	}
+	std::vector<uint32_t> offsets(vertex_count + 1, 0);
+	for (size_t i = 0; i < vertex_count; i++) {
+		offsets[i + 1] = offsets[i] + remaining[i];
+	}
+	std::vector<uint32_t> adjacency(triangle_count * 3);
+	{
+		std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < triangle_count * 3; i++) {
+			adjacency[next[indices[i]]++] = i / 3;
+		}
+	}
+
+	std::vector<int> cache_positions(vertex_count, -1);
+	std::vector<float> vertex_scores(vertex_count);
+	for (size_t i = 0; i < vertex_count; i++) {
+		vertex_scores[i] = GetVertexScore(tables, -1, remaining[i]);
+	}
+
+	std::vector<bool> emitted(triangle_count, false);
+	std::vector<uint32_t> output(triangle_count * 3);
+	uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+	uint32_t new_cache[FORSYTH_CACHE_SIZE + 3];
+	int cache_count = 0;
+	size_t cursor = 0;
+	int64_t best = -1;
+	for (size_t i = 0; i < triangle_count; i++) {
+		// When no triangle touches the cache, carry on from the next triangle in the original order.
+		if (best == -1) {
+			while (emitted[cursor]) {
+				cursor++;
+			}
+			best = cursor;
+		}
+		const uint32_t* triangle = indices + best * 3;
+		std::copy(triangle, triangle + 3, output.data() + i * 3);
+		emitted[best] = true;
+
+		for (int j = 0; j < 3; j++) {
+			uint32_t vertex = triangle[j];
+			uint32_t* triangles = adjacency.data() + offsets[vertex];
+			uint32_t* end = triangles + remaining[vertex];
+			std::iter_swap(std::find(triangles, end, (uint32_t)best), end - 1);
+			remaining[vertex]--;
+		}
+
+		// The triangle's vertices move to the front of the cache.
+		int new_count = 0;
+		for (int j = 0; j < 3; j++) {
+			if (std::find(new_cache, new_cache + new_count, triangle[j]) == new_cache + new_count) {
+				new_cache[new_count++] = triangle[j];
+			}
+		}
+		for (int j = 0; j < cache_count; j++) {
+			if (cache[j] != triangle[0] && cache[j] != triangle[1] && cache[j] != triangle[2]) {
+				new_cache[new_count++] = cache[j];
+			}
+		}
+		for (int j = 0; j < new_count; j++) {
+			uint32_t vertex = new_cache[j];
+			cache_positions[vertex] = j < FORSYTH_CACHE_SIZE ? j : -1;
+			vertex_scores[vertex] = GetVertexScore(tables, cache_positions[vertex], remaining[vertex]);
+		}
+
+		// Only triangles that use a vertex whose score changed can have a new score.
+		best = -1;
+		float best_score = 0.0f;
+		for (int j = 0; j < new_count; j++) {
+			uint32_t vertex = new_cache[j];
+			for (uint32_t k = 0; k < remaining[vertex]; k++) {
+				uint32_t candidate = adjacency[offsets[vertex] + k];
+				const uint32_t* candidate_indices = indices + candidate * 3;
+				float score = vertex_scores[candidate_indices[0]] + vertex_scores[candidate_indices[1]] + vertex_scores[candidate_indices[2]];
+				if (score > best_score) {
+					best = candidate;
+					best_score = score;
+				}
+			}
+		}
+
+		cache_count = std::min(new_count, FORSYTH_CACHE_SIZE);
+		std::copy(new_cache, new_cache + cache_count, cache);
+	}
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void OptimizeOverdraw(uint32_t* indices, size_t index_count, const glm::vec3* positions, size_t vertex_count)
+{
+	ProfileZoneScoped();
+	constexpr uint32_t CACHE_SIZE = 16;
+	size_t triangle_count = index_count / 3;
+	if (triangle_count == 0 || vertex_count == 0) {
+		return;
+	}
+
+	// A cluster starts wherever a triangle misses the cache with every vertex.
+	struct Cluster {
+		size_t first;
+		size_t count;
+		float sort_key;
+	};
+	std::vector<Cluster> clusters;
+	std::vector<uint32_t> transformed_at(vertex_count, 0);
+	uint32_t time = CACHE_SIZE + 1;
+	for (size_t i = 0; i < triangle_count; i++) {
+		int misses = 0;
+		for (int j = 0; j < 3; j++) {
+			uint32_t vertex = indices[i * 3 + j];
+			if (time - transformed_at[vertex] > CACHE_SIZE) {
+				transformed_at[vertex] = time++;
+				misses++;
+			}
+		}
+		if (clusters.empty() || misses == 3) {
+			clusters.push_back({i, 0, 0.0f});
+		}
+		clusters.back().count++;
+	}
+	if (clusters.size() < 2) {
+		return;
+	}
+
+	glm::vec3 mesh_centroid = glm::vec3(0.0f);
+	for (size_t i = 0; i < vertex_count; i++) {
+		mesh_centroid += positions[i];
+	}
+	mesh_centroid /= (float)vertex_count;
+
+	// Clusters that face away from the centre of the mesh are more likely to occlude the others, so they are drawn first.
+	for (Cluster& cluster: clusters) {
+		glm::vec3 normal = glm::vec3(0.0f);
+		glm::vec3 centroid = glm::vec3(0.0f);
+		float area = 0.0f;
+		for (size_t i = cluster.first; i < cluster.first + cluster.count; i++) {
+			glm::vec3 a = positions[indices[i * 3 + 0]];
+			glm::vec3 b = positions[indices[i * 3 + 1]];
+			glm::vec3 c = positions[indices[i * 3 + 2]];
+			glm::vec3 triangle_normal = glm::cross(b - a, c - a);
+			float triangle_area = glm::length(triangle_normal);
+			normal += triangle_normal;
+			centroid += (a + b + c) * (triangle_area / 3.0f);
+			area += triangle_area;
+		}
+		float normal_length = glm::length(normal);
+		if (area > 0.0f && normal_length > 0.0f) {
+			cluster.sort_key = glm::dot(centroid / area - mesh_centroid, normal / normal_length);
+		}
+	}
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+		return a.sort_key > b.sort_key;
+	});
+
+	std::vector<uint32_t> sorted;
+	sorted.reserve(triangle_count * 3);
+	for (const Cluster& cluster: clusters) {
+		sorted.insert(sorted.end(), indices + cluster.first * 3, indices + (cluster.first + cluster.count) * 3);
+	}
+	std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+uint32_t OptimizeVertexFetch(uint32_t* indices, size_t index_count, size_t vertex_count, std::vector<uint32_t>* remap)
+{
+	ProfileZoneScoped();
+	remap->assign(vertex_count, UINT32_MAX);
+	uint32_t next = 0;
+	for (size_t i = 0; i < index_count; i++) {
+		uint32_t& remapped = (*remap)[indices[i]];
+		if (remapped == UINT32_MAX) {
+			remapped = next++;
+		}
+		indices[i] = remapped;
+	}
+	return next;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Reordering of indexed triangle lists for the GPU's post-transform vertex cache and vertex fetch.
+
+// Counts from simulating a FIFO vertex cache.
+struct VertexCacheStats {
+    uint64_t triangles = 0;
+    uint64_t vertices = 0; // Vertices that are referenced by at least one triangle.
+    uint64_t transforms = 0; // Cache misses.
+
+    // Average cache miss ratio, vertices transformed per triangle. 0.5 is the best possible on a regular grid, 3 is the worst.
+    float GetAcmr() const;
+    // Average transform to vertex ratio. 1 is the best possible.
+    float GetAtvr() const;
+    VertexCacheStats& operator+=(const VertexCacheStats& other);
+};
+
+VertexCacheStats SimulateVertexCache(const uint32_t* indices, size_t index_count, size_t vertex_count, int cache_size = 16);
+
+// Reorders triangles for vertex cache locality using Tom Forsyth's linear speed algorithm.
+void OptimizeVertexCache(uint32_t* indices, size_t index_count, size_t vertex_count);
+// Reorders clusters of triangles from OptimizeVertexCache so that outward facing clusters are drawn first.
+// Clusters are split where the cache was cold, so vertex cache efficiency is barely affected.
+void OptimizeOverdraw(uint32_t* indices, size_t index_count, const glm::vec3* positions, size_t vertex_count);
+// Renumbers vertices in the order they are first used, so vertex fetch is mostly sequential.
+// Unused vertices are dropped. Returns the new number of vertices, with remap set to UINT32_MAX for dropped vertices.
+uint32_t OptimizeVertexFetch(uint32_t* indices, size_t index_count, size_t vertex_count, std::vector<uint32_t>* remap);
+
+// Applies a remap from OptimizeVertexFetch to a vertex stream. Empty streams are left empty.
+template<typename T>
+void RemapVertexStream(std::vector<T>* stream, const std::vector<uint32_t>& remap, uint32_t vertex_count)
+{
+    if (stream->empty()) {
+        return;
+    }
+    std::vector<T> remapped(vertex_count);
+    for (size_t i = 0; i < stream->size() && i < remap.size(); i++) {
+        if (remap[i] != UINT32_MAX) {
+            remapped[remap[i]] = (*stream)[i];
+        }
+    }
+    stream->swap(remapped);
+}
@@ -0,0 +1,275 @@
+#include "MeshSimplification.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include "Hash.h"
+#include "Profiling.h"
+
+// Sum of squared distances to a set of planes, weighted by the area of the triangles they came from.
+struct Quadric {
+	double a2 = 0.0, b2 = 0.0, c2 = 0.0;
+	double ab = 0.0, ac = 0.0, bc = 0.0;
+	double ad = 0.0, bd = 0.0, cd = 0.0;
+	double d2 = 0.0;
+	double weight = 0.0;
+
+	Quadric& operator+=(const Quadric& other)
+	{
+		a2 += other.a2; b2 += other.b2; c2 += other.c2;
+		ab += other.ab; ac += other.ac; bc += other.bc;
+		ad += other.ad; bd += other.bd; cd += other.cd;
+		d2 += other.d2;
+		weight += other.weight;
+		return *this;
+	}
+};
+
+static Quadric GetTriangleQuadric(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2)
+{
+	Quadric quadric;
+	glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+	float length = glm::length(normal);
+	if (length == 0.0f) {
+		return quadric;
+	}
+	normal /= length;
+	double a = normal.x;
+	double b = normal.y;
+	double c = normal.z;
+	double d = -glm::dot(normal, p0);
+	double area = length * 0.5;
+	quadric.a2 = a * a * area; quadric.b2 = b * b * area; quadric.c2 = c * c * area;
+	quadric.ab = a * b * area; quadric.ac = a * c * area; quadric.bc = b * c * area;
+	quadric.ad = a * d * area; quadric.bd = b * d * area; quadric.cd = c * d * area;
+	quadric.d2 = d * d * area;
+	quadric.weight = area;
+	return quadric;
+}
+
+// Mean squared distance from a point to the planes of the quadric.
+static double EvaluateQuadric(const Quadric& quadric, glm::vec3 point)
+{
+	if (quadric.weight <= 0.0) {
+		return 0.0;
+	}
+	double x = point.x;
+	double y = point.y;
+	double z = point.z;
+	double error = quadric.a2 * x * x + quadric.b2 * y * y + quadric.c2 * z * z;
+	error += 2.0 * (quadric.ab * x * y + quadric.ac * x * z + quadric.bc * y * z);
+	error += 2.0 * (quadric.ad * x + quadric.bd * y + quadric.cd * z);
+	error += quadric.d2;
+	return std::max(error, 0.0) / quadric.weight;
+}
+
+static uint64_t GetEdgeKey(uint32_t a, uint32_t b)
+{
+	return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+// Finds vertices that must not move: seams, where several vertices share a position, and open or non-manifold edges.
+static std::vector<bool> FindLockedVertices(const uint32_t* indices, size_t index_count, const glm::vec3* positions, size_t vertex_count)
+{
+	// Give every vertex the index of the first vertex with the same position.
+	std::vector<uint32_t> welded(vertex_count);
+	std::vector<uint32_t> wedges(vertex_count, 0);
+	std::unordered_map<uint64_t, uint32_t> first_at_position;
+	first_at_position.reserve(vertex_count);
+	for (size_t i = 0; i < vertex_count; i++) {
+		auto [first, inserted] = first_at_position.try_emplace(Hash(&positions[i], sizeof(glm::vec3)), (uint32_t)i);
+		// A hash collision between different positions only loses the vertex as a seam candidate.
+		welded[i] = positions[first->second] == positions[i] ? first->second : (uint32_t)i;
+		wedges[welded[i]]++;
+	}
+
+	std::vector<bool> locked(vertex_count, false);
+	std::unordered_map<uint64_t, uint32_t> edge_counts;
+	edge_counts.reserve(index_count);
+	for (size_t i = 0; i + 2 < index_count; i += 3) {
+		for (int j = 0; j < 3; j++) {
+			edge_counts[GetEdgeKey(welded[indices[i + j]], welded[indices[i + (j + 1) % 3]])]++;
+		}
+	}
+	std::vector<bool> locked_position(vertex_count, false);
+	for (auto [key, count]: edge_counts) {
+		if (count != 2) {
+			locked_position[key >> 32] = true;
+			locked_position[key & UINT32_MAX] = true;
+		}
+	}
+	for (size_t i = 0; i < vertex_count; i++) {
+		locked[i] = wedges[welded[i]] > 1 || locked_position[welded[i]];
+	}
+	return locked;
+}
+
+float SimplifyMesh(const uint32_t* indices, size_t index_count, const SimplifyVertices* vertices, size_t target_index_count, float max_error, std::vector<uint32_t>* output)
+{
+	ProfileZoneScoped();
+	size_t vertex_count = vertices->vertex_count;
+	const glm::vec3* positions = vertices->positions;
+	output->assign(indices, indices + index_count / 3 * 3);
+	if (output->size() <= target_index_count) {
+		return 0.0f;
+	}
+
+	std::vector<bool> locked = FindLockedVertices(output->data(), output->size(), positions, vertex_count);
+	std::vector<Quadric> quadrics(vertex_count);
+	for (size_t i = 0; i < output->size(); i += 3) {
+		const uint32_t* triangle = output->data() + i;
+		Quadric quadric = GetTriangleQuadric(positions[triangle[0]], positions[triangle[1]], positions[triangle[2]]);
+		for (int j = 0; j < 3; j++) {
+			quadrics[triangle[j]] += quadric;
+		}
+	}
+
+	struct Collapse {
+		uint32_t from;
+		uint32_t to;
+		float error;
+	};
+	auto get_error = [&](uint32_t from, uint32_t to) -> float {
+		Quadric quadric = quadrics[from];
+		quadric += quadrics[to];
+		double error = EvaluateQuadric(quadric, positions[to]);
+		// Moving a vertex onto another also moves its attributes, so the difference counts as distance.
+		for (uint32_t i = 0; i < vertices->attribute_count; i++) {
+			double difference = vertices->attributes[from * vertices->attribute_count + i] - vertices->attributes[to * vertices->attribute_count + i];
+			error += difference * difference;
+		}
+		return (float)std::sqrt(error);
+	};
+
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> offsets(vertex_count + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<uint32_t> remap(vertex_count);
+	std::vector<bool> touched(vertex_count);
+	float result_error = 0.0f;
+	size_t target_triangles = target_index_count / 3;
+	while (output->size() / 3 > target_triangles) {
+		size_t triangle_count = output->size() / 3;
+
+		// Triangles around each vertex.
+		std::fill(offsets.begin(), offsets.end(), 0);
+		for (uint32_t index: *output) {
+			offsets[index + 1]++;
+		}
+		for (size_t i = 0; i < vertex_count; i++) {
+			offsets[i + 1] += offsets[i];
+		}
+		adjacency.resize(output->size());
+		{
+			std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < output->size(); i++) {
+				adjacency[next[(*output)[i]]++] = i / 3;
+			}
+		}
+
+		// Each edge can collapse either way, so take whichever direction is allowed and cheaper.
+		collapses.clear();
+		for (size_t i = 0; i < output->size(); i += 3) {
+			const uint32_t* triangle = output->data() + i;
+			for (int j = 0; j < 3; j++) {
+				uint32_t a = triangle[j];
+				uint32_t b = triangle[(j + 1) % 3];
+				// Interior edges are seen from both of their triangles, so only one of them adds the edge. Open edges are locked anyway.
+				if (a > b) {
+					continue;
+				}
+				if (vertices->groups && vertices->groups[a] != vertices->groups[b]) {
+					continue;
+				}
+				float a_to_b = locked[a] ? INFINITY : get_error(a, b);
+				float b_to_a = locked[b] ? INFINITY : get_error(b, a);
+				if (a_to_b == INFINITY && b_to_a == INFINITY) {
+					continue;
+				}
+				collapses.push_back(a_to_b <= b_to_a ? Collapse{a, b, a_to_b} : Collapse{b, a, b_to_a});
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+			return a.error < b.error;
+		});
+
+		// Collapses in one pass can't share any triangles, so each one can be checked against the mesh as it was at the start of the pass.
+		for (size_t i = 0; i < vertex_count; i++) {
+			remap[i] = i;
+		}
+		std::fill(touched.begin(), touched.end(), false);
+		size_t removed = 0;
+		size_t applied = 0;
+		for (const Collapse& collapse: collapses) {
+			if (triangle_count - removed <= target_triangles || collapse.error > max_error) {
+				break;
+			}
+			if (touched[collapse.from] || touched[collapse.to]) {
+				continue;
+			}
+
+			// Reject collapses that would flip a triangle over.
+			bool flips = false;
+			size_t shared = 0;
+			for (uint32_t j = offsets[collapse.from]; j < offsets[collapse.from + 1] && !flips; j++) {
+				const uint32_t* triangle = output->data() + adjacency[j] * 3;
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+					shared++;
+					continue;
+				}
+				glm::vec3 before[3];
+				glm::vec3 after[3];
+				for (int k = 0; k < 3; k++) {
+					before[k] = positions[triangle[k]];
+					after[k] = triangle[k] == collapse.from ? positions[collapse.to] : before[k];
+				}
+				glm::vec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::vec3 normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+				flips = glm::dot(normal_before, normal_after) <= 0.0f;
+			}
+			if (flips) {
+				continue;
+			}
+
+			for (uint32_t j = offsets[collapse.from]; j < offsets[collapse.from + 1]; j++) {
+				const uint32_t* triangle = output->data() + adjacency[j] * 3;
+				touched[triangle[0]] = true;
+				touched[triangle[1]] = true;
+				touched[triangle[2]] = true;
+			}
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to] += quadrics[collapse.from];
+			result_error = std::max(result_error, collapse.error);
+			removed += shared;
+			applied++;
+		}
+		if (applied == 0) {
+			break;
+		}
+
+		// Remove the triangles that collapsed.
+		size_t write = 0;
+		for (size_t i = 0; i < output->size(); i += 3) {
+			uint32_t a = remap[(*output)[i + 0]];
+			uint32_t b = remap[(*output)[i + 1]];
+			uint32_t c = remap[(*output)[i + 2]];
+			if (a != b && a != c && b != c) {
+				(*output)[write++] = a;
+				(*output)[write++] = b;
+				(*output)[write++] = c;
+			}
+		}
+		output->resize(write);
+	}
+	return result_error;
+}
+
+int SelectMeshLod(const MeshLodData& data, float max_error)
+{
+	int lod = -1;
+	for (int i = 0; i < data.lods.size() && data.lods[i].error <= max_error; i++) {
+		lod = i;
+	}
+	return lod;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Edge collapse simplification with quadric error metrics, used to build levels of detail at import.
+
+constexpr int MESH_MAX_LODS = 4; // Levels below the full detail mesh.
+constexpr uint32_t MESH_LOD_MIN_TRIANGLES = 256; // Primitives with fewer triangles are cheap enough to always draw at full detail.
+
+struct MeshLod {
+    uint32_t first_index; // Into the LOD index buffer of the mesh.
+    uint32_t num_of_indices;
+    float error; // How far the simplified surface may be from the full detail surface, in object space.
+};
+
+// Levels of detail below the full detail mesh, from most to least detailed. Every level uses the vertices of the full detail mesh.
+struct MeshLodData {
+    std::vector<MeshLod> lods;
+    glm::vec3 center = glm::vec3(0.0f); // Bounding sphere of the full detail mesh.
+    float radius = 0.0f;
+};
+
+struct SimplifyVertices {
+    const glm::vec3* positions = nullptr;
+    size_t vertex_count = 0;
+    // Optional attributes that vary smoothly across the surface, such as texture coordinates and skin weights.
+    // They are compared with positions, so they should already be scaled by how much they matter.
+    const float* attributes = nullptr;
+    uint32_t attribute_count = 0; // Floats per vertex.
+    // Optional. Vertices can only collapse onto vertices in the same group, such as vertices that are influenced by the same joints.
+    const uint32_t* groups = nullptr;
+};
+
+// Collapses edges until there are at most target_index_count / 3 triangles, or any other collapse would have an error above max_error.
+// Vertices on borders and seams, where several vertices share a position, are never moved, so texture seams and hard edges are kept.
+// Returns the largest error of any collapse.
+float SimplifyMesh(const uint32_t* indices, size_t index_count, const SimplifyVertices* vertices, size_t target_index_count, float max_error, std::vector<uint32_t>* output);
+// Returns the least detailed level whose error is at most max_error, or -1 for the full detail mesh.
+int SelectMeshLod(const MeshLodData& data, float max_error);
@@ -0,0 +1,136 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Profiling.h"
+
+void BuildMeshlets(const uint32_t* indices, size_t index_count, size_t vertex_count, MeshletData* data)
+{
+	ProfileZoneScoped();
+	data->meshlets.clear();
+	data->vertices.clear();
+	data->triangles.clear();
+	size_t triangle_count = index_count / 3;
+	data->triangles.reserve(triangle_count * 3);
+
+	// Position of each vertex in the current meshlet, valid if meshlet_of matches the current meshlet.
+	std::vector<uint32_t> meshlet_of(vertex_count, UINT32_MAX);
+	std::vector<uint8_t> local_index(vertex_count);
+	Meshlet meshlet = {};
+	for (size_t i = 0; i < triangle_count; i++) {
+		const uint32_t* triangle = indices + i * 3;
+		uint32_t current = data->meshlets.size();
+		uint32_t new_vertices = 0;
+		for (int j = 0; j < 3; j++) {
+			bool seen = meshlet_of[triangle[j]] == current || (j > 0 && triangle[j] == triangle[0]) || (j > 1 && triangle[j] == triangle[1]);
+			new_vertices += seen ? 0 : 1;
+		}
+		if (meshlet.vertex_count + new_vertices > MESHLET_MAX_VERTICES || meshlet.triangle_count + 1 > MESHLET_MAX_TRIANGLES) {
+			data->meshlets.push_back(meshlet);
+			meshlet = {
+				.vertex_offset = (uint32_t)data->vertices.size(),
+				.triangle_offset = (uint32_t)data->triangles.size(),
+			};
+			current++;
+		}
+		for (int j = 0; j < 3; j++) {
+			uint32_t vertex = triangle[j];
+			if (meshlet_of[vertex] != current) {
+				meshlet_of[vertex] = current;
+				local_index[vertex] = meshlet.vertex_count++;
+				data->vertices.push_back(vertex);
+			}
+			data->triangles.push_back(local_index[vertex]);
+		}
+		meshlet.triangle_count++;
+	}
+	if (meshlet.triangle_count > 0) {
+		data->meshlets.push_back(meshlet);
+	}
+}
+
+void ComputeMeshletBounds(const glm::vec3* positions, MeshletData* data)
+{
+	ProfileZoneScoped();
+	data->bounds.resize(data->meshlets.size());
+	for (size_t i = 0; i < data->meshlets.size(); i++) {
+		const Meshlet& meshlet = data->meshlets[i];
+		const uint32_t* vertices = data->vertices.data() + meshlet.vertex_offset;
+		const uint8_t* triangles = data->triangles.data() + meshlet.triangle_offset;
+		MeshletBounds& bounds = data->bounds[i];
+
+		// Sphere around the centre of the bounding box. Not minimal, but close enough for culling.
+		glm::vec3 minimum = positions[vertices[0]];
+		glm::vec3 maximum = positions[vertices[0]];
+		for (uint32_t j = 1; j < meshlet.vertex_count; j++) {
+			minimum = glm::min(minimum, positions[vertices[j]]);
+			maximum = glm::max(maximum, positions[vertices[j]]);
+		}
+		bounds.center = (minimum + maximum) * 0.5f;
+		bounds.radius = 0.0f;
+		for (uint32_t j = 0; j < meshlet.vertex_count; j++) {
+			bounds.radius = std::max(bounds.radius, glm::length(positions[vertices[j]] - bounds.center));
+		}
+
+		// The cone axis is the average of the triangle normals, and the cone is wide enough to hold all of them.
+		glm::vec3 normals[MESHLET_MAX_TRIANGLES];
+		uint32_t normal_count = 0;
+		glm::vec3 axis = glm::vec3(0.0f);
+		for (uint32_t j = 0; j < meshlet.triangle_count; j++) {
+			glm::vec3 a = positions[vertices[triangles[j * 3 + 0]]];
+			glm::vec3 b = positions[vertices[triangles[j * 3 + 1]]];
+			glm::vec3 c = positions[vertices[triangles[j * 3 + 2]]];
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float length = glm::length(normal);
+			// Degenerate triangles are never visible, so they don't widen the cone.
+			if (length > 0.0f) {
+				normals[normal_count] = normal / length;
+				axis += normals[normal_count];
+				normal_count++;
+			}
+		}
+		float axis_length = glm::length(axis);
+		bounds.cone_axis = axis_length > 0.0f ? axis / axis_length : glm::vec3(0.0f, 0.0f, 1.0f);
+		bounds.cone_cutoff = 1.0f;
+		if (axis_length > 0.0f) {
+			float minimum_dot = 1.0f;
+			for (uint32_t j = 0; j < normal_count; j++) {
+				minimum_dot = std::min(minimum_dot, glm::dot(normals[j], bounds.cone_axis));
+			}
+			// Cones that are close to a hemisphere or wider can't be used for back face culling.
+			if (minimum_dot > 0.1f) {
+				bounds.cone_cutoff = std::sqrt(1.0f - minimum_dot * minimum_dot);
+			}
+		}
+	}
+}
+
+bool ValidateMeshlets(const MeshletData& data, uint32_t vertex_count)
+{
+	if (data.bounds.size() != data.meshlets.size()) {
+		return false;
+	}
+	for (const Meshlet& meshlet: data.meshlets) {
+		if (meshlet.vertex_count > MESHLET_MAX_VERTICES || meshlet.triangle_count > MESHLET_MAX_TRIANGLES) {
+			return false;
+		}
+		if (meshlet.vertex_offset > data.vertices.size() || meshlet.vertex_count > data.vertices.size() - meshlet.vertex_offset) {
+			return false;
+		}
+		if (meshlet.triangle_offset > data.triangles.size() || meshlet.triangle_count * 3 > data.triangles.size() - meshlet.triangle_offset) {
+			return false;
+		}
+		for (uint32_t i = 0; i < meshlet.vertex_count; i++) {
+			if (data.vertices[meshlet.vertex_offset + i] >= vertex_count) {
+				return false;
+			}
+		}
+		for (uint32_t i = 0; i < meshlet.triangle_count * 3; i++) {
+			if (data.triangles[meshlet.triangle_offset + i] >= meshlet.vertex_count) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Splits triangle lists into small clusters that can be culled individually.
+
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+struct Meshlet {
+    uint32_t vertex_offset; // First entry in MeshletData::vertices.
+    uint32_t triangle_offset; // First byte in MeshletData::triangles.
+    uint32_t vertex_count;
+    uint32_t triangle_count;
+};
+
+// A meshlet can be culled if its bounding sphere is outside the frustum.
+// It is entirely back facing if dot(center - camera_position, cone_axis) >= cone_cutoff * length(center - camera_position) + radius.
+struct MeshletBounds {
+    glm::vec3 center;
+    float radius;
+    glm::vec3 cone_axis;
+    float cone_cutoff; // Sine of the cone's half angle. 1 if the meshlet faces too many directions to be back face culled.
+};
+
+struct MeshletData {
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshletBounds> bounds;
+    std::vector<uint32_t> vertices; // Vertex indices of every meshlet, one after the other.
+    std::vector<uint8_t> triangles; // Three meshlet vertices per triangle.
+};
+
+// Groups consecutive triangles, so the triangles should already be ordered for locality, see OptimizeVertexCache.
+void BuildMeshlets(const uint32_t* indices, size_t index_count, size_t vertex_count, MeshletData* data);
+void ComputeMeshletBounds(const glm::vec3* positions, MeshletData* data);
+// Checks that every meshlet is within its arrays and only references valid vertices.
+bool ValidateMeshlets(const MeshletData& data, uint32_t vertex_count);
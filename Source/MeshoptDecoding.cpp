@@ -0,0 +1,636 @@
+#include "MeshoptDecoding.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "Profiling.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESHOPT_DECODING_SSE2
+#include <emmintrin.h>
+#endif
+
+// Vertex codec.
+// Vertices are split into blocks, and each block stores every byte of the vertex separately as deltas from the previous vertex.
+// The deltas are stored in groups of 16, each group packed into 0, 2, 4 or 8 bits per delta.
+
+static constexpr uint8_t VERTEX_HEADER = 0xa0;
+static constexpr size_t VERTEX_BLOCK_SIZE_BYTES = 8192;
+static constexpr size_t VERTEX_BLOCK_MAX_SIZE = 256;
+static constexpr size_t BYTE_GROUP_SIZE = 16;
+// A group never needs more than this many bytes, which the tail padding guarantees for valid data.
+static constexpr size_t BYTE_GROUP_DECODE_LIMIT = 24;
+static constexpr size_t TAIL_MIN_SIZE = 32;
+
+static size_t GetVertexBlockSize(size_t stride)
+{
+	size_t result = (VERTEX_BLOCK_SIZE_BYTES / stride) & ~(BYTE_GROUP_SIZE - 1);
+	return std::min(result, VERTEX_BLOCK_MAX_SIZE);
+}
+
+// Values are packed from the high bits down. The largest value means the byte is stored after the packed values instead.
+template<int BITS>
+static const uint8_t* DecodeBytesGroup(const uint8_t* data, uint8_t* out)
+{
+	constexpr size_t PACKED_SIZE = BYTE_GROUP_SIZE * BITS / 8;
+	constexpr size_t VALUES_PER_BYTE = 8 / BITS;
+	constexpr uint8_t SENTINEL = (1 << BITS) - 1;
+	const uint8_t* explicit_bytes = data + PACKED_SIZE;
+	for (size_t i = 0; i < BYTE_GROUP_SIZE; i++) {
+		int shift = 8 - BITS - int(i % VALUES_PER_BYTE) * BITS;
+		uint8_t value = (data[i / VALUES_PER_BYTE] >> shift) & SENTINEL;
+		out[i] = value == SENTINEL ? *explicit_bytes++ : value;
+	}
+	return explicit_bytes;
+}
+
+static const uint8_t* DecodeBytes(const uint8_t* data, const uint8_t* end, uint8_t* out, size_t count)
+{
+	assert(count % BYTE_GROUP_SIZE == 0);
+	// Each group has a 2 bit mode, four to a byte.
+	size_t header_size = (count / BYTE_GROUP_SIZE + 3) / 4;
+	if (size_t(end - data) < header_size) {
+		return nullptr;
+	}
+	const uint8_t* header = data;
+	data += header_size;
+	for (size_t i = 0; i < count; i += BYTE_GROUP_SIZE) {
+		if (size_t(end - data) < BYTE_GROUP_DECODE_LIMIT) {
+			return nullptr;
+		}
+		size_t group = i / BYTE_GROUP_SIZE;
+		int mode = (header[group / 4] >> ((group % 4) * 2)) & 3;
+		switch (mode) {
+			case 0: {
+				std::memset(out + i, 0, BYTE_GROUP_SIZE);
+			} break;
+			case 1: {
+				data = DecodeBytesGroup<2>(data, out + i);
+			} break;
+			case 2: {
+				data = DecodeBytesGroup<4>(data, out + i);
+			} break;
+			case 3: {
+				std::memcpy(out + i, data, BYTE_GROUP_SIZE);
+				data += BYTE_GROUP_SIZE;
+			} break;
+		}
+	}
+	return data;
+}
+
+#ifdef MESHOPT_DECODING_SSE2
+static __m128i Unzigzag8(__m128i value)
+{
+	__m128i negative = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(value, _mm_set1_epi8(1)));
+	__m128i shifted = _mm_and_si128(_mm_srli_epi16(value, 1), _mm_set1_epi8(0x7f));
+	return _mm_xor_si128(negative, shifted);
+}
+
+// Adds each vertex to the sum of the ones before it, with the last vertex of the previous register in every lane of previous.
+static __m128i PrefixSum4(__m128i value, __m128i* previous)
+{
+	value = _mm_add_epi8(value, _mm_slli_si128(value, 4));
+	value = _mm_add_epi8(value, _mm_slli_si128(value, 8));
+	value = _mm_add_epi8(value, *previous);
+	*previous = _mm_shuffle_epi32(value, _MM_SHUFFLE(3, 3, 3, 3));
+	return value;
+}
+#endif
+
+// Turns the deltas of four consecutive bytes of each vertex into values, writing them to out with the vertex stride.
+static void DecodeDeltas4(const uint8_t (*deltas)[VERTEX_BLOCK_MAX_SIZE], size_t count, size_t stride, uint8_t* out, uint8_t* last)
+{
+#ifdef MESHOPT_DECODING_SSE2
+	// Bytes are added lane by lane without carries, so four bytes of 16 vertices can be summed at once.
+	uint32_t last_bytes;
+	std::memcpy(&last_bytes, last, sizeof(last_bytes));
+	__m128i previous = _mm_set1_epi32((int)last_bytes);
+	for (size_t i = 0; i < count; i += BYTE_GROUP_SIZE) {
+		__m128i byte_0 = Unzigzag8(_mm_loadu_si128((const __m128i*)&deltas[0][i]));
+		__m128i byte_1 = Unzigzag8(_mm_loadu_si128((const __m128i*)&deltas[1][i]));
+		__m128i byte_2 = Unzigzag8(_mm_loadu_si128((const __m128i*)&deltas[2][i]));
+		__m128i byte_3 = Unzigzag8(_mm_loadu_si128((const __m128i*)&deltas[3][i]));
+
+		// Transpose into four bytes per vertex.
+		__m128i bytes_01_low = _mm_unpacklo_epi8(byte_0, byte_1);
+		__m128i bytes_01_high = _mm_unpackhi_epi8(byte_0, byte_1);
+		__m128i bytes_23_low = _mm_unpacklo_epi8(byte_2, byte_3);
+		__m128i bytes_23_high = _mm_unpackhi_epi8(byte_2, byte_3);
+		alignas(16) uint32_t vertices[BYTE_GROUP_SIZE];
+		_mm_store_si128((__m128i*)&vertices[0], PrefixSum4(_mm_unpacklo_epi16(bytes_01_low, bytes_23_low), &previous));
+		_mm_store_si128((__m128i*)&vertices[4], PrefixSum4(_mm_unpackhi_epi16(bytes_01_low, bytes_23_low), &previous));
+		_mm_store_si128((__m128i*)&vertices[8], PrefixSum4(_mm_unpacklo_epi16(bytes_01_high, bytes_23_high), &previous));
+		_mm_store_si128((__m128i*)&vertices[12], PrefixSum4(_mm_unpackhi_epi16(bytes_01_high, bytes_23_high), &previous));
+
+		size_t group_count = std::min(count - i, BYTE_GROUP_SIZE);
+		for (size_t j = 0; j < group_count; j++) {
+			std::memcpy(out + (i + j) * stride, &vertices[j], sizeof(uint32_t));
+		}
+		if (group_count < BYTE_GROUP_SIZE) {
+			previous = _mm_set1_epi32((int)vertices[group_count - 1]);
+		}
+	}
+	last_bytes = (uint32_t)_mm_cvtsi128_si32(previous);
+	std::memcpy(last, &last_bytes, sizeof(last_bytes));
+#else
+	for (int k = 0; k < 4; k++) {
+		uint8_t previous = last[k];
+		for (size_t i = 0; i < count; i++) {
+			uint8_t delta = deltas[k][i];
+			previous += (uint8_t)(-(delta & 1) ^ (delta >> 1));
+			out[i * stride + k] = previous;
+		}
+		last[k] = previous;
+	}
+#endif
+}
+
+static const uint8_t* DecodeVertexBlock(const uint8_t* data, const uint8_t* end, uint8_t* out, size_t count, size_t stride, uint8_t* last_vertex)
+{
+	uint8_t deltas[4][VERTEX_BLOCK_MAX_SIZE];
+	size_t aligned_count = (count + BYTE_GROUP_SIZE - 1) & ~(BYTE_GROUP_SIZE - 1);
+	for (size_t k = 0; k < stride; k += 4) {
+		for (int j = 0; j < 4; j++) {
+			data = DecodeBytes(data, end, deltas[j], aligned_count);
+			if (!data) {
+				return nullptr;
+			}
+		}
+		DecodeDeltas4(deltas, count, stride, out + k, last_vertex + k);
+	}
+	return data;
+}
+
+bool DecodeMeshoptVertices(void* out, size_t count, size_t stride, const uint8_t* data, size_t size)
+{
+	ProfileZoneScoped();
+	if (stride == 0 || stride > VERTEX_BLOCK_MAX_SIZE || stride % 4 != 0) {
+		return false;
+	}
+	if (size < 1 + stride || data[0] != VERTEX_HEADER) {
+		return false;
+	}
+	const uint8_t* end = data + size;
+	data++;
+
+	// The tail holds the first vertex, which the first deltas are relative to.
+	uint8_t last_vertex[VERTEX_BLOCK_MAX_SIZE];
+	std::memcpy(last_vertex, end - stride, stride);
+	size_t block_size = GetVertexBlockSize(stride);
+	for (size_t offset = 0; offset < count; offset += block_size) {
+		data = DecodeVertexBlock(data, end, (uint8_t*)out + offset * stride, std::min(block_size, count - offset), stride, last_vertex);
+		if (!data) {
+			return false;
+		}
+	}
+	return size_t(end - data) == std::max(stride, TAIL_MIN_SIZE);
+}
+
+// Index codecs.
+// Indices are mostly encoded as references to recently seen edges and vertices, falling back to deltas from the last explicit index.
+
+static constexpr uint8_t TRIANGLE_HEADER = 0xe0;
+static constexpr uint8_t SEQUENCE_HEADER = 0xd0;
+
+static uint32_t DecodeVByte(const uint8_t** data)
+{
+	const uint8_t* bytes = *data;
+	uint8_t lead = *bytes++;
+	uint32_t result = lead & 127;
+	if (lead >= 128) {
+		uint32_t shift = 7;
+		for (int i = 0; i < 4; i++) {
+			uint8_t group = *bytes++;
+			result |= uint32_t(group & 127) << shift;
+			shift += 7;
+			if (group < 128) {
+				break;
+			}
+		}
+	}
+	*data = bytes;
+	return result;
+}
+
+static uint32_t DecodeIndex(const uint8_t** data, uint32_t last)
+{
+	uint32_t value = DecodeVByte(data);
+	uint32_t delta = (value >> 1) ^ -int32_t(value & 1);
+	return last + delta;
+}
+
+static void WriteIndex(void* out, size_t i, size_t index_size, uint32_t index)
+{
+	if (index_size == 2) {
+		((uint16_t*)out)[i] = (uint16_t)index;
+	} else {
+		((uint32_t*)out)[i] = index;
+	}
+}
+
+struct TriangleFifos {
+	uint32_t vertices[16];
+	uint32_t edges[16][2];
+	uint32_t vertex_offset = 0;
+	uint32_t edge_offset = 0;
+
+	uint32_t GetVertex(uint32_t age) const
+	{
+		return this->vertices[(this->vertex_offset - 1 - age) & 15];
+	}
+
+	void PushVertex(uint32_t vertex, bool condition = true)
+	{
+		this->vertices[this->vertex_offset] = vertex;
+		this->vertex_offset = (this->vertex_offset + (condition ? 1 : 0)) & 15;
+	}
+
+	void PushEdge(uint32_t a, uint32_t b)
+	{
+		this->edges[this->edge_offset][0] = a;
+		this->edges[this->edge_offset][1] = b;
+		this->edge_offset = (this->edge_offset + 1) & 15;
+	}
+};
+
+bool DecodeMeshoptTriangles(void* out, size_t count, size_t index_size, const uint8_t* data, size_t size)
+{
+	ProfileZoneScoped();
+	if (count % 3 != 0 || (index_size != 2 && index_size != 4)) {
+		return false;
+	}
+	// One code per triangle, followed by the extra data and a 16 byte table of common codes.
+	if (size < 1 + count / 3 + 16 || (data[0] & 0xf0) != TRIANGLE_HEADER) {
+		return false;
+	}
+	int version = data[0] & 0x0f;
+	if (version > 1) {
+		return false;
+	}
+
+	TriangleFifos fifos;
+	std::memset(fifos.vertices, -1, sizeof(fifos.vertices));
+	std::memset(fifos.edges, -1, sizeof(fifos.edges));
+	uint32_t next = 0;
+	uint32_t last = 0;
+	// Version 1 uses codes 13 and 14 for the last index minus and plus one.
+	int vertex_fifo_max = version >= 1 ? 13 : 15;
+
+	const uint8_t* codes = data + 1;
+	const uint8_t* extra = codes + count / 3;
+	const uint8_t* extra_end = data + size - 16;
+	const uint8_t* code_table = extra_end;
+
+	for (size_t i = 0; i < count; i += 3) {
+		if (extra > extra_end) {
+			return false;
+		}
+		uint8_t code = *codes++;
+		uint32_t a, b, c;
+		if (code < 0xf0) {
+			// Reuses an edge from the edge FIFO.
+			int edge_age = code >> 4;
+			a = fifos.edges[(fifos.edge_offset - 1 - edge_age) & 15][0];
+			b = fifos.edges[(fifos.edge_offset - 1 - edge_age) & 15][1];
+			int vertex_age = code & 15;
+			if (vertex_age < vertex_fifo_max) {
+				c = vertex_age == 0 ? next++ : fifos.GetVertex(vertex_age);
+				fifos.PushVertex(c, vertex_age == 0);
+			} else {
+				// Decodes 13 and 14 into -1 and 1.
+				c = last = vertex_age != 15 ? last + (vertex_age - (vertex_age ^ 3)) : DecodeIndex(&extra, last);
+				fifos.PushVertex(c);
+			}
+			fifos.PushEdge(c, b);
+			fifos.PushEdge(a, c);
+		} else {
+			// A new triangle, where the first vertex is the next one or a free index.
+			uint8_t code_aux;
+			int a_age;
+			if (code < 0xfe) {
+				code_aux = code_table[code & 15];
+				a_age = 0;
+			} else {
+				code_aux = *extra++;
+				a_age = code == 0xfe ? 0 : 15;
+				// A full byte of zeros resets the next index.
+				if (code_aux == 0) {
+					next = 0;
+				}
+			}
+			int b_age = code_aux >> 4;
+			int c_age = code_aux & 15;
+			a = a_age == 0 ? next++ : 0;
+			b = b_age == 0 ? next++ : fifos.vertices[(fifos.vertex_offset - b_age) & 15];
+			c = c_age == 0 ? next++ : fifos.vertices[(fifos.vertex_offset - c_age) & 15];
+			if (a_age == 15) {
+				last = a = DecodeIndex(&extra, last);
+			}
+			if (b_age == 15) {
+				last = b = DecodeIndex(&extra, last);
+			}
+			if (c_age == 15) {
+				last = c = DecodeIndex(&extra, last);
+			}
+			fifos.PushVertex(a);
+			fifos.PushVertex(b, b_age == 0 || b_age == 15);
+			fifos.PushVertex(c, c_age == 0 || c_age == 15);
+			fifos.PushEdge(b, a);
+			fifos.PushEdge(c, b);
+			fifos.PushEdge(a, c);
+		}
+		WriteIndex(out, i + 0, index_size, a);
+		WriteIndex(out, i + 1, index_size, b);
+		WriteIndex(out, i + 2, index_size, c);
+	}
+	// All of the extra data should have been read, stopping at the code table.
+	return extra == extra_end;
+}
+
+bool DecodeMeshoptIndices(void* out, size_t count, size_t index_size, const uint8_t* data, size_t size)
+{
+	ProfileZoneScoped();
+	if (index_size != 2 && index_size != 4) {
+		return false;
+	}
+	// At least a byte per index, followed by 4 bytes of padding.
+	if (size < 1 + count + 4 || (data[0] & 0xf0) != SEQUENCE_HEADER) {
+		return false;
+	}
+	int version = data[0] & 0x0f;
+	if (version > 1) {
+		return false;
+	}
+	const uint8_t* end = data + size - 4;
+	data++;
+	// Each index is a delta from one of two previous indices, picked by the lowest bit.
+	uint32_t last[2] = {};
+	for (size_t i = 0; i < count; i++) {
+		if (data >= end) {
+			return false;
+		}
+		uint32_t value = DecodeVByte(&data);
+		uint32_t baseline = value & 1;
+		value >>= 1;
+		uint32_t index = last[baseline] + ((value >> 1) ^ -int32_t(value & 1));
+		last[baseline] = index;
+		WriteIndex(out, i, index_size, index);
+	}
+	return data == end;
+}
+
+// Filters.
+// Float math is done in the same order in the scalar and SIMD versions, so they round identically.
+
+template<typename T>
+static void DecodeOctahedralFilterScalar(T* data, size_t count)
+{
+	constexpr float MAX = float((1 << (sizeof(T) * 8 - 1)) - 1);
+	for (size_t i = 0; i < count; i++) {
+		// z holds 1 in the same scale as x and y.
+		float x = float(data[i * 4 + 0]);
+		float y = float(data[i * 4 + 1]);
+		float z = float(data[i * 4 + 2]) - std::fabs(x) - std::fabs(y);
+		// Unfold the lower half of the octahedron.
+		float t = z < 0.0f ? z : 0.0f;
+		x -= x >= 0.0f ? t : -t;
+		y -= y >= 0.0f ? t : -t;
+		float length = std::sqrt(x * x + y * y + z * z);
+		float scale = MAX / length;
+		data[i * 4 + 0] = T(int(x * scale + (x >= 0.0f ? 0.5f : -0.5f)));
+		data[i * 4 + 1] = T(int(y * scale + (y >= 0.0f ? 0.5f : -0.5f)));
+		data[i * 4 + 2] = T(int(z * scale + (z >= 0.0f ? 0.5f : -0.5f)));
+	}
+}
+
+static void DecodeQuaternionFilterScalar(int16_t* data, size_t count)
+{
+	const float SCALE = 1.0f / std::sqrt(2.0f);
+	for (size_t i = 0; i < count; i++) {
+		// The largest component is left out. Its index is in the low 2 bits of w, and the scale of the others in the high bits.
+		int scale_bits = data[i * 4 + 3] | 3;
+		float scale = SCALE / float(scale_bits);
+		float x = float(data[i * 4 + 0]) * scale;
+		float y = float(data[i * 4 + 1]) * scale;
+		float z = float(data[i * 4 + 2]) * scale;
+		float ww = 1.0f - x * x - y * y - z * z;
+		float w = std::sqrt(ww >= 0.0f ? ww : 0.0f);
+		int largest = data[i * 4 + 3] & 3;
+		int16_t xi = int16_t(int(x * 32767.0f + (x >= 0.0f ? 0.5f : -0.5f)));
+		int16_t yi = int16_t(int(y * 32767.0f + (y >= 0.0f ? 0.5f : -0.5f)));
+		int16_t zi = int16_t(int(z * 32767.0f + (z >= 0.0f ? 0.5f : -0.5f)));
+		int16_t wi = int16_t(int(w * 32767.0f + 0.5f));
+		data[i * 4 + ((largest + 1) & 3)] = xi;
+		data[i * 4 + ((largest + 2) & 3)] = yi;
+		data[i * 4 + ((largest + 3) & 3)] = zi;
+		data[i * 4 + ((largest + 0) & 3)] = wi;
+	}
+}
+
+static void DecodeExponentialFilterScalar(uint32_t* data, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		// A 24 bit signed mantissa and an 8 bit signed exponent.
+		uint32_t value = data[i];
+		int mantissa = int32_t(value << 8) >> 8;
+		int exponent = int32_t(value) >> 24;
+		uint32_t power_bits = uint32_t(exponent + 127) << 23;
+		float power;
+		std::memcpy(&power, &power_bits, sizeof(power));
+		float result = power * float(mantissa);
+		std::memcpy(&data[i], &result, sizeof(result));
+	}
+}
+
+#ifdef MESHOPT_DECODING_SSE2
+// Returns 0.5 with the sign of value, as the scalar rounding does.
+static __m128 GetRoundingBias(__m128 value)
+{
+	__m128 negative = _mm_cmplt_ps(value, _mm_setzero_ps());
+	return _mm_or_ps(_mm_set1_ps(0.5f), _mm_and_ps(negative, _mm_set1_ps(-0.0f)));
+}
+
+static __m128i RoundToInt(__m128 value, __m128 scale)
+{
+	return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), GetRoundingBias(value)));
+}
+
+static __m128 Abs(__m128 value)
+{
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), value);
+}
+
+// Decodes four octahedral vectors, where x, y and z are sign extended integers.
+static void DecodeOctahedral4(__m128i xi, __m128i yi, __m128i zi, float max, __m128i* x_out, __m128i* y_out, __m128i* z_out)
+{
+	__m128 x = _mm_cvtepi32_ps(xi);
+	__m128 y = _mm_cvtepi32_ps(yi);
+	__m128 z = _mm_sub_ps(_mm_sub_ps(_mm_cvtepi32_ps(zi), Abs(x)), Abs(y));
+	__m128 t = _mm_and_ps(_mm_cmplt_ps(z, _mm_setzero_ps()), z);
+	__m128 sign = _mm_set1_ps(-0.0f);
+	x = _mm_sub_ps(x, _mm_xor_ps(t, _mm_and_ps(_mm_cmplt_ps(x, _mm_setzero_ps()), sign)));
+	y = _mm_sub_ps(y, _mm_xor_ps(t, _mm_and_ps(_mm_cmplt_ps(y, _mm_setzero_ps()), sign)));
+	__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+	__m128 scale = _mm_div_ps(_mm_set1_ps(max), length);
+	*x_out = RoundToInt(x, scale);
+	*y_out = RoundToInt(y, scale);
+	*z_out = RoundToInt(z, scale);
+}
+
+static size_t DecodeOctahedralFilter8(int8_t* data, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i vertices = _mm_loadu_si128((const __m128i*)&data[i * 4]);
+		__m128i x = _mm_srai_epi32(_mm_slli_epi32(vertices, 24), 24);
+		__m128i y = _mm_srai_epi32(_mm_slli_epi32(vertices, 16), 24);
+		__m128i z = _mm_srai_epi32(_mm_slli_epi32(vertices, 8), 24);
+		DecodeOctahedral4(x, y, z, 127.0f, &x, &y, &z);
+		__m128i low_byte = _mm_set1_epi32(0xff);
+		__m128i result = _mm_and_si128(vertices, _mm_set1_epi32((int)0xff000000));
+		result = _mm_or_si128(result, _mm_and_si128(x, low_byte));
+		result = _mm_or_si128(result, _mm_slli_epi32(_mm_and_si128(y, low_byte), 8));
+		result = _mm_or_si128(result, _mm_slli_epi32(_mm_and_si128(z, low_byte), 16));
+		_mm_storeu_si128((__m128i*)&data[i * 4], result);
+	}
+	return i;
+}
+
+// Splits four 16 bit vectors into their xy and zw halves, one vector per 32 bit lane.
+static void Load4x16(const int16_t* data, __m128i* xy, __m128i* zw)
+{
+	__m128 vertices_01 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)&data[0]));
+	__m128 vertices_23 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)&data[8]));
+	*xy = _mm_castps_si128(_mm_shuffle_ps(vertices_01, vertices_23, _MM_SHUFFLE(2, 0, 2, 0)));
+	*zw = _mm_castps_si128(_mm_shuffle_ps(vertices_01, vertices_23, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+static size_t DecodeOctahedralFilter16(int16_t* data, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i xy, zw;
+		Load4x16(&data[i * 4], &xy, &zw);
+		__m128i x = _mm_srai_epi32(_mm_slli_epi32(xy, 16), 16);
+		__m128i y = _mm_srai_epi32(xy, 16);
+		__m128i z = _mm_srai_epi32(_mm_slli_epi32(zw, 16), 16);
+		DecodeOctahedral4(x, y, z, 32767.0f, &x, &y, &z);
+		__m128i low_short = _mm_set1_epi32(0xffff);
+		xy = _mm_or_si128(_mm_and_si128(x, low_short), _mm_slli_epi32(y, 16));
+		zw = _mm_or_si128(_mm_and_si128(z, low_short), _mm_andnot_si128(low_short, zw));
+		_mm_storeu_si128((__m128i*)&data[i * 4], _mm_unpacklo_epi32(xy, zw));
+		_mm_storeu_si128((__m128i*)&data[i * 4 + 8], _mm_unpackhi_epi32(xy, zw));
+	}
+	return i;
+}
+
+static size_t DecodeQuaternionFilter(int16_t* data, size_t count)
+{
+	const float SCALE = 1.0f / std::sqrt(2.0f);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i xy, zw;
+		Load4x16(&data[i * 4], &xy, &zw);
+		__m128i w_bits = _mm_srai_epi32(zw, 16);
+		__m128 scale = _mm_div_ps(_mm_set1_ps(SCALE), _mm_cvtepi32_ps(_mm_or_si128(w_bits, _mm_set1_epi32(3))));
+		__m128 x = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(xy, 16), 16)), scale);
+		__m128 y = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(xy, 16)), scale);
+		__m128 z = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(zw, 16), 16)), scale);
+		__m128 ww = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(x, x)), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+		__m128 w = _mm_sqrt_ps(_mm_max_ps(ww, _mm_setzero_ps()));
+		__m128 max = _mm_set1_ps(32767.0f);
+		alignas(16) int32_t xi[4], yi[4], zi[4], wi[4], largest[4];
+		_mm_store_si128((__m128i*)xi, RoundToInt(x, max));
+		_mm_store_si128((__m128i*)yi, RoundToInt(y, max));
+		_mm_store_si128((__m128i*)zi, RoundToInt(z, max));
+		_mm_store_si128((__m128i*)wi, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(w, max), _mm_set1_ps(0.5f))));
+		_mm_store_si128((__m128i*)largest, _mm_and_si128(w_bits, _mm_set1_epi32(3)));
+		// The order of the components depends on which one was left out, which varies per vertex.
+		for (int j = 0; j < 4; j++) {
+			int16_t* vertex = &data[(i + j) * 4];
+			vertex[(largest[j] + 1) & 3] = (int16_t)xi[j];
+			vertex[(largest[j] + 2) & 3] = (int16_t)yi[j];
+			vertex[(largest[j] + 3) & 3] = (int16_t)zi[j];
+			vertex[(largest[j] + 0) & 3] = (int16_t)wi[j];
+		}
+	}
+	return i;
+}
+
+static size_t DecodeExponentialFilter(uint32_t* data, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i values = _mm_loadu_si128((const __m128i*)&data[i]);
+		__m128i mantissa = _mm_srai_epi32(_mm_slli_epi32(values, 8), 8);
+		__m128i exponent = _mm_srai_epi32(values, 24);
+		__m128 power = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(exponent, _mm_set1_epi32(127)), 23));
+		_mm_storeu_ps((float*)&data[i], _mm_mul_ps(power, _mm_cvtepi32_ps(mantissa)));
+	}
+	return i;
+}
+#endif
+
+void DecodeMeshoptFilterScalar(MeshoptFilter filter, void* data, size_t count, size_t stride)
+{
+	ProfileZoneScoped();
+	switch (filter) {
+		case MESHOPT_FILTER_NONE: {
+		} break;
+		case MESHOPT_FILTER_OCTAHEDRAL: {
+			assert(stride == 4 || stride == 8);
+			if (stride == 4) {
+				DecodeOctahedralFilterScalar((int8_t*)data, count);
+			} else {
+				DecodeOctahedralFilterScalar((int16_t*)data, count);
+			}
+		} break;
+		case MESHOPT_FILTER_QUATERNION: {
+			assert(stride == 8);
+			DecodeQuaternionFilterScalar((int16_t*)data, count);
+		} break;
+		case MESHOPT_FILTER_EXPONENTIAL: {
+			assert(stride % 4 == 0);
+			DecodeExponentialFilterScalar((uint32_t*)data, count * stride / 4);
+		} break;
+	}
+}
+
+void DecodeMeshoptFilter(MeshoptFilter filter, void* data, size_t count, size_t stride)
+{
+#ifdef MESHOPT_DECODING_SSE2
+	ProfileZoneScoped();
+	// Whatever doesn't fill a full register is left to the scalar version.
+	switch (filter) {
+		case MESHOPT_FILTER_NONE: {
+		} break;
+		case MESHOPT_FILTER_OCTAHEDRAL: {
+			assert(stride == 4 || stride == 8);
+			if (stride == 4) {
+				size_t done = DecodeOctahedralFilter8((int8_t*)data, count);
+				DecodeOctahedralFilterScalar((int8_t*)data + done * 4, count - done);
+			} else {
+				size_t done = DecodeOctahedralFilter16((int16_t*)data, count);
+				DecodeOctahedralFilterScalar((int16_t*)data + done * 4, count - done);
+			}
+		} break;
+		case MESHOPT_FILTER_QUATERNION: {
+			assert(stride == 8);
+			size_t done = DecodeQuaternionFilter((int16_t*)data, count);
+			DecodeQuaternionFilterScalar((int16_t*)data + done * 4, count - done);
+		} break;
+		case MESHOPT_FILTER_EXPONENTIAL: {
+			assert(stride % 4 == 0);
+			size_t word_count = count * stride / 4;
+			size_t done = DecodeExponentialFilter((uint32_t*)data, word_count);
+			DecodeExponentialFilterScalar((uint32_t*)data + done, word_count - done);
+		} break;
+	}
+#else
+	DecodeMeshoptFilterScalar(filter, data, count, stride);
+#endif
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Decoders for buffer views compressed with EXT_meshopt_compression.
+// Each decoder returns false if the data is malformed, in which case the contents of the output are undefined.
+
+enum MeshoptFilter {
+    MESHOPT_FILTER_NONE,
+    MESHOPT_FILTER_OCTAHEDRAL, // 8 or 16 bit normals and tangents, with a stride of 4 or 8.
+    MESHOPT_FILTER_QUATERNION, // 16 bit rotations, with a stride of 8.
+    MESHOPT_FILTER_EXPONENTIAL, // 32 bit floats, with a stride that is a multiple of 4.
+};
+
+// Decodes count vertices of stride bytes. The stride must be a multiple of 4 and at most 256.
+bool DecodeMeshoptVertices(void* out, size_t count, size_t stride, const uint8_t* data, size_t size);
+// Decodes a triangle list of count indices, which must be a multiple of 3. The index size is 2 or 4 bytes.
+bool DecodeMeshoptTriangles(void* out, size_t count, size_t index_size, const uint8_t* data, size_t size);
+// Decodes count indices with no particular topology. The index size is 2 or 4 bytes.
+bool DecodeMeshoptIndices(void* out, size_t count, size_t index_size, const uint8_t* data, size_t size);
+
+// Applies a filter in place to count decoded vertices.
+void DecodeMeshoptFilter(MeshoptFilter filter, void* data, size_t count, size_t stride);
+// Scalar version of DecodeMeshoptFilter. Results are bit identical.
+void DecodeMeshoptFilterScalar(MeshoptFilter filter, void* data, size_t count, size_t stride);
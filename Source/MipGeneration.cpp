@@ -0,0 +1,243 @@
+#include "MipGeneration.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "Profiling.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_GENERATION_SSE2
+#include <emmintrin.h>
+#endif
+
+// Lookup tables for filtering sRGB images in linear space.
+struct ConversionTables {
+	float srgb_to_linear[256];
+	float unorm_to_float[256];
+	uint8_t linear_to_srgb[65536]; // Indexed by linear * 65535.
+
+	ConversionTables()
+	{
+		for (int i = 0; i < 256; i++) {
+			float c = i / 255.0f;
+			srgb_to_linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			unorm_to_float[i] = c;
+		}
+		for (int i = 0; i < 65536; i++) {
+			float c = i / 65535.0f;
+			float srgb = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+			linear_to_srgb[i] = (uint8_t)std::lrint(std::clamp(srgb, 0.0f, 1.0f) * 255.0f);
+		}
+	}
+};
+
+static const ConversionTables& GetConversionTables()
+{
+	static const ConversionTables tables;
+	return tables;
+}
+
+static void DownsampleTexelUnorm(const uint8_t* a, const uint8_t* b, const uint8_t* c, const uint8_t* d, uint8_t* dest)
+{
+	for (int i = 0; i < 4; i++) {
+		dest[i] = (a[i] + b[i] + c[i] + d[i] + 2) >> 2;
+	}
+}
+
+static void DownsampleTexelSrgb(const ConversionTables& tables, const uint8_t* a, const uint8_t* b, const uint8_t* c, const uint8_t* d, uint8_t* dest)
+{
+	for (int i = 0; i < 3; i++) {
+		float linear = ((tables.srgb_to_linear[a[i]] + tables.srgb_to_linear[b[i]]) + (tables.srgb_to_linear[c[i]] + tables.srgb_to_linear[d[i]])) * 0.25f;
+		dest[i] = tables.linear_to_srgb[std::lrint(linear * 65535.0f)];
+	}
+	float alpha = ((tables.unorm_to_float[a[3]] + tables.unorm_to_float[b[3]]) + (tables.unorm_to_float[c[3]] + tables.unorm_to_float[d[3]])) * 0.25f;
+	dest[3] = (uint8_t)std::lrint(alpha * 255.0f);
+}
+
+#ifdef MIP_GENERATION_SSE2
+
+// Downsamples two texels at a time. Returns the number of texels written.
+static uint32_t DownsampleRowUnormSse2(const uint8_t* row_0, const uint8_t* row_1, uint32_t dest_width, uint8_t* dest)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i rounding = _mm_set1_epi16(2);
+	uint32_t x = 0;
+	for (; x + 2 <= dest_width; x += 2) {
+		__m128i top = _mm_loadu_si128((const __m128i*)(row_0 + x * 8));
+		__m128i bottom = _mm_loadu_si128((const __m128i*)(row_1 + x * 8));
+		// Sum vertically, giving source texels 0 and 1 in low and 2 and 3 in high.
+		__m128i low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+		__m128i high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+		// Sum horizontally.
+		__m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+		sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+		_mm_storel_epi64((__m128i*)(dest + x * 4), _mm_packus_epi16(sum, sum));
+	}
+	return x;
+}
+
+static __m128 LoadLinearTexel(const ConversionTables& tables, const uint8_t* texel)
+{
+	return _mm_setr_ps(tables.srgb_to_linear[texel[0]], tables.srgb_to_linear[texel[1]], tables.srgb_to_linear[texel[2]], tables.unorm_to_float[texel[3]]);
+}
+
+// Matches DownsampleTexelSrgb exactly. Returns the number of texels written.
+static uint32_t DownsampleRowSrgbSse2(const ConversionTables& tables, const uint8_t* row_0, const uint8_t* row_1, uint32_t dest_width, uint8_t* dest)
+{
+	const __m128 quarter = _mm_set1_ps(0.25f);
+	const __m128 scale = _mm_setr_ps(65535.0f, 65535.0f, 65535.0f, 255.0f);
+	alignas(16) int32_t indices[4];
+	for (uint32_t x = 0; x < dest_width; x++) {
+		__m128 top = _mm_add_ps(LoadLinearTexel(tables, row_0 + x * 8), LoadLinearTexel(tables, row_0 + x * 8 + 4));
+		__m128 bottom = _mm_add_ps(LoadLinearTexel(tables, row_1 + x * 8), LoadLinearTexel(tables, row_1 + x * 8 + 4));
+		__m128 average = _mm_mul_ps(_mm_add_ps(top, bottom), quarter);
+		_mm_store_si128((__m128i*)indices, _mm_cvtps_epi32(_mm_mul_ps(average, scale)));
+		dest[x * 4 + 0] = tables.linear_to_srgb[indices[0]];
+		dest[x * 4 + 1] = tables.linear_to_srgb[indices[1]];
+		dest[x * 4 + 2] = tables.linear_to_srgb[indices[2]];
+		dest[x * 4 + 3] = (uint8_t)indices[3];
+	}
+	return dest_width;
+}
+
+#endif
+
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t levels = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size /= 2) {
+		levels++;
+	}
+	return levels;
+}
+
+uint64_t GetMipChainSize(uint32_t width, uint32_t height)
+{
+	uint64_t size = 0;
+	uint32_t levels = GetMipLevelCount(width, height);
+	for (uint32_t i = 0; i < levels; i++) {
+		size += (uint64_t)width * height * 4;
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
+	return size;
+}
+
+void DownsampleRgba8(const uint8_t* source, uint32_t width, uint32_t height, bool srgb, uint8_t* dest)
+{
+	ProfileZoneScoped();
+	const ConversionTables& tables = GetConversionTables();
+	uint32_t dest_width = std::max(width / 2, 1u);
+	uint32_t dest_height = std::max(height / 2, 1u);
+	for (uint32_t y = 0; y < dest_height; y++) {
+		// Odd sizes drop the last row or column. Images that are one texel wide or high repeat it instead.
+		const uint8_t* row_0 = source + (uint64_t)std::min(2 * y, height - 1) * width * 4;
+		const uint8_t* row_1 = source + (uint64_t)std::min(2 * y + 1, height - 1) * width * 4;
+		uint8_t* dest_row = dest + (uint64_t)y * dest_width * 4;
+		uint32_t x = 0;
+#ifdef MIP_GENERATION_SSE2
+		if (width >= 2) {
+			x = srgb ? DownsampleRowSrgbSse2(tables, row_0, row_1, dest_width, dest_row) : DownsampleRowUnormSse2(row_0, row_1, dest_width, dest_row);
+		}
+#endif
+		for (; x < dest_width; x++) {
+			uint32_t x_0 = std::min(2 * x, width - 1) * 4;
+			uint32_t x_1 = std::min(2 * x + 1, width - 1) * 4;
+			if (srgb) {
+				DownsampleTexelSrgb(tables, row_0 + x_0, row_0 + x_1, row_1 + x_0, row_1 + x_1, dest_row + x * 4);
+			} else {
+				DownsampleTexelUnorm(row_0 + x_0, row_0 + x_1, row_1 + x_0, row_1 + x_1, dest_row + x * 4);
+			}
+		}
+	}
+}
+
+// Number of texels with each alpha value.
+static void GetAlphaHistogram(const uint8_t* image, uint64_t texel_count, uint64_t* histogram)
+{
+	std::fill(histogram, histogram + 256, 0);
+	for (uint64_t i = 0; i < texel_count; i++) {
+		histogram[image[i * 4 + 3]]++;
+	}
+}
+
+static float GetAlphaCoverage(const uint64_t* histogram, uint64_t texel_count, float alpha_cutoff)
+{
+	uint64_t covered = 0;
+	for (int i = 0; i < 256; i++) {
+		covered += i / 255.0f > alpha_cutoff ? histogram[i] : 0;
+	}
+	return (float)covered / texel_count;
+}
+
+float GetAlphaCoverage(const uint8_t* image, uint32_t width, uint32_t height, float alpha_cutoff)
+{
+	uint64_t histogram[256];
+	uint64_t texel_count = (uint64_t)width * height;
+	GetAlphaHistogram(image, texel_count, histogram);
+	return GetAlphaCoverage(histogram, texel_count, alpha_cutoff);
+}
+
+void PreserveAlphaCoverage(uint8_t* image, uint32_t width, uint32_t height, float alpha_cutoff, float coverage)
+{
+	ProfileZoneScoped();
+	uint64_t histogram[256];
+	uint64_t texel_count = (uint64_t)width * height;
+	GetAlphaHistogram(image, texel_count, histogram);
+
+	// Find the cutoff that would give this level the wanted coverage.
+	// Coverage only gets smaller as the cutoff gets larger, so a binary search works.
+	float low = 0.0f;
+	float high = 1.0f;
+	float best_cutoff = alpha_cutoff;
+	float best_error = std::numeric_limits<float>::max();
+	for (int i = 0; i < 16; i++) {
+		float cutoff = (low + high) * 0.5f;
+		float level_coverage = GetAlphaCoverage(histogram, texel_count, cutoff);
+		float error = std::abs(level_coverage - coverage);
+		if (error < best_error) {
+			best_error = error;
+			best_cutoff = cutoff;
+		}
+		if (level_coverage < coverage) {
+			high = cutoff;
+		} else {
+			low = cutoff;
+		}
+	}
+
+	// Scale alpha so that the found cutoff lands on the real one.
+	float scale = alpha_cutoff / best_cutoff;
+	uint8_t scaled[256];
+	for (int i = 0; i < 256; i++) {
+		scaled[i] = (uint8_t)std::min(std::lrint(i * scale), 255l);
+	}
+	for (uint64_t i = 0; i < texel_count; i++) {
+		image[i * 4 + 3] = scaled[image[i * 4 + 3]];
+	}
+}
+
+void GenerateMipChain(std::vector<unsigned char>* image, uint32_t width, uint32_t height, bool srgb, float alpha_cutoff)
+{
+	ProfileZoneScoped();
+	assert(image->size() == (uint64_t)width * height * 4);
+	image->resize(GetMipChainSize(width, height));
+	bool alpha_tested = alpha_cutoff > 0.0f && alpha_cutoff < 1.0f;
+	float coverage = alpha_tested ? GetAlphaCoverage(image->data(), width, height, alpha_cutoff) : 0.0f;
+
+	uint8_t* level = image->data();
+	uint32_t levels = GetMipLevelCount(width, height);
+	for (uint32_t i = 1; i < levels; i++) {
+		uint8_t* next_level = level + (uint64_t)width * height * 4;
+		DownsampleRgba8(level, width, height, srgb, next_level);
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+		if (alpha_tested) {
+			PreserveAlphaCoverage(next_level, width, height, alpha_cutoff, coverage);
+		}
+		level = next_level;
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// CPU mip generation for tightly packed RGBA8 images.
+// A mip chain stores every level one after the other, down to 1x1. Each level is half the size of the previous one, rounded down.
+
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+// Size in bytes of a full mip chain.
+uint64_t GetMipChainSize(uint32_t width, uint32_t height);
+// Box filters an image down to the next mip level. sRGB images are filtered in linear space. Alpha is always linear.
+void DownsampleRgba8(const uint8_t* source, uint32_t width, uint32_t height, bool srgb, uint8_t* dest);
+// Fraction of texels with an alpha above the cutoff.
+float GetAlphaCoverage(const uint8_t* image, uint32_t width, uint32_t height, float alpha_cutoff);
+// Scales alpha so that the fraction of texels passing the alpha test matches coverage as closely as possible.
+void PreserveAlphaCoverage(uint8_t* image, uint32_t width, uint32_t height, float alpha_cutoff, float coverage);
+// Appends every level below the first to an image. Pass a positive alpha cutoff to preserve alpha tested coverage.
+void GenerateMipChain(std::vector<unsigned char>* image, uint32_t width, uint32_t height, bool srgb, float alpha_cutoff);
@@ -144,19 +144,24 @@ void Pathtracer::BuildAllBlas(CommandContext* context, Gltf* gltf, RaytracingAcc
             Gltf::Mesh& mesh = gltf->meshes[mesh_id];
 			for (int j = 0; j < mesh.primitives.size(); j++) {
 				Gltf::Primitive& primitive = mesh.primitives[j];
+				if (!primitive.resident) {
+					continue;
+				}
 				int dynamic_meshes_id = node.dynamic_mesh;
 				if (dynamic_meshes_id != -1) {
 					// Dynamic.
 					DynamicMesh& dynamic_mesh = gltf->dynamic_primitives[dynamic_meshes_id].dynamic_meshes[j];
 					gltf->dynamic_primitives[dynamic_meshes_id].dynamic_blases.resize(gltf->dynamic_primitives[dynamic_meshes_id].dynamic_meshes.size());
 					RaytracingAccelerationStructure::DynamicBlas& dynamic_blas = gltf->dynamic_primitives[dynamic_meshes_id].dynamic_blases[j];
+					// Built from the skinned float positions that updates refit from, as the mesh's own positions may be quantized.
+					// Skinning runs before ray tracing, so they already hold this frame's pose.
 					if (!dynamic_blas.resource.resource.Get()) {
-						acceleration_structure->BuildDynamicBlas(context->command_list.Get(), primitive.mesh.position.view.BufferLocation, primitive.mesh.num_of_vertices, primitive.mesh.index.view, primitive.mesh.num_of_indices, &dynamic_blas);
+						acceleration_structure->BuildDynamicBlas(context->command_list.Get(), dynamic_mesh.GetCurrentPositionBuffer()->view.BufferLocation, primitive.mesh.num_of_vertices, primitive.mesh.index.view, primitive.mesh.num_of_indices, &dynamic_blas);
 					}
 				} else {
 					// Static.
 					if (!primitive.blas.resource.resource.Get()) {
-						acceleration_structure->BuildStaticBlas(context->command_list.Get(), primitive.mesh.position.view.BufferLocation, primitive.mesh.num_of_vertices, primitive.mesh.index.view, primitive.mesh.num_of_indices, &primitive.blas);
+						acceleration_structure->BuildStaticBlas(context->command_list.Get(), primitive.mesh.position.view.BufferLocation, Mesh::GetPositionFormat(primitive.mesh.flags), primitive.mesh.num_of_vertices, primitive.mesh.index.view, primitive.mesh.num_of_indices, &primitive.blas);
 					}
 				}
 			}
@@ -175,6 +180,9 @@ void Pathtracer::UpdateAllBlas(CommandContext* context, Gltf* gltf, RaytracingAc
 			std::vector<Gltf::Primitive>& primitives = gltf->meshes[mesh_id].primitives; 
 			Gltf::DynamicPrimitives& dynamic_primitives = gltf->dynamic_primitives[skin_id];
 			for (int j = 0; j < dynamic_primitives.dynamic_blases.size(); j++) {
+				if (!primitives[j].resident) {
+					continue;
+				}
 				acceleration_structure->UpdateDynamicBlas(context->command_list.Get(), &dynamic_primitives.dynamic_blases[j], dynamic_primitives.dynamic_meshes[j].GetCurrentPositionBuffer()->view.BufferLocation, primitives[j].mesh.num_of_vertices, primitives[j].mesh.index.view, primitives[j].mesh.num_of_indices);
 			}
         }
@@ -192,17 +200,24 @@ void Pathtracer::BuildTlas(CommandContext* context, Gltf* gltf, int scene_id, Ra
 		MASK_NONE = 1 << 0,
 		MASK_ALPHA_BLEND = 1 << 1,
 	};
-	gltf->TraverseScene(scene_id, [&](Gltf* gltf, int node_id) {
+	for (int node_id: gltf->scenes[scene_id].mesh_nodes) {
 		const Gltf::Node& node = gltf->nodes[node_id];
 		int mesh_id = node.mesh_id;
-		if (mesh_id != -1) {
-			std::vector<Gltf::Primitive>& primitives = gltf->meshes[mesh_id].primitives; 
+		std::vector<Gltf::Primitive>& primitives = gltf->meshes[mesh_id].primitives; 
+		// Every instance of an instanced node is a separate TLAS instance.
+		glm::mat4x4 global_transform = gltf->transforms.GetGlobalTransform(node_id);
+		size_t num_of_instances = std::max<size_t>(node.instances.size(), 1);
+		for (size_t j = 0; j < num_of_instances; j++) {
+			glm::mat4x4 transform = node.instances.empty() ? global_transform : global_transform * node.instances[j];
 			for (int i = 0; i < primitives.size(); i++) {
+				if (!primitives[i].resident) {
+					continue;
+				}
 				const Mesh& mesh = primitives[i].mesh;
 				const Gltf::Material& material = gltf->materials[primitives[i].material_id];
 				GpuMeshInstance gpu_mesh_instance = {
-					.transform = node.global_transform,
-					.normal_transform = glm::inverseTranspose(node.global_transform),
+					.transform = transform,
+					.normal_transform = glm::inverseTranspose(transform),
 					.index_descriptor = mesh.index.descriptor,
 					.position_descriptor = mesh.position.descriptor,
 					.tangent_space_descriptor = mesh.tangent_space.descriptor,
@@ -213,6 +228,14 @@ void Pathtracer::BuildTlas(CommandContext* context, Gltf* gltf, int scene_id, Ra
 					.color_descriptor = mesh.color.descriptor,
 					.material_id = primitives[i].material_id,
 				};
+				if (mesh.flags & Mesh::FLAG_QUANTIZED_POSITION) {
+					gpu_mesh_instance.position_scale = mesh.dequantization.position_scale;
+					gpu_mesh_instance.position_offset = mesh.dequantization.position_offset;
+				}
+				if (mesh.flags & Mesh::FLAG_QUANTIZED_ATTRIBUTES) {
+					gpu_mesh_instance.texcoord_transforms[0] = mesh.dequantization.texcoord_transforms[0];
+					gpu_mesh_instance.texcoord_transforms[1] = mesh.dequantization.texcoord_transforms[1];
+				}
 				unsigned int flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
 				if (material.flags & Gltf::Material::FLAG_DOUBLE_SIDED) {
 					flags |=  D3D12_RAYTRACING_INSTANCE_FLAG_TRIANGLE_CULL_DISABLE;
@@ -232,9 +255,11 @@ void Pathtracer::BuildTlas(CommandContext* context, Gltf* gltf, int scene_id, Ra
 						// Dynamic.
 						DynamicMesh& dynamic_mesh = gltf->dynamic_primitives[node.dynamic_mesh].dynamic_meshes[i];
 						RaytracingAccelerationStructure::DynamicBlas& dynamic_blas = gltf->dynamic_primitives[node.dynamic_mesh].dynamic_blases[i];
-						tlas_added = acceleration_structure->AddTlasInstance(&dynamic_blas, node.global_transform, instance_mask, flags);
+						tlas_added = acceleration_structure->AddTlasInstance(&dynamic_blas, transform, instance_mask, flags);
 						if (dynamic_mesh.flags & DynamicMesh::Flags::FLAG_POSITION) {
 							gpu_mesh_instance.position_descriptor = dynamic_mesh.GetCurrentPositionBuffer()->descriptor;
+							gpu_mesh_instance.position_scale = glm::vec3(1.0f);
+							gpu_mesh_instance.position_offset = glm::vec3(0.0f);
 						}
 						if (dynamic_mesh.flags & DynamicMesh::Flags::FLAG_TANGENT_SPACE) {
 							gpu_mesh_instance.tangent_space_descriptor = dynamic_mesh.tangent_space.descriptor;
@@ -242,15 +267,20 @@ void Pathtracer::BuildTlas(CommandContext* context, Gltf* gltf, int scene_id, Ra
 					}
 				} else {
 					// Static.
+					// Static BLASes are built from quantized positions as they are, so the instance dequantizes them.
 					RaytracingAccelerationStructure::Blas& blas = primitives[i].blas;
-					tlas_added = acceleration_structure->AddTlasInstance(&blas, node.global_transform, instance_mask, flags);
+					glm::mat4x4 blas_transform = transform;
+					if (mesh.flags & Mesh::FLAG_QUANTIZED_POSITION) {
+						blas_transform = blas_transform * mesh.dequantization.GetPositionTransform();
+					}
+					tlas_added = acceleration_structure->AddTlasInstance(&blas, blas_transform, instance_mask, flags);
 				}
 				if (tlas_added) {
 					mesh_instances.push_back(gpu_mesh_instance);
 				}
 			}
 		}
-	});
+	}
 
     acceleration_structure->BuildTlas(context->command_list.Get());
 	this->gpu_mesh_instances = context->AllocateAndCopy(mesh_instances.data(), sizeof(GpuMeshInstance) * mesh_instances.size(), 4);
@@ -137,6 +137,9 @@ class Pathtracer {
 		int texcoord_descriptors[2] = {-1, -1};
 		int color_descriptor = -1;
 		int material_id = 0;
+		glm::vec3 position_scale = glm::vec3(1.0f);
+		glm::vec3 position_offset = glm::vec3(0.0f);
+		glm::vec4 texcoord_transforms[2] = {glm::vec4(1.0f, 1.0f, 0.0f, 0.0f), glm::vec4(1.0f, 1.0f, 0.0f, 0.0f)};
 	};
     
     ShaderTableCollection shader_tables;
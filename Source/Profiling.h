@@ -21,6 +21,8 @@ namespace Profiling {
 #if TRACY_ENABLE
 #define ProfileZoneScoped() ZoneScopedS(Profiling::callstack_depth)
 #define ProfileZoneScopedN(name) ZoneScopedNS(name, Profiling::callstack_depth)
+#define ProfileZoneText(text, size) ZoneText(text, size)
+#define ProfileSetThreadName(name) tracy::SetThreadName(name)
 #define ProfileMarkFrame() FrameMark
 #define ProfilePlotBytes(name, bytes) TracyPlotConfig(name, tracy::PlotFormatType::Memory, true, true, 0); TracyPlot(name, bytes)
 #define ProfilePlotNumber(name, number) TracyPlotConfig(name, tracy::PlotFormatType::Number, true, true, 0); TracyPlot(name, number)
@@ -32,6 +34,8 @@ namespace Profiling {
 #else
 #define ProfileZoneScoped()
 #define ProfileZoneScopedN(name)
+#define ProfileZoneText(text, size)
+#define ProfileSetThreadName(name)
 #define ProfileMarkFrame()
 #define ProfilePlotBytes(name, bytes)
 #define ProfilePlotNumber(name, number)
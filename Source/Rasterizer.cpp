@@ -1,5 +1,6 @@
 #include "Rasterizer.h"
 #include <algorithm>
+#include <limits>
 
 #include <directx/d3dx12_barriers.h>
 #include <directx/d3dx12_core.h>
@@ -71,45 +72,71 @@ void Rasterizer::Resize(uint32_t width, uint32_t height)
     }
 }
 
-void Rasterizer::GatherRenderObjects(Gltf* gltf, int scene)
+void Rasterizer::GatherRenderObjects(Gltf* gltf, int scene, glm::vec3 camera_pos, glm::mat4x4 view_to_clip, float lod_pixel_error)
 {
 	opaque_render_objects.clear();
 	alpha_mask_render_objects.clear();
 	alpha_render_objects.clear();
 	transparent_render_objects.clear();
 
-	gltf->TraverseScene(scene, [&](Gltf* gltf, int node_id) {
+	// Pixels covered by one unit of length one unit in front of a perspective camera, or at any distance from an orthographic camera.
+	bool perspective = view_to_clip[3][3] == 0.0f;
+	float pixels_per_unit = view_to_clip[1][1] * this->height * 0.5f;
+
+	for (int node_id: gltf->scenes[scene].mesh_nodes) {
 		const Gltf::Node& node = gltf->nodes[node_id];
-		if (node.mesh_id != -1) {
-			const Gltf::Mesh& mesh = gltf->meshes[node.mesh_id];
-			for (int i = 0; i < mesh.primitives.size(); i++) {
-
-				// Gather the data needed to render an object.
-				int material_id = mesh.primitives[i].material_id;
-				RenderObject render_object = {
-					.transform = node.global_transform,
-					.normal_transform = glm::inverseTranspose(glm::mat3x3(node.global_transform)),
-					.previous_transform = node.previous_global_transform,
-					.mesh_id = node.mesh_id,
-					.dynamic_mesh_id = node.dynamic_mesh,
-					.primitive_id = i,
-					.material_id = material_id,
-				};
-
-				// Bin the render object depending on material properties.
-				const Gltf::Material& material = gltf->materials[material_id];
-				if (material.alpha_mode == Gltf::Material::ALPHA_MODE_BLEND) {
-					alpha_render_objects.push_back(render_object);
-				} else if (material.alpha_mode == Gltf::Material::ALPHA_MODE_MASK) {
-					alpha_mask_render_objects.push_back(render_object);
-				} else if (material.transmission_factor > 0.0f) {
-					transparent_render_objects.push_back(render_object);
-				} else {
-					opaque_render_objects.push_back(render_object);
+		const Gltf::Mesh& mesh = gltf->meshes[node.mesh_id];
+		glm::mat4x4 global_transform = gltf->transforms.GetGlobalTransform(node_id);
+		for (int i = 0; i < mesh.primitives.size(); i++) {
+			if (!mesh.primitives[i].resident) {
+				continue;
+			}
+
+			// Pick the level of detail whose error projects to at most lod_pixel_error pixels at the nearest point of the primitive's bounds.
+			// Instances share a draw, so they use the level of detail of the instance that needs the most detail.
+			const MeshLodData& lods = mesh.primitives[i].lods;
+			int lod = -1;
+			if (!lods.lods.empty()) {
+				float max_error = std::numeric_limits<float>::max();
+				size_t num_of_instances = std::max<size_t>(node.instances.size(), 1);
+				for (size_t j = 0; j < num_of_instances && max_error > 0.0f; j++) {
+					glm::mat4x4 transform = node.instances.empty() ? global_transform : global_transform * node.instances[j];
+					float scale = std::max({glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))});
+					glm::vec3 center = transform * glm::vec4(lods.center, 1.0f);
+					float distance = perspective ? glm::length(center - camera_pos) - lods.radius * scale : 1.0f;
+					max_error = scale > 0.0f && distance > 0.0f ? std::min(max_error, lod_pixel_error * distance / (pixels_per_unit * scale)) : 0.0f;
+				}
+				if (max_error > 0.0f) {
+					lod = SelectMeshLod(lods, max_error);
 				}
 			}
+
+			// Gather the data needed to render an object.
+			int material_id = mesh.primitives[i].material_id;
+			RenderObject render_object = {
+				.transform = global_transform,
+				.previous_transform = gltf->transforms.GetPreviousGlobalTransform(node_id),
+				.node_id = node_id,
+				.mesh_id = node.mesh_id,
+				.dynamic_mesh_id = node.dynamic_mesh,
+				.primitive_id = i,
+				.material_id = material_id,
+				.lod = lod,
+			};
+
+			// Bin the render object depending on material properties.
+			const Gltf::Material& material = gltf->materials[material_id];
+			if (material.alpha_mode == Gltf::Material::ALPHA_MODE_BLEND) {
+				alpha_render_objects.push_back(render_object);
+			} else if (material.alpha_mode == Gltf::Material::ALPHA_MODE_MASK) {
+				alpha_mask_render_objects.push_back(render_object);
+			} else if (material.transmission_factor > 0.0f) {
+				transparent_render_objects.push_back(render_object);
+			} else {
+				opaque_render_objects.push_back(render_object);
+			}
 		}
-	});
+	}
 }
 
 void Rasterizer::SortRenderObjects(glm::vec3 camera_pos)
@@ -127,14 +154,18 @@ void Rasterizer::DrawRenderObjects(CommandContext* context, Gltf* gltf, const st
 {
 	for (auto& render_object: render_objects) {
 		DynamicMesh* dynamic_mesh = render_object.dynamic_mesh_id != -1 ? &gltf->dynamic_primitives[render_object.dynamic_mesh_id].dynamic_meshes[render_object.primitive_id] : nullptr;
+		Gltf::Primitive* primitive = &gltf->meshes[render_object.mesh_id].primitives[render_object.primitive_id];
+		const std::vector<glm::mat4x4>& instances = gltf->nodes[render_object.node_id].instances;
 		forward.Draw(
 			context,
-			&gltf->meshes[render_object.mesh_id].primitives[render_object.primitive_id].mesh,
+			&primitive->mesh,
 			render_object.material_id,
 			render_object.transform,
-			render_object.normal_transform,
 			render_object.previous_transform,
-			dynamic_mesh
+			dynamic_mesh,
+			render_object.lod != -1 ? &primitive->lods.lods[render_object.lod] : nullptr,
+			instances.empty() ? nullptr : instances.data(),
+			instances.size()
 		);
 	}
 }
@@ -157,7 +188,7 @@ void Rasterizer::DrawScene(CommandContext* context, const Settings* settings, co
 	glm::vec3 camera_pos = view_to_world[3];
     
     // Gather everything to draw.
-	GatherRenderObjects(execute_params->gltf, execute_params->scene);
+	GatherRenderObjects(execute_params->gltf, execute_params->scene, camera_pos, execute_params->camera->GetViewToClip(), settings->lod_pixel_error);
 	SortRenderObjects(camera_pos);
 
 	// Prepare render targets.
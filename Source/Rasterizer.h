@@ -14,6 +14,7 @@ class Rasterizer {
 		float bloom_strength = 0.01f;
 		int bloom_radius = 4;
 		uint32_t render_flags;
+		float lod_pixel_error = 1.0f; // The least detailed level of detail whose error covers at most this many pixels is drawn.
 	};
 
     struct ExecuteParams {
@@ -37,12 +38,13 @@ class Rasterizer {
 
     struct RenderObject {
 		glm::mat4x4 transform;
-		glm::mat4x4 normal_transform;
 		glm::mat4x4 previous_transform;
+		int node_id; // Nodes with instances draw all of them at once.
 		int mesh_id;
 		int dynamic_mesh_id;
 		int primitive_id;
 		int material_id;
+		int lod; // -1 for full detail.
 	};
 
 	Microsoft::WRL::ComPtr<ID3D12Device> device;
@@ -76,7 +78,7 @@ class Rasterizer {
 
     // Forward renderer.
 	void SetViewportAndScissorRects(CommandContext* context, int width, int height);
-	void GatherRenderObjects(Gltf* gltf, int scene);
+	void GatherRenderObjects(Gltf* gltf, int scene, glm::vec3 camera_pos, glm::mat4x4 view_to_clip, float lod_pixel_error);
 	void SortRenderObjects(glm::vec3 camera_pos);
 	void DrawRenderObjects(CommandContext* context, Gltf* gltf, const std::vector<RenderObject>& render_objects);
 };
\ No newline at end of file
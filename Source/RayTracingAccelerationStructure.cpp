@@ -97,14 +97,14 @@ void RaytracingAccelerationStructure::Init(ID3D12Device5* device, GpuAllocator*
 	assert(result == S_OK);
 }
 
-void RaytracingAccelerationStructure::BuildStaticBlas(ID3D12GraphicsCommandList4* command_list, D3D12_GPU_VIRTUAL_ADDRESS vertices, uint32_t num_of_vertices, D3D12_INDEX_BUFFER_VIEW indices, uint32_t num_of_indices, Blas* blas)
+void RaytracingAccelerationStructure::BuildStaticBlas(ID3D12GraphicsCommandList4* command_list, D3D12_GPU_VIRTUAL_ADDRESS vertices, DXGI_FORMAT vertex_format, uint32_t num_of_vertices, D3D12_INDEX_BUFFER_VIEW indices, uint32_t num_of_indices, Blas* blas)
 {
-	BuildBlas(command_list, vertices, num_of_vertices, indices, num_of_indices, &blas->resource);
+	BuildBlas(command_list, vertices, vertex_format, num_of_vertices, indices, num_of_indices, &blas->resource);
 }
 
 void RaytracingAccelerationStructure::BuildDynamicBlas(ID3D12GraphicsCommandList4* command_list, D3D12_GPU_VIRTUAL_ADDRESS vertices, uint32_t num_of_vertices, D3D12_INDEX_BUFFER_VIEW indices, uint32_t num_of_indices, DynamicBlas* blas)
 {
-	BuildBlas(command_list, vertices, num_of_vertices, indices, num_of_indices, &blas->resource, &blas->update_scratch_size);
+	BuildBlas(command_list, vertices, DXGI_FORMAT_R32G32B32_FLOAT, num_of_vertices, indices, num_of_indices, &blas->resource, &blas->update_scratch_size);
 }
 
 void RaytracingAccelerationStructure::UpdateDynamicBlas(ID3D12GraphicsCommandList4* command_list, DynamicBlas* blas, D3D12_GPU_VIRTUAL_ADDRESS vertices, uint32_t num_of_vertices, D3D12_INDEX_BUFFER_VIEW indices, uint32_t num_of_indices)
@@ -225,21 +225,22 @@ D3D12_GPU_VIRTUAL_ADDRESS RaytracingAccelerationStructure::GetAccelerationStruct
 	return tlas.resource->GetGPUVirtualAddress();
 }
 
-void RaytracingAccelerationStructure::BuildBlas(ID3D12GraphicsCommandList4* command_list, D3D12_GPU_VIRTUAL_ADDRESS vertices, uint32_t num_of_vertices, D3D12_INDEX_BUFFER_VIEW indices, uint32_t num_of_indices, GpuResource* blas_resource, uint64_t* update_scratch_size)
+void RaytracingAccelerationStructure::BuildBlas(ID3D12GraphicsCommandList4* command_list, D3D12_GPU_VIRTUAL_ADDRESS vertices, DXGI_FORMAT vertex_format, uint32_t num_of_vertices, D3D12_INDEX_BUFFER_VIEW indices, uint32_t num_of_indices, GpuResource* blas_resource, uint64_t* update_scratch_size)
 {
+	assert(vertex_format == DXGI_FORMAT_R32G32B32_FLOAT || vertex_format == DXGI_FORMAT_R16G16B16A16_SNORM);
 	D3D12_RAYTRACING_GEOMETRY_DESC geometry = {
 		.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES, 
 		.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE,
 		.Triangles = {
 			.Transform3x4 = 0,
 			.IndexFormat = indices.Format,
-			.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT,
+			.VertexFormat = vertex_format,
 			.IndexCount = num_of_indices,
 			.VertexCount = num_of_vertices,
 			.IndexBuffer = indices.BufferLocation,
 			.VertexBuffer = {
 				.StartAddress = vertices,
-				.StrideInBytes = sizeof(glm::vec3),
+				.StrideInBytes = vertex_format == DXGI_FORMAT_R16G16B16A16_SNORM ? sizeof(glm::i16vec4) : sizeof(glm::vec3),
 			}
 		}
 	};
@@ -23,7 +23,9 @@ class RaytracingAccelerationStructure {
     
     void Init(ID3D12Device5* device, GpuAllocator* allocator, uint32_t max_blas_vertices, uint32_t max_tlas_instances);
     
-    void BuildStaticBlas(ID3D12GraphicsCommandList4* command_list, D3D12_GPU_VIRTUAL_ADDRESS vertices, uint32_t num_of_vertices, D3D12_INDEX_BUFFER_VIEW indices, uint32_t num_of_indices, Blas* blas);
+    // Vertices can be R32G32B32_FLOAT or R16G16B16A16_SNORM.
+    void BuildStaticBlas(ID3D12GraphicsCommandList4* command_list, D3D12_GPU_VIRTUAL_ADDRESS vertices, DXGI_FORMAT vertex_format, uint32_t num_of_vertices, D3D12_INDEX_BUFFER_VIEW indices, uint32_t num_of_indices, Blas* blas);
+    // Vertices must be R32G32B32_FLOAT, the layout of the DynamicMesh positions that updates refit from.
     void BuildDynamicBlas(ID3D12GraphicsCommandList4* command_list, D3D12_GPU_VIRTUAL_ADDRESS vertices, uint32_t num_of_vertices, D3D12_INDEX_BUFFER_VIEW indices, uint32_t num_of_indices, DynamicBlas* blas);
     void UpdateDynamicBlas(ID3D12GraphicsCommandList4* command_list, DynamicBlas* blas, D3D12_GPU_VIRTUAL_ADDRESS vertices, uint32_t num_of_vertices, D3D12_INDEX_BUFFER_VIEW indices, uint32_t num_of_indices);
     void EndBlasBuilds(ID3D12GraphicsCommandList4* command_list);
@@ -49,6 +51,6 @@ class RaytracingAccelerationStructure {
     GpuResource tlas_scratch;
     GpuResource tlas;
 
-    void BuildBlas(ID3D12GraphicsCommandList4* command_list, D3D12_GPU_VIRTUAL_ADDRESS vertices, uint32_t num_of_vertices, D3D12_INDEX_BUFFER_VIEW indices, uint32_t num_of_indices, GpuResource* resource, uint64_t* update_scratch_size = nullptr);
+    void BuildBlas(ID3D12GraphicsCommandList4* command_list, D3D12_GPU_VIRTUAL_ADDRESS vertices, DXGI_FORMAT vertex_format, uint32_t num_of_vertices, D3D12_INDEX_BUFFER_VIEW indices, uint32_t num_of_indices, GpuResource* resource, uint64_t* update_scratch_size = nullptr);
     bool AddTlasInstance(D3D12_GPU_VIRTUAL_ADDRESS blas, glm::mat4x4 transform, uint32_t instance_mask, uint32_t flags);
 };
\ No newline at end of file
@@ -398,94 +398,79 @@ void Renderer::CreateRenderTargets()
 
 void Renderer::PerformSkinning(CommandContext* context, Gltf* gltf, int scene)
 {
-	gltf->TraverseScene(scene, [&](Gltf* gltf, int node_id) {
+	for (int node_id: gltf->scenes[scene].dynamic_nodes) {
 		const Gltf::Node& node = gltf->nodes[node_id];
 		bool skinned = node.skin_id != -1;
 		bool morphed = node.current_weights.size() > 0;
-		if (skinned || morphed) {
+		// Dynamic meshes are only created once a scene has finished streaming in.
+		if ((skinned || morphed) && node.dynamic_mesh != -1) {
 
-			// Calculate and upload bones to gpu.
+			// Upload the bones calculated by Gltf::CalculateSkinPalettes.
 			D3D12_GPU_VIRTUAL_ADDRESS gpu_bones = 0;
 			if (skinned) {
-				Gltf::Skin& skin = gltf->skins[node.skin_id];
-				GpuSkin::Bone* bones = (GpuSkin::Bone*)context->Allocate(sizeof(bones[0]) * skin.joints.size(), D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, &gpu_bones);
-				for (int i = 0; i < skin.joints.size(); i++) {
-					int joint = skin.joints[i];
-					bones[i].transform = glm::affineInverse(node.global_transform) * gltf->nodes[joint].global_transform * skin.inverse_bind_poses[i];
-					bones[i].inverse_transpose = glm::inverseTranspose(glm::mat3x3(bones[i].transform));
-				}
+				GpuSkin::Bone* bones = (GpuSkin::Bone*)context->Allocate(sizeof(bones[0]) * node.bones.size(), D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, &gpu_bones);
+				std::copy(node.bones.begin(), node.bones.end(), bones);
+			}
+
+			// Upload every morph weight, the skinning shader only reads the weights of targets that move a vertex.
+			D3D12_GPU_VIRTUAL_ADDRESS gpu_weights = 0;
+			if (morphed) {
+				float* weights = (float*)context->Allocate(sizeof(float) * node.current_weights.size(), D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, &gpu_weights);
+				std::copy(node.current_weights.begin(), node.current_weights.end(), weights);
 			}
 
 			// Perform gpu skinning.
 			std::vector<Gltf::Primitive>& primitive = gltf->meshes[node.mesh_id].primitives;
 			std::vector<DynamicMesh>& dynamic = gltf->dynamic_primitives[node.dynamic_mesh].dynamic_meshes;
 			for (int i = 0; i < primitive.size(); i++) {
-				dynamic[i].Flip();
-
-				// Pick only the largest weights, and ignore any weights that are not larger than 0.
-				int num_of_targets = 0;
-				float weights[::Config::MAX_SIMULTANEOUS_MORPH_TARGETS] = {};
-				MorphTarget* targets[::Config::MAX_SIMULTANEOUS_MORPH_TARGETS] = {};
-				for (int j = 0; j < node.current_weights.size(); j++) {
-					if (node.current_weights[j] > 0.0f) {
-						if (num_of_targets < ::Config::MAX_SIMULTANEOUS_MORPH_TARGETS) {
-							weights[num_of_targets] = node.current_weights[j];
-							targets[num_of_targets] = &primitive[i].targets[j];
-							num_of_targets++;
-						} else {
-							int min_index = std::distance(&weights[0], std::min_element(&weights[0], &weights[::Config::MAX_SIMULTANEOUS_MORPH_TARGETS]));
-							if (weights[min_index] < node.current_weights[j]) {
-								weights[min_index] = node.current_weights[j];
-								targets[min_index] = &primitive[i].targets[j];
-							}
-						}
-					}
+				if (!primitive[i].resident) {
+					continue;
 				}
+				dynamic[i].Flip();
 
 				gpu_skinner.Run(
 					context,
 					&primitive[i].mesh,
 					&dynamic[i],
 					skinned ? gpu_bones : 0,
-					num_of_targets,
-					targets,
-					weights
+					&primitive[i].morph_targets,
+					gpu_weights,
+					node.current_weights.size()
 				);
 			}
 		}
-	});
+	}
 }
 
 void Renderer::GatherLights(Gltf* gltf, int scene, CpuMappedLinearBuffer* allocator)
 {
 	lights.clear();
-	gltf->TraverseScene(scene, [&](Gltf* gltf, int node_id) {
+	for (int node_id: gltf->scenes[scene].light_nodes) {
 		const Gltf::Node& node = gltf->nodes[node_id];
 		int light_id = node.light_id;
-		if (light_id != -1) {
-			const Gltf::Light& scene_light = gltf->lights[light_id];
-			GpuLight light;
-			switch (scene_light.type) {
-				case Gltf::Light::TYPE_POINT:
-					light.type = GpuLight::TYPE_POINT;
-					break;
-				case Gltf::Light::TYPE_SPOT:
-					light.type = GpuLight::TYPE_SPOT;
-					break;
-				case Gltf::Light::TYPE_DIRECTIONAL:
-					light.type = GpuLight::TYPE_DIRECTIONAL;
-					break;
-			}
-			light.color = scene_light.color;
-			light.intensity = scene_light.intensity;
-			light.cutoff = scene_light.cutoff;
-			light.position = node.global_transform[3];
-			light.direction = glm::normalize(glm::inverseTranspose(node.global_transform) * glm::vec4(0.0, 0.0, -1.0, 0.0));
-			light.inner_angle = scene_light.inner_angle;
-			light.outer_angle = scene_light.outer_angle;
-			lights.emplace_back(light);
+		const Gltf::Light& scene_light = gltf->lights[light_id];
+		GpuLight light;
+		switch (scene_light.type) {
+			case Gltf::Light::TYPE_POINT:
+				light.type = GpuLight::TYPE_POINT;
+				break;
+			case Gltf::Light::TYPE_SPOT:
+				light.type = GpuLight::TYPE_SPOT;
+				break;
+			case Gltf::Light::TYPE_DIRECTIONAL:
+				light.type = GpuLight::TYPE_DIRECTIONAL;
+				break;
 		}
-	});
+		light.color = scene_light.color;
+		light.intensity = scene_light.intensity;
+		light.cutoff = scene_light.cutoff;
+		glm::mat4x4 global_transform = gltf->transforms.GetGlobalTransform(node_id);
+		light.position = global_transform[3];
+		light.direction = glm::normalize(glm::inverseTranspose(global_transform) * glm::vec4(0.0, 0.0, -1.0, 0.0));
+		light.inner_angle = scene_light.inner_angle;
+		light.outer_angle = scene_light.outer_angle;
+		lights.emplace_back(light);
+	}
 	if (lights.data()) {
 		this->gpu_lights = allocator->Copy(lights.data(), sizeof(GpuLight) * lights.size(), D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
 	}
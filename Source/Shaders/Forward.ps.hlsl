@@ -19,6 +19,7 @@ struct PSIn {
 	float4 color: COLOR;
 	float4 previous_pos: POSITION;
 	float3 world_pos: POS;
+	nointerpolation float3 model_scale: MODEL_SCALE;
 	bool is_front_face: SV_IsFrontFace;
 };
 
@@ -35,7 +36,6 @@ enum RenderFlags {
 struct PerModel {
 	uint32_t mesh_flags;
 	int material_index;
-	float4x4 model_to_world;
 };
 
 struct PerFrame {
@@ -186,8 +186,7 @@ PSOut main(PSIn input)
 	surface_properties.thickness = GetThickness(material, input.tex_coords);
 	float3 transmission_vector = normalize(input.world_pos - g_per_frame.camera_pos);
 	transmission_vector = refract(transmission_vector, surface_properties.shading_normal, 1 / material.ior);
-	float3 scale = float3(length(g_per_model.model_to_world[0].xyz), length(g_per_model.model_to_world[1].xyz), length(g_per_model.model_to_world[2].xyz));
-	transmission_vector *= scale;
+	transmission_vector *= input.model_scale;
 	surface_properties.thickness = length(transmission_vector);
 	surface_properties.attenuation_distance = material.attenuation_distance;
 	surface_properties.attenuation_color = material.attenuation_color;
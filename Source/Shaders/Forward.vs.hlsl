@@ -16,6 +16,7 @@ struct VSOut {
 	float4 color: COLOR;
 	float4 previous_pos: POSITION;
 	float3 world_pos: POS;
+	nointerpolation float3 model_scale: MODEL_SCALE;
 };
 
 struct PerFrame {
@@ -24,29 +25,37 @@ struct PerFrame {
 };
 
 struct PerModel  {
+	float4 texcoord_transforms[2]; // Scale in xy, offset in zw.
+};
+
+struct Instance {
+	float4x4 position_to_world; // model_to_world with the dequantization of positions.
 	float4x4 model_to_world;
 	float4x4 model_to_world_normals;
-	float4x4 previous_model_to_world;
+	float4x4 previous_position_to_world;
 };
 
 ConstantBuffer<PerFrame> per_frame: register(b0);
 ConstantBuffer<PerModel> per_model: register(b1);
+StructuredBuffer<Instance> instances: register(t2);
 
-VSOut main(VSIn input)
+VSOut main(VSIn input, uint instance_id: SV_InstanceID)
 {
 	VSOut output;
+	Instance instance = instances[instance_id];
 
-	float4 world_pos = mul(per_model.model_to_world, float4(input.pos, 1.));
+	float4 world_pos = mul(instance.position_to_world, float4(input.pos, 1.));
 	output.pos = mul(per_frame.world_to_clip, world_pos);
-	output.previous_pos = mul(per_frame.previous_world_to_clip, mul(per_model.previous_model_to_world, float4(input.previous_pos, 1.)));
+	output.previous_pos = mul(per_frame.previous_world_to_clip, mul(instance.previous_position_to_world, float4(input.previous_pos, 1.)));
 	output.world_pos = world_pos.xyz;
+	output.model_scale = float3(length(instance.model_to_world[0].xyz), length(instance.model_to_world[1].xyz), length(instance.model_to_world[2].xyz));
 
 	DecodeTangentSpace(input.tangent_space, output.normal.xyz, output.tangent);
-	output.normal.xyz = mul(per_model.model_to_world_normals, float4(output.normal.xyz, 0)).xyz;
-	output.tangent.xyz = mul(per_model.model_to_world, float4(output.tangent.xyz, 0)).xyz;
+	output.normal.xyz = mul(instance.model_to_world_normals, float4(output.normal.xyz, 0)).xyz;
+	output.tangent.xyz = mul(instance.model_to_world, float4(output.tangent.xyz, 0)).xyz;
 
-	output.tex_coords[0] = input.tex_coords[0];
-	output.tex_coords[1] = input.tex_coords[1];
+	output.tex_coords[0] = input.tex_coords[0] * per_model.texcoord_transforms[0].xy + per_model.texcoord_transforms[0].zw;
+	output.tex_coords[1] = input.tex_coords[1] * per_model.texcoord_transforms[1].xy + per_model.texcoord_transforms[1].zw;
 
 	output.color = input.color;
 
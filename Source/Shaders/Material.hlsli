@@ -87,12 +87,36 @@ float2 TransformUv(TextureAddress address, float2 uv)
 	return uv_transformed;
 }
 
+// Ray tracing has no screen space derivatives to pick a mip level from, so ray tracing shaders define
+// MATERIAL_EXPLICIT_LOD and set g_texture_lod for the current hit instead.
+#ifdef MATERIAL_EXPLICIT_LOD
+// One per texcoord set, without the texture's size, which SampleTexture adds. Defaults to the most detailed level.
+static float2 g_texture_lod = -32.xx;
+#endif
+
 float4 SampleTexture(in Texture2D<float4> texture, in TextureAddress address, in float2 tex_coords[2])
 {
 	SamplerState texture_sampler = SamplerDescriptorHeap[address.sampler_index];
 	float2 uv = tex_coords[address.tex_coord];
 	uv = TransformUv(address, uv);
-	return texture.SampleLevel(texture_sampler, uv, 0); // TODO: This doesn't support mip mapping, but is used because raytracing can't use the standard sample function!
+#ifdef MATERIAL_EXPLICIT_LOD
+	float width, height;
+	texture.GetDimensions(width, height);
+	float lod = g_texture_lod[address.tex_coord] + 0.5 * log2(width * height * abs(address.scale.x * address.scale.y));
+	return texture.SampleLevel(texture_sampler, uv, lod);
+#else
+	return texture.Sample(texture_sampler, uv);
+#endif
+}
+
+// Normal maps may be stored as BC5, which only has x and y, so z is always reconstructed.
+float3 SampleNormalMap(in Texture2D<float4> texture, in TextureAddress address, in float2 tex_coords[2], float scale)
+{
+	float3 normal_map;
+	normal_map.xy = SampleTexture(texture, address, tex_coords).xy * 2. - 1.;
+	normal_map.z = sqrt(saturate(1. - dot(normal_map.xy, normal_map.xy)));
+	normal_map.xy *= scale;
+	return normal_map;
 }
 
 float4 GetBaseColor(Material material, float2 texcoords[2], float4 vertex_color)
@@ -120,8 +144,7 @@ float3 GetShadingNormal(Material material, float2 texcoords[2], float3 geometric
 {
     float3 shading_normal = geometric_normal;
 	if (material.normal.descriptor != -1) {
-		float3 normal_map = SampleTexture(ResourceDescriptorHeap[material.normal.descriptor], material.normal, texcoords).xyz * 2. - 1.;
-		normal_map.xy *= material.normal_scale;
+		float3 normal_map = SampleNormalMap(ResourceDescriptorHeap[material.normal.descriptor], material.normal, texcoords, material.normal_scale);
 		shading_normal = normalize(mul(tangent_to_world, normal_map));
 	}
     return shading_normal;
@@ -199,8 +222,7 @@ float3 GetClearcoatNormal(Material material, float2 texcoords[2], float3 geometr
 {
 	float3 clearcoat_normal = geometric_normal;
 	if (material.clearcoat_normal.descriptor != -1) {
-		float3 clearcoat_normal_map = SampleTexture(ResourceDescriptorHeap[material.clearcoat_normal.descriptor], material.clearcoat_normal, texcoords).xyz * 2. - 1.;
-		clearcoat_normal_map.xy *= material.clearcoat_normal_scale;
+		float3 clearcoat_normal_map = SampleNormalMap(ResourceDescriptorHeap[material.clearcoat_normal.descriptor], material.clearcoat_normal, texcoords, material.clearcoat_normal_scale);
 		clearcoat_normal = normalize(mul(tangent_to_world, clearcoat_normal_map));
 	}
     return clearcoat_normal;
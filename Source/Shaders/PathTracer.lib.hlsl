@@ -1,3 +1,5 @@
+#define MATERIAL_EXPLICIT_LOD
+
 #include "Lights.hlsli"
 #include "Random.hlsli"
 #include "Material.hlsli"
@@ -38,6 +40,9 @@ struct Instance {
 	int texcoord_descriptors[2];
 	int color_descriptor;
 	int material_id;
+	float3 position_scale; // Dequantization of positions, identity if they aren't quantized.
+	float3 position_offset;
+	float4 texcoord_transforms[2]; // Scale in xy, offset in zw.
 };
 
 enum DebugOutput {
@@ -114,6 +119,9 @@ struct Payload {
     uint flags;
     int bounce;
     int random_count;
+    // Ray cone for texture level of detail.
+    float cone_width;
+    float cone_spread;
 };
 
 struct ShadowPayload {
@@ -183,12 +191,12 @@ uint3 GetIndices(int index_descriptor, uint primitive_index)
     return v;
 }
 
-float3 GetPositions(int position_descriptor, uint3 vertex, float3 barycentric_weights, out float3 pos_0, out float3 pos_1, out float3 pos_2)
+float3 GetPositions(int position_descriptor, float3 position_scale, float3 position_offset, uint3 vertex, float3 barycentric_weights, out float3 pos_0, out float3 pos_1, out float3 pos_2)
 {
     Buffer<float3> position_buffer = ResourceDescriptorHeap[NonUniformResourceIndex(position_descriptor)];
-    pos_0 = position_buffer[vertex.x];
-    pos_1 = position_buffer[vertex.y];
-    pos_2 = position_buffer[vertex.z];
+    pos_0 = position_buffer[vertex.x] * position_scale + position_offset;
+    pos_1 = position_buffer[vertex.y] * position_scale + position_offset;
+    pos_2 = position_buffer[vertex.z] * position_scale + position_offset;
     float3 pos = BarycentricInterpolate(pos_0, pos_1, pos_2, barycentric_weights);
     return pos;
 }
@@ -241,7 +249,7 @@ float4 GetVertexColor(int color_descriptor, uint3 vertex, float3 barycentric_wei
     return color;
 }
 
-float2 GetTexcoord(int texcoord_descriptor, uint3 vertex, float3 barycentric_weights)
+float2 GetTexcoord(int texcoord_descriptor, float4 texcoord_transform, uint3 vertex, float3 barycentric_weights)
 {
     float2 texcoord;
     if (texcoord_descriptor != -1) {
@@ -250,12 +258,48 @@ float2 GetTexcoord(int texcoord_descriptor, uint3 vertex, float3 barycentric_wei
         float2 texcoord_1 = texcoord_buffer[vertex.y];
         float2 texcoord_2 = texcoord_buffer[vertex.z];
         texcoord = BarycentricInterpolate(texcoord_0, texcoord_1, texcoord_2, barycentric_weights);
+        texcoord = texcoord * texcoord_transform.xy + texcoord_transform.zw;
     } else {
         texcoord = 0.xx;
     }
     return texcoord;
 }
 
+float GetTexcoordArea(int texcoord_descriptor, float4 texcoord_transform, uint3 vertex)
+{
+    if (texcoord_descriptor == -1) {
+        return 0;
+    }
+    Buffer<float2> texcoord_buffer = ResourceDescriptorHeap[NonUniformResourceIndex(texcoord_descriptor)];
+    float2 texcoord_0 = texcoord_buffer[vertex.x] * texcoord_transform.xy;
+    float2 texcoord_1 = texcoord_buffer[vertex.y] * texcoord_transform.xy;
+    float2 texcoord_2 = texcoord_buffer[vertex.z] * texcoord_transform.xy;
+    float2 edge_1 = texcoord_1 - texcoord_0;
+    float2 edge_2 = texcoord_2 - texcoord_0;
+    return abs(edge_1.x * edge_2.y - edge_2.x * edge_1.y);
+}
+
+// Ray cone texture level of detail, adapted from Ray Tracing Gems Chapter 20.
+// Returns a level for each texcoord set, without the texture's size, for g_texture_lod.
+float2 CalculateTextureLod(Instance instance, uint3 vertex, float cone_width)
+{
+    float3 pos_0, pos_1, pos_2;
+    GetPositions(instance.position_descriptor, instance.position_scale, instance.position_offset, vertex, 0.xxx, pos_0, pos_1, pos_2);
+    pos_0 = mul(instance.transform, float4(pos_0, 1)).xyz;
+    pos_1 = mul(instance.transform, float4(pos_1, 1)).xyz;
+    pos_2 = mul(instance.transform, float4(pos_2, 1)).xyz;
+    float3 normal = GetGeometricNormal(pos_0, pos_1, pos_2);
+    float area = max(length(normal), 1e-20);
+    float cos_theta = max(abs(dot(normal / area, normalize(WorldRayDirection()))), 1e-4);
+    float footprint = log2(abs(cone_width) / cos_theta);
+    float2 lod;
+    for (int i = 0; i < 2; i++) {
+        float texcoord_area = GetTexcoordArea(instance.texcoord_descriptors[i], instance.texcoord_transforms[i], vertex);
+        lod[i] = 0.5 * log2(texcoord_area / area) + footprint;
+    }
+    return lod;
+}
+
 // Adapted from Ray Tracing Gems Chapter 6.
 float3 OffsetRay(float3 position, float3 geometric_normal)
 {
@@ -283,7 +327,7 @@ VertexAttributes GetVertexAttributes(Instance instance, uint primitive_index, fl
     uint3 v = GetIndices(instance.index_descriptor, primitive_index);
 
     float3 pos_0, pos_1, pos_2;
-    attributes.position = GetPositions(instance.position_descriptor, v, barycentric_weights, pos_0, pos_1, pos_2);
+    attributes.position = GetPositions(instance.position_descriptor, instance.position_scale, instance.position_offset, v, barycentric_weights, pos_0, pos_1, pos_2);
     attributes.geometric_normal = GetGeometricNormal(pos_0, pos_1, pos_2);
     GetVertexNormalAndTangent(instance.tangent_space_descriptor, v, barycentric_weights, attributes.geometric_normal, attributes.normal, attributes.tangent);
 
@@ -296,7 +340,7 @@ VertexAttributes GetVertexAttributes(Instance instance, uint primitive_index, fl
     attributes.bitangent = CalculateBitangent(attributes.normal, attributes.tangent); // TODO: Should bitangents be calculated per vertex, and then interpolated with barycentric weights instead?
     attributes.color = GetVertexColor(instance.color_descriptor, v, barycentric_weights);
     for (int i = 0; i < 2; i++) {
-        attributes.texcoords[i] = GetTexcoord(instance.texcoord_descriptors[i], v, barycentric_weights);
+        attributes.texcoords[i] = GetTexcoord(instance.texcoord_descriptors[i], instance.texcoord_transforms[i], v, barycentric_weights);
     }
     return attributes;
 }
@@ -666,13 +710,14 @@ float3 SampleBsdf(SurfaceProperties surface_properties, float3 u, float3 v, out
 
 }
 
-float3 TraceBounceRay(float3 origin, float3 direction, int seed, int bounce, float3 throughput, float bsdf_pdf, bool use_mis)
+// Bounces keep the camera's cone spread, so glossy and diffuse bounces get sharper textures than a full ray cone would give.
+float3 TraceBounceRay(float3 origin, float3 direction, int seed, int bounce, float3 throughput, float bsdf_pdf, bool use_mis, float cone_width, float cone_spread)
 {
     const uint instance_mask = g_scene_constants.flags & FLAG_INDIRECT_ENVIRONMENT_ONLY ? 0 : 0xff;
     const uint ray_flags = g_scene_constants.flags & FLAG_CULL_BACKFACE ? RAY_FLAG_CULL_FRONT_FACING_TRIANGLES : 0;
     const uint payload_flags = use_mis ? PAYLOAD_FLAG_MIS : 0;
     RayDesc ray = {origin, 0, direction, g_scene_constants.max_ray_length};
-    Payload bounce_payload = {throughput, bsdf_pdf, 0.xxx, payload_flags, bounce + 1, seed};
+    Payload bounce_payload = {throughput, bsdf_pdf, 0.xxx, payload_flags, bounce + 1, seed, cone_width, cone_spread};
     TraceRay(g_acceleration_structure, ray_flags, instance_mask, 0, 0, 0, ray, bounce_payload);
     return bounce_payload.color;
 }
@@ -746,13 +791,19 @@ void RayGeneration()
 {
     const uint ray_flags = g_scene_constants.flags & FLAG_CULL_BACKFACE ? RAY_FLAG_CULL_BACK_FACING_TRIANGLES : 0;
 
-    Payload payload = {1.xxx, 0, 0.xxx, 0, 0, 0};
+    Payload payload = {1.xxx, 0, 0.xxx, 0, 0, 0, 0, 0};
     float2 jitter = GenerateNextRandom(payload.random_count).xy - 0.5;
 
     uint2 pixel = DispatchRaysIndex().xy;
     float3 ray_origin;
     float3 ray_direction;
     GenerateCameraRay(pixel, g_scene_constants.resolution, g_scene_constants.clip_to_world, jitter, ray_origin, ray_direction);
+
+    // The cone spreads by the angle between neighbouring pixels.
+    float3 neighbour_origin;
+    float3 neighbour_direction;
+    GenerateCameraRay(pixel + uint2(1, 0), g_scene_constants.resolution, g_scene_constants.clip_to_world, jitter, neighbour_origin, neighbour_direction);
+    payload.cone_spread = acos(saturate(dot(normalize(ray_direction), normalize(neighbour_direction))));
     RayDesc ray = {ray_origin, 0, normalize(ray_direction), length(ray_direction)};
 
     TraceRay(g_acceleration_structure, ray_flags, 0xff, 0, 0, 0, ray, payload);
@@ -802,6 +853,8 @@ void ClosestHit(inout Payload payload, in BuiltInTriangleIntersectionAttributes
 
     // Get interpolated vertex attributes.
     VertexAttributes vertex_attributes = GetVertexAttributes(instance, primitive_index, barycentric_weights);
+    float cone_width = payload.cone_width + payload.cone_spread * RayTCurrent();
+    g_texture_lod = CalculateTextureLod(instance, GetIndices(instance.index_descriptor, primitive_index), cone_width);
 
     switch (g_scene_constants.debug_output) {
         case DEBUG_OUTPUT_HIT_KIND: {
@@ -999,7 +1052,9 @@ void ClosestHit(inout Payload payload, in BuiltInTriangleIntersectionAttributes
                     payload.bounce,
                     throughput * weight,
                     bsdf_pdf, 
-                    use_mis
+                    use_mis,
+                    cone_width,
+                    payload.cone_spread
                 );
             }
         }
@@ -1022,10 +1077,11 @@ void AnyHit(inout Payload payload, in BuiltInTriangleIntersectionAttributes attr
 
     // Get interpolated vertex attributes.
     uint3 vertices = GetIndices(instance.index_descriptor, primitive_index);
+    g_texture_lod = CalculateTextureLod(instance, vertices, payload.cone_width + payload.cone_spread * RayTCurrent());
     float4 base_color = GetVertexColor(instance.color_descriptor, vertices, barycentric_weights);
     float2 texcoords[2];
     for (int i = 0; i < 2; i++) {
-        texcoords[i] = GetTexcoord(instance.texcoord_descriptors[i], vertices, barycentric_weights);
+        texcoords[i] = GetTexcoord(instance.texcoord_descriptors[i], instance.texcoord_transforms[i], vertices, barycentric_weights);
     }
     base_color = GetBaseColor(material, texcoords, base_color);
 
@@ -1065,10 +1121,11 @@ void ShadowAnyHit(inout ShadowPayload payload, in BuiltInTriangleIntersectionAtt
 
     // Get interpolated vertex attributes.
     uint3 vertices = GetIndices(instance.index_descriptor, primitive_index);
+    // Shadow rays don't carry a ray cone, so alpha is tested against the most detailed level.
     float4 base_color = GetVertexColor(instance.color_descriptor, vertices, barycentric_weights);
     float2 texcoords[2];
     for (int i = 0; i < 2; i++) {
-        texcoords[i] = GetTexcoord(instance.texcoord_descriptors[i], vertices, barycentric_weights);
+        texcoords[i] = GetTexcoord(instance.texcoord_descriptors[i], instance.texcoord_transforms[i], vertices, barycentric_weights);
     }
     base_color = GetBaseColor(material, texcoords, base_color);
     float alpha = GetAlpha(material, base_color);
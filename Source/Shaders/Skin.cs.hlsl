@@ -8,6 +8,7 @@ enum MeshFlags {
     MESH_FLAG_TEXCOORD_1 = 1 << 3,
     MESH_FLAG_COLOR = 1 << 4,
     MESH_FLAG_JOINT_WEIGHT = 1 << 5,
+    MESH_FLAG_QUANTIZED_POSITION = 1 << 6,
 };
 
 enum DynamicMeshFlags {
@@ -16,8 +17,9 @@ enum DynamicMeshFlags {
 };
 
 enum MorphFlags {
-    MORPH_FLAG_POSITIONS = 1 << 0,
-    MORPH_FLAG_TANGENT_SPACE = 1 << 1,
+    MORPH_FLAG_POSITION = 1 << 0,
+    MORPH_FLAG_NORMAL = 1 << 1,
+    MORPH_FLAG_TANGENT = 1 << 2,
 };
 
 struct BoneWeights {
@@ -29,12 +31,17 @@ struct PerModel {
     uint32_t num_of_vertices;
     uint32_t input_mesh_flags;
     uint32_t output_mesh_flags;
-    int num_of_morph_targets;
-    struct {
-        float weight;
-        int position_descriptor;
-        int tangent_space_descriptor;
-    } morph_targets[4];
+    uint32_t morph_flags; // Zero if there are no morph targets.
+    // Decodes R16G16B16A16_SNORM positions with MESH_FLAG_QUANTIZED_POSITION.
+    float3 position_scale;
+    uint32_t num_of_morph_weights;
+    float3 position_offset;
+    // Morph targets are stored as the deltas of each vertex, see MorphTargets in Mesh.h.
+    int morph_delta_offsets_descriptor;
+    int morph_targets_descriptor;
+    int morph_position_descriptor;
+    int morph_normal_descriptor;
+    int morph_tangent_descriptor;
 };
 
 struct Bone {
@@ -43,13 +50,26 @@ struct Bone {
 };
 
 ConstantBuffer<PerModel> per_model : register(b0);
-StructuredBuffer<float3> input_positions : register(t0);
+ByteAddressBuffer input_positions : register(t0); // float3, or int16_t4 with MESH_FLAG_QUANTIZED_POSITION.
 StructuredBuffer<uint> input_tangent_space : register(t1);
 StructuredBuffer<BoneWeights> skin : register(t3);
 StructuredBuffer<Bone> bones : register(t4);
+StructuredBuffer<float> morph_weights : register(t5);
 RWStructuredBuffer<float3> output_positions : register(u0);
 RWStructuredBuffer<uint> output_tangent_space : register(u1);
 
+float3 LoadPosition(uint index)
+{
+    if (per_model.input_mesh_flags & MESH_FLAG_QUANTIZED_POSITION) {
+        // Sign extend each 16 bit component, then decode as SNORM.
+        uint2 packed = input_positions.Load2(index * 8);
+        int3 quantized = int3(int(packed.x << 16) >> 16, int(packed.x) >> 16, int(packed.y << 16) >> 16);
+        float3 position = max(float3(quantized) / 32767.0f, -1.0f);
+        return position * per_model.position_scale + per_model.position_offset;
+    }
+    return asfloat(input_positions.Load3(index * 12));
+}
+
 [numthreads(64, 1, 1)]
 void main(in uint3 thread_id: SV_DispatchThreadID)
 {
@@ -60,29 +80,37 @@ void main(in uint3 thread_id: SV_DispatchThreadID)
     }
     
     // Get inputs.
-    float3 position = input_positions[index];
+    float3 position = LoadPosition(index);
     float3 normal = float3(0, 0, 0);
     float4 tangent = float4(0, 0, 0, 1);
     if (per_model.input_mesh_flags & MESH_FLAG_TANGENT_SPACE) {
         DecodeTangentSpace(UnpackR10G10B10A2(input_tangent_space[index]), normal, tangent);
     }
 
-    // Morph targets.
-    for (int i = 0; i < per_model.num_of_morph_targets; i++) {
-        float weight = per_model.morph_targets[i].weight;
-        if (per_model.morph_targets[i].position_descriptor != -1) {
-            Buffer<float3> morph_pos_buffer = ResourceDescriptorHeap[per_model.morph_targets[i].position_descriptor];
-            float3 morph_position = morph_pos_buffer[index];
-            position += weight * morph_position;
-        }
-        if (per_model.morph_targets[i].tangent_space_descriptor != -1) {
-            Buffer<float4> morph_tangent_space_buffer = ResourceDescriptorHeap[per_model.morph_targets[i].tangent_space_descriptor];
-            float4 morph_tangent_space = morph_tangent_space_buffer[index];
-            float3 morph_normal;
-            float4 morph_tangent;
-            DecodeTangentSpace(morph_tangent_space, morph_normal, morph_tangent);
-            normal += weight * morph_normal;
-            tangent.xyz += weight * morph_tangent.xyz;
+    // Morph targets. Only the targets that move this vertex have a delta.
+    if (per_model.morph_flags != 0) {
+        Buffer<uint> delta_offsets = ResourceDescriptorHeap[per_model.morph_delta_offsets_descriptor];
+        Buffer<uint> targets = ResourceDescriptorHeap[per_model.morph_targets_descriptor];
+        uint first_delta = delta_offsets[index];
+        uint last_delta = delta_offsets[index + 1];
+        for (uint i = first_delta; i < last_delta; i++) {
+            uint target = targets[i];
+            float weight = target < per_model.num_of_morph_weights ? morph_weights[target] : 0;
+            if (weight == 0) {
+                continue;
+            }
+            if (per_model.morph_flags & MORPH_FLAG_POSITION) {
+                Buffer<float3> morph_positions = ResourceDescriptorHeap[per_model.morph_position_descriptor];
+                position += weight * morph_positions[i];
+            }
+            if (per_model.morph_flags & MORPH_FLAG_NORMAL) {
+                Buffer<float3> morph_normals = ResourceDescriptorHeap[per_model.morph_normal_descriptor];
+                normal += weight * morph_normals[i];
+            }
+            if (per_model.morph_flags & MORPH_FLAG_TANGENT) {
+                Buffer<float3> morph_tangents = ResourceDescriptorHeap[per_model.morph_tangent_descriptor];
+                tangent.xyz += weight * morph_tangents[i];
+            }
         }
     }
 
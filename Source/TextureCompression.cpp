@@ -0,0 +1,775 @@
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "File.h"
+#include "Hash.h"
+#include "MipGeneration.h"
+#include "Profiling.h"
+#include "ThreadPool.h"
+
+// Increment whenever the encoders change, so that stale cache entries are ignored.
+static constexpr uint32_t ENCODER_VERSION = 1;
+static constexpr uint32_t CACHE_MAGIC = 0x43584554; // "TEXC".
+static constexpr const char* CACHE_EXTENSION = ".texture";
+// Rows of blocks compressed by each thread pool task.
+static constexpr uint32_t BLOCK_ROWS_PER_TASK = 16;
+
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint64_t size;
+};
+
+static uint32_t GetBlockSize(DXGI_FORMAT format)
+{
+	switch (format) {
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+		case DXGI_FORMAT_BC4_UNORM:
+			return 8;
+		default:
+			return 16;
+	}
+}
+
+bool IsBlockCompressed(DXGI_FORMAT format)
+{
+	switch (format) {
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+		case DXGI_FORMAT_BC4_UNORM:
+		case DXGI_FORMAT_BC5_UNORM:
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			return true;
+		default:
+			return false;
+	}
+}
+
+const char* GetFormatName(DXGI_FORMAT format)
+{
+	switch (format) {
+		case DXGI_FORMAT_R8G8B8A8_UNORM: return "RGBA8";
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB: return "RGBA8 sRGB";
+		case DXGI_FORMAT_BC1_UNORM: return "BC1";
+		case DXGI_FORMAT_BC1_UNORM_SRGB: return "BC1 sRGB";
+		case DXGI_FORMAT_BC3_UNORM: return "BC3";
+		case DXGI_FORMAT_BC3_UNORM_SRGB: return "BC3 sRGB";
+		case DXGI_FORMAT_BC4_UNORM: return "BC4";
+		case DXGI_FORMAT_BC5_UNORM: return "BC5";
+		case DXGI_FORMAT_BC7_UNORM: return "BC7";
+		case DXGI_FORMAT_BC7_UNORM_SRGB: return "BC7 sRGB";
+		default: return "Unknown";
+	}
+}
+
+void GetSurfaceInfo(DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t* row_size, uint32_t* row_count)
+{
+	if (IsBlockCompressed(format)) {
+		*row_size = std::max((width + 3) / 4, 1u) * GetBlockSize(format);
+		*row_count = std::max((height + 3) / 4, 1u);
+	} else {
+		*row_size = width * 4;
+		*row_count = height;
+	}
+}
+
+uint64_t GetTextureSize(DXGI_FORMAT format, uint32_t width, uint32_t height)
+{
+	uint64_t size = 0;
+	uint32_t levels = GetMipLevelCount(width, height);
+	for (uint32_t i = 0; i < levels; i++) {
+		uint32_t row_size = 0;
+		uint32_t row_count = 0;
+		GetSurfaceInfo(format, width, height, &row_size, &row_count);
+		size += (uint64_t)row_size * row_count;
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
+	return size;
+}
+
+static int CountChannels(uint32_t channels)
+{
+	int count = 0;
+	for (int i = 0; i < 4; i++) {
+		count += (channels >> i) & 1;
+	}
+	return count;
+}
+
+static bool IsOpaque(const uint8_t* image, uint32_t width, uint32_t height)
+{
+	uint64_t texel_count = (uint64_t)width * height;
+	for (uint64_t i = 0; i < texel_count; i++) {
+		if (image[i * 4 + 3] != 255) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Maps the stored channels back to the channels that are read. Channels that aren't read are zero, or one for alpha.
+static uint32_t GetComponentMapping(int channel_count, const int* source_channels)
+{
+	int mapping[4] = {
+		D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_0,
+		D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_0,
+		D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_0,
+		D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_1,
+	};
+	for (int i = 0; i < channel_count; i++) {
+		mapping[source_channels[i]] = D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_0 + i;
+	}
+	return D3D12_ENCODE_SHADER_4_COMPONENT_MAPPING(mapping[0], mapping[1], mapping[2], mapping[3]);
+}
+
+TextureEncoding ChooseTextureEncoding(const uint8_t* image, uint32_t width, uint32_t height, uint32_t channels, bool srgb, bool fast)
+{
+	TextureEncoding encoding;
+	encoding.format = srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+
+	// The top level of a block compressed texture has to be a whole number of blocks.
+	if (channels == 0 || width % 4 != 0 || height % 4 != 0) {
+		return encoding;
+	}
+	if ((channels & TEXTURE_CHANNEL_A) && IsOpaque(image, width, height)) {
+		channels &= ~TEXTURE_CHANNEL_A;
+	}
+
+	// Colors keep all three channels, as they need to be filtered in sRGB.
+	int channel_count = CountChannels(channels);
+	if (srgb || channel_count > 2) {
+		bool alpha = channels & TEXTURE_CHANNEL_A;
+		if (srgb) {
+			encoding.format = alpha ? (fast ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM_SRGB) : DXGI_FORMAT_BC1_UNORM_SRGB;
+		} else if (fast) {
+			encoding.format = alpha ? DXGI_FORMAT_BC3_UNORM : DXGI_FORMAT_BC1_UNORM;
+		} else {
+			// Packed data like occlusion, roughness and metalness loses too much in BC1.
+			encoding.format = DXGI_FORMAT_BC7_UNORM;
+		}
+		return encoding;
+	}
+
+	int count = 0;
+	for (int i = 0; i < 4; i++) {
+		if (channels & (1 << i)) {
+			encoding.source_channels[count++] = i;
+		}
+	}
+	encoding.format = channel_count == 1 ? DXGI_FORMAT_BC4_UNORM : DXGI_FORMAT_BC5_UNORM;
+	encoding.component_mapping = GetComponentMapping(channel_count, encoding.source_channels);
+	return encoding;
+}
+
+// Gathers a block of texels, repeating the last row and column for levels smaller than a block.
+static void LoadBlock(const uint8_t* image, uint32_t width, uint32_t height, uint32_t block_x, uint32_t block_y, uint8_t* texels)
+{
+	for (uint32_t y = 0; y < 4; y++) {
+		uint32_t image_y = std::min(block_y * 4 + y, height - 1);
+		for (uint32_t x = 0; x < 4; x++) {
+			uint32_t image_x = std::min(block_x * 4 + x, width - 1);
+			std::memcpy(texels + (y * 4 + x) * 4, image + ((uint64_t)image_y * width + image_x) * 4, 4);
+		}
+	}
+}
+
+// Writes values to a block least significant bit first.
+class BitWriter {
+
+	public:
+
+	BitWriter(uint8_t* data, int size): data(data)
+	{
+		std::memset(data, 0, size);
+	}
+
+	void Write(uint32_t value, int bits)
+	{
+		for (int i = 0; i < bits; i++) {
+			data[position / 8] |= ((value >> i) & 1) << (position % 8);
+			position++;
+		}
+	}
+
+	private:
+
+	uint8_t* data;
+	int position = 0;
+};
+
+// Finds the axis of greatest variance of a set of points with power iteration.
+template<int N>
+static void GetPrincipalAxis(const float (*points)[N], int count, float* mean, float* axis)
+{
+	for (int c = 0; c < N; c++) {
+		mean[c] = 0.0f;
+		for (int i = 0; i < count; i++) {
+			mean[c] += points[i][c];
+		}
+		mean[c] /= count;
+	}
+	float covariance[N][N] = {};
+	for (int i = 0; i < count; i++) {
+		for (int a = 0; a < N; a++) {
+			for (int b = 0; b < N; b++) {
+				covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+			}
+		}
+	}
+
+	// Start from the diagonal of the bounding box, which is usually close already.
+	float minimum[N];
+	float maximum[N];
+	for (int c = 0; c < N; c++) {
+		minimum[c] = std::numeric_limits<float>::max();
+		maximum[c] = std::numeric_limits<float>::lowest();
+		for (int i = 0; i < count; i++) {
+			minimum[c] = std::min(minimum[c], points[i][c]);
+			maximum[c] = std::max(maximum[c], points[i][c]);
+		}
+		axis[c] = maximum[c] - minimum[c];
+	}
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float next[N] = {};
+		for (int a = 0; a < N; a++) {
+			for (int b = 0; b < N; b++) {
+				next[a] += covariance[a][b] * axis[b];
+			}
+		}
+		float length = 0.0f;
+		for (int c = 0; c < N; c++) {
+			length = std::max(length, std::abs(next[c]));
+		}
+		if (length < 1e-8f) {
+			break;
+		}
+		for (int c = 0; c < N; c++) {
+			axis[c] = next[c] / length;
+		}
+	}
+	float length = 0.0f;
+	for (int c = 0; c < N; c++) {
+		length += axis[c] * axis[c];
+	}
+	length = std::sqrt(length);
+	for (int c = 0; c < N; c++) {
+		axis[c] = length > 0.0f ? axis[c] / length : 0.0f;
+	}
+}
+
+// Endpoints at the extremes of the points projected onto their principal axis, moved inwards by inset of the range.
+template<int N>
+static void GetEndpoints(const float (*points)[N], int count, float inset, float* endpoint_0, float* endpoint_1)
+{
+	float mean[N];
+	float axis[N];
+	GetPrincipalAxis<N>(points, count, mean, axis);
+	float minimum = std::numeric_limits<float>::max();
+	float maximum = std::numeric_limits<float>::lowest();
+	for (int i = 0; i < count; i++) {
+		float t = 0.0f;
+		for (int c = 0; c < N; c++) {
+			t += (points[i][c] - mean[c]) * axis[c];
+		}
+		minimum = std::min(minimum, t);
+		maximum = std::max(maximum, t);
+	}
+	float offset = (maximum - minimum) * inset;
+	minimum += offset;
+	maximum -= offset;
+	for (int c = 0; c < N; c++) {
+		endpoint_0[c] = std::clamp(mean[c] + axis[c] * maximum, 0.0f, 255.0f);
+		endpoint_1[c] = std::clamp(mean[c] + axis[c] * minimum, 0.0f, 255.0f);
+	}
+}
+
+// Least squares endpoints for a fixed set of indices, where weights[i] is how much of endpoint 1 texel i gets.
+// Returns false if every texel uses the same weight.
+template<int N>
+static bool SolveEndpoints(const float (*points)[N], const float* weights, int count, float* endpoint_0, float* endpoint_1)
+{
+	float aa = 0.0f;
+	float ab = 0.0f;
+	float bb = 0.0f;
+	float ax[N] = {};
+	float bx[N] = {};
+	for (int i = 0; i < count; i++) {
+		float b = weights[i];
+		float a = 1.0f - b;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (int c = 0; c < N; c++) {
+			ax[c] += a * points[i][c];
+			bx[c] += b * points[i][c];
+		}
+	}
+	float determinant = aa * bb - ab * ab;
+	if (std::abs(determinant) < 1e-6f) {
+		return false;
+	}
+	for (int c = 0; c < N; c++) {
+		endpoint_0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+		endpoint_1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+	}
+	return true;
+}
+
+static uint16_t EncodeRgb565(const float* color)
+{
+	uint32_t r = std::lrint(color[0] * (31.0f / 255.0f));
+	uint32_t g = std::lrint(color[1] * (63.0f / 255.0f));
+	uint32_t b = std::lrint(color[2] * (31.0f / 255.0f));
+	return (r << 11) | (g << 5) | b;
+}
+
+static void DecodeRgb565(uint16_t packed, int* color)
+{
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+// Picks the closest of the four colors for each texel. Returns the total squared error.
+static int GetBc1Indices(const float (*colors)[3], uint16_t packed_0, uint16_t packed_1, uint8_t* indices)
+{
+	int palette[4][3];
+	DecodeRgb565(packed_0, palette[0]);
+	DecodeRgb565(packed_1, palette[1]);
+	for (int c = 0; c < 3; c++) {
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+	int total_error = 0;
+	for (int i = 0; i < 16; i++) {
+		int best_error = std::numeric_limits<int>::max();
+		for (int j = 0; j < 4; j++) {
+			int error = 0;
+			for (int c = 0; c < 3; c++) {
+				int difference = (int)colors[i][c] - palette[j][c];
+				error += difference * difference;
+			}
+			if (error < best_error) {
+				best_error = error;
+				indices[i] = j;
+			}
+		}
+		total_error += best_error;
+	}
+	return total_error;
+}
+
+static void CompressColorBlock(const uint8_t* texels, uint8_t* block)
+{
+	float colors[16][3];
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 3; c++) {
+			colors[i][c] = texels[i * 4 + c];
+		}
+	}
+	float endpoint_0[3];
+	float endpoint_1[3];
+	GetEndpoints<3>(colors, 16, 1.0f / 16.0f, endpoint_0, endpoint_1);
+	uint16_t packed_0 = EncodeRgb565(endpoint_0);
+	uint16_t packed_1 = EncodeRgb565(endpoint_1);
+	uint8_t indices[16];
+	int error = GetBc1Indices(colors, packed_0, packed_1, indices);
+
+	// Refine the endpoints once for the chosen indices.
+	static constexpr float WEIGHTS[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+	float weights[16];
+	for (int i = 0; i < 16; i++) {
+		weights[i] = WEIGHTS[indices[i]];
+	}
+	if (SolveEndpoints<3>(colors, weights, 16, endpoint_0, endpoint_1)) {
+		uint16_t refined_0 = EncodeRgb565(endpoint_0);
+		uint16_t refined_1 = EncodeRgb565(endpoint_1);
+		uint8_t refined_indices[16];
+		int refined_error = GetBc1Indices(colors, refined_0, refined_1, refined_indices);
+		if (refined_error < error) {
+			packed_0 = refined_0;
+			packed_1 = refined_1;
+			std::memcpy(indices, refined_indices, sizeof(indices));
+		}
+	}
+
+	// The first endpoint has to be larger to select four color mode. Swapping them swaps indices 0 and 1, and 2 and 3.
+	if (packed_0 < packed_1) {
+		std::swap(packed_0, packed_1);
+		for (int i = 0; i < 16; i++) {
+			indices[i] ^= 1;
+		}
+	} else if (packed_0 == packed_1) {
+		std::memset(indices, 0, sizeof(indices));
+	}
+
+	BitWriter writer(block, 8);
+	writer.Write(packed_0, 16);
+	writer.Write(packed_1, 16);
+	for (int i = 0; i < 16; i++) {
+		writer.Write(indices[i], 2);
+	}
+}
+
+// Single channel block with eight interpolated values, as used by BC3 alpha, BC4 and BC5.
+static void CompressChannelBlock(const uint8_t* texels, int channel, uint8_t* block)
+{
+	int minimum = 255;
+	int maximum = 0;
+	for (int i = 0; i < 16; i++) {
+		minimum = std::min(minimum, (int)texels[i * 4 + channel]);
+		maximum = std::max(maximum, (int)texels[i * 4 + channel]);
+	}
+	int palette[8] = {maximum, minimum};
+	for (int i = 1; i < 7; i++) {
+		palette[i + 1] = ((7 - i) * maximum + i * minimum + 3) / 7;
+	}
+
+	BitWriter writer(block, 8);
+	writer.Write(maximum, 8);
+	writer.Write(minimum, 8);
+	for (int i = 0; i < 16; i++) {
+		int value = texels[i * 4 + channel];
+		int best_index = 0;
+		int best_error = std::numeric_limits<int>::max();
+		for (int j = 0; j < 8 && maximum != minimum; j++) {
+			int error = std::abs(value - palette[j]);
+			if (error < best_error) {
+				best_error = error;
+				best_index = j;
+			}
+		}
+		writer.Write(best_index, 3);
+	}
+}
+
+void CompressBlockBc1(const uint8_t* texels, uint8_t* block)
+{
+	CompressColorBlock(texels, block);
+}
+
+void CompressBlockBc3(const uint8_t* texels, uint8_t* block)
+{
+	CompressChannelBlock(texels, 3, block);
+	CompressColorBlock(texels, block + 8);
+}
+
+void CompressBlockBc4(const uint8_t* texels, int channel, uint8_t* block)
+{
+	CompressChannelBlock(texels, channel, block);
+}
+
+void CompressBlockBc5(const uint8_t* texels, int channel_0, int channel_1, uint8_t* block)
+{
+	CompressChannelBlock(texels, channel_0, block);
+	CompressChannelBlock(texels, channel_1, block + 8);
+}
+
+static constexpr int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+struct Bc7Endpoints {
+    int quantized[2][4]; // 7 bits per channel.
+    int p_bits[2];
+    int colors[2][4]; // Quantized colors with their p-bit.
+};
+
+// Mode 6 endpoints are 7 bits per channel with a shared lowest bit, so pick whichever lowest bit is closer.
+static void QuantizeBc7Endpoint(const float* color, Bc7Endpoints* endpoints, int endpoint)
+{
+	float best_error = std::numeric_limits<float>::max();
+	for (int p_bit = 0; p_bit < 2; p_bit++) {
+		int quantized[4];
+		float error = 0.0f;
+		for (int c = 0; c < 4; c++) {
+			quantized[c] = std::clamp((int)std::lrint((color[c] - p_bit) / 2.0f), 0, 127);
+			float difference = color[c] - (quantized[c] * 2 + p_bit);
+			error += difference * difference;
+		}
+		if (error < best_error) {
+			best_error = error;
+			endpoints->p_bits[endpoint] = p_bit;
+			for (int c = 0; c < 4; c++) {
+				endpoints->quantized[endpoint][c] = quantized[c];
+				endpoints->colors[endpoint][c] = quantized[c] * 2 + p_bit;
+			}
+		}
+	}
+}
+
+static int GetBc7Indices(const float (*colors)[4], const Bc7Endpoints& endpoints, uint8_t* indices)
+{
+	int palette[16][4];
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 4; c++) {
+			palette[i][c] = ((64 - BC7_WEIGHTS[i]) * endpoints.colors[0][c] + BC7_WEIGHTS[i] * endpoints.colors[1][c] + 32) >> 6;
+		}
+	}
+	int total_error = 0;
+	for (int i = 0; i < 16; i++) {
+		int best_error = std::numeric_limits<int>::max();
+		for (int j = 0; j < 16; j++) {
+			int error = 0;
+			for (int c = 0; c < 4; c++) {
+				int difference = (int)colors[i][c] - palette[j][c];
+				error += difference * difference;
+			}
+			if (error < best_error) {
+				best_error = error;
+				indices[i] = j;
+			}
+		}
+		total_error += best_error;
+	}
+	return total_error;
+}
+
+// Only mode 6 is used, which has a single RGBA line per block. It handles smooth color and alpha well, but not blocks with sharp edges.
+void CompressBlockBc7(const uint8_t* texels, uint8_t* block)
+{
+	float colors[16][4];
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 4; c++) {
+			colors[i][c] = texels[i * 4 + c];
+		}
+	}
+	float endpoint_0[4];
+	float endpoint_1[4];
+	GetEndpoints<4>(colors, 16, 0.0f, endpoint_0, endpoint_1);
+	Bc7Endpoints endpoints;
+	QuantizeBc7Endpoint(endpoint_0, &endpoints, 0);
+	QuantizeBc7Endpoint(endpoint_1, &endpoints, 1);
+	uint8_t indices[16];
+	int error = GetBc7Indices(colors, endpoints, indices);
+
+	// Refine the endpoints once for the chosen indices.
+	float weights[16];
+	for (int i = 0; i < 16; i++) {
+		weights[i] = BC7_WEIGHTS[indices[i]] / 64.0f;
+	}
+	if (error > 0 && SolveEndpoints<4>(colors, weights, 16, endpoint_0, endpoint_1)) {
+		Bc7Endpoints refined;
+		QuantizeBc7Endpoint(endpoint_0, &refined, 0);
+		QuantizeBc7Endpoint(endpoint_1, &refined, 1);
+		uint8_t refined_indices[16];
+		int refined_error = GetBc7Indices(colors, refined, refined_indices);
+		if (refined_error < error) {
+			endpoints = refined;
+			std::memcpy(indices, refined_indices, sizeof(indices));
+		}
+	}
+
+	// The highest bit of the first index is implied to be zero, so swap the endpoints if it is set.
+	if (indices[0] & 8) {
+		for (int c = 0; c < 4; c++) {
+			std::swap(endpoints.quantized[0][c], endpoints.quantized[1][c]);
+		}
+		std::swap(endpoints.p_bits[0], endpoints.p_bits[1]);
+		for (int i = 0; i < 16; i++) {
+			indices[i] = 15 - indices[i];
+		}
+	}
+
+	BitWriter writer(block, 16);
+	writer.Write(1 << 6, 7);
+	for (int c = 0; c < 4; c++) {
+		writer.Write(endpoints.quantized[0][c], 7);
+		writer.Write(endpoints.quantized[1][c], 7);
+	}
+	writer.Write(endpoints.p_bits[0], 1);
+	writer.Write(endpoints.p_bits[1], 1);
+	writer.Write(indices[0], 3);
+	for (int i = 1; i < 16; i++) {
+		writer.Write(indices[i], 4);
+	}
+}
+
+static void CompressBlock(const TextureEncoding& encoding, const uint8_t* texels, uint8_t* block)
+{
+	switch (encoding.format) {
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+			CompressBlockBc1(texels, block);
+			break;
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+			CompressBlockBc3(texels, block);
+			break;
+		case DXGI_FORMAT_BC4_UNORM:
+			CompressBlockBc4(texels, encoding.source_channels[0], block);
+			break;
+		case DXGI_FORMAT_BC5_UNORM:
+			CompressBlockBc5(texels, encoding.source_channels[0], encoding.source_channels[1], block);
+			break;
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			CompressBlockBc7(texels, block);
+			break;
+		default:
+			assert(false);
+			break;
+	}
+}
+
+void CompressMipChain(const TextureEncoding& encoding, const uint8_t* mip_chain, uint32_t width, uint32_t height, std::vector<unsigned char>* compressed, ThreadPool* thread_pool)
+{
+	ProfileZoneScoped();
+	assert(IsBlockCompressed(encoding.format));
+	compressed->resize(GetTextureSize(encoding.format, width, height));
+
+	// Split every level into tasks of a few rows of blocks, so a single large texture still uses the whole pool.
+	struct Task {
+		const uint8_t* source;
+		uint8_t* dest;
+		uint32_t width;
+		uint32_t height;
+		uint32_t first_row;
+		uint32_t row_count;
+	};
+	std::vector<Task> tasks;
+	const uint8_t* source = mip_chain;
+	uint8_t* dest = compressed->data();
+	uint32_t levels = GetMipLevelCount(width, height);
+	for (uint32_t level = 0; level < levels; level++) {
+		uint32_t row_size = 0;
+		uint32_t row_count = 0;
+		GetSurfaceInfo(encoding.format, width, height, &row_size, &row_count);
+		for (uint32_t row = 0; row < row_count; row += BLOCK_ROWS_PER_TASK) {
+			tasks.push_back({source, dest, width, height, row, std::min(BLOCK_ROWS_PER_TASK, row_count - row)});
+		}
+		source += (uint64_t)width * height * 4;
+		dest += (uint64_t)row_size * row_count;
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
+
+	uint32_t block_size = GetBlockSize(encoding.format);
+	auto compress_task = [&](int i) {
+		const Task& task = tasks[i];
+		uint32_t blocks_x = std::max((task.width + 3) / 4, 1u);
+		uint8_t texels[16 * 4];
+		for (uint32_t y = task.first_row; y < task.first_row + task.row_count; y++) {
+			for (uint32_t x = 0; x < blocks_x; x++) {
+				LoadBlock(task.source, task.width, task.height, x, y, texels);
+				CompressBlock(encoding, texels, task.dest + ((uint64_t)y * blocks_x + x) * block_size);
+			}
+		}
+	};
+	if (thread_pool) {
+		thread_pool->ParallelFor(tasks.size(), compress_task);
+	} else {
+		for (int i = 0; i < tasks.size(); i++) {
+			compress_task(i);
+		}
+	}
+}
+
+uint64_t GetTextureCacheKey(const uint8_t* image, uint32_t width, uint32_t height, const TextureEncoding& encoding, bool srgb, float alpha_cutoff)
+{
+	ProfileZoneScoped();
+	struct {
+		uint64_t image_hash;
+		uint32_t encoder_version;
+		uint32_t width;
+		uint32_t height;
+		uint32_t format;
+		int32_t source_channels[2];
+		uint32_t srgb;
+		float alpha_cutoff;
+	} key = {
+		.image_hash = Hash(image, (uint64_t)width * height * 4),
+		.encoder_version = ENCODER_VERSION,
+		.width = width,
+		.height = height,
+		.format = (uint32_t)encoding.format,
+		.source_channels = {encoding.source_channels[0], encoding.source_channels[1]},
+		.srgb = srgb,
+		.alpha_cutoff = alpha_cutoff,
+	};
+	return Hash(&key, sizeof(key));
+}
+
+static std::filesystem::path GetCachePath(const char* directory, uint64_t key)
+{
+	char filename[32];
+	snprintf(filename, sizeof(filename), "%016llx%s", (unsigned long long)key, CACHE_EXTENSION);
+	return std::filesystem::path(directory) / filename;
+}
+
+bool LoadCachedTexture(const char* directory, uint64_t key, uint64_t size, std::vector<unsigned char>* data)
+{
+	ProfileZoneScoped();
+	std::error_code error;
+	std::filesystem::path path = GetCachePath(directory, key);
+	if (!std::filesystem::exists(path, error)) {
+		return false;
+	}
+	uint64_t file_size = 0;
+	void* file = File::Map(path.string().c_str(), &file_size);
+	if (!file) {
+		return false;
+	}
+	CacheHeader header;
+	bool valid = file_size >= sizeof(header);
+	if (valid) {
+		std::memcpy(&header, file, sizeof(header));
+		valid = header.magic == CACHE_MAGIC && header.version == ENCODER_VERSION && header.key == key && header.size == size && file_size - sizeof(header) == size;
+	}
+	if (valid) {
+		data->resize(size);
+		std::memcpy(data->data(), (const std::byte*)file + sizeof(header), size);
+	}
+	File::Unmap(file, file_size);
+	return valid;
+}
+
+bool SaveCachedTexture(const char* directory, uint64_t key, const std::vector<unsigned char>& data)
+{
+	ProfileZoneScoped();
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error) {
+		return false;
+	}
+
+	// Write to a temporary file first, so a partially written file is never read.
+	std::filesystem::path path = GetCachePath(directory, key);
+	std::filesystem::path temporary_path = path;
+	temporary_path += "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+	{
+		std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+		CacheHeader header = {CACHE_MAGIC, ENCODER_VERSION, key, data.size()};
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)data.data(), data.size());
+		if (!file.good()) {
+			file.close();
+			std::filesystem::remove(temporary_path, error);
+			return false;
+		}
+	}
+	std::filesystem::rename(temporary_path, path, error);
+	if (error) {
+		std::filesystem::remove(temporary_path, error);
+		return false;
+	}
+	return true;
+}
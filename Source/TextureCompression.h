@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <directx/d3d12.h>
+#include <directx/dxgiformat.h>
+
+class ThreadPool;
+
+// CPU block compression for RGBA8 mip chains, see MipGeneration.h.
+// A compressed mip chain stores every level one after the other, each level as tightly packed rows of 4x4 blocks.
+
+// Channels of a texture that a material reads.
+enum TextureChannel {
+    TEXTURE_CHANNEL_R = 1 << 0,
+    TEXTURE_CHANNEL_G = 1 << 1,
+    TEXTURE_CHANNEL_B = 1 << 2,
+    TEXTURE_CHANNEL_A = 1 << 3,
+    TEXTURE_CHANNEL_RGB = TEXTURE_CHANNEL_R | TEXTURE_CHANNEL_G | TEXTURE_CHANNEL_B,
+};
+
+struct TextureEncoding {
+    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+    // BC4 and BC5 store only the channels that are read, in red and green. The view maps them back to where the shader expects them.
+    int source_channels[2] = {0, 1};
+    uint32_t component_mapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+};
+
+bool IsBlockCompressed(DXGI_FORMAT format);
+const char* GetFormatName(DXGI_FORMAT format);
+// Layout of one level of a texture. For block compressed formats a row is a row of blocks.
+void GetSurfaceInfo(DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t* row_size, uint32_t* row_count);
+// Size in bytes of a full mip chain in any supported format.
+uint64_t GetTextureSize(DXGI_FORMAT format, uint32_t width, uint32_t height);
+
+// Picks the smallest format that keeps the channels that are read. Alpha is dropped if every texel is opaque.
+// Fast compression uses BC1 and BC3 instead of BC7. Textures that can't be block compressed stay RGBA8.
+TextureEncoding ChooseTextureEncoding(const uint8_t* image, uint32_t width, uint32_t height, uint32_t channels, bool srgb, bool fast);
+// Compresses a full RGBA8 mip chain, splitting the blocks across the thread pool.
+void CompressMipChain(const TextureEncoding& encoding, const uint8_t* mip_chain, uint32_t width, uint32_t height, std::vector<unsigned char>* compressed, ThreadPool* thread_pool);
+
+// Single block encoders. Texels are 16 RGBA8 values in row order.
+void CompressBlockBc1(const uint8_t* texels, uint8_t* block);
+void CompressBlockBc3(const uint8_t* texels, uint8_t* block);
+void CompressBlockBc4(const uint8_t* texels, int channel, uint8_t* block);
+void CompressBlockBc5(const uint8_t* texels, int channel_0, int channel_1, uint8_t* block);
+void CompressBlockBc7(const uint8_t* texels, uint8_t* block);
+
+// Compressed textures are cached on disk, keyed on the level 0 image and everything that affects how it is compressed.
+uint64_t GetTextureCacheKey(const uint8_t* image, uint32_t width, uint32_t height, const TextureEncoding& encoding, bool srgb, float alpha_cutoff);
+bool LoadCachedTexture(const char* directory, uint64_t key, uint64_t size, std::vector<unsigned char>* data);
+bool SaveCachedTexture(const char* directory, uint64_t key, const std::vector<unsigned char>& data);
@@ -0,0 +1,132 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "Profiling.h"
+
+void ThreadPool::Create(int thread_count)
+{
+	ProfileZoneScoped();
+	if (thread_count <= 0) {
+		thread_count = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+	}
+	running = true;
+	threads.reserve(thread_count);
+	for (int i = 0; i < thread_count; i++) {
+		threads.emplace_back(&ThreadPool::WorkerThread, this, i);
+	}
+}
+
+void ThreadPool::Destroy()
+{
+	ProfileZoneScoped();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+	job_available.notify_all();
+	for (std::thread& thread: threads) {
+		thread.join();
+	}
+	threads.clear();
+}
+
+int ThreadPool::GetThreadCount() const
+{
+	return threads.size();
+}
+
+void ThreadPool::Submit(Job job)
+{
+	if (threads.empty()) {
+		// No workers, so run the job immediately.
+		job();
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.emplace_back(std::move(job));
+	}
+	job_available.notify_one();
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& lambda)
+{
+	ProfileZoneScoped();
+	if (count <= 0) {
+		return;
+	}
+
+	// The calling thread also takes part, so one less helper than iterations is needed.
+	// Only iterations are waited for, not helpers. A helper that starts after every iteration has been taken finds nothing to do,
+	// so the counters are shared with it rather than kept on this stack frame, and lambda is never called once this returns.
+	// This stops a short loop from waiting behind long jobs that are queued ahead of its helpers.
+	struct Counters {
+		std::atomic<int> next = 0;
+		std::atomic<int> completed = 0;
+	};
+	int helper_count = std::min((int)threads.size(), count - 1);
+	std::shared_ptr<Counters> counters = std::make_shared<Counters>();
+	const std::function<void(int)>* iteration = &lambda;
+	auto run_iterations = [this, counters, count, iteration]() {
+		int finished = 0;
+		for (int i = counters->next.fetch_add(1); i < count; i = counters->next.fetch_add(1)) {
+			(*iteration)(i);
+			finished++;
+		}
+		if (finished > 0 && counters->completed.fetch_add(finished) + finished == count) {
+			// Take the lock so the waiting thread can't miss the notification between checking and waiting.
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+			}
+			job_complete.notify_all();
+		}
+	};
+	for (int i = 0; i < helper_count; i++) {
+		Submit(run_iterations);
+	}
+	run_iterations();
+
+	// Only wait for iterations that helpers are still running. Other queued jobs aren't picked up, as one could be a long loader task
+	// that would stall a per frame loop on the main thread.
+	std::unique_lock<std::mutex> lock(mutex);
+	job_complete.wait(lock, [&]() {
+		return counters->completed == count;
+	});
+}
+
+void ThreadPool::ParallelForRanges(int count, int range_size, const std::function<void(int, int)>& lambda)
+{
+	if (count <= range_size) {
+		if (count > 0) {
+			lambda(0, count);
+		}
+		return;
+	}
+	int range_count = (count + range_size - 1) / range_size;
+	ParallelFor(range_count, [&](int i) {
+		lambda(i * range_size, std::min((i + 1) * range_size, count));
+	});
+}
+
+void ThreadPool::WorkerThread(int index)
+{
+	std::string name = "Worker " + std::to_string(index);
+	ProfileSetThreadName(name.c_str());
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		job_available.wait(lock, [this]() { return !running || !jobs.empty(); });
+		// Drain any remaining jobs before shutting down.
+		if (jobs.empty()) {
+			return;
+		}
+		Job job = std::move(jobs.front());
+		jobs.pop_front();
+		lock.unlock();
+		job();
+		lock.lock();
+	}
+}
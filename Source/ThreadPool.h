@@ -0,0 +1,37 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+    public:
+
+    using Job = std::function<void()>;
+
+    // A thread count of 0 creates one worker per hardware thread, leaving one for the calling thread.
+    void Create(int thread_count = 0);
+    void Destroy();
+    int GetThreadCount() const;
+    void Submit(Job job);
+    // Calls lambda(i) for every i in [0, count) across the workers and the calling thread.
+    // Returns once every iteration has completed.
+    void ParallelFor(int count, const std::function<void(int)>& lambda);
+    // Calls lambda(begin, end) for consecutive ranges of at most range_size iterations that cover [0, count).
+    // Use for small iterations, where a call per iteration would cost more than the work. A single range runs on the calling thread.
+    void ParallelForRanges(int count, int range_size, const std::function<void(int, int)>& lambda);
+
+    private:
+
+    std::vector<std::thread> threads;
+    std::deque<Job> jobs;
+    std::mutex mutex;
+    std::condition_variable job_available;
+    std::condition_variable job_complete;
+    bool running = false;
+
+    void WorkerThread(int index);
+};
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <cassert>
 #include <cstddef>
+#include <cstring>
 #include <functional>
 #include <algorithm>
+#include <vector>
 
 #include <directx/d3d12.h>
 #include <glm/gtc/packing.hpp>
@@ -57,12 +60,58 @@ inline int GetStride(const tinygltf::Model* model, const tinygltf::Accessor* acc
     }
 }
 
+// Buffer data that is stored outside of tinygltf::Buffer::data, such as the BIN chunk of a memory mapped .glb.
+struct ExternalBuffer {
+    const tinygltf::Buffer* buffer;
+    std::byte* data;
+    size_t size;
+};
+
+// Only modified while no accessors are being read.
+inline std::vector<ExternalBuffer> external_buffers;
+
+inline void AddExternalBuffer(const tinygltf::Buffer* buffer, std::byte* data, size_t size)
+{
+    external_buffers.push_back({buffer, data, size});
+}
+
+inline void ClearExternalBuffers()
+{
+    external_buffers.clear();
+}
+
+inline std::byte* GetBufferData(const tinygltf::Model* model, int buffer_id)
+{
+    const tinygltf::Buffer* buffer = &model->buffers[buffer_id];
+    for (const ExternalBuffer& external_buffer: external_buffers) {
+        if (external_buffer.buffer == buffer) {
+            return external_buffer.data;
+        }
+    }
+    return (std::byte*)buffer->data.data();
+}
+
+inline size_t GetBufferSize(const tinygltf::Model* model, int buffer_id)
+{
+    const tinygltf::Buffer* buffer = &model->buffers[buffer_id];
+    for (const ExternalBuffer& external_buffer: external_buffers) {
+        if (external_buffer.buffer == buffer) {
+            return external_buffer.size;
+        }
+    }
+    return buffer->data.size();
+}
+
+inline std::byte* GetBufferViewPtr(const tinygltf::Model* model, int buffer_view_id)
+{
+    const tinygltf::BufferView& buffer_view = model->bufferViews[buffer_view_id];
+    return GetBufferData(model, buffer_view.buffer) + buffer_view.byteOffset;
+}
+
 inline std::byte* GetBufferPtr(const tinygltf::Model* model, const tinygltf::Accessor* accessor)
 {
     if (accessor->bufferView != -1) {
-        const tinygltf::BufferView& buffer_view = model->bufferViews[accessor->bufferView];
-        const tinygltf::Buffer& buffer = model->buffers[buffer_view.buffer];
-        return (std::byte*)&buffer.data[accessor->byteOffset + buffer_view.byteOffset];
+        return GetBufferViewPtr(model, accessor->bufferView) + accessor->byteOffset;
     }
 	return nullptr;
 }
@@ -70,9 +119,7 @@ inline std::byte* GetBufferPtr(const tinygltf::Model* model, const tinygltf::Acc
 inline std::byte* GetSparseIndexPtr(const tinygltf::Model* model, const tinygltf::Accessor* accessor)
 {
     if (accessor->sparse.isSparse) {
-        const tinygltf::BufferView& sparse_index_buffer_view = model->bufferViews[accessor->sparse.indices.bufferView];
-        const tinygltf::Buffer& sparse_index_buffer = model->buffers[sparse_index_buffer_view.buffer];
-        return (std::byte*)&sparse_index_buffer.data[accessor->sparse.indices.byteOffset + sparse_index_buffer_view.byteOffset];
+        return GetBufferViewPtr(model, accessor->sparse.indices.bufferView) + accessor->sparse.indices.byteOffset;
     }
 	return nullptr;
 }
@@ -89,9 +136,7 @@ inline int GetSparseIndexStride(const tinygltf::Model* model, const tinygltf::Ac
 inline std::byte* GetSparseValuePtr(const tinygltf::Model* model, const tinygltf::Accessor* accessor)
 {
     if (accessor->sparse.isSparse) {
-        const tinygltf::BufferView& sparse_values_buffer_view = model->bufferViews[accessor->sparse.values.bufferView];
-        const tinygltf::Buffer& sparse_values_buffer = model->buffers[sparse_values_buffer_view.buffer];
-        return (std::byte*)&sparse_values_buffer.data[accessor->sparse.values.byteOffset + sparse_values_buffer_view.byteOffset];
+        return GetBufferViewPtr(model, accessor->sparse.values.bufferView) + accessor->sparse.values.byteOffset;
     }
 	return nullptr;
 }
@@ -212,10 +257,12 @@ inline glm::vec<L, T> Convert(const std::byte* data, bool normalized, uint32_t i
 {
     glm::vec<L, T> result;
     for (int i = 0; i < std::min((uint32_t)L, input_components); i++) {
-        result[i] = Convert<T, NORMALIZE>(data + tinygltf::GetComponentSizeInBytes(input_type) * i, normalized, input_type);
+        // Accessors without a buffer view have no data and are zero.
+        result[i] = data ? Convert<T, NORMALIZE>(data + tinygltf::GetComponentSizeInBytes(input_type) * i, normalized, input_type) : (T)0;
     }
+    // Missing components default to one, which is the maximum value for normalized data.
     for (int i = input_components; i < L; i++) {
-        result[i] = (T)1;
+        result[i] = normalized || NORMALIZE ? PackNormalizedValue<T>(1.0f) : (T)1;
     } 
     return result;
 }
@@ -243,7 +290,7 @@ class RawIterator {
         std::byte* raw = nullptr;
         if (accessor->sparse.isSparse && sparse_index == data_i) {
             // Get the sparse data.
-            raw = sparse_values + sparse_index * sparse_values_stride;
+            raw = sparse_values + sparse_i * sparse_values_stride;
         } else {
             // Get the original data.
             raw = data + data_i * data_stride;
@@ -325,46 +372,263 @@ inline void Iterate(const tinygltf::Model* model, tinygltf::Accessor* accessor,
     }
 }
 
+// Bulk conversion of accessor data.
+// The component type, component count, normalization and stride are dispatched once per accessor, so the per element conversion is fully inlined and can be vectorized by the compiler.
+
+template<typename S>
+inline float UnpackNormalizedComponent(S value)
+{
+    if constexpr (std::is_same_v<uint8_t, S>) {
+        return glm::unpackUnorm1x8(value);
+    } else if constexpr (std::is_same_v<int8_t, S>) {
+        return glm::unpackSnorm1x8(value);
+    } else if constexpr (std::is_same_v<uint16_t, S>) {
+        return glm::unpackUnorm1x16(value);
+    } else if constexpr (std::is_same_v<int16_t, S>) {
+        return glm::unpackSnorm1x16(value);
+    } else if constexpr (std::is_same_v<uint32_t, S>) {
+        return glm::unpackUnorm<float, 1, uint32_t, glm::defaultp>(glm::u32vec1(value)).x;
+    } else if constexpr (std::is_same_v<int32_t, S>) {
+        return glm::unpackSnorm<float, 1, int32_t, glm::defaultp>(glm::i32vec1(value)).x;
+    } else {
+        return value;
+    }
+}
+
+// Matches Convert<T, NORMALIZE>() for a single component.
+template<typename T, typename S, bool NORMALIZED>
+inline T ConvertComponent(S value)
+{
+    if constexpr (std::is_same_v<T, S>) {
+        return value;
+    } else if constexpr (NORMALIZED && std::is_same_v<uint8_t, S> && std::is_same_v<uint16_t, T>) {
+        // Exact integer form of PackNormalizedValue<uint16_t>(UnpackNormalizedComponent(value)).
+        return (uint16_t)(value * 257);
+    } else if constexpr (NORMALIZED) {
+        return PackNormalizedValue<T>(UnpackNormalizedComponent(value));
+    } else {
+        return (T)value;
+    }
+}
+
+// Converts count elements of C components of type S. Packed data uses compile time strides.
+template<glm::length_t L, typename T, bool NORMALIZED, typename S, int C, bool PACKED>
+inline void ConvertElements(const std::byte* data, size_t stride, size_t count, glm::vec<L, T>* output, size_t output_stride)
+{
+    constexpr int N = std::min<int>(L, C);
+    constexpr size_t INPUT_SIZE = sizeof(S) * C;
+    constexpr size_t OUTPUT_SIZE = sizeof(glm::vec<L, T>);
+    if constexpr (PACKED) {
+        stride = INPUT_SIZE;
+        output_stride = OUTPUT_SIZE;
+    }
+    const T missing = NORMALIZED ? PackNormalizedValue<T>(1.0f) : (T)1;
+    std::byte* out = (std::byte*)output;
+    for (size_t i = 0; i < count; i++) {
+        S components[C];
+        std::memcpy(components, data + i * stride, INPUT_SIZE);
+        glm::vec<L, T> result;
+        for (int j = 0; j < N; j++) {
+            result[j] = ConvertComponent<T, S, NORMALIZED>(components[j]);
+        }
+        for (int j = N; j < L; j++) {
+            result[j] = missing;
+        }
+        std::memcpy(out + i * output_stride, &result, OUTPUT_SIZE);
+    }
+}
+
+template<glm::length_t L, typename T, bool NORMALIZED, typename S, int C>
+inline void ConvertElements(const std::byte* data, size_t stride, size_t count, glm::vec<L, T>* output, size_t output_stride)
+{
+    if (stride == sizeof(S) * C && output_stride == sizeof(glm::vec<L, T>)) {
+        ConvertElements<L, T, NORMALIZED, S, C, true>(data, stride, count, output, output_stride);
+    } else {
+        ConvertElements<L, T, NORMALIZED, S, C, false>(data, stride, count, output, output_stride);
+    }
+}
+
+template<glm::length_t L, typename T, bool NORMALIZE, typename S>
+inline bool ConvertElements(const std::byte* data, size_t stride, size_t count, int num_of_components, bool normalized, glm::vec<L, T>* output, size_t output_stride)
+{
+    // Normalization is only applied between different types, the same as Convert<T, NORMALIZE>().
+    if (NORMALIZE || normalized) {
+        switch (num_of_components) {
+            case 1: ConvertElements<L, T, true, S, 1>(data, stride, count, output, output_stride); return true;
+            case 2: ConvertElements<L, T, true, S, 2>(data, stride, count, output, output_stride); return true;
+            case 3: ConvertElements<L, T, true, S, 3>(data, stride, count, output, output_stride); return true;
+            case 4: ConvertElements<L, T, true, S, 4>(data, stride, count, output, output_stride); return true;
+            default: return false;
+        }
+    } else {
+        switch (num_of_components) {
+            case 1: ConvertElements<L, T, false, S, 1>(data, stride, count, output, output_stride); return true;
+            case 2: ConvertElements<L, T, false, S, 2>(data, stride, count, output, output_stride); return true;
+            case 3: ConvertElements<L, T, false, S, 3>(data, stride, count, output, output_stride); return true;
+            case 4: ConvertElements<L, T, false, S, 4>(data, stride, count, output, output_stride); return true;
+            default: return false;
+        }
+    }
+}
+
+// Returns false if there is no fast path for the accessor, such as for matrices.
+template<glm::length_t L, typename T, bool NORMALIZE = false>
+inline bool ConvertElements(const std::byte* data, size_t stride, size_t count, uint32_t component_type, int num_of_components, bool normalized, glm::vec<L, T>* output, size_t output_stride)
+{
+    switch (component_type) {
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            return ConvertElements<L, T, NORMALIZE, uint8_t>(data, stride, count, num_of_components, normalized, output, output_stride);
+        case TINYGLTF_COMPONENT_TYPE_BYTE:
+            return ConvertElements<L, T, NORMALIZE, int8_t>(data, stride, count, num_of_components, normalized, output, output_stride);
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+            return ConvertElements<L, T, NORMALIZE, uint16_t>(data, stride, count, num_of_components, normalized, output, output_stride);
+        case TINYGLTF_COMPONENT_TYPE_SHORT:
+            return ConvertElements<L, T, NORMALIZE, int16_t>(data, stride, count, num_of_components, normalized, output, output_stride);
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+            return ConvertElements<L, T, NORMALIZE, uint32_t>(data, stride, count, num_of_components, normalized, output, output_stride);
+        case TINYGLTF_COMPONENT_TYPE_INT:
+            return ConvertElements<L, T, NORMALIZE, int32_t>(data, stride, count, num_of_components, normalized, output, output_stride);
+        case TINYGLTF_COMPONENT_TYPE_FLOAT:
+            return ConvertElements<L, T, NORMALIZE, float>(data, stride, count, num_of_components, normalized, output, output_stride);
+        default:
+            return false;
+    }
+}
+
+template<size_t SIZE>
+inline void GatherElements(const std::byte* data, size_t stride, size_t count, std::byte* output)
+{
+    for (size_t i = 0; i < count; i++) {
+        std::memcpy(output + i * SIZE, data + i * stride, SIZE);
+    }
+}
+
+// Copies count elements of element_size bytes from strided data into tightly packed output.
+inline void GatherElements(const std::byte* data, size_t stride, size_t element_size, size_t count, std::byte* output)
+{
+    switch (element_size) {
+        case 1: GatherElements<1>(data, stride, count, output); break;
+        case 2: GatherElements<2>(data, stride, count, output); break;
+        case 4: GatherElements<4>(data, stride, count, output); break;
+        case 8: GatherElements<8>(data, stride, count, output); break;
+        case 12: GatherElements<12>(data, stride, count, output); break;
+        case 16: GatherElements<16>(data, stride, count, output); break;
+        default:
+            for (size_t i = 0; i < count; i++) {
+                std::memcpy(output + i * element_size, data + i * stride, element_size);
+            }
+            break;
+    }
+}
+
+template<typename I>
+inline void ScatterElements(const std::byte* values, size_t value_stride, size_t element_size, const std::byte* indices, size_t index_stride, size_t count, size_t output_count, std::byte* output, size_t output_stride)
+{
+    for (size_t i = 0; i < count; i++) {
+        I index;
+        std::memcpy(&index, indices + i * index_stride, sizeof(I));
+        if (index < output_count) {
+            std::memcpy(output + index * output_stride, values + i * value_stride, element_size);
+        }
+    }
+}
+
+// Copies count elements of element_size bytes to the positions given by sparse indices. Indices that are out of range are ignored.
+inline void ScatterElements(const std::byte* values, size_t value_stride, size_t element_size, const std::byte* indices, size_t index_stride, uint32_t index_type, size_t count, size_t output_count, std::byte* output, size_t output_stride)
+{
+    switch (index_type) {
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            ScatterElements<uint8_t>(values, value_stride, element_size, indices, index_stride, count, output_count, output, output_stride);
+            break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+            ScatterElements<uint16_t>(values, value_stride, element_size, indices, index_stride, count, output_count, output, output_stride);
+            break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+            ScatterElements<uint32_t>(values, value_stride, element_size, indices, index_stride, count, output_count, output, output_stride);
+            break;
+        default:
+            break;
+    }
+}
+
 // Performs a raw copy with no conversion for data that is stored contiguously.
+// Only the base data is copied, sparse values have to be applied afterwards.
 inline void CopyContiguous(const tinygltf::Model* model, const tinygltf::Accessor* accessor, void* output)
 {
-    assert(!accessor->sparse.isSparse);
     assert(GetStride(model, accessor) == GetTypeSize(accessor));
     std::memcpy(output, GetBufferPtr(model, accessor), accessor->count * GetTypeSize(accessor));
 }
 
+// Overwrites the base data of a sparse accessor with its converted sparse values.
 template<glm::length_t L, typename T, bool NORMALIZE = false>
-inline void Copy(glm::vec<L, T>* output, const tinygltf::Model* model, tinygltf::Accessor* accessor)
+inline bool ApplySparse(glm::vec<L, T>* output, size_t output_stride, const tinygltf::Model* model, tinygltf::Accessor* accessor)
+{
+    ProfileZoneScoped();
+    // Convert the values in bulk, then move each one to its index.
+    std::vector<glm::vec<L, T>> values(accessor->sparse.count);
+    if (!ConvertElements<L, T, NORMALIZE>(GetSparseValuePtr(model, accessor), GetSparseValueStride(model, accessor), values.size(), accessor->componentType, tinygltf::GetNumComponentsInType(accessor->type), accessor->normalized, values.data(), sizeof(glm::vec<L, T>))) {
+        return false;
+    }
+    ScatterElements((std::byte*)values.data(), sizeof(glm::vec<L, T>), sizeof(glm::vec<L, T>), GetSparseIndexPtr(model, accessor), GetSparseIndexStride(model, accessor), accessor->sparse.indices.componentType, values.size(), accessor->count, (std::byte*)output, output_stride);
+    return true;
+}
+
+// Copies into output elements that are output_stride bytes apart, such as a member of an array of structs.
+// Sparse accessors are copied as their base data, or zeros if there is no buffer view, followed by a scatter of the sparse values.
+template<glm::length_t L, typename T, bool NORMALIZE = false>
+inline void Copy(glm::vec<L, T>* output, size_t output_stride, const tinygltf::Model* model, tinygltf::Accessor* accessor)
 {
     ProfileZoneScoped();
     // Check if conversion is required.
-    bool same_dimension = tinygltf::GetNumComponentsInType(accessor->type) == L;
+    int num_of_components = tinygltf::GetNumComponentsInType(accessor->type);
+    bool same_dimension = num_of_components == L;
     bool same_component = IsSameType<T>(accessor->componentType);
     bool contiguous = GetStride(model, accessor) == GetTypeSize(accessor);
-    if (same_dimension && same_component && contiguous && !accessor->sparse.isSparse) {
+    bool packed_output = output_stride == sizeof(glm::vec<L, T>);
+    bool converted = false;
+    if (accessor->bufferView == -1 && num_of_components >= L && packed_output) {
+        std::memset(output, 0, accessor->count * sizeof(glm::vec<L, T>));
+        converted = true;
+    } else if (accessor->bufferView == -1) {
+        // Converting a single zero element with a stride of zero gives the same result as the iterator.
+        static const std::byte zeros[sizeof(uint32_t) * 4] = {};
+        converted = ConvertElements<L, T, NORMALIZE>(zeros, 0, accessor->count, accessor->componentType, num_of_components, accessor->normalized, output, output_stride);
+    } else if (same_dimension && same_component && contiguous && packed_output) {
         CopyContiguous(model, accessor, output);
+        converted = true;
     } else {
+        converted = ConvertElements<L, T, NORMALIZE>(GetBufferPtr(model, accessor), GetStride(model, accessor), accessor->count, accessor->componentType, num_of_components, accessor->normalized, output, output_stride);
+    }
+    if (converted && accessor->sparse.isSparse) {
+        converted = ApplySparse<L, T, NORMALIZE>(output, output_stride, model, accessor);
+    }
+    if (!converted) {
         Iterate<L, T, NORMALIZE>(model, accessor, [&](int i, const glm::vec<L, T>& data) {
-            output[i] = data;
+            *(glm::vec<L, T>*)((std::byte*)output + i * output_stride) = data;
         });
     }
 }
 
+template<glm::length_t L, typename T, bool NORMALIZE = false>
+inline void Copy(glm::vec<L, T>* output, const tinygltf::Model* model, tinygltf::Accessor* accessor)
+{
+    Copy<L, T, NORMALIZE>(output, sizeof(glm::vec<L, T>), model, accessor);
+}
+
 // Copy without conversion.
 inline void Copy(std::byte* out, const tinygltf::Model* model, tinygltf::Accessor* accessor)
 {
     ProfileZoneScoped();
     int element_size = GetTypeSize(accessor);
-    if (IsContiguous(model, accessor)) {
+    if (accessor->bufferView == -1) {
+        std::memset(out, 0, accessor->count * element_size);
+    } else if (IsContiguous(model, accessor)) {
         CopyContiguous(model, accessor, out);
     } else {
-        IterateRaw(model, accessor, [&](int i, std::byte* data) {
-            if (data) {
-                std::memcpy(&out[i * element_size], data, element_size);
-            } else {
-                std::memset(&out[i * element_size], 0, element_size);
-            }
-        });
+        GatherElements(GetBufferPtr(model, accessor), GetStride(model, accessor), element_size, accessor->count, out);
+    }
+    if (accessor->sparse.isSparse) {
+        ScatterElements(GetSparseValuePtr(model, accessor), GetSparseValueStride(model, accessor), element_size, GetSparseIndexPtr(model, accessor), GetSparseIndexStride(model, accessor), accessor->sparse.indices.componentType, accessor->sparse.count, accessor->count, out, element_size);
     }
 }
 
@@ -0,0 +1,310 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+
+#include <glm/ext/matrix_transform.hpp>
+
+#include "Profiling.h"
+#include "ThreadPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_HIERARCHY_SSE2
+#include <emmintrin.h>
+#endif
+
+// Subtrees with more nodes than this are split between threads.
+static constexpr int TASK_SIZE = 2048;
+
+AffineTransform ToAffineTransform(const glm::mat4x4& matrix)
+{
+	glm::mat4x4 transposed = glm::transpose(matrix);
+	return {transposed[0], transposed[1], transposed[2]};
+}
+
+glm::mat4x4 ToMatrix(const AffineTransform& transform)
+{
+	return glm::transpose(glm::mat4x4(transform.rows[0], transform.rows[1], transform.rows[2], glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+}
+
+AffineTransform ComposeAffineTransform(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+	// The rotation matrix with each column scaled, then the translation as the last column.
+	glm::mat3x3 r = glm::mat3_cast(rotation);
+	return {
+		glm::vec4(r[0][0] * scale.x, r[1][0] * scale.y, r[2][0] * scale.z, translation.x),
+		glm::vec4(r[0][1] * scale.x, r[1][1] * scale.y, r[2][1] * scale.z, translation.y),
+		glm::vec4(r[0][2] * scale.x, r[1][2] * scale.y, r[2][2] * scale.z, translation.z),
+	};
+}
+
+AffineTransform MultiplyAffineTransforms(const AffineTransform& a, const AffineTransform& b)
+{
+	// Each row of the result is a weighted sum of the rows of b, plus the translation of a.
+	AffineTransform result;
+#ifdef TRANSFORM_HIERARCHY_SSE2
+	const __m128 b0 = _mm_load_ps(&b.rows[0].x);
+	const __m128 b1 = _mm_load_ps(&b.rows[1].x);
+	const __m128 b2 = _mm_load_ps(&b.rows[2].x);
+	const __m128 translation_mask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+	for (int i = 0; i < 3; i++) {
+		__m128 row = _mm_load_ps(&a.rows[i].x);
+		__m128 sum = _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+		sum = _mm_add_ps(sum, _mm_and_ps(row, translation_mask));
+		_mm_store_ps(&result.rows[i].x, sum);
+	}
+#else
+	for (int i = 0; i < 3; i++) {
+		const glm::vec4& row = a.rows[i];
+		result.rows[i] = row.x * b.rows[0] + row.y * b.rows[1] + row.z * b.rows[2] + glm::vec4(0.0f, 0.0f, 0.0f, row.w);
+	}
+#endif
+	return result;
+}
+
+void TransformHierarchy::Build(const std::vector<int>& children, const std::vector<int>& siblings)
+{
+	ProfileZoneScoped();
+	int num_of_nodes = children.size();
+	Clear();
+	this->positions.assign(num_of_nodes, -1);
+	this->order.reserve(num_of_nodes);
+	this->parents.reserve(num_of_nodes);
+
+	// Roots are nodes that are not linked to by any other node.
+	std::vector<bool> linked(num_of_nodes, false);
+	for (int i = 0; i < num_of_nodes; i++) {
+		if (children[i] != -1) {
+			linked[children[i]] = true;
+		}
+		if (siblings[i] != -1) {
+			linked[siblings[i]] = true;
+		}
+	}
+
+	struct StackEntry {
+		int node;
+		int parent;
+	};
+	std::vector<StackEntry> stack;
+	auto place = [&](int root) {
+		stack.push_back({root, -1});
+		while (!stack.empty()) {
+			StackEntry entry = stack.back();
+			stack.pop_back();
+			if (this->positions[entry.node] != -1) {
+				continue;
+			}
+			int position = this->order.size();
+			this->positions[entry.node] = position;
+			this->order.push_back(entry.node);
+			this->parents.push_back(entry.parent);
+			// The count stops a cycle of siblings from looping forever.
+			// Children are reversed on the stack so they are placed in the order they are linked, the same order as a recursive traversal.
+			int first_child = stack.size();
+			int count = 0;
+			for (int i = children[entry.node]; i != -1 && count < num_of_nodes; i = siblings[i], count++) {
+				stack.push_back({i, position});
+			}
+			std::reverse(stack.begin() + first_child, stack.end());
+		}
+	};
+	for (int i = 0; i < num_of_nodes; i++) {
+		if (!linked[i]) {
+			place(i);
+		}
+	}
+	for (int i = 0; i < num_of_nodes; i++) {
+		if (this->positions[i] == -1) {
+			place(i);
+		}
+	}
+
+	// Subtrees are contiguous, so each one ends where the last subtree of its children ends.
+	this->subtree_ends.resize(num_of_nodes);
+	for (int i = 0; i < num_of_nodes; i++) {
+		this->subtree_ends[i] = i + 1;
+	}
+	for (int i = num_of_nodes - 1; i >= 0; i--) {
+		if (this->parents[i] != -1) {
+			this->subtree_ends[this->parents[i]] = std::max(this->subtree_ends[this->parents[i]], this->subtree_ends[i]);
+		}
+	}
+
+	AffineTransform identity = ToAffineTransform(glm::mat4x4(1.0f));
+	this->translations.assign(num_of_nodes, glm::vec3(0.0f));
+	this->rotations.assign(num_of_nodes, glm::identity<glm::quat>());
+	this->scales.assign(num_of_nodes, glm::vec3(1.0f));
+	this->global_transforms.assign(num_of_nodes, identity);
+	this->previous_global_transforms.assign(num_of_nodes, identity);
+	this->dirty.assign(num_of_nodes, false);
+	Invalidate();
+}
+
+void TransformHierarchy::Clear()
+{
+	this->order.clear();
+	this->positions.clear();
+	this->parents.clear();
+	this->subtree_ends.clear();
+	this->translations.clear();
+	this->rotations.clear();
+	this->scales.clear();
+	this->global_transforms.clear();
+	this->previous_global_transforms.clear();
+	this->dirty.clear();
+	this->dirty_positions.clear();
+	this->moved_subtrees.clear();
+	this->tasks.clear();
+	this->split_stack.clear();
+}
+
+void TransformHierarchy::SetTranslation(int node, const glm::vec3& translation)
+{
+	int position = this->positions[node];
+	if (this->translations[position] != translation) {
+		this->translations[position] = translation;
+		MarkDirty(position);
+	}
+}
+
+void TransformHierarchy::SetRotation(int node, const glm::quat& rotation)
+{
+	int position = this->positions[node];
+	if (this->rotations[position] != rotation) {
+		this->rotations[position] = rotation;
+		MarkDirty(position);
+	}
+}
+
+void TransformHierarchy::SetScale(int node, const glm::vec3& scale)
+{
+	int position = this->positions[node];
+	if (this->scales[position] != scale) {
+		this->scales[position] = scale;
+		MarkDirty(position);
+	}
+}
+
+void TransformHierarchy::Invalidate()
+{
+	for (int i = 0; i < this->order.size(); i++) {
+		if (this->parents[i] == -1) {
+			MarkDirty(i);
+		}
+	}
+}
+
+void TransformHierarchy::MarkDirty(int position)
+{
+	if (!this->dirty[position]) {
+		this->dirty[position] = true;
+		this->dirty_positions.push_back(position);
+	}
+}
+
+void TransformHierarchy::CalculateGlobalTransform(int position, const AffineTransform& root)
+{
+	AffineTransform local = ComposeAffineTransform(this->translations[position], this->rotations[position], this->scales[position]);
+	const AffineTransform& parent = this->parents[position] == -1 ? root : this->global_transforms[this->parents[position]];
+	this->global_transforms[position] = MultiplyAffineTransforms(parent, local);
+}
+
+void TransformHierarchy::CalculateRange(int start, int end, const AffineTransform& root)
+{
+	for (int i = start; i < end; i++) {
+		CalculateGlobalTransform(i, root);
+	}
+}
+
+void TransformHierarchy::SplitSubtree(int start, const AffineTransform& root)
+{
+	// The root of a large subtree is calculated here, before any task reads it, and the subtrees of its children become tasks or are split again.
+	// Children are found by jumping from the end of one child's subtree to the start of the next.
+	this->split_stack.push_back(start);
+	while (!this->split_stack.empty()) {
+		int position = this->split_stack.back();
+		this->split_stack.pop_back();
+		int end = this->subtree_ends[position];
+		if (end - position <= TASK_SIZE) {
+			AddTask(position, end);
+			continue;
+		}
+		CalculateGlobalTransform(position, root);
+		for (int child = position + 1; child < end; child = this->subtree_ends[child]) {
+			if (this->subtree_ends[child] - child > TASK_SIZE) {
+				this->split_stack.push_back(child);
+			} else {
+				AddTask(child, this->subtree_ends[child]);
+			}
+		}
+	}
+}
+
+void TransformHierarchy::AddTask(int start, int end)
+{
+	// Neighbouring small subtrees share a task, as any run of whole subtrees can be calculated on its own.
+	if (!this->tasks.empty() && this->tasks.back().end == start && end - this->tasks.back().start <= TASK_SIZE) {
+		this->tasks.back().end = end;
+	} else {
+		this->tasks.push_back({start, end});
+	}
+}
+
+void TransformHierarchy::CalculateGlobalTransforms(const glm::mat4x4& root_transform, ThreadPool* thread_pool)
+{
+	ProfileZoneScoped();
+	// Subtrees that moved last time are still now, unless they are recalculated again below.
+	for (int start: this->moved_subtrees) {
+		int end = this->subtree_ends[start];
+		std::copy(this->global_transforms.begin() + start, this->global_transforms.begin() + end, this->previous_global_transforms.begin() + start);
+	}
+	this->moved_subtrees.clear();
+	if (root_transform != this->root_transform) {
+		this->root_transform = root_transform;
+		Invalidate();
+	}
+
+	// Positions are visited in order, so a dirty node inside a subtree that has already been recalculated is skipped.
+	std::sort(this->dirty_positions.begin(), this->dirty_positions.end());
+	AffineTransform root = ToAffineTransform(root_transform);
+	int end = 0;
+	int dirty_count = 0;
+	for (int start: this->dirty_positions) {
+		this->dirty[start] = false;
+		if (start < end) {
+			continue;
+		}
+		end = this->subtree_ends[start];
+		dirty_count += end - start;
+		this->moved_subtrees.push_back(start);
+		std::copy(this->global_transforms.begin() + start, this->global_transforms.begin() + end, this->previous_global_transforms.begin() + start);
+	}
+	this->dirty_positions.clear();
+
+	if (!thread_pool || dirty_count <= TASK_SIZE) {
+		for (int start: this->moved_subtrees) {
+			CalculateRange(start, this->subtree_ends[start], root);
+		}
+		return;
+	}
+	// Tasks never overlap and only read parents that are already calculated or inside the task, so they can run in any order.
+	this->tasks.clear();
+	for (int start: this->moved_subtrees) {
+		SplitSubtree(start, root);
+	}
+	thread_pool->ParallelFor(this->tasks.size(), [&](int i) {
+		CalculateRange(this->tasks[i].start, this->tasks[i].end, root);
+	});
+}
+
+glm::mat4x4 TransformHierarchy::GetGlobalTransform(int node) const
+{
+	return ToMatrix(this->global_transforms[this->positions[node]]);
+}
+
+glm::mat4x4 TransformHierarchy::GetPreviousGlobalTransform(int node) const
+{
+	return ToMatrix(this->previous_global_transforms[this->positions[node]]);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+class ThreadPool;
+
+// The top three rows of an affine 4x4 matrix, stored by row. The bottom row is always 0, 0, 0, 1.
+struct alignas(16) AffineTransform {
+    glm::vec4 rows[3];
+};
+
+AffineTransform ToAffineTransform(const glm::mat4x4& matrix);
+glm::mat4x4 ToMatrix(const AffineTransform& transform);
+// Same as glm::translate(translation) * glm::mat4_cast(rotation) * glm::scale(scale), without building the three matrices.
+AffineTransform ComposeAffineTransform(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+// Same as a * b for the equivalent 4x4 matrices.
+AffineTransform MultiplyAffineTransforms(const AffineTransform& a, const AffineTransform& b);
+
+// Node transforms flattened into arrays in depth first order, so every parent comes before its children and each subtree is contiguous.
+// Children are in the order they are linked, so walking a subtree's positions visits nodes in the same order as recursing through it.
+// Global transforms are calculated in one pass over the arrays instead of recursing through the nodes.
+// Only the subtrees of nodes whose local transform changed are recalculated, so a scene where nothing moves costs next to nothing.
+// Every array apart from positions is indexed by position in the order, not by node.
+class TransformHierarchy {
+    public:
+
+    std::vector<int> order; // Node at each position.
+    std::vector<int> positions; // Position of each node.
+    std::vector<int> parents; // Position of the parent, which is always lower, or -1 for a root.
+    std::vector<int> subtree_ends; // One past the last position in the subtree of each position.
+    // Local transforms. Change them with the setters so that the change is tracked, or call Invalidate after writing to them directly.
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<AffineTransform> global_transforms;
+    std::vector<AffineTransform> previous_global_transforms; // Global transforms before the last call to CalculateGlobalTransforms.
+
+    // Orders the nodes using first child and next sibling links, which are -1 where there is none.
+    // A node that can be reached more than once is only placed the first time, and nodes that can't be reached from a root become roots, so any links give a valid order.
+    void Build(const std::vector<int>& children, const std::vector<int>& siblings);
+    void Clear();
+    void SetTranslation(int node, const glm::vec3& translation);
+    void SetRotation(int node, const glm::quat& rotation);
+    void SetScale(int node, const glm::vec3& scale);
+    // Recalculates every global transform on the next call to CalculateGlobalTransforms.
+    void Invalidate();
+    // Roots are relative to root_transform. The global transforms from the previous call are kept for motion vectors.
+    // With a thread pool, large subtrees are split into independent subtrees that are calculated in parallel. Every node is calculated the same way either way, so the results are identical.
+    void CalculateGlobalTransforms(const glm::mat4x4& root_transform, ThreadPool* thread_pool = nullptr);
+    glm::mat4x4 GetGlobalTransform(int node) const;
+    glm::mat4x4 GetPreviousGlobalTransform(int node) const;
+
+    private:
+
+    std::vector<bool> dirty;
+    std::vector<int> dirty_positions;
+    std::vector<int> moved_subtrees; // Subtrees recalculated by the last call, whose previous transforms differ from their global transforms.
+    glm::mat4x4 root_transform = glm::mat4x4(1.0f);
+    struct Range {
+        int start;
+        int end;
+    };
+    std::vector<Range> tasks; // Runs of whole subtrees calculated in parallel.
+    std::vector<int> split_stack;
+
+    void MarkDirty(int position);
+    void CalculateGlobalTransform(int position, const AffineTransform& root);
+    void CalculateRange(int start, int end, const AffineTransform& root);
+    void SplitSubtree(int start, const AffineTransform& root);
+    void AddTask(int start, int end);
+};
@@ -1,5 +1,6 @@
 #include "UploadBuffer.h"
 #include "DirectXHelpers.h"
+#include "Memory.h"
 
 #include <cassert>
 #include <vector>
@@ -151,6 +152,12 @@ uint64_t UploadBuffer::Submit()
 	return this->submission_count;
 }
 
+bool UploadBuffer::IsSubmissionComplete(uint64_t submission)
+{
+	assert(submission <= this->submission_count);
+	return upload_fence->GetCompletedValue() >= submission;
+}
+
 void UploadBuffer::WaitForSubmissionToComplete(uint64_t submission)
 {
 	ProfileZoneScoped();
@@ -188,9 +195,16 @@ void* UploadBuffer::QueueTextureUpload(DXGI_FORMAT format, uint32_t width, uint3
 	ProfileZoneScoped();
     HRESULT result = S_OK;
 
+	// Block compressed footprints have to be a whole number of blocks, even for levels smaller than a block.
+	uint32_t block_width = D3D12_PROPERTY_LAYOUT_FORMAT_TABLE::GetWidthAlignment(format);
+	uint32_t block_height = D3D12_PROPERTY_LAYOUT_FORMAT_TABLE::GetHeightAlignment(format);
+	width = AlignPowerOfTwo(width, block_width);
+	height = AlignPowerOfTwo(height, block_height);
 	result = D3D12_PROPERTY_LAYOUT_FORMAT_TABLE::CalculateMinimumRowMajorRowPitch(format, width, *row_pitch);
 	assert(result == S_OK);
-	uint64_t allocation_size = (*row_pitch) * height * depth;
+	// Copies from a buffer need an aligned pitch, which small mip levels don't have.
+	*row_pitch = (*row_pitch + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1);
+	uint64_t allocation_size = (*row_pitch) * (height / block_height) * depth;
 	uint64_t offset = Allocate(allocation_size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
 	void* pointer = GetCpuAddress(offset);
 
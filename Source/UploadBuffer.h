@@ -14,8 +14,10 @@ class UploadBuffer {
     void Create(ID3D12Device* device, GpuAllocator* allocator, size_t capacity, D3D12_COMMAND_QUEUE_PRIORITY command_queue_priority, int max_queued_uploads);
     void Begin();
     void* QueueBufferUpload(uint64_t size, ID3D12Resource* destination_resource, uint64_t destination_offset);
+    // Returns where to write the texels, one row every row_pitch bytes. Block compressed formats have a row of blocks per row.
     void* QueueTextureUpload(DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t depth, ID3D12Resource* destination_resource, int destination_subresource_index, uint32_t* row_pitch);
     uint64_t Submit();
+    bool IsSubmissionComplete(uint64_t submission);
     void WaitForSubmissionToComplete(uint64_t submission);
     void WaitForAllSubmissionsToComplete();
     
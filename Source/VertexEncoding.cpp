@@ -0,0 +1,338 @@
+#include "VertexEncoding.h"
+
+#include <cmath>
+#include <cstdint>
+
+#include <glm/gtc/constants.hpp>
+
+#include "Profiling.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VERTEX_ENCODING_SSE2
+#include <emmintrin.h>
+#endif
+
+static glm::vec2 EncodeOctahedralMap(glm::vec3 normal)
+{
+	// Project onto the octahedron.
+	glm::vec3 octahedral = normal / (glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z));
+	// Flatten onto square with coordinates in range [-1, 1].
+	glm::vec2 result;
+	if (octahedral.z >= 0.f) {
+		result = glm::vec2(octahedral.x, octahedral.y);
+	} else {
+		result.x = (octahedral.x >= 0.f ? 1.f : -1.f) * (1.f - glm::abs(octahedral.y));
+		result.y = (octahedral.y >= 0.f ? 1.f : -1.f) * (1.f - glm::abs(octahedral.x));
+	}
+	return result;
+}
+
+static glm::vec3 DecodeOctahedralMap(glm::vec2 encoded)
+{
+	glm::vec3 result;
+	// Find point on octahedron.
+	result.z = 1. - glm::abs(encoded.x) - glm::abs(encoded.y);
+	if (result.z >= 0.) {
+		result.x = encoded.x;
+		result.y = encoded.y;
+	} else {
+		result.x = (encoded.x >= 0.f ? 1.f : -1.f) * (1.f - glm::abs(encoded.y));
+		result.y = (encoded.y >= 0.f ? 1.f : -1.f) * (1.f - glm::abs(encoded.x));
+	}
+	// Project onto sphere.
+	result = glm::normalize(result);
+	return result;
+}
+
+// From the paper "Building an Orthonormal Basis, Revisited".
+static void CreateBasis(glm::vec3 normal, glm::vec3* tangent, glm::vec3* bitangent)
+{
+	const float sign = normal.z >= 0.0f ? 1.0f : -1.0f;
+	const float a = -1.0f / (sign + normal.z);
+	const float b = normal.x * normal.y * a;
+	*tangent = glm::vec3(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+	*bitangent = glm::vec3(b, sign + normal.y * normal.y * a, -normal.y);
+}
+
+uint32_t EncodeNormal(glm::vec3 normal)
+{
+    // Encode normal.
+    glm::vec2 encoded_normal = 0.5f * EncodeOctahedralMap(normal) + 0.5f;
+	glm::u32vec2 quantized_normal = glm::clamp(encoded_normal, 0.0f, 1.0f) * 1023.0f + 0.5f;
+
+    // Encode winding.
+    uint32_t quantized_winding = 3;
+
+    return quantized_normal.x | (quantized_normal.y << 10) | (quantized_winding << 30);
+}
+
+uint32_t EncodeTangentSpace(glm::vec3 normal, glm::vec4 tangent)
+{
+    // Encode and quantize normal.
+    glm::vec2 encoded_normal = 0.5f * EncodeOctahedralMap(normal) + 0.5f;
+	glm::u32vec2 quantized_normal = glm::clamp(encoded_normal, 0.0f, 1.0f) * 1023.0f + 0.5f;
+
+	// Decode normal to use in basis calculation.
+	// This is to prevent numerical issues due to quantization.
+	glm::vec2 unpacked_encoded_normal = glm::vec2(quantized_normal) / 1023.0f;
+	normal = DecodeOctahedralMap(2.0f * unpacked_encoded_normal - 1.0f);
+
+    // Encode tangent.
+    glm::vec3 canonical_tangent;
+    glm::vec3 canonical_bitangent;
+    CreateBasis(normal, &canonical_tangent, &canonical_bitangent);
+    float angle = std::atan2(glm::dot(glm::vec3(tangent), canonical_bitangent), glm::dot(glm::vec3(tangent), canonical_tangent));
+    float encoded_tangent = (angle / glm::two_pi<float>()) + 0.5f;
+	uint32_t quantized_tangent = glm::clamp(encoded_tangent, 0.0f, 1.0f) * 1023.0f + 0.5f;
+
+    // Encode winding.
+    uint32_t quantized_winding = tangent.w == 1.0f ? 3 : 0;
+
+    return quantized_normal.x | (quantized_normal.y << 10) | (quantized_tangent << 20) | (quantized_winding << 30);
+}
+
+#ifdef VERTEX_ENCODING_SSE2
+
+// The SSE versions perform exactly the same sequence of IEEE operations as the scalar versions above, four vertices at a time.
+// Any change to the scalar versions must be mirrored here.
+
+static inline __m128 Abs(__m128 v)
+{
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+}
+
+static inline __m128 Negate(__m128 v)
+{
+	return _mm_xor_ps(_mm_set1_ps(-0.0f), v);
+}
+
+static inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Equivalent of (v >= 0.f ? 1.f : -1.f).
+static inline __m128 Sign(__m128 v)
+{
+	return Select(_mm_cmpge_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f), _mm_set1_ps(-1.0f));
+}
+
+// Equivalent of glm::clamp(v, 0.0f, 1.0f), which is min(max(v, 0), 1) with glm's comparison order.
+static inline __m128 Clamp01(__m128 v)
+{
+	v = Select(_mm_cmplt_ps(v, _mm_setzero_ps()), _mm_setzero_ps(), v);
+	return Select(_mm_cmplt_ps(_mm_set1_ps(1.0f), v), _mm_set1_ps(1.0f), v);
+}
+
+// Equivalent of (uint32_t)(glm::clamp(v, 0.0f, 1.0f) * 1023.0f + 0.5f).
+static inline __m128i Quantize(__m128 v)
+{
+	return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(Clamp01(v), _mm_set1_ps(1023.0f)), _mm_set1_ps(0.5f)));
+}
+
+// True for lanes that are neither infinite nor NaN.
+static inline __m128 IsFinite(__m128 v)
+{
+	return _mm_cmpeq_ps(_mm_sub_ps(v, v), _mm_setzero_ps());
+}
+
+// Loads 4 tightly packed xyz vectors and transposes them.
+static inline void Load3(const float* data, __m128* x, __m128* y, __m128* z)
+{
+	__m128 a = _mm_loadu_ps(data); // x0 y0 z0 x1
+	__m128 b = _mm_loadu_ps(data + 4); // y1 z1 x2 y2
+	__m128 c = _mm_loadu_ps(data + 8); // z2 x3 y3 z3
+	__m128 b2c1 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+	*x = _mm_shuffle_ps(a, b2c1, _MM_SHUFFLE(2, 0, 3, 0));
+	__m128 a1b0 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+	__m128 b3c2 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+	*y = _mm_shuffle_ps(a1b0, b3c2, _MM_SHUFFLE(2, 0, 2, 0));
+	__m128 a2b1 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+	*z = _mm_shuffle_ps(a2b1, c, _MM_SHUFFLE(3, 0, 2, 0));
+}
+
+// Loads 4 tightly packed xyzw vectors and transposes them.
+static inline void Load4(const float* data, __m128* x, __m128* y, __m128* z, __m128* w)
+{
+	__m128 a = _mm_loadu_ps(data);
+	__m128 b = _mm_loadu_ps(data + 4);
+	__m128 c = _mm_loadu_ps(data + 8);
+	__m128 d = _mm_loadu_ps(data + 12);
+	_MM_TRANSPOSE4_PS(a, b, c, d);
+	*x = a;
+	*y = b;
+	*z = c;
+	*w = d;
+}
+
+// Octahedral encode and quantize. Returns the quantized x and y, and a mask of lanes where the normal was degenerate.
+static inline void EncodeOctahedralMapQuantized(__m128 x, __m128 y, __m128 z, __m128i* quantized_x, __m128i* quantized_y, __m128* invalid)
+{
+	__m128 denominator = _mm_add_ps(_mm_add_ps(Abs(x), Abs(y)), Abs(z));
+	*invalid = _mm_or_ps(_mm_cmpeq_ps(denominator, _mm_setzero_ps()), _mm_xor_ps(IsFinite(denominator), _mm_castsi128_ps(_mm_set1_epi32(-1))));
+	__m128 octahedral_x = _mm_div_ps(x, denominator);
+	__m128 octahedral_y = _mm_div_ps(y, denominator);
+	__m128 octahedral_z = _mm_div_ps(z, denominator);
+	__m128 upper = _mm_cmpge_ps(octahedral_z, _mm_setzero_ps());
+	__m128 folded_x = _mm_mul_ps(Sign(octahedral_x), _mm_sub_ps(_mm_set1_ps(1.0f), Abs(octahedral_y)));
+	__m128 folded_y = _mm_mul_ps(Sign(octahedral_y), _mm_sub_ps(_mm_set1_ps(1.0f), Abs(octahedral_x)));
+	__m128 encoded_x = Select(upper, octahedral_x, folded_x);
+	__m128 encoded_y = Select(upper, octahedral_y, folded_y);
+	*quantized_x = Quantize(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.5f), encoded_x), _mm_set1_ps(0.5f)));
+	*quantized_y = Quantize(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.5f), encoded_y), _mm_set1_ps(0.5f)));
+}
+
+// Computes 1.0 - a - b in double precision and rounds the result to float, as the scalar decode does.
+static inline __m128 OneMinusDouble(__m128 a, __m128 b)
+{
+	__m128d one = _mm_set1_pd(1.0);
+	__m128d low = _mm_sub_pd(_mm_sub_pd(one, _mm_cvtps_pd(a)), _mm_cvtps_pd(b));
+	__m128d high = _mm_sub_pd(_mm_sub_pd(one, _mm_cvtps_pd(_mm_movehl_ps(a, a))), _mm_cvtps_pd(_mm_movehl_ps(b, b)));
+	return _mm_movelh_ps(_mm_cvtpd_ps(low), _mm_cvtpd_ps(high));
+}
+
+// Approximate atan2 with a maximum error well below ATAN2_TOLERANCE.
+// Based on the Cephes atanf polynomial, with the input reduced to [0, tan(pi/8)].
+static inline __m128 Atan2Approximate(__m128 y, __m128 x)
+{
+	const __m128 pi = _mm_set1_ps(glm::pi<float>());
+	const __m128 half_pi = _mm_set1_ps(glm::half_pi<float>());
+	const __m128 quarter_pi = _mm_set1_ps(glm::quarter_pi<float>());
+	__m128 abs_x = Abs(x);
+	__m128 abs_y = Abs(y);
+	__m128 t = _mm_div_ps(_mm_min_ps(abs_x, abs_y), _mm_max_ps(abs_x, abs_y));
+	__m128 reduce = _mm_cmpgt_ps(t, _mm_set1_ps(0.4142135623730950f));
+	t = Select(reduce, _mm_div_ps(_mm_sub_ps(t, _mm_set1_ps(1.0f)), _mm_add_ps(t, _mm_set1_ps(1.0f))), t);
+	__m128 t2 = _mm_mul_ps(t, t);
+	__m128 p = _mm_set1_ps(8.05374449538e-2f);
+	p = _mm_sub_ps(_mm_mul_ps(p, t2), _mm_set1_ps(1.38776856032e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(1.99777106478e-1f));
+	p = _mm_sub_ps(_mm_mul_ps(p, t2), _mm_set1_ps(3.33329491539e-1f));
+	p = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, t2), t), t);
+	p = _mm_add_ps(p, _mm_and_ps(reduce, quarter_pi));
+	p = Select(_mm_cmpgt_ps(abs_y, abs_x), _mm_sub_ps(half_pi, p), p);
+	p = Select(_mm_cmplt_ps(x, _mm_setzero_ps()), _mm_sub_ps(pi, p), p);
+	p = Select(_mm_cmplt_ps(y, _mm_setzero_ps()), Negate(p), p);
+	return p;
+}
+
+// Equivalent of the scalar angle quantization.
+static inline __m128i QuantizeAngle(__m128 angle)
+{
+	return Quantize(_mm_add_ps(_mm_div_ps(angle, _mm_set1_ps(glm::two_pi<float>())), _mm_set1_ps(0.5f)));
+}
+
+// Bound on the difference between Atan2Approximate and std::atan2, including the error of std::atan2 itself.
+// The approximation is accurate to about 5e-7, so this leaves a wide margin.
+static constexpr float ATAN2_TOLERANCE = 1e-5f;
+
+#endif
+
+void EncodeNormalBatch(const float* normals, uint32_t* out, size_t count)
+{
+	ProfileZoneScoped();
+	size_t i = 0;
+#ifdef VERTEX_ENCODING_SSE2
+	const __m128i winding = _mm_set1_epi32((int)(3u << 30));
+	for (; i + 4 <= count; i += 4) {
+		__m128 x, y, z;
+		Load3(normals + 3 * i, &x, &y, &z);
+		__m128i quantized_x, quantized_y;
+		__m128 invalid;
+		EncodeOctahedralMapQuantized(x, y, z, &quantized_x, &quantized_y, &invalid);
+		__m128i result = _mm_or_si128(_mm_or_si128(quantized_x, _mm_slli_epi32(quantized_y, 10)), winding);
+		_mm_storeu_si128((__m128i*)(out + i), result);
+
+		// Degenerate normals give implementation defined float to integer conversions, so use the scalar path for them.
+		int invalid_mask = _mm_movemask_ps(invalid);
+		for (int j = 0; invalid_mask != 0; j++, invalid_mask >>= 1) {
+			if (invalid_mask & 1) {
+				const float* normal = normals + 3 * (i + j);
+				out[i + j] = EncodeNormal(glm::vec3(normal[0], normal[1], normal[2]));
+			}
+		}
+	}
+#endif
+	for (; i < count; i++) {
+		const float* normal = normals + 3 * i;
+		out[i] = EncodeNormal(glm::vec3(normal[0], normal[1], normal[2]));
+	}
+}
+
+void EncodeTangentSpaceBatch(const float* normals, const float* tangents, uint32_t* out, size_t count)
+{
+	ProfileZoneScoped();
+	size_t i = 0;
+#ifdef VERTEX_ENCODING_SSE2
+	const __m128 one = _mm_set1_ps(1.0f);
+	for (; i + 4 <= count; i += 4) {
+		__m128 normal_x, normal_y, normal_z;
+		Load3(normals + 3 * i, &normal_x, &normal_y, &normal_z);
+		__m128 tangent_x, tangent_y, tangent_z, tangent_w;
+		Load4(tangents + 4 * i, &tangent_x, &tangent_y, &tangent_z, &tangent_w);
+
+		// Encode and quantize normal.
+		__m128i quantized_x, quantized_y;
+		__m128 invalid;
+		EncodeOctahedralMapQuantized(normal_x, normal_y, normal_z, &quantized_x, &quantized_y, &invalid);
+
+		// Decode normal to use in basis calculation.
+		__m128 encoded_x = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(2.0f), _mm_div_ps(_mm_cvtepi32_ps(quantized_x), _mm_set1_ps(1023.0f))), one);
+		__m128 encoded_y = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(2.0f), _mm_div_ps(_mm_cvtepi32_ps(quantized_y), _mm_set1_ps(1023.0f))), one);
+		__m128 decoded_z = OneMinusDouble(Abs(encoded_x), Abs(encoded_y));
+		__m128 upper = _mm_cmpge_ps(decoded_z, _mm_setzero_ps());
+		__m128 decoded_x = Select(upper, encoded_x, _mm_mul_ps(Sign(encoded_x), _mm_sub_ps(one, Abs(encoded_y))));
+		__m128 decoded_y = Select(upper, encoded_y, _mm_mul_ps(Sign(encoded_y), _mm_sub_ps(one, Abs(encoded_x))));
+		__m128 length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(decoded_x, decoded_x), _mm_mul_ps(decoded_y, decoded_y)), _mm_mul_ps(decoded_z, decoded_z));
+		__m128 inverse_length = _mm_div_ps(one, _mm_sqrt_ps(length_squared));
+		__m128 n_x = _mm_mul_ps(decoded_x, inverse_length);
+		__m128 n_y = _mm_mul_ps(decoded_y, inverse_length);
+		__m128 n_z = _mm_mul_ps(decoded_z, inverse_length);
+
+		// Create basis.
+		__m128 sign = Sign(n_z);
+		__m128 a = _mm_div_ps(_mm_set1_ps(-1.0f), _mm_add_ps(sign, n_z));
+		__m128 b = _mm_mul_ps(_mm_mul_ps(n_x, n_y), a);
+		__m128 canonical_tangent_x = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(sign, n_x), n_x), a));
+		__m128 canonical_tangent_y = _mm_mul_ps(sign, b);
+		__m128 canonical_tangent_z = _mm_mul_ps(Negate(sign), n_x);
+		__m128 canonical_bitangent_x = b;
+		__m128 canonical_bitangent_y = _mm_add_ps(sign, _mm_mul_ps(_mm_mul_ps(n_y, n_y), a));
+		__m128 canonical_bitangent_z = Negate(n_y);
+
+		// Encode tangent.
+		__m128 dot_bitangent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tangent_x, canonical_bitangent_x), _mm_mul_ps(tangent_y, canonical_bitangent_y)), _mm_mul_ps(tangent_z, canonical_bitangent_z));
+		__m128 dot_tangent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tangent_x, canonical_tangent_x), _mm_mul_ps(tangent_y, canonical_tangent_y)), _mm_mul_ps(tangent_z, canonical_tangent_z));
+		__m128 angle = Atan2Approximate(dot_bitangent, dot_tangent);
+
+		// The approximate angle is only used if the quantized result is the same anywhere within the error bound.
+		// Otherwise the lane falls back to the scalar path, which keeps the output bit identical.
+		__m128 tolerance = _mm_set1_ps(ATAN2_TOLERANCE);
+		__m128i quantized_tangent = QuantizeAngle(_mm_sub_ps(angle, tolerance));
+		__m128i quantized_tangent_upper = QuantizeAngle(_mm_add_ps(angle, tolerance));
+		invalid = _mm_or_ps(invalid, _mm_castsi128_ps(_mm_xor_si128(_mm_cmpeq_epi32(quantized_tangent, quantized_tangent_upper), _mm_set1_epi32(-1))));
+		invalid = _mm_or_ps(invalid, _mm_xor_ps(_mm_and_ps(IsFinite(dot_bitangent), IsFinite(dot_tangent)), _mm_castsi128_ps(_mm_set1_epi32(-1))));
+		invalid = _mm_or_ps(invalid, _mm_cmpeq_ps(_mm_max_ps(Abs(dot_bitangent), Abs(dot_tangent)), _mm_setzero_ps()));
+
+		// Encode winding.
+		__m128i winding = _mm_and_si128(_mm_castps_si128(_mm_cmpeq_ps(tangent_w, one)), _mm_set1_epi32((int)(3u << 30)));
+
+		__m128i result = _mm_or_si128(_mm_or_si128(quantized_x, _mm_slli_epi32(quantized_y, 10)), _mm_or_si128(_mm_slli_epi32(quantized_tangent, 20), winding));
+		_mm_storeu_si128((__m128i*)(out + i), result);
+
+		int invalid_mask = _mm_movemask_ps(invalid);
+		for (int j = 0; invalid_mask != 0; j++, invalid_mask >>= 1) {
+			if (invalid_mask & 1) {
+				const float* normal = normals + 3 * (i + j);
+				const float* tangent = tangents + 4 * (i + j);
+				out[i + j] = EncodeTangentSpace(glm::vec3(normal[0], normal[1], normal[2]), glm::vec4(tangent[0], tangent[1], tangent[2], tangent[3]));
+			}
+		}
+	}
+#endif
+	for (; i < count; i++) {
+		const float* normal = normals + 3 * i;
+		const float* tangent = tangents + 4 * i;
+		out[i] = EncodeTangentSpace(glm::vec3(normal[0], normal[1], normal[2]), glm::vec4(tangent[0], tangent[1], tangent[2], tangent[3]));
+	}
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Encodes a normal into R10G10B10A2 with an octahedral map. The tangent bits are left as zero.
+uint32_t EncodeNormal(glm::vec3 normal);
+// Encodes a normal and tangent into R10G10B10A2. The tangent is stored as an angle around the normal and the bitangent sign as the winding.
+uint32_t EncodeTangentSpace(glm::vec3 normal, glm::vec4 tangent);
+
+// Batch versions of the above. Normals are tightly packed xyz and tangents are tightly packed xyzw.
+// Results are bit identical to calling the scalar versions for each vertex.
+void EncodeNormalBatch(const float* normals, uint32_t* out, size_t count);
+void EncodeTangentSpaceBatch(const float* normals, const float* tangents, uint32_t* out, size_t count);
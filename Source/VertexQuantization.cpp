@@ -0,0 +1,126 @@
+#include "VertexQuantization.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Profiling.h"
+
+glm::mat4x4 VertexDequantization::GetPositionTransform() const
+{
+	glm::mat4x4 transform = glm::mat4x4(1.0f);
+	transform[0][0] = this->position_scale.x;
+	transform[1][1] = this->position_scale.y;
+	transform[2][2] = this->position_scale.z;
+	transform[3] = glm::vec4(this->position_offset, 1.0f);
+	return transform;
+}
+
+QuantizationStats& QuantizationStats::operator+=(const QuantizationStats& other)
+{
+	this->position_error = std::max(this->position_error, other.position_error);
+	this->texcoord_error = std::max(this->texcoord_error, other.texcoord_error);
+	this->color_error = std::max(this->color_error, other.color_error);
+	this->vertex_bytes_before += other.vertex_bytes_before;
+	this->vertex_bytes_after += other.vertex_bytes_after;
+	return *this;
+}
+
+float QuantizePositions(const glm::vec3* positions, size_t count, glm::i16vec4* out, glm::vec3* scale, glm::vec3* offset)
+{
+	ProfileZoneScoped();
+	if (count == 0) {
+		*scale = glm::vec3(1.0f);
+		*offset = glm::vec3(0.0f);
+		return 0.0f;
+	}
+	glm::vec3 minimum = positions[0];
+	glm::vec3 maximum = positions[0];
+	for (size_t i = 1; i < count; i++) {
+		minimum = glm::min(minimum, positions[i]);
+		maximum = glm::max(maximum, positions[i]);
+	}
+	*offset = (minimum + maximum) * 0.5f;
+	*scale = (maximum - minimum) * 0.5f;
+
+	// -32768 is left unused, as it decodes to -1 just like -32767.
+	glm::vec3 inverse_scale;
+	for (int i = 0; i < 3; i++) {
+		inverse_scale[i] = (*scale)[i] > 0.0f ? 32767.0f / (*scale)[i] : 0.0f;
+	}
+	float error = 0.0f;
+	for (size_t i = 0; i < count; i++) {
+		glm::vec3 quantized = glm::clamp(glm::round((positions[i] - *offset) * inverse_scale), -32767.0f, 32767.0f);
+		out[i] = glm::i16vec4(glm::i16vec3(quantized), 0);
+		glm::vec3 decoded = quantized / 32767.0f * *scale + *offset;
+		glm::vec3 difference = glm::abs(decoded - positions[i]);
+		error = std::max({error, difference.x, difference.y, difference.z});
+	}
+	float extent = 2.0f * std::max({scale->x, scale->y, scale->z});
+	return extent > 0.0f ? error / extent : 0.0f;
+}
+
+float QuantizeTexcoords(const glm::vec2* texcoords, size_t count, glm::u16vec2* out, glm::vec4* transform)
+{
+	ProfileZoneScoped();
+	if (count == 0) {
+		*transform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+		return 0.0f;
+	}
+	glm::vec2 minimum = texcoords[0];
+	glm::vec2 maximum = texcoords[0];
+	for (size_t i = 1; i < count; i++) {
+		minimum = glm::min(minimum, texcoords[i]);
+		maximum = glm::max(maximum, texcoords[i]);
+	}
+	glm::vec2 scale = maximum - minimum;
+	*transform = glm::vec4(scale, minimum);
+
+	glm::vec2 inverse_scale;
+	for (int i = 0; i < 2; i++) {
+		inverse_scale[i] = scale[i] > 0.0f ? 65535.0f / scale[i] : 0.0f;
+	}
+	float error = 0.0f;
+	for (size_t i = 0; i < count; i++) {
+		glm::vec2 quantized = glm::clamp(glm::round((texcoords[i] - minimum) * inverse_scale), 0.0f, 65535.0f);
+		out[i] = glm::u16vec2(quantized);
+		glm::vec2 decoded = quantized / 65535.0f * scale + minimum;
+		glm::vec2 difference = glm::abs(decoded - texcoords[i]);
+		error = std::max({error, difference.x, difference.y});
+	}
+	return error;
+}
+
+float QuantizeColors(const glm::u16vec4* colors, size_t count, glm::u8vec4* out)
+{
+	ProfileZoneScoped();
+	int error = 0;
+	for (size_t i = 0; i < count; i++) {
+		for (int j = 0; j < 4; j++) {
+			// 65535 / 255 = 257, so this rounds to the nearest 8 bit value.
+			int quantized = (colors[i][j] + 128) / 257;
+			out[i][j] = (uint8_t)quantized;
+			error = std::max(error, std::abs(quantized * 257 - colors[i][j]));
+		}
+	}
+	return error / 65535.0f;
+}
+
+void DequantizePositions(const glm::i16vec4* positions, size_t count, glm::vec3 scale, glm::vec3 offset, glm::vec3* out)
+{
+	ProfileZoneScoped();
+	for (size_t i = 0; i < count; i++) {
+		// Matches how the GPU decodes SNORM, which clamps -32768 to -1.
+		glm::vec3 normalized = glm::max(glm::vec3(positions[i]) / 32767.0f, glm::vec3(-1.0f));
+		out[i] = normalized * scale + offset;
+	}
+}
+
+void DequantizeTexcoords(const glm::u16vec2* texcoords, size_t count, glm::vec4 transform, glm::vec2* out)
+{
+	ProfileZoneScoped();
+	glm::vec2 scale = glm::vec2(transform.x, transform.y);
+	glm::vec2 offset = glm::vec2(transform.z, transform.w);
+	for (size_t i = 0; i < count; i++) {
+		out[i] = glm::vec2(texcoords[i]) / 65535.0f * scale + offset;
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Quantization of vertex streams into smaller formats.
+// Positions and texture coordinates are stored relative to their bounding box, so they need to be dequantized with a scale and offset.
+
+// Dequantized value = quantized value * scale + offset.
+struct VertexDequantization {
+    glm::vec3 position_scale = glm::vec3(1.0f);
+    glm::vec3 position_offset = glm::vec3(0.0f);
+    glm::vec4 texcoord_transforms[2] = {glm::vec4(1.0f, 1.0f, 0.0f, 0.0f), glm::vec4(1.0f, 1.0f, 0.0f, 0.0f)}; // Scale in xy, offset in zw.
+
+    // Transform from quantized positions to the original object space.
+    glm::mat4x4 GetPositionTransform() const;
+};
+
+struct QuantizationStats {
+    // Largest difference between an original and a dequantized value.
+    float position_error = 0.0f; // Relative to the largest dimension of the bounding box.
+    float texcoord_error = 0.0f;
+    float color_error = 0.0f;
+    uint64_t vertex_bytes_before = 0;
+    uint64_t vertex_bytes_after = 0;
+
+    QuantizationStats& operator+=(const QuantizationStats& other);
+};
+
+// Positions become R16G16B16A16_SNORM, from -1 to 1 across the bounding box. The w component is zero.
+// Returns the largest error relative to the largest dimension of the bounding box.
+float QuantizePositions(const glm::vec3* positions, size_t count, glm::i16vec4* out, glm::vec3* scale, glm::vec3* offset);
+// Texture coordinates become R16G16_UNORM, from 0 to 1 across their bounding box. Returns the largest error.
+float QuantizeTexcoords(const glm::vec2* texcoords, size_t count, glm::u16vec2* out, glm::vec4* transform);
+// Colors go from R16G16B16A16_UNORM to R8G8B8A8_UNORM. Returns the largest error.
+float QuantizeColors(const glm::u16vec4* colors, size_t count, glm::u8vec4* out);
+
+// Decode quantized streams back to floats, for processing that needs them on the CPU.
+void DequantizePositions(const glm::i16vec4* positions, size_t count, glm::vec3 scale, glm::vec3 offset, glm::vec3* out);
+void DequantizeTexcoords(const glm::u16vec2* texcoords, size_t count, glm::vec4 transform, glm::vec2* out);